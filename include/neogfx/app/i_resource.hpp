@@ -21,6 +21,8 @@
 
 #include <neogfx/neogfx.hpp>
 
+#include <span>
+
 #include <neogfx/core/i_event.hpp>
 
 namespace neogfx
@@ -55,5 +57,13 @@ namespace neogfx
         virtual void* data() = 0;
         virtual std::size_t size() const = 0;
         virtual hash_digest_type const& hash() const = 0;
+    public:
+        // cdata() and size() as a span (empty if there is no data), valid for the lifetime of the resource
+        std::span<std::uint8_t const> bytes() const
+        {
+            if (is_empty())
+                return {};
+            return { static_cast<std::uint8_t const*>(cdata()), size() };
+        }
     };
 }
\ No newline at end of file
@@ -24,6 +24,7 @@
 #include <optional>
 
 #include <neogfx/core/event.hpp>
+#include <neogfx/core/mapped_file.hpp>
 #include <neogfx/app/i_resource.hpp>
 #include <neogfx/app/i_resource_manager.hpp>
 
@@ -39,8 +40,10 @@ namespace neogfx
         typedef data_type hash_digest_type;
     public:
         resource() = delete;
+        // an asset file, memory mapped if possible; archive entries ("...#entry") are extracted by resource_manager
         resource(i_resource_manager& aManager, std::string const& aUri);
         resource(i_resource_manager& aManager, std::string const& aUri, const void* aData, std::size_t aSize);
+        resource(i_resource_manager& aManager, std::string const& aUri, data_type::std_type&& aData);
         ~resource();
     public:
         bool available() const override;
@@ -56,12 +59,16 @@ namespace neogfx
         void* data() override;
         std::size_t size() const override;
         hash_digest_type const& hash() const override;
+    private:
+        void read(std::string const& aPath);
     private:
         i_resource_manager& iManager;
         string iUri;
         std::optional<string> iError;
         std::size_t iSize;
         data_type iData;
+        std::optional<mapped_file> iFile; // the data until writable access is wanted, then kept for earlier pointers
+        bool iCopied = false;
         mutable std::optional<data_type> iHash;
     };
 }
\ No newline at end of file
@@ -0,0 +1,85 @@
+// resource_archive.hpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2024 Leigh Johnston.  All Rights Reserved.
+
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <neolib/file/zip.hpp>
+
+#include <neogfx/app/i_resource.hpp>
+
+namespace neogfx
+{
+    // A zip archive of resources (a file or an embedded .nrc) opened once: the entries are indexed by path when the
+    // archive is opened and an entry is only decompressed when it is extracted. Recently extracted entries are kept
+    // in a cache bounded by size, least recently used first out.
+    class resource_archive
+    {
+    public:
+        struct entry_not_found : std::runtime_error { entry_not_found(std::string const& aPath) : std::runtime_error{ "neogfx::resource_archive::entry_not_found: " + aPath } {} };
+    public:
+        typedef neolib::zip::buffer_type buffer_type;
+    public:
+        static constexpr std::size_t DefaultCacheCapacity = 8u * 1024u * 1024u;
+    private:
+        struct cached_entry
+        {
+            std::size_t index;
+            buffer_type data;
+        };
+        typedef std::list<cached_entry> cache;
+    public:
+        resource_archive(std::string const& aPath, std::size_t aCacheCapacity = DefaultCacheCapacity);
+        resource_archive(i_ref_ptr<i_resource> const& aArchive, std::size_t aCacheCapacity = DefaultCacheCapacity);
+        resource_archive(resource_archive const&) = delete;
+        resource_archive& operator=(resource_archive const&) = delete;
+    public:
+        std::size_t entry_count() const;
+        bool contains(std::string const& aPath) const;
+        // decompresses the entry, or copies it from the cache
+        void extract(std::string const& aPath, buffer_type& aOutput);
+    public:
+        std::size_t cache_capacity() const;
+        // zero disables the cache
+        void set_cache_capacity(std::size_t aCapacity);
+        std::size_t cache_size() const;
+        std::uint64_t cache_hits() const;
+        std::uint64_t cache_misses() const;
+    private:
+        void build_index();
+        void trim_cache();
+    private:
+        ref_ptr<i_resource> iArchive; // keeps an embedded archive's data alive
+        neolib::zip iZip;
+        std::unordered_map<std::string, std::size_t> iIndex;
+        mutable std::mutex iMutex;
+        std::size_t iCacheCapacity;
+        std::size_t iCacheSize = 0u;
+        cache iCache; // most recently used first
+        std::unordered_map<std::size_t, cache::iterator> iCacheIndex;
+        std::uint64_t iCacheHits = 0u;
+        std::uint64_t iCacheMisses = 0u;
+    };
+}
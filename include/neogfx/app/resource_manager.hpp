@@ -21,10 +21,13 @@
 
 #include <neogfx/neogfx.hpp>
 
+#include <memory>
+#include <unordered_map>
 #include <neolib/core/variant.hpp>
 #include <neolib/core/map.hpp>
 
 #include "i_resource_manager.hpp"
+#include "resource_archive.hpp"
 
 namespace neogfx
 {
@@ -48,8 +51,16 @@ namespace neogfx
     public:
         neolib::i_map<i_string, neolib::i_variant<i_ref_ptr<i_resource>, i_weak_ref_ptr<i_resource>>> const& resources() override;
         neolib::i_map<i_string, neolib::i_variant<i_ref_ptr<i_resource>, i_weak_ref_ptr<i_resource>>> const& resource_archives() override;
+    public:
+        // the archive part of a "file://path#entry" or ":/path#entry" URI; archives are opened on first use and
+        // kept until clean()
+        resource_archive& archive(std::string const& aArchiveUri);
+        std::size_t archive_cache_capacity() const;
+        void set_archive_cache_capacity(std::size_t aCapacity);
     private:
         neolib::map<string, neolib::variant<ref_ptr<i_resource>, weak_ref_ptr<i_resource>>> iResources;
         neolib::map<string, neolib::variant<ref_ptr<i_resource>, weak_ref_ptr<i_resource>>> iResourceArchives;
+        std::unordered_map<std::string, std::unique_ptr<resource_archive>> iArchives;
+        std::size_t iArchiveCacheCapacity;
     };
 }
\ No newline at end of file
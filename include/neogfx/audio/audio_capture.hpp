@@ -0,0 +1,60 @@
+// audio_capture.hpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2024 Leigh Johnston.  All Rights Reserved.
+
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+
+#include <atomic>
+
+#include <neogfx/core/spsc_queue.hpp>
+#include <neogfx/audio/audio_primitives.hpp>
+
+namespace neogfx
+{
+    // Captured interleaved F32 frames on their way from the audio thread to one consumer thread. write() only
+    // copies into a lock-free ring buffer; frames that do not fit are dropped and counted rather than waited for.
+    // Metering and analysis (audio_level_meter, audio_spectrum) are done by the consumer on what it reads.
+    class audio_capture
+    {
+    public:
+        // aCapacity defaults to half a second
+        audio_capture(audio_data_format const& aDataFormat, audio_frame_count aCapacity = 0ULL);
+    public:
+        audio_data_format const& data_format() const;
+        audio_frame_count capacity() const;
+    public:
+        // audio thread
+        void write(float const* aInput, audio_frame_count aFrameCount);
+    public:
+        // consumer thread
+        audio_frame_count available() const;
+        audio_frame_count read(float* aOutput, audio_frame_count aMaxFrames);
+    public:
+        // writes that did not fit and the frames they lost
+        std::uint64_t overruns() const;
+        std::uint64_t dropped_frames() const;
+    private:
+        audio_data_format iDataFormat;
+        std::size_t iChannels;
+        spsc_queue<float> iBuffer;
+        std::atomic<std::uint64_t> iOverruns;
+        std::atomic<std::uint64_t> iDroppedFrames;
+    };
+}
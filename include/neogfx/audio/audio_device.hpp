@@ -19,9 +19,13 @@
 
 #include <neogfx/neogfx.hpp>
 
+#include <optional>
+
 #include <neogfx/audio/i_audio.hpp>
 #include <neogfx/audio/i_audio_device.hpp>
 #include <neogfx/audio/i_audio_bitstream.hpp>
+#include <neogfx/audio/audio_mixer.hpp>
+#include <neogfx/audio/audio_capture.hpp>
 
 #pragma once
 
@@ -50,6 +54,9 @@ namespace neogfx
 
 	class audio_device : public reference_counted<i_audio_device>
 	{
+	public:
+		struct command_queue_full : std::runtime_error { command_queue_full() : std::runtime_error("neogfx::audio_device::command_queue_full") {} };
+		struct not_a_capture_device : std::logic_error { not_a_capture_device() : std::logic_error("neogfx::audio_device::not_a_capture_device") {} };
 	public:
 		audio_device(audio_context aContext, i_audio_device_info const& aDeviceInfo, audio_data_format const& aDataFormat);
 		~audio_device();
@@ -61,17 +68,17 @@ namespace neogfx
 		void stop() final;
 	public:
 		void play(i_audio_bitstream& aBitstream, std::chrono::duration<double> const& aDuration) final;
+	public:
+		audio_mixer const& mixer() const;
+		audio_mixer& mixer();
+		// Capture, Duplex and Loopback devices only
+		audio_capture& capture();
 	private:
-		mutable std::recursive_mutex iMutex;
 		audio_device_info iInfo;
 		audio_data_format iDataFormat;
 		audio_device_config iConfig;
 		audio_device_handle iHandle;
-		struct source
-		{
-			ref_ptr<i_audio_bitstream> bitstream; // todo: should be i_audio_bitstream
-			std::optional<std::chrono::steady_clock::time_point> expiryTime;
-		};
-		std::vector<source> iSources;
+		audio_mixer iMixer;
+		std::optional<audio_capture> iCapture;
 	};
 }
\ No newline at end of file
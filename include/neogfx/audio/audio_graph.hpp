@@ -0,0 +1,176 @@
+// audio_graph.hpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2024 Leigh Johnston.  All Rights Reserved.
+
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <neogfx/audio/audio_primitives.hpp>
+#include <neogfx/audio/i_audio_bitstream.hpp>
+#include <neogfx/audio/audio_bitstream.hpp>
+
+namespace neogfx
+{
+    typedef std::uint32_t audio_node_id;
+
+    // A processing step in an audio_graph. Nodes work on whole blocks of interleaved stereo frames so there is one
+    // virtual call per node per block, not per sample.
+    class audio_node
+    {
+        friend class audio_graph;
+    public:
+        audio_node(std::string const& aName);
+        virtual ~audio_node() = default;
+    public:
+        audio_node_id id() const;
+        std::string const& name() const;
+    public:
+        // called when the graph is prepared, which is where a node allocates what it needs for processing
+        virtual void prepare(audio_sample_rate aSampleRate, audio_frame_count aBlockSize);
+        virtual void reset();
+        // aInput is the sum of the outputs of the nodes connected to this one, nullptr if there are none
+        virtual void process(float const* aInput, float* aOutput, audio_frame_count aFrameCount) = 0;
+    private:
+        std::string iName;
+        audio_node_id iId = 0u;
+    };
+
+    struct audio_node_timing
+    {
+        std::chrono::nanoseconds last;
+        std::chrono::nanoseconds total;
+        std::uint64_t blocks;
+    };
+
+    // Nodes connected into a directed acyclic graph. prepare() sorts the nodes topologically, splits them into
+    // independent subgraphs and allocates every buffer into a snapshot that processing works from, so processing
+    // allocates nothing; process() does not prepare the graph itself. The outputs of nodes with no outgoing
+    // connections are summed, in a fixed order, into the graph's (stereo) output. When multithreaded the subgraphs
+    // of each block run in parallel on the thread pool, which queues tasks and waits on them, so that is for offline
+    // rendering only; audio_graph_bitstream always processes on the calling thread. The time each node takes is
+    // recorded for profiling.
+    // The graph is changed and prepared on a control thread while it plays: the audio thread only ever sees the
+    // snapshot published by the last prepare(), which it swaps to atomically at the start of a callback. Snapshots
+    // (and the nodes removed since) are released on the control thread by release_retired(), which prepare() also
+    // calls, once the audio thread has finished with them. Node parameters are atomics; reset() and
+    // set_multithreaded() are not synchronized with playback and a graph is played by one bitstream at a time.
+    class audio_graph
+    {
+        friend class audio_graph_bitstream;
+    public:
+        struct not_prepared : std::logic_error { not_prepared() : std::logic_error("neogfx::audio_graph::not_prepared") {} };
+        struct node_not_found : std::logic_error { node_not_found() : std::logic_error("neogfx::audio_graph::node_not_found") {} };
+        struct cycle_detected : std::logic_error { cycle_detected() : std::logic_error("neogfx::audio_graph::cycle_detected") {} };
+    private:
+        struct node_entry
+        {
+            std::unique_ptr<audio_node> node;
+            std::vector<audio_node_id> inputs;
+            std::vector<audio_node_id> outputs;
+            bool prepared = false;            // node->prepare() has been called, which is only done once
+            std::atomic<std::int64_t> lastNanoseconds = 0;
+            std::atomic<std::int64_t> totalNanoseconds = 0;
+            std::atomic<std::uint64_t> blocks = 0u;
+        };
+        struct prepared_node
+        {
+            std::shared_ptr<node_entry> entry; // keeps a removed node alive until the snapshot is released
+            std::vector<std::size_t> inputs;   // indices into the node's subgraph
+            std::vector<float> inputBuffer;    // only used by nodes with more than one input
+            std::vector<float> outputBuffer;
+        };
+        // the structure is fixed once published, only the buffers are written to while processing
+        struct prepared_graph
+        {
+            std::vector<std::vector<prepared_node>> subgraphs;          // each in topological order
+            std::vector<std::pair<std::size_t, std::size_t>> terminals; // (subgraph, node) whose output is the graph's output
+        };
+    public:
+        audio_graph(audio_sample_rate aSampleRate, audio_frame_count aBlockSize = 256u, bool aMultithreaded = false);
+        ~audio_graph();
+    public:
+        audio_sample_rate sample_rate() const;
+        audio_frame_count block_size() const;
+        bool multithreaded() const;
+        void set_multithreaded(bool aMultithreaded);
+    public:
+        audio_node& add(std::unique_ptr<audio_node> aNode);
+        template <typename Node, typename... Args>
+        Node& add(Args&&... aArgs)
+        {
+            return static_cast<Node&>(add(std::make_unique<Node>(std::forward<Args>(aArgs)...)));
+        }
+        void remove(audio_node const& aNode);
+        void connect(audio_node const& aFrom, audio_node const& aTo);
+        void disconnect(audio_node const& aFrom, audio_node const& aTo);
+        std::vector<audio_node*> nodes() const;
+    public:
+        // call after changing the graph and before processing (prepare() allocates); publishes a new snapshot
+        void prepare();
+        bool prepared() const;
+        // releases the snapshots the audio thread has finished with and returns how many there were
+        std::size_t release_retired();
+        void reset();
+        // writes aFrameCount interleaved stereo frames; throws not_prepared if the graph has changed since prepare()
+        void process(float* aOutput, audio_frame_count aFrameCount);
+    public:
+        audio_node_timing timing(audio_node const& aNode) const;
+        void reset_timings();
+    private:
+        node_entry& entry(audio_node const& aNode) const;
+        // audio thread; the snapshot to process, nullptr if the graph has never been prepared
+        prepared_graph* acquire_snapshot();
+        void release_snapshot();
+        void process(prepared_graph& aGraph, float* aOutput, audio_frame_count aFrameCount, bool aMultithreaded);
+        void process_block(prepared_graph& aGraph, float* aOutput, audio_frame_count aFrameCount, bool aMultithreaded);
+        void process_subgraph(std::vector<prepared_node>& aSubgraph, audio_frame_count aFrameCount);
+    private:
+        audio_sample_rate iSampleRate;
+        audio_frame_count iBlockSize;
+        bool iMultithreaded;
+        std::vector<std::shared_ptr<node_entry>> iNodes; // indexed by id, removed nodes leave an empty entry
+        bool iChanged = true;
+        std::vector<std::unique_ptr<prepared_graph>> iSnapshots; // the published one and those not yet released
+        std::atomic<prepared_graph*> iPublished = nullptr;
+        std::atomic<prepared_graph*> iInUse = nullptr;         // by the audio thread
+    };
+
+    // Plays an audio_graph as a bitstream, e.g. through audio_mixer. The graph is prepared on construction and
+    // processed single threaded on the audio thread; changes to the graph are heard once it has been prepared again.
+    class audio_graph_bitstream : public audio_bitstream<i_audio_bitstream>
+    {
+    public:
+        audio_graph_bitstream(audio_graph& aGraph, audio_frame_count aLength);
+    public:
+        audio_frame_count length() const final;
+        void generate(audio_channel aChannel, audio_frame_count aFrameCount, float* aOutputFrames) final;
+        void generate_from(audio_channel aChannel, audio_frame_index aFrameFrom, audio_frame_count aFrameCount, float* aOutputFrames) final;
+    private:
+        audio_graph& iGraph;
+        audio_frame_count iLength;
+        std::vector<float> iBuffer;
+    };
+}
@@ -19,6 +19,9 @@
 
 #include <neogfx/neogfx.hpp>
 
+#include <array>
+#include <vector>
+
 #include <neogfx/audio/i_audio_device.hpp>
 #include <neogfx/audio/i_audio_instrument.hpp>
 #include <neogfx/audio/audio_bitstream.hpp>
@@ -27,6 +30,9 @@
 
 namespace neogfx
 {
+    // The composition is kept in order of start time with a cursor to the next note to play so rendering a block
+    // only touches the notes sounding in it, however long the composition. Each note's envelope is turned into
+    // straight line gain ramps when it starts to sound.
     class audio_instrument : public audio_bitstream<i_audio_instrument>
     {
     public:
@@ -42,17 +48,41 @@ namespace neogfx
         void generate(audio_channel aChannel, audio_frame_count aFrameCount, float* aOutputFrames) final;
         void generate_from(audio_channel aChannel, audio_frame_index aFrameFrom, audio_frame_count aFrameCount, float* aOutputFrames) final;
     private:
-        neogfx::instrument iInstrument;
-        time_point iInputCursor = 0ULL;
-        time_point iOutputCursor = 0ULL;
         struct part
         {
-            std::optional<note> note;
-            std::optional<time_interval> noteLength;
-            std::optional<float> amplitude;
-            time_interval start;
+            neogfx::note note;
+            time_interval noteLength;
+            float amplitude;
+            time_point start;
             time_interval duration;
         };
-        std::vector<part> iComposition;
+        // gain from begin to end (frames from the start of the note) changing linearly
+        struct ramp
+        {
+            time_interval begin;
+            time_interval end;
+            float from;
+            float to;
+        };
+        struct voice
+        {
+            audio_instrument::part part;
+            time_point end;
+            std::array<ramp, 4> ramps;
+            std::size_t rampCount;
+        };
+    private:
+        void seek(time_point aPosition);
+        voice start_voice(part const& aPart) const;
+        void render_voice(voice const& aVoice, audio_channel aChannel, audio_frame_index aFrameFrom, audio_frame_count aFrameCount, float* aOutputFrames) const;
+    private:
+        neogfx::instrument iInstrument;
+        time_point iInputCursor = 0ULL;
+        time_point iOutputCursor = 0ULL;
+        time_point iLength = 0ULL;
+        std::vector<part> iComposition; // ordered by start
+        time_interval iLongestNote = 0ULL;
+        std::size_t iNextPart = 0u;
+        std::vector<voice> iVoices;
     };
 }
\ No newline at end of file
@@ -19,17 +19,32 @@
 
 #include <neogfx/neogfx.hpp>
 
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <future>
+#include <optional>
+
 #include <neogfx/audio/audio_primitives.hpp>
+#include <neogfx/audio/audio_sample_bank.hpp>
 #include <neogfx/audio/i_audio_instrument_atlas.hpp>
 
 #pragma once
 
 namespace neogfx
 {
+	// Instrument notes come from sample banks baked from music.zip (see audio_sample_bank) so playing a note
+	// never decodes. Each note resamples the zone covering it to its pitch and the device rate as it plays so
+	// an instrument's samples are held once whatever the number of notes and sample rates. Loaded instruments are
+	// published through atomic pointers so that the audio thread can find them without taking a lock.
 	class audio_instrument_atlas : public i_audio_instrument_atlas
 	{
+	public:
+		struct too_many_sample_rates : std::logic_error { too_many_sample_rates() : std::logic_error("neogfx::audio_instrument_atlas::too_many_sample_rates") {} };
 	private:
-		typedef std::tuple<neogfx::instrument, audio_sample_rate, note> note_key;
+		static constexpr std::size_t InstrumentCount = static_cast<std::size_t>(neogfx::instrument::Gunshot) + 1u;
+		static constexpr std::size_t MaxSampleRates = 8u;
+		typedef std::pair<neogfx::instrument, audio_sample_rate> instrument_key;
 		struct sample_info
 		{
 			std::string sampleFile;
@@ -37,13 +52,50 @@ namespace neogfx
 			note midiKeyPitchCentre;
 			note midiKeyHigh;
 		};
+		static constexpr std::size_t NoteCount = static_cast<std::size_t>(note::Ab9) + 1u;
+		struct instrument_samples
+		{
+			std::optional<audio_sample_bank> bank;
+			std::vector<audio_sample_bank::baked_zone> unsaved; // if the bank could not be written
+			std::vector<audio_sample_bank::zone> zones;
+		};
+		struct loaded_instrument
+		{
+			std::shared_ptr<instrument_samples const> samples;
+			std::vector<ref_ptr<i_audio_bitstream>> bitstreams;
+			std::array<i_audio_bitstream*, NoteCount> notes = {};
+		};
+		struct sample_rate_slot
+		{
+			std::atomic<audio_sample_rate> sampleRate = 0u;
+			std::array<std::atomic<loaded_instrument const*>, InstrumentCount> instruments = {};
+		};
 	public:
 		audio_instrument_atlas();
+		~audio_instrument_atlas();
 	public:
 		bool load_instrument(neogfx::instrument aInstrument, audio_sample_rate aSampleRate) override;
+		void load_instrument_async(neogfx::instrument aInstrument, audio_sample_rate aSampleRate) override;
+		bool instrument_loaded(neogfx::instrument aInstrument, audio_sample_rate aSampleRate) const override;
+		bool bake_instrument(neogfx::instrument aInstrument) override;
 		i_audio_bitstream& instrument(neogfx::instrument aInstrument, audio_sample_rate aSampleRate, note aNote) override;
+		i_audio_bitstream* find_instrument(neogfx::instrument aInstrument, audio_sample_rate aSampleRate, note aNote) const override;
+	private:
+		bool known(neogfx::instrument aInstrument) const;
+		loaded_instrument const* find_loaded(neogfx::instrument aInstrument, audio_sample_rate aSampleRate) const;
+		std::shared_future<void> start_loading(instrument_key const& aKey, bool aAsync);
+		void load(instrument_key const& aKey);
+		std::shared_ptr<instrument_samples const> samples(neogfx::instrument aInstrument);
+		std::vector<audio_sample_bank::baked_zone> bake(neogfx::instrument aInstrument) const;
+		std::pair<std::vector<float>, audio_sample_rate> decode(std::string const& aSampleFile) const;
+		static std::string atlas_file();
+		static audio_sample_bank::source_stamp atlas_stamp();
 	private:
 		std::map<neogfx::instrument, std::map<note, sample_info>> iSamples;
-		std::map<note_key, ref_ptr<i_audio_bitstream>> iNotes;
+		mutable std::mutex iMutex;
+		std::array<sample_rate_slot, MaxSampleRates> iSampleRates;
+		std::vector<std::unique_ptr<loaded_instrument>> iLoaded;
+		std::map<neogfx::instrument, std::shared_ptr<instrument_samples const>> iInstrumentSamples;
+		std::map<instrument_key, std::shared_future<void>> iLoading;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,102 @@
+// audio_meter.hpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2024 Leigh Johnston.  All Rights Reserved.
+
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+
+#include <span>
+#include <vector>
+#include <boost/align/aligned_allocator.hpp>
+
+#include <neogfx/audio/audio_primitives.hpp>
+
+struct _ffts_plan_t;
+
+namespace neogfx
+{
+    // Peak and RMS levels per channel of interleaved F32 frames. Peaks fall back at a fixed rate in dB per second
+    // and RMS is averaged over a time window so that readings are steady enough to display.
+    class audio_level_meter
+    {
+    public:
+        struct levels
+        {
+            float peak;
+            float rms;
+        };
+    public:
+        audio_level_meter(std::uint32_t aChannels, audio_sample_rate aSampleRate, float aRmsWindow = 0.3f, float aPeakFall = 20.0f);
+    public:
+        std::uint32_t channels() const;
+        levels const& channel(std::uint32_t aChannel) const;
+        void process(float const* aInput, audio_frame_count aFrameCount);
+        void reset();
+    public:
+        static float to_decibels(float aLevel);
+    private:
+        std::uint32_t iChannels;
+        audio_sample_rate iSampleRate;
+        float iRmsWindow;
+        float iPeakFall;
+        std::vector<levels> iLevels;
+        std::vector<float> iMeanSquares;
+        std::vector<float> iBlockPeaks;
+        std::vector<float> iBlockSums;
+    };
+
+    // Magnitude spectrum of the mono mix of interleaved F32 frames (Hann window, half overlapping frames) using
+    // the bundled FFTS library. A full scale sine reads 1.0 in its bin.
+    class audio_spectrum
+    {
+    public:
+        struct invalid_size : std::logic_error { invalid_size() : std::logic_error("neogfx::audio_spectrum::invalid_size") {} };
+        struct failed_to_create_plan : std::runtime_error { failed_to_create_plan() : std::runtime_error("neogfx::audio_spectrum::failed_to_create_plan") {} };
+    private:
+        typedef std::vector<float, boost::alignment::aligned_allocator<float, 32>> buffer;
+    public:
+        // aSize is the number of frames per transform and must be a power of two
+        audio_spectrum(std::uint32_t aChannels, audio_sample_rate aSampleRate, std::size_t aSize = 2048u);
+        ~audio_spectrum();
+        audio_spectrum(audio_spectrum const&) = delete;
+        audio_spectrum& operator=(audio_spectrum const&) = delete;
+    public:
+        std::size_t size() const;
+        float bin_frequency(std::size_t aBin) const;
+        // aSize / 2 + 1 bins from DC to Nyquist
+        std::span<float const> magnitudes() const;
+        // returns true if the magnitudes were updated
+        bool process(float const* aInput, audio_frame_count aFrameCount);
+        void reset();
+    private:
+        void transform();
+    private:
+        std::uint32_t iChannels;
+        audio_sample_rate iSampleRate;
+        std::size_t iSize;
+        _ffts_plan_t* iPlan;
+        std::vector<float> iWindow;
+        float iScale;
+        std::vector<float> iHistory;
+        std::size_t iFill = 0u;
+        buffer iInput;
+        buffer iOutput;
+        std::vector<float> iMagnitudes;
+    };
+}
@@ -0,0 +1,100 @@
+// audio_mixer.hpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2024 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <neogfx/neogfx.hpp>
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include <neogfx/core/spsc_queue.hpp>
+#include <neogfx/audio/audio_primitives.hpp>
+#include <neogfx/audio/i_audio_bitstream.hpp>
+
+#pragma once
+
+namespace neogfx
+{
+    // Mixes bitstreams into interleaved F32 frames. Voices may be submitted from any thread; producers are serialized
+    // by a mutex the audio thread never takes and commands reach it through a lock-free queue. Voices are mixed on
+    // the audio thread from a preallocated voice table so mix() neither locks nor allocates. play() takes a reference
+    // to the bitstream which is handed back to a control thread when the voice expires and released there by
+    // release_expired() (which play() also calls) so a bitstream is never destroyed on the audio thread.
+    class audio_mixer
+    {
+    private:
+        struct command
+        {
+            enum type_e
+            {
+                Play,
+                StopAll
+            } type;
+            i_audio_bitstream* bitstream;
+            audio_frame_count duration;
+            float gain;
+        };
+        struct voice
+        {
+            i_audio_bitstream* bitstream;
+            audio_frame_count remaining;
+            float gain;
+        };
+    public:
+        audio_mixer(audio_data_format const& aDataFormat, std::size_t aMaxVoices = 64u, std::size_t aCommandCapacity = 256u, audio_frame_count aMaxBlockFrames = 1024u);
+        ~audio_mixer();
+    public:
+        audio_data_format const& data_format() const;
+        std::size_t max_voices() const;
+    public:
+        // control threads; return false if the command queue is full
+        bool play(i_audio_bitstream& aBitstream, audio_frame_count aDuration, float aGain = 1.0f);
+        bool stop_all();
+        // control threads; releases the bitstreams of expired voices and returns how many there were
+        std::size_t release_expired();
+    public:
+        // audio thread; overwrites aFrameCount interleaved frames of the mixer's channel count
+        void mix(float* aOutput, audio_frame_count aFrameCount);
+    public:
+        std::size_t active_voices() const;
+        audio_frame_index position() const;
+        // mix() calls that took longer than the audio they produced (not device underruns, which the mixer can't see)
+        std::uint64_t overbudget_callbacks() const;
+        // voices not played because the command queue or voice table was full
+        std::uint64_t dropped() const;
+    private:
+        void apply_commands();
+        void mix_block(float* aOutput, audio_frame_count aFrameCount);
+        void expire(i_audio_bitstream* aBitstream);
+        std::size_t do_release_expired();
+    private:
+        audio_data_format iDataFormat;
+        audio_frame_count iMaxBlockFrames;
+        std::mutex iControlMutex;
+        spsc_queue<command> iCommands;
+        spsc_queue<i_audio_bitstream*> iExpired;
+        std::vector<voice> iVoices;
+        std::size_t iVoiceCount;
+        std::vector<float> iScratch;
+        std::atomic<std::size_t> iActiveVoices;
+        std::atomic<audio_frame_index> iPosition;
+        std::atomic<std::uint64_t> iOverbudgetCallbacks;
+        std::atomic<std::uint64_t> iDropped;
+    };
+}
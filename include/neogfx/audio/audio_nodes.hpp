@@ -0,0 +1,214 @@
+// audio_nodes.hpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2024 Leigh Johnston.  All Rights Reserved.
+
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+
+#include <array>
+#include <atomic>
+#include <vector>
+
+#include <neogfx/audio/i_audio_bitstream.hpp>
+#include <neogfx/audio/audio_graph.hpp>
+
+namespace neogfx
+{
+    // Node parameters are atomics so that they can be changed from any thread; a node picks up new values at the
+    // start of its next block.
+
+    // Plays a bitstream (oscillator waveform, instrument, track etc.) into the graph; its input is ignored.
+    class audio_source_node : public audio_node
+    {
+    public:
+        audio_source_node(i_audio_bitstream& aSource);
+        audio_source_node(i_ref_ptr<i_audio_bitstream> const& aSource);
+    public:
+        i_audio_bitstream& source() const;
+    public:
+        void process(float const* aInput, float* aOutput, audio_frame_count aFrameCount) final;
+    private:
+        ref_ptr<i_audio_bitstream> iSource;
+    };
+
+    // Changes in gain are ramped over a block to avoid zipper noise.
+    class audio_gain_node : public audio_node
+    {
+    public:
+        audio_gain_node(float aGain = 1.0f);
+    public:
+        float gain() const;
+        void set_gain(float aGain);
+    public:
+        void reset() final;
+        void process(float const* aInput, float* aOutput, audio_frame_count aFrameCount) final;
+    private:
+        std::atomic<float> iGain;
+        float iCurrentGain;
+    };
+
+    // Constant power pan (balance) from -1.0 (left) to 1.0 (right), unity gain when centred.
+    class audio_pan_node : public audio_node
+    {
+    public:
+        audio_pan_node(float aPan = 0.0f);
+    public:
+        float pan() const;
+        void set_pan(float aPan);
+    public:
+        void reset() final;
+        void process(float const* aInput, float* aOutput, audio_frame_count aFrameCount) final;
+    private:
+        std::atomic<float> iPan;
+        std::array<float, 2> iCurrentGains;
+    };
+
+    enum class audio_filter_type : std::uint32_t
+    {
+        LowPass,
+        HighPass,
+        BandPass,
+        Notch,
+        Peak,
+        LowShelf,
+        HighShelf
+    };
+
+    // Second order IIR filter (RBJ cookbook coefficients, transposed direct form II).
+    class audio_biquad_node : public audio_node
+    {
+    public:
+        audio_biquad_node(audio_filter_type aType, float aFrequency, float aQ = 0.70710678f, float aGain = 0.0f);
+    public:
+        audio_filter_type type() const;
+        float frequency() const;
+        float q() const;
+        float gain() const; // dB, used by Peak, LowShelf and HighShelf
+        void set(audio_filter_type aType, float aFrequency, float aQ = 0.70710678f, float aGain = 0.0f);
+    public:
+        void prepare(audio_sample_rate aSampleRate, audio_frame_count aBlockSize) final;
+        void reset() final;
+        void process(float const* aInput, float* aOutput, audio_frame_count aFrameCount) final;
+    private:
+        void update_coefficients();
+    private:
+        std::atomic<audio_filter_type> iType;
+        std::atomic<float> iFrequency;
+        std::atomic<float> iQ;
+        std::atomic<float> iGain;
+        std::atomic<bool> iChanged = true;
+        double iSampleRate = 44100.0;
+        float iB0 = 1.0f;
+        float iB1 = 0.0f;
+        float iB2 = 0.0f;
+        float iA1 = 0.0f;
+        float iA2 = 0.0f;
+        std::array<std::array<float, 2>, 2> iState = {};
+    };
+
+    // Stereo feedback delay.
+    class audio_delay_node : public audio_node
+    {
+    public:
+        audio_delay_node(float aMaximumDelay, float aDelay, float aFeedback = 0.0f, float aMix = 0.5f);
+    public:
+        float maximum_delay() const;
+        float delay() const;
+        void set_delay(float aDelay);
+        float feedback() const;
+        void set_feedback(float aFeedback);
+        float mix() const;
+        void set_mix(float aMix);
+    public:
+        void prepare(audio_sample_rate aSampleRate, audio_frame_count aBlockSize) final;
+        void reset() final;
+        void process(float const* aInput, float* aOutput, audio_frame_count aFrameCount) final;
+    private:
+        float const iMaximumDelay;
+        std::atomic<float> iDelay;
+        std::atomic<float> iFeedback;
+        std::atomic<float> iMix;
+        audio_sample_rate iSampleRate = 44100ULL;
+        std::vector<float> iLine; // interleaved stereo
+        std::size_t iWrite = 0u;
+    };
+
+    // Reverb for a send bus: scales its input by the send level and outputs only the reverberation (parallel comb
+    // filters into series allpass filters per channel, after Schroeder and Moorer). Connect its output alongside
+    // the dry signal.
+    class audio_reverb_node : public audio_node
+    {
+    private:
+        struct comb
+        {
+            std::vector<float> buffer;
+            std::size_t index;
+            float store;
+        };
+        struct allpass
+        {
+            std::vector<float> buffer;
+            std::size_t index;
+        };
+        static constexpr std::size_t Combs = 4u;
+        static constexpr std::size_t Allpasses = 2u;
+    public:
+        audio_reverb_node(float aSend = 0.3f, float aRoomSize = 0.5f, float aDamping = 0.5f);
+    public:
+        float send() const;
+        void set_send(float aSend);
+        float room_size() const;
+        void set_room_size(float aRoomSize);
+        float damping() const;
+        void set_damping(float aDamping);
+    public:
+        void prepare(audio_sample_rate aSampleRate, audio_frame_count aBlockSize) final;
+        void reset() final;
+        void process(float const* aInput, float* aOutput, audio_frame_count aFrameCount) final;
+    private:
+        std::atomic<float> iSend;
+        std::atomic<float> iRoomSize;
+        std::atomic<float> iDamping;
+        std::array<std::array<comb, Combs>, 2> iCombs;
+        std::array<std::array<allpass, Allpasses>, 2> iAllpasses;
+    };
+
+    // Peak limiter with instant attack and exponential release.
+    class audio_limiter_node : public audio_node
+    {
+    public:
+        audio_limiter_node(float aThreshold = 1.0f, float aRelease = 0.05f);
+    public:
+        float threshold() const;
+        void set_threshold(float aThreshold);
+        float release() const;
+        void set_release(float aRelease);
+        float gain_reduction() const; // current gain, 1.0 when not limiting
+    public:
+        void prepare(audio_sample_rate aSampleRate, audio_frame_count aBlockSize) final;
+        void reset() final;
+        void process(float const* aInput, float* aOutput, audio_frame_count aFrameCount) final;
+    private:
+        std::atomic<float> iThreshold;
+        std::atomic<float> iRelease;
+        audio_sample_rate iSampleRate = 44100ULL;
+        float iGain = 1.0f;
+        std::atomic<float> iReportedGain = 1.0f;
+    };
+}
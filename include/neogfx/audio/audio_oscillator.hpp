@@ -43,6 +43,12 @@ namespace neogfx
     public:
         void generate(audio_sample_count aSampleCount, float* aOutputSamples) final;
         void generate_from(audio_sample_index aSampleFrom, audio_sample_count aSampleCount, float* aOutputSamples) final;
+        void mix(audio_sample_count aSampleCount, float aGain, std::uint32_t aChannels, float* aOutputFrames) final;
+        void mix_from(audio_sample_index aSampleFrom, audio_sample_count aSampleCount, float aGain, std::uint32_t aChannels, float* aOutputFrames) final;
+    private:
+        template <typename Output>
+        void render(audio_sample_index aSampleFrom, audio_sample_count aSampleCount, Output aOutput);
+        std::size_t shape(float aPhase, float aIncrement, std::size_t aCount, float* aOutput) const;
     private:
         audio_sample_rate iSampleRate;
         float iFrequency;
@@ -50,5 +56,6 @@ namespace neogfx
         oscillator_function iFunction;
         std::function<float(float)> iCustomFunction;
         audio_sample_index iCursor = 0ULL;
+        double iPhase = 0.0; // [0, 1) at iCursor
     };
 }
\ No newline at end of file
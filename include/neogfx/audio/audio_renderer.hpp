@@ -0,0 +1,85 @@
+// audio_renderer.hpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2024 Leigh Johnston.  All Rights Reserved.
+
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+
+#include <chrono>
+#include <functional>
+#include <ostream>
+#include <vector>
+
+#include <neogfx/audio/audio_primitives.hpp>
+#include <neogfx/audio/i_audio_track.hpp>
+
+namespace neogfx
+{
+    enum class audio_file_format : std::uint32_t
+    {
+        Wav,
+        RawPcm // interleaved little endian samples with no header
+    };
+
+    // Renders tracks to a file or to memory without an audio device, as fast as the CPU allows. For each block the
+    // tracks are rendered in parallel on the thread pool, each into a buffer of its own, and the buffers are then
+    // summed in track order so the output is the same whatever the number of threads.
+    class audio_renderer
+    {
+    public:
+        struct unsupported_sample_format : std::logic_error { unsupported_sample_format() : std::logic_error("neogfx::audio_renderer::unsupported_sample_format") {} };
+        struct failed_to_write : std::runtime_error { failed_to_write() : std::runtime_error("neogfx::audio_renderer::failed_to_write") {} };
+    public:
+        struct statistics
+        {
+            audio_frame_count frames;
+            std::chrono::duration<double> elapsed;
+            // seconds of audio rendered per second taken
+            double realTimeFactor;
+        };
+    public:
+        // tracks are rendered in stereo and mapped to aDataFormat's channels: mono is the average of left and
+        // right, otherwise left and right go to the first two channels
+        audio_renderer(audio_data_format const& aDataFormat, audio_frame_count aBlockSize = 4096u, bool aMultithreaded = true);
+    public:
+        audio_data_format const& data_format() const;
+        bool multithreaded() const;
+        void set_multithreaded(bool aMultithreaded);
+        void add_track(i_audio_track& aTrack);
+        void add_track(i_ref_ptr<i_audio_track> const& aTrack);
+        void clear();
+        audio_frame_count length() const;
+    public:
+        statistics render(std::string const& aPath, audio_file_format aFileFormat = audio_file_format::Wav);
+        statistics render(std::ostream& aOutput, audio_file_format aFileFormat = audio_file_format::Wav);
+        // interleaved float frames in aDataFormat's channels
+        statistics render(std::vector<float>& aOutput);
+    private:
+        statistics render(std::function<void(float const*, audio_frame_count)> const& aSink);
+        void render_track(std::size_t aTrack, audio_frame_index aFrameFrom, audio_frame_count aFrameCount);
+    private:
+        audio_data_format iDataFormat;
+        audio_frame_count iBlockSize;
+        bool iMultithreaded;
+        std::vector<ref_ptr<i_audio_track>> iTracks;
+        std::vector<std::vector<float>> iTrackBuffers;
+        std::vector<float> iMix;
+        std::vector<float> iOutput;
+    };
+}
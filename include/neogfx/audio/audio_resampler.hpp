@@ -0,0 +1,58 @@
+// audio_resampler.hpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2024 Leigh Johnston.  All Rights Reserved.
+
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+
+#include <memory>
+#include <span>
+#include <vector>
+
+#include <neogfx/audio/audio_primitives.hpp>
+
+namespace neogfx
+{
+    // Band-limited interpolation of mono PCM at any position: a polyphase table of Kaiser windowed sinc kernels,
+    // linearly interpolated between phases. Reading the source at a step other than one both changes the pitch and
+    // converts the sample rate; steps above one use a kernel with a lower cutoff so that nothing aliases. Any output
+    // frame can be rendered without state so playback can start anywhere.
+    class audio_resampler
+    {
+    public:
+        static constexpr std::size_t Taps = 32u;
+        static constexpr std::size_t Phases = 256u;
+    private:
+        typedef std::vector<float> kernel; // (Phases + 1) rows of Taps coefficients
+    public:
+        // aStep is source frames per output frame
+        audio_resampler(double aStep);
+    public:
+        double step() const;
+        audio_frame_count length(std::size_t aSourceFrames) const;
+        // source frames outside aSource are silence
+        void generate_from(std::span<float const> aSource, audio_frame_index aFrameFrom, audio_frame_count aFrameCount, float* aOutputFrames) const;
+    private:
+        // kernels are shared by all resamplers with the same (quantized) cutoff
+        static std::shared_ptr<kernel const> kernel_for(double aStep);
+    private:
+        double iStep;
+        std::shared_ptr<kernel const> iKernel;
+    };
+}
@@ -0,0 +1,79 @@
+// audio_sample_bank.hpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2024 Leigh Johnston.  All Rights Reserved.
+
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+
+#include <span>
+#include <vector>
+
+#include <neogfx/core/mapped_file.hpp>
+#include <neogfx/audio/audio_primitives.hpp>
+
+namespace neogfx
+{
+    // The decoded samples of one instrument: a zone per sample file holding its mono float PCM at the file's own
+    // sample rate together with the range of keys it is played for. The file is memory mapped so that playback,
+    // which resamples each zone to the note and device rate (see audio_resampler), reads the samples in place.
+    class audio_sample_bank
+    {
+    public:
+        struct invalid_bank : std::runtime_error { invalid_bank() : std::runtime_error("neogfx::audio_sample_bank::invalid_bank") {} };
+        struct failed_to_save : std::runtime_error { failed_to_save() : std::runtime_error("neogfx::audio_sample_bank::failed_to_save") {} };
+    public:
+        // identifies the source the bank was baked from so that a stale bank is not used
+        struct source_stamp
+        {
+            std::uint64_t size;
+            std::int64_t lastWriteTime;
+
+            friend bool operator==(source_stamp const&, source_stamp const&) = default;
+        };
+        struct zone
+        {
+            note low;
+            note pitchCentre;
+            note high;
+            audio_sample_rate sampleRate;
+            std::span<float const> pcm;
+        };
+        struct baked_zone
+        {
+            note low;
+            note pitchCentre;
+            note high;
+            audio_sample_rate sampleRate;
+            std::vector<float> pcm;
+        };
+    public:
+        // throws invalid_bank if the file is not a bank for aInstrument baked from aSource
+        audio_sample_bank(std::string const& aPath, neogfx::instrument aInstrument, source_stamp const& aSource);
+    public:
+        static void save(std::string const& aPath, neogfx::instrument aInstrument, source_stamp const& aSource, std::vector<baked_zone> const& aZones);
+        static std::string default_path(neogfx::instrument aInstrument);
+    public:
+        neogfx::instrument instrument() const;
+        std::vector<zone> const& zones() const;
+    private:
+        mapped_file iFile;
+        neogfx::instrument iInstrument;
+        std::vector<zone> iZones;
+    };
+}
@@ -0,0 +1,61 @@
+// audio_track.hpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2024 Leigh Johnston.  All Rights Reserved.
+
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <neogfx/neogfx.hpp>
+
+#include <vector>
+
+#include <neogfx/audio/i_audio_device.hpp>
+#include <neogfx/audio/i_audio_track.hpp>
+#include <neogfx/audio/audio_bitstream.hpp>
+
+#pragma once
+
+namespace neogfx
+{
+    class audio_track : public audio_bitstream<i_audio_track>
+    {
+    public:
+        struct clip_not_found : std::logic_error { clip_not_found() : std::logic_error("neogfx::audio_track::clip_not_found") {} };
+    private:
+        struct clip_info
+        {
+            ref_ptr<i_audio_bitstream> bitstream;
+            audio_frame_index start;
+            audio_frame_count length;
+        };
+    public:
+        audio_track(audio_sample_rate aSampleRate, float aAmplitude = 1.0f);
+        audio_track(i_audio_device const& aDevice, float aAmplitude = 1.0f);
+    public:
+        std::uint32_t clip_count() const final;
+        i_audio_bitstream& clip(std::uint32_t aIndex) const final;
+        audio_frame_index clip_start(std::uint32_t aIndex) const final;
+        i_audio_bitstream& add_clip(i_audio_bitstream& aBitstream, audio_frame_index aStart, audio_frame_count aLength = 0ULL) final;
+        i_audio_bitstream& add_clip(i_ref_ptr<i_audio_bitstream> const& aBitstream, audio_frame_index aStart, audio_frame_count aLength = 0ULL) final;
+        void remove_clip(i_audio_bitstream const& aBitstream) final;
+    public:
+        audio_frame_count length() const final;
+        void generate(audio_channel aChannel, audio_frame_count aFrameCount, float* aOutputFrames) final;
+        void generate_from(audio_channel aChannel, audio_frame_index aFrameFrom, audio_frame_count aFrameCount, float* aOutputFrames) final;
+    private:
+        std::vector<clip_info> iClips; // ordered by start
+        audio_frame_index iCursor = 0ULL;
+    };
+}
@@ -69,6 +69,7 @@ namespace neogfx
 		virtual void start() = 0;
 		virtual void stop() = 0;
 	public:
+		// takes a reference to aBitstream until it has finished playing so it must be heap allocated
 		virtual void play(i_audio_bitstream& aBitstream, std::chrono::duration<double> const& aDuration) = 0;
 	};
 }
\ No newline at end of file
@@ -36,7 +36,17 @@ namespace neogfx
 	public:
 		virtual ~i_audio_instrument_atlas() = default;
 	public:
+		// loads all of an instrument's notes, baking its sample bank first if there is no up to date one; blocks
 		virtual bool load_instrument(neogfx::instrument aInstrument, audio_sample_rate aSampleRate) = 0;
+		// as load_instrument but on a worker thread, returning immediately
+		virtual void load_instrument_async(neogfx::instrument aInstrument, audio_sample_rate aSampleRate) = 0;
+		virtual bool instrument_loaded(neogfx::instrument aInstrument, audio_sample_rate aSampleRate) const = 0;
+		// decodes every sample of an instrument into its sample bank file; on Windows this throws
+		// audio_sample_bank::failed_to_save if that instrument's bank is loaded (mapped) at the time
+		virtual bool bake_instrument(neogfx::instrument aInstrument) = 0;
+		// loads the instrument (blocking) if necessary so must not be called from the audio thread
 		virtual i_audio_bitstream& instrument(neogfx::instrument aInstrument, audio_sample_rate aSampleRate, note aNote) = 0;
+		// never loads or blocks so may be called from the audio thread; nullptr if the instrument has not been loaded
+		virtual i_audio_bitstream* find_instrument(neogfx::instrument aInstrument, audio_sample_rate aSampleRate, note aNote) const = 0;
 	};
 }
\ No newline at end of file
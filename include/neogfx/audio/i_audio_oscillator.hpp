@@ -53,5 +53,8 @@ namespace neogfx
     public:
         virtual void generate(audio_sample_count aSampleCount, float* aOutputSamples) = 0;
         virtual void generate_from(audio_sample_index aSampleFrom, audio_sample_count aSampleCount, float* aOutputSamples) = 0;
+        // adds aGain times the oscillator's output to each of aChannels interleaved channels of aOutputFrames
+        virtual void mix(audio_sample_count aSampleCount, float aGain, std::uint32_t aChannels, float* aOutputFrames) = 0;
+        virtual void mix_from(audio_sample_index aSampleFrom, audio_sample_count aSampleCount, float aGain, std::uint32_t aChannels, float* aOutputFrames) = 0;
     };
 }
\ No newline at end of file
@@ -26,6 +26,7 @@
 
 namespace neogfx
 {
+    // A timeline of clips: bitstreams that start playing at a given frame.
     class i_audio_track : public i_audio_bitstream
     {
     public:
@@ -33,5 +34,12 @@ namespace neogfx
     public:
         virtual ~i_audio_track() = default;
     public:
+        virtual std::uint32_t clip_count() const = 0;
+        virtual i_audio_bitstream& clip(std::uint32_t aIndex) const = 0;
+        virtual audio_frame_index clip_start(std::uint32_t aIndex) const = 0;
+        // a length of zero plays the whole of the bitstream
+        virtual i_audio_bitstream& add_clip(i_audio_bitstream& aBitstream, audio_frame_index aStart, audio_frame_count aLength = 0ULL) = 0;
+        virtual i_audio_bitstream& add_clip(i_ref_ptr<i_audio_bitstream> const& aBitstream, audio_frame_index aStart, audio_frame_count aLength = 0ULL) = 0;
+        virtual void remove_clip(i_audio_bitstream const& aBitstream) = 0;
     };
 }
\ No newline at end of file
@@ -0,0 +1,57 @@
+// mapped_file.hpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2024 Leigh Johnston.  All Rights Reserved.
+
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+
+#include <string>
+#include <span>
+#include <cstddef>
+
+namespace neogfx
+{
+    // A read-only view of a whole file mapped into memory; pages are loaded by the OS as they are touched. Other
+    // processes may write, rename or delete the file while it is mapped (writes show through the view). Windows
+    // will not replace a file that has a mapped view, so a rename over a mapped file fails until it is unmapped.
+    class mapped_file
+    {
+    public:
+        struct failed_to_open_file : std::runtime_error { failed_to_open_file() : std::runtime_error("neogfx::mapped_file::failed_to_open_file") {} };
+        struct failed_to_map_file : std::runtime_error { failed_to_map_file() : std::runtime_error("neogfx::mapped_file::failed_to_map_file") {} };
+    public:
+        mapped_file(std::string const& aPath);
+        ~mapped_file();
+        mapped_file(mapped_file const&) = delete;
+        mapped_file& operator=(mapped_file const&) = delete;
+    public:
+        std::string const& path() const;
+        std::size_t size() const;
+        std::byte const* data() const;
+        std::span<std::byte const> bytes() const;
+    private:
+        std::string iPath;
+        std::size_t iSize = 0u;
+        void const* iData = nullptr;
+#ifdef _WIN32
+        void* iFile = nullptr;
+        void* iMapping = nullptr;
+#endif
+    };
+}
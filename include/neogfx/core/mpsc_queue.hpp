@@ -0,0 +1,85 @@
+// mpsc_queue.hpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2024 Leigh Johnston.  All Rights Reserved.
+
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+
+#include <atomic>
+#include <optional>
+#include <utility>
+
+namespace neogfx
+{
+    // Unbounded multiple producer, single consumer queue (D. Vyukov's intrusive design): push() is lock-free and
+    // wait-free and may be called from any thread; pop() must only be called from one thread at a time.
+    template <typename T>
+    class mpsc_queue
+    {
+    public:
+        typedef T value_type;
+    private:
+        struct node
+        {
+            std::atomic<node*> next = nullptr;
+            std::optional<value_type> value;
+        };
+    public:
+        mpsc_queue() :
+            iHead{ new node{} },
+            iTail{ iHead.load() }
+        {
+        }
+        ~mpsc_queue()
+        {
+            while (pop());
+            delete iTail;
+        }
+        mpsc_queue(mpsc_queue const&) = delete;
+        mpsc_queue& operator=(mpsc_queue const&) = delete;
+    public:
+        void push(value_type aValue)
+        {
+            auto newNode = new node{};
+            newNode->value.emplace(std::move(aValue));
+            auto previous = iHead.exchange(newNode, std::memory_order_acq_rel);
+            previous->next.store(newNode, std::memory_order_release);
+        }
+        // returns std::nullopt when empty or when a producer is between its two steps of push()
+        std::optional<value_type> pop()
+        {
+            auto tail = iTail;
+            auto next = tail->next.load(std::memory_order_acquire);
+            if (next == nullptr)
+                return {};
+            std::optional<value_type> result{ std::move(next->value) };
+            next->value.reset();
+            iTail = next;
+            delete tail;
+            return result;
+        }
+        bool empty() const
+        {
+            return iTail->next.load(std::memory_order_acquire) == nullptr;
+        }
+    private:
+        std::atomic<node*> iHead;
+        node* iTail;
+    };
+}
@@ -0,0 +1,365 @@
+// piece_table.hpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2024 Leigh Johnston.  All Rights Reserved.
+
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+
+#include <algorithm>
+#include <compare>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+namespace neogfx
+{
+    // Styled text held as pieces of an append-only character buffer, with the style of each character kept as runs
+    // of equal style. An edit costs in proportion to its length plus the number of pieces and runs, not the length
+    // of the document, and a copy (e.g. the undo state) shares the buffer so only copies the piece and run tables.
+    // Elements are read as Value{ character, style } through random access const iterators that remember the piece
+    // and run they were last in, so walking the text is O(1) per element and a random access is O(log pieces).
+    template <typename Char, typename Style, typename Value>
+    class piece_table
+    {
+    public:
+        typedef Char character_type;
+        typedef Style style_type;
+        typedef Value value_type;
+        typedef std::size_t size_type;
+        typedef std::ptrdiff_t difference_type;
+    private:
+        typedef std::vector<character_type> buffer_type;
+        struct piece
+        {
+            size_type start;  // in the document
+            size_type offset; // in the buffer
+            size_type length;
+            bool operator==(piece const&) const = default;
+        };
+        struct run
+        {
+            size_type start;
+            style_type style;
+            bool operator==(run const&) const = default;
+        };
+    public:
+        class const_iterator
+        {
+            friend class piece_table;
+        public:
+            typedef std::random_access_iterator_tag iterator_category;
+            typedef std::random_access_iterator_tag iterator_concept;
+            typedef piece_table::value_type value_type;
+            typedef piece_table::difference_type difference_type;
+            typedef value_type reference;
+            struct pointer
+            {
+                value_type value;
+                value_type const* operator->() const { return &value; }
+            };
+        public:
+            const_iterator() = default;
+        private:
+            const_iterator(piece_table const& aOwner, size_type aPosition) :
+                iOwner{ &aOwner }, iPosition{ aPosition }
+            {
+            }
+        public:
+            reference operator*() const
+            {
+                return iOwner->at(iPosition, iPiece, iRun);
+            }
+            pointer operator->() const
+            {
+                return pointer{ **this };
+            }
+            reference operator[](difference_type aOffset) const
+            {
+                return *(*this + aOffset);
+            }
+            const_iterator& operator++()
+            {
+                ++iPosition;
+                return *this;
+            }
+            const_iterator operator++(int)
+            {
+                auto const result = *this;
+                ++*this;
+                return result;
+            }
+            const_iterator& operator--()
+            {
+                --iPosition;
+                return *this;
+            }
+            const_iterator operator--(int)
+            {
+                auto const result = *this;
+                --*this;
+                return result;
+            }
+            const_iterator& operator+=(difference_type aOffset)
+            {
+                iPosition = static_cast<size_type>(static_cast<difference_type>(iPosition) + aOffset);
+                return *this;
+            }
+            const_iterator& operator-=(difference_type aOffset)
+            {
+                return *this += -aOffset;
+            }
+            const_iterator operator+(difference_type aOffset) const
+            {
+                auto result = *this;
+                return result += aOffset;
+            }
+            friend const_iterator operator+(difference_type aOffset, const_iterator const& aIterator)
+            {
+                return aIterator + aOffset;
+            }
+            const_iterator operator-(difference_type aOffset) const
+            {
+                auto result = *this;
+                return result -= aOffset;
+            }
+            difference_type operator-(const_iterator const& aOther) const
+            {
+                return static_cast<difference_type>(iPosition) - static_cast<difference_type>(aOther.iPosition);
+            }
+            bool operator==(const_iterator const& aOther) const
+            {
+                return iPosition == aOther.iPosition;
+            }
+            std::strong_ordering operator<=>(const_iterator const& aOther) const
+            {
+                return iPosition <=> aOther.iPosition;
+            }
+        private:
+            piece_table const* iOwner = nullptr;
+            size_type iPosition = 0u;
+            mutable size_type iPiece = 0u;
+            mutable size_type iRun = 0u;
+        };
+        typedef const_iterator iterator;
+    public:
+        piece_table() :
+            iBuffer{ std::make_shared<buffer_type>() }
+        {
+        }
+    public:
+        size_type size() const
+        {
+            return iSize;
+        }
+        bool empty() const
+        {
+            return iSize == 0u;
+        }
+        size_type piece_count() const
+        {
+            return iPieces.size();
+        }
+        size_type run_count() const
+        {
+            return iRuns.size();
+        }
+        const_iterator begin() const
+        {
+            return const_iterator{ *this, 0u };
+        }
+        const_iterator end() const
+        {
+            return const_iterator{ *this, iSize };
+        }
+        const_iterator cbegin() const
+        {
+            return begin();
+        }
+        const_iterator cend() const
+        {
+            return end();
+        }
+        value_type operator[](size_type aPosition) const
+        {
+            size_type pieceHint = 0u;
+            size_type runHint = 0u;
+            return at(aPosition, pieceHint, runHint);
+        }
+    public:
+        void clear()
+        {
+            iPieces.clear();
+            iRuns.clear();
+            iSize = 0u;
+            // a copy may still be using the buffer
+            if (iBuffer.use_count() == 1)
+                iBuffer->clear();
+            else
+                iBuffer = std::make_shared<buffer_type>();
+        }
+        iterator insert(const_iterator aWhere, value_type const& aValue)
+        {
+            return insert(aWhere, &aValue.character, std::next(&aValue.character), aValue.style);
+        }
+        iterator insert(const_iterator aWhere, character_type const* aFirst, character_type const* aLast, style_type const& aStyle)
+        {
+            auto const position = aWhere.iPosition;
+            auto const count = static_cast<size_type>(aLast - aFirst);
+            if (count == 0u)
+                return iterator{ *this, position };
+            auto const offset = iBuffer->size();
+            iBuffer->insert(iBuffer->end(), aFirst, aLast);
+            auto next = split(position);
+            // typing extends the piece it is typed at the end of
+            if (next > 0u && iPieces[next - 1u].offset + iPieces[next - 1u].length == offset)
+                iPieces[next - 1u].length += count;
+            else
+                iPieces.insert(std::next(iPieces.begin(), next++), piece{ position, offset, count });
+            for (; next < iPieces.size(); ++next)
+                iPieces[next].start += count;
+            insert_run(position, count, aStyle);
+            iSize += count;
+            return iterator{ *this, position };
+        }
+        iterator erase(const_iterator aFirst, const_iterator aLast)
+        {
+            auto const from = aFirst.iPosition;
+            auto const to = aLast.iPosition;
+            if (from == to)
+                return iterator{ *this, from };
+            auto const count = to - from;
+            auto const first = split(from);
+            auto const last = split(to);
+            iPieces.erase(std::next(iPieces.begin(), first), std::next(iPieces.begin(), last));
+            for (auto next = first; next < iPieces.size(); ++next)
+                iPieces[next].start -= count;
+            erase_runs(from, to);
+            iSize -= count;
+            return iterator{ *this, from };
+        }
+        // replaces the character at aPosition, keeping its style
+        void replace(size_type aPosition, character_type aCharacter)
+        {
+            auto const style = (*this)[aPosition].style;
+            auto const where = erase(std::next(begin(), aPosition), std::next(begin(), aPosition + 1u));
+            insert(where, &aCharacter, std::next(&aCharacter), style);
+        }
+        void swap(piece_table& aOther)
+        {
+            std::swap(iBuffer, aOther.iBuffer);
+            std::swap(iPieces, aOther.iPieces);
+            std::swap(iRuns, aOther.iRuns);
+            std::swap(iSize, aOther.iSize);
+        }
+    public:
+        // compares characters only, as the document_char vector this replaces did
+        friend bool operator==(piece_table const& aLhs, piece_table const& aRhs)
+        {
+            if (aLhs.size() != aRhs.size())
+                return false;
+            if (aLhs.iBuffer == aRhs.iBuffer && aLhs.iPieces == aRhs.iPieces)
+                return true;
+            return std::equal(aLhs.begin(), aLhs.end(), aRhs.begin(),
+                [](value_type const& aLeft, value_type const& aRight) { return aLeft.character == aRight.character; });
+        }
+    private:
+        value_type at(size_type aPosition, size_type& aPieceHint, size_type& aRunHint) const
+        {
+            auto const& p = iPieces[find(iPieces, aPosition, aPieceHint)];
+            return value_type{ (*iBuffer)[p.offset + (aPosition - p.start)], iRuns[find(iRuns, aPosition, aRunHint)].style };
+        }
+        template <typename Entries>
+        size_type find(Entries const& aEntries, size_type aPosition, size_type& aHint) const
+        {
+            auto const contains = [&](size_type aEntry)
+            {
+                return aEntries[aEntry].start <= aPosition &&
+                    (aEntry + 1u == aEntries.size() ? aPosition < iSize : aPosition < aEntries[aEntry + 1u].start);
+            };
+            if (aHint < aEntries.size() && contains(aHint))
+                return aHint;
+            if (aHint + 1u < aEntries.size() && contains(aHint + 1u))
+                return ++aHint;
+            auto const next = std::upper_bound(aEntries.begin(), aEntries.end(), aPosition,
+                [](size_type aValue, auto const& aEntry) { return aValue < aEntry.start; });
+            return aHint = static_cast<size_type>(std::distance(aEntries.begin(), next)) - 1u;
+        }
+        // returns the index of the piece starting at aPosition, splitting the piece containing it if need be
+        size_type split(size_type aPosition)
+        {
+            auto const next = std::upper_bound(iPieces.begin(), iPieces.end(), aPosition,
+                [](size_type aValue, piece const& aPiece) { return aValue < aPiece.start; });
+            if (next == iPieces.begin())
+                return 0u;
+            auto const containing = static_cast<size_type>(std::distance(iPieces.begin(), next)) - 1u;
+            auto& p = iPieces[containing];
+            if (p.start == aPosition)
+                return containing;
+            if (p.start + p.length == aPosition)
+                return containing + 1u;
+            auto const head = aPosition - p.start;
+            piece const tail{ aPosition, p.offset + head, p.length - head };
+            p.length = head;
+            iPieces.insert(std::next(iPieces.begin(), containing + 1u), tail);
+            return containing + 1u;
+        }
+        void insert_run(size_type aPosition, size_type aCount, style_type const& aStyle)
+        {
+            auto next = static_cast<size_type>(std::distance(iRuns.begin(), std::lower_bound(iRuns.begin(), iRuns.end(), aPosition,
+                [](run const& aRun, size_type aValue) { return aRun.start < aValue; })));
+            // the run the text is inserted into continues after it
+            if (next > 0u && aPosition < iSize && (next == iRuns.size() || iRuns[next].start != aPosition))
+                iRuns.insert(std::next(iRuns.begin(), next), run{ aPosition, iRuns[next - 1u].style });
+            for (auto later = next; later < iRuns.size(); ++later)
+                iRuns[later].start += aCount;
+            iRuns.insert(std::next(iRuns.begin(), next), run{ aPosition, aStyle });
+            merge_runs(next);
+        }
+        void erase_runs(size_type aFrom, size_type aTo)
+        {
+            auto const bound = [&](size_type aPosition)
+            {
+                return static_cast<size_type>(std::distance(iRuns.begin(), std::lower_bound(iRuns.begin(), iRuns.end(), aPosition,
+                    [](run const& aRun, size_type aValue) { return aRun.start < aValue; })));
+            };
+            auto const first = bound(aFrom);
+            auto last = bound(aTo);
+            // the run containing aTo keeps its style for what follows
+            if (last > first && aTo < iSize && (last == iRuns.size() || iRuns[last].start != aTo))
+                iRuns[--last].start = aTo;
+            iRuns.erase(std::next(iRuns.begin(), first), std::next(iRuns.begin(), last));
+            for (auto later = first; later < iRuns.size(); ++later)
+                iRuns[later].start -= aTo - aFrom;
+            if (first < iRuns.size())
+                merge_runs(first);
+        }
+        void merge_runs(size_type aRun)
+        {
+            if (aRun + 1u < iRuns.size() && iRuns[aRun + 1u].style == iRuns[aRun].style)
+                iRuns.erase(std::next(iRuns.begin(), aRun + 1u));
+            if (aRun > 0u && iRuns[aRun - 1u].style == iRuns[aRun].style)
+                iRuns.erase(std::next(iRuns.begin(), aRun));
+        }
+    private:
+        std::shared_ptr<buffer_type> iBuffer;
+        std::vector<piece> iPieces;
+        std::vector<run> iRuns;
+        size_type iSize = 0u;
+    };
+}
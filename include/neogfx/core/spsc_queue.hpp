@@ -0,0 +1,110 @@
+// spsc_queue.hpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2024 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+#include <optional>
+#include <bit>
+
+namespace neogfx
+{
+    // Bounded single producer, single consumer ring buffer: push() and pop() are wait-free and never allocate so
+    // they are safe to call from a real-time thread. The capacity is rounded up to a power of two.
+    template <typename T>
+    class spsc_queue
+    {
+    public:
+        typedef T value_type;
+    public:
+        explicit spsc_queue(std::size_t aCapacity) :
+            iBuffer(std::bit_ceil(std::max<std::size_t>(aCapacity, 2u))),
+            iMask{ iBuffer.size() - 1u }
+        {
+        }
+        spsc_queue(spsc_queue const&) = delete;
+        spsc_queue& operator=(spsc_queue const&) = delete;
+    public:
+        std::size_t capacity() const
+        {
+            return iBuffer.size();
+        }
+        std::size_t size() const
+        {
+            return iTail.load(std::memory_order_acquire) - iHead.load(std::memory_order_acquire);
+        }
+        bool empty() const
+        {
+            return size() == 0u;
+        }
+        // producer; returns false if the queue is full
+        bool push(value_type const& aValue)
+        {
+            auto const tail = iTail.load(std::memory_order_relaxed);
+            if (tail - iHead.load(std::memory_order_acquire) == iBuffer.size())
+                return false;
+            iBuffer[tail & iMask] = aValue;
+            iTail.store(tail + 1u, std::memory_order_release);
+            return true;
+        }
+        // consumer
+        std::optional<value_type> pop()
+        {
+            auto const head = iHead.load(std::memory_order_relaxed);
+            if (head == iTail.load(std::memory_order_acquire))
+                return {};
+            std::optional<value_type> result{ std::move(iBuffer[head & iMask]) };
+            iHead.store(head + 1u, std::memory_order_release);
+            return result;
+        }
+        // producer; pushes as many of aCount values as fit and returns how many that was
+        std::size_t push(value_type const* aValues, std::size_t aCount)
+        {
+            auto const tail = iTail.load(std::memory_order_relaxed);
+            auto const count = std::min(aCount, iBuffer.size() - (tail - iHead.load(std::memory_order_acquire)));
+            auto const start = tail & iMask;
+            auto const first = std::min(count, iBuffer.size() - start);
+            std::copy_n(aValues, first, iBuffer.begin() + start);
+            std::copy_n(aValues + first, count - first, iBuffer.begin());
+            iTail.store(tail + count, std::memory_order_release);
+            return count;
+        }
+        // consumer; pops up to aMaxCount values and returns how many that was
+        std::size_t pop(value_type* aValues, std::size_t aMaxCount)
+        {
+            auto const head = iHead.load(std::memory_order_relaxed);
+            auto const count = std::min(aMaxCount, iTail.load(std::memory_order_acquire) - head);
+            auto const start = head & iMask;
+            auto const first = std::min(count, iBuffer.size() - start);
+            std::copy_n(iBuffer.begin() + start, first, aValues);
+            std::copy_n(iBuffer.begin(), count - first, aValues + first);
+            iHead.store(head + count, std::memory_order_release);
+            return count;
+        }
+    private:
+        std::vector<value_type> iBuffer;
+        std::size_t const iMask;
+        alignas(64) std::atomic<std::size_t> iHead = 0u;
+        alignas(64) std::atomic<std::size_t> iTail = 0u;
+    };
+}
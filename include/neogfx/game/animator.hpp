@@ -21,6 +21,9 @@
 
 #include <neogfx/neogfx.hpp>
 
+#include <vector>
+#include <unordered_map>
+
 #include <neolib/ecs/chrono.hpp>
 
 #include <neogfx/core/event.hpp>
@@ -59,7 +62,25 @@ namespace neogfx::game
                 return sName;
             }
         };
+    private:
+        // cumulative frame end times of an animation so the current frame of an entity is found with a modulo and
+        // a binary search however far behind it is
+        struct frame_table
+        {
+            std::vector<scalar> durations;
+            step_time timestep = 0;
+            std::vector<step_time> ends;
+            step_time total = 0;
+            std::uint64_t tick = 0u;
+            // entities sharing the animation and its start time share the result
+            std::optional<step_time> lastCycleStart;
+            step_time lastCycle = 0;
+            u32 lastFrame = 0u;
+        };
+        frame_table& table(animation const& aAnimation, step_time aTimestep);
     private:
         scoped_component_lock<entity_info, mesh_render_cache, animation_filter> iLock;
+        std::unordered_map<animation const*, frame_table> iFrameTables;
+        std::uint64_t iTick = 0u;
     };
 }   
\ No newline at end of file
@@ -0,0 +1,84 @@
+// barnes_hut.hpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2024 Leigh Johnston.  All Rights Reserved.
+
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+
+#include <vector>
+
+#include <neogfx/core/numerical.hpp>
+
+namespace neogfx::game
+{
+    enum class gravitation_solver : std::uint32_t
+    {
+        Direct,     // every pair of bodies, O(n^2)
+        BarnesHut   // octree of centres of mass, O(n log n)
+    };
+
+    // Barnes-Hut approximation of universal gravitation: distant groups of bodies are treated as a single body at
+    // their centre of mass when cell size / distance < theta (the opening angle), typically 0.5 to 1.0. A cell
+    // containing the body being evaluated is always opened, whatever theta. Bodies are stored in tree order
+    // in flat arrays so each leaf's interactions are a branch free loop over contiguous memory.
+    class barnes_hut
+    {
+    public:
+        static constexpr std::uint32_t LeafSize = 8u;
+        static constexpr std::uint32_t MaxDepth = 32u;
+    private:
+        struct node
+        {
+            vec3f centre;
+            float halfSize;
+            vec3f centreOfMass;
+            float mass;
+            std::uint32_t firstChild; // 0 for a leaf (the root is never a child)
+            std::uint32_t childCount;
+            std::uint32_t firstBody;
+            std::uint32_t bodyCount;
+        };
+    public:
+        barnes_hut(float aTheta = 0.5f);
+    public:
+        float theta() const;
+        void set_theta(float aTheta);
+    public:
+        // bodies with zero mass are affected by gravity but don't contribute to it; aAccelerations is indexed as aPositions
+        void solve(std::vector<vec3f> const& aPositions, std::vector<float> const& aMasses, float aGravitationalConstant,
+            std::vector<vec3f>& aAccelerations, bool aMultithreaded);
+    public:
+        std::uint32_t node_count() const;
+        std::uint32_t depth() const;
+    private:
+        void build(std::vector<vec3f> const& aPositions, std::vector<float> const& aMasses);
+        void build_node(std::vector<vec3f> const& aPositions, std::vector<float> const& aMasses, std::uint32_t aNode, std::uint32_t aFirst, std::uint32_t aLast, std::uint32_t aDepth);
+        vec3f acceleration(vec3f const& aPosition, std::vector<std::uint32_t>& aStack) const;
+    private:
+        float iTheta;
+        std::vector<node> iNodes;
+        std::vector<std::uint32_t> iOrder;
+        std::vector<std::uint32_t> iScratch;
+        std::vector<float> iX;
+        std::vector<float> iY;
+        std::vector<float> iZ;
+        std::vector<float> iMass;
+        std::uint32_t iDepth;
+    };
+}
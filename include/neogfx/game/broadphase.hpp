@@ -0,0 +1,91 @@
+// broadphase.hpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2024 Leigh Johnston.  All Rights Reserved.
+
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+
+#include <neogfx/core/numerical.hpp>
+
+namespace neogfx::game
+{
+    enum class broadphase_type : std::uint32_t
+    {
+        Tree,               // aabb_octree / aabb_quadtree rebuilt every cycle
+        SortAndSweep,       // sort and sweep over a flat array of AABBs, only moving the entries that changed
+        DynamicAabbTree     // bounding volume hierarchy of fattened AABBs, updated incrementally
+    };
+
+    namespace detail
+    {
+        template <typename Aabb>
+        struct broadphase_traits;
+
+        template <>
+        struct broadphase_traits<aabbf>
+        {
+            typedef vec3f vector_type;
+            static constexpr std::size_t dimensions = 3u;
+        };
+
+        template <>
+        struct broadphase_traits<aabb_2df>
+        {
+            typedef vec2f vector_type;
+            static constexpr std::size_t dimensions = 2u;
+        };
+
+        template <typename Aabb>
+        inline bool broadphase_aabb_contains(const Aabb& aOuter, const Aabb& aInner)
+        {
+            for (std::size_t i = 0u; i < broadphase_traits<Aabb>::dimensions; ++i)
+                if (aInner.min[i] < aOuter.min[i] || aInner.max[i] > aOuter.max[i])
+                    return false;
+            return true;
+        }
+
+        // sum of the extents: proportional to perimeter (2D) and a cheap stand-in for surface area (3D)
+        template <typename Aabb>
+        inline float broadphase_aabb_cost(const Aabb& aAabb)
+        {
+            float result = 0.0f;
+            for (std::size_t i = 0u; i < broadphase_traits<Aabb>::dimensions; ++i)
+                result += aAabb.max[i] - aAabb.min[i];
+            return result;
+        }
+
+        // inflates by aMargin on every side and extends further along aDisplacement so that steadily moving
+        // colliders stay inside their fattened bounds for several cycles
+        template <typename Aabb>
+        inline Aabb broadphase_aabb_fattened(const Aabb& aAabb, float aMargin, const typename broadphase_traits<Aabb>::vector_type& aDisplacement)
+        {
+            Aabb result = aAabb;
+            for (std::size_t i = 0u; i < broadphase_traits<Aabb>::dimensions; ++i)
+            {
+                result.min[i] -= aMargin;
+                result.max[i] += aMargin;
+                if (aDisplacement[i] < 0.0f)
+                    result.min[i] += aDisplacement[i] * 2.0f;
+                else
+                    result.max[i] += aDisplacement[i] * 2.0f;
+            }
+            return result;
+        }
+    }
+}
@@ -22,6 +22,7 @@
 
 #include <neogfx/gui/widget/widget.hpp>
 #include <neogfx/game/ecs.hpp>
+#include <neogfx/game/sprite_packer.hpp>
 
 namespace neogfx::game
 {
@@ -56,6 +57,10 @@ namespace neogfx::game
         bool layer_visible(scene_layer aLayer) const;
         void show_layer(scene_layer aLayer);
         void hide_layer(scene_layer aLayer);
+        bool sprite_packing() const;
+        // textures of new sprites are packed into shared atlas pages before each paint
+        void enable_sprite_packing();
+        void disable_sprite_packing();
     public:
         neogfx::logical_coordinate_system logical_coordinate_system() const override;
     public:
@@ -64,11 +69,13 @@ namespace neogfx::game
     private:
         void init();
     private:
+        std::optional<sprite_packer> iSpritePacker; // destroyed after the ECS whose materials refer to its atlas
         std::shared_ptr<game::i_ecs> iEcs;
         std::vector<bool> iLayers;
         sink iSink;
         std::optional<widget_timer> iUpdater;
         bool iEcsPaused;
+        bool iSpritePacking = false;
     };
 }
 
@@ -20,10 +20,19 @@
 
 #include <neogfx/neogfx.hpp>
 
+#include <vector>
+#include <utility>
+#include <memory>
+#include <mutex>
+
+#include <neolib/task/thread_pool.hpp>
+
 #include <neogfx/core/event.hpp>
 #include <neogfx/game/system.hpp>
 #include <neogfx/game/aabb_quadtree.hpp>
 #include <neogfx/game/aabb_octree.hpp>
+#include <neogfx/game/sort_and_sweep.hpp>
+#include <neogfx/game/dynamic_aabb_tree.hpp>
 #include <neogfx/game/box_collider.hpp>
 
 namespace neogfx::game
@@ -51,10 +60,22 @@ namespace neogfx::game
         return static_cast<collision_detection_cycle>(static_cast<std::uint32_t>(aLhs) & static_cast<std::uint32_t>(aRhs));
     }
 
+    enum class collision_delivery : std::uint32_t
+    {
+        PerPair,    // a Collision event for each pair, triggered with the collider components locked
+        Batch       // pairs gathered on worker threads where the broadphase allows it then one CollisionBatch event
+    };
+
+    typedef std::pair<entity_id, entity_id> collision_pair;
+    typedef std::vector<collision_pair> collision_pairs;
+
     class collision_detector : public game::system<entity_info, box_collider, box_collider_2d>
     {
     public:
         define_event(Collision, collision, entity_id, entity_id)
+        // triggered after the collider components are unlocked; pairs are unique, ordered (lower entity id first) and
+        // sorted but handlers must check for entities destroyed by earlier handlers
+        define_event(CollisionBatch, collision_batch, collision_pairs const&)
     public:
         collision_detector(i_ecs& aEcs);
         ~collision_detector();
@@ -67,23 +88,62 @@ namespace neogfx::game
         bool apply() override;
     public:
         void run_cycle(collision_detection_cycle aCycle = collision_detection_cycle::Default);
+    public:
+        // Collider bounds are only recalculated for entities marked dirty (simple_physics and animator do this
+        // when a rigid body moves or an animation frame changes); code that moves a rigid body directly should
+        // call set_collider_dirty. Without simple_physics every collider is recalculated each cycle.
+        void set_collider_dirty(entity_id aEntity);
+        void set_all_colliders_dirty();
+    public:
+        game::collision_delivery collision_delivery() const;
+        void set_collision_delivery(game::collision_delivery aDelivery);
         template <typename Visitor>
         void visit_aabbs(const Visitor& aVisitor) const
         {
-            iBroadphaseTree.visit_aabbs(aVisitor);
+            switch (iBroadphase)
+            {
+            case broadphase_type::Tree:
+                iBroadphaseTree.visit_aabbs(aVisitor);
+                break;
+            case broadphase_type::SortAndSweep:
+                iSortAndSweep.visit_aabbs(aVisitor);
+                break;
+            case broadphase_type::DynamicAabbTree:
+                iDynamicTree.visit_aabbs(aVisitor);
+                break;
+            }
         }
         template <typename Visitor>
         void visit_aabbs_2d(const Visitor& aVisitor) const
         {
-            iBroadphase2dTree.visit_aabbs(aVisitor);
+            switch (iBroadphase)
+            {
+            case broadphase_type::Tree:
+                iBroadphase2dTree.visit_aabbs(aVisitor);
+                break;
+            case broadphase_type::SortAndSweep:
+                iSortAndSweep2d.visit_aabbs(aVisitor);
+                break;
+            case broadphase_type::DynamicAabbTree:
+                iDynamicTree2d.visit_aabbs(aVisitor);
+                break;
+            }
         }
     public:
+        broadphase_type broadphase() const;
+        void set_broadphase(broadphase_type aBroadphase);
         const aabb_octree<box_collider>& broadphase_tree() const;
         const aabb_quadtree<box_collider_2d>& broadphase_2d_tree() const;
+        const dynamic_aabb_tree<box_collider>& broadphase_dynamic_tree() const;
+        const dynamic_aabb_tree<box_collider_2d>& broadphase_dynamic_2d_tree() const;
     private:
         void update_colliders();
-        void update_trees();
-        void detect_collisions();
+        template <typename Collider, typename AabbFunction>
+        void update_colliders(std::vector<entity_id> const& aDirty, bool aAll, std::vector<entity_id>& aKnown, AabbFunction aToAabb);
+        void update_trees(broadphase_type aBroadphase);
+        void detect_collisions(broadphase_type aBroadphase);
+        template <typename Broadphase>
+        void gather_collisions(Broadphase const& aBroadphase);
     public:
         struct meta
         {
@@ -99,8 +159,29 @@ namespace neogfx::game
             }
         };
     private:
+        // held for a whole cycle and while switching broadphase so that a broadphase is never cleared while in use
+        mutable std::recursive_mutex iBroadphaseMutex;
+        std::atomic<broadphase_type> iBroadphase;
         aabb_octree<box_collider> iBroadphaseTree;
         aabb_quadtree<box_collider_2d> iBroadphase2dTree;
+        sort_and_sweep<box_collider> iSortAndSweep;
+        sort_and_sweep<box_collider_2d> iSortAndSweep2d;
+        dynamic_aabb_tree<box_collider> iDynamicTree;
+        dynamic_aabb_tree<box_collider_2d> iDynamicTree2d;
         std::atomic<bool> iCollidersUpdated;
+        std::atomic<game::collision_delivery> iCollisionDelivery;
+        collision_pairs iCollisionPairs;
+        std::vector<collision_pairs> iCollisionPairBuffers;
+        // batch gathering waits on its partitions so it has a pool of its own: the cycle may itself be running on
+        // a default pool thread (e.g. under frame_scheduler)
+        std::unique_ptr<neolib::thread_pool> iCollisionPool;
+        mutable std::mutex iDirtyMutex;
+        std::vector<entity_id> iDirtyColliders;
+        bool iAllCollidersDirty;
+        std::vector<entity_id> iMovedColliders;
+        std::vector<entity_id> iRemovedColliders;
+        bool iAllCollidersMoved;
+        std::vector<entity_id> iKnownColliders;
+        std::vector<entity_id> iKnownColliders2d;
     };
 }
\ No newline at end of file
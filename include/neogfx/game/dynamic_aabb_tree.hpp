@@ -0,0 +1,478 @@
+// dynamic_aabb_tree.hpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2024 Leigh Johnston.  All Rights Reserved.
+
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <algorithm>
+
+#include <neogfx/game/i_ecs.hpp>
+#include <neogfx/game/entity_info.hpp>
+#include <neogfx/game/broadphase.hpp>
+
+namespace neogfx::game
+{
+    // Bounding volume hierarchy whose leaves hold fattened collider AABBs. A leaf is only re-inserted when its
+    // collider leaves the fattened bounds so most cycles touch nothing but the leaf's stored bounds; insertion
+    // picks the sibling by an area heuristic and the tree is kept balanced with AVL style rotations.
+    template <typename Collider>
+    class dynamic_aabb_tree
+    {
+    public:
+        typedef Collider collider_type;
+        typedef typename decltype(collider_type::currentAabb)::value_type aabb_type;
+        typedef typename detail::broadphase_traits<aabb_type>::vector_type vector_type;
+    private:
+        typedef std::int32_t node_index;
+        static constexpr node_index NullNode = -1;
+        struct node
+        {
+            aabb_type fatAabb;
+            aabb_type aabb;
+            std::uint64_t mask;
+            entity_id entity;
+            node_index parent; // next free node when on the free list
+            node_index left;
+            node_index right;
+            std::int32_t height; // leaves are 0, free nodes -1
+            std::uint32_t updateId;
+
+            bool is_leaf() const
+            {
+                return left == NullNode;
+            }
+        };
+    public:
+        dynamic_aabb_tree(i_ecs& aEcs, float aMargin = 2.0f) :
+            iEcs{ aEcs },
+            iMargin{ aMargin }
+        {
+        }
+    public:
+        float margin() const
+        {
+            return iMargin;
+        }
+        void clear()
+        {
+            iNodes.clear();
+            iProxies.clear();
+            iRoot = NullNode;
+            iFreeList = NullNode;
+            iCount = 0u;
+        }
+        void update()
+        {
+            if (++iUpdateId == 0u)
+                iUpdateId = 1u;
+            auto const& infos = iEcs.component<entity_info>();
+            auto const& colliders = iEcs.component<collider_type>();
+            for (auto entity : colliders.entities())
+            {
+                auto const& collider = colliders.entity_record(entity);
+                if (infos.entity_record(entity).destroyed || !collider.currentAabb)
+                    continue;
+                update_proxy(entity, collider);
+            }
+            for (auto proxy = iProxies.begin(); proxy != iProxies.end();)
+            {
+                if (iNodes[proxy->second].updateId != iUpdateId)
+                {
+                    remove_leaf(proxy->second);
+                    free_node(proxy->second);
+                    proxy = iProxies.erase(proxy);
+                }
+                else
+                    ++proxy;
+            }
+        }
+        // only touches the proxies of colliders that have moved (or been added) and of those removed
+        void update(std::vector<entity_id> const& aMoved, std::vector<entity_id> const& aRemoved)
+        {
+            auto const& infos = iEcs.component<entity_info>();
+            auto const& colliders = iEcs.component<collider_type>();
+            for (auto entity : aRemoved)
+                remove_proxy(entity);
+            for (auto entity : aMoved)
+            {
+                if (!colliders.has_entity_record(entity))
+                {
+                    remove_proxy(entity);
+                    continue;
+                }
+                auto const& collider = colliders.entity_record(entity);
+                if (infos.entity_record(entity).destroyed || !collider.currentAabb)
+                {
+                    remove_proxy(entity);
+                    continue;
+                }
+                update_proxy(entity, collider);
+            }
+        }
+        template <typename CollisionAction>
+        void collisions(CollisionAction aCollisionAction) const
+        {
+            collisions(0u, partition_size(), aCollisionAction);
+        }
+        std::size_t partition_size() const
+        {
+            return iNodes.size();
+        }
+        // queries from the leaves among nodes [aFirst, aLast) only so disjoint ranges can be queried concurrently
+        template <typename CollisionAction>
+        void collisions(std::size_t aFirst, std::size_t aLast, CollisionAction aCollisionAction) const
+        {
+            auto const& infos = iEcs.component<entity_info>();
+            for (auto leaf = static_cast<node_index>(aFirst); leaf < static_cast<node_index>(aLast); ++leaf)
+            {
+                if (iNodes[leaf].height != 0)
+                    continue;
+                query(iNodes[leaf].aabb, [&](node_index aHit)
+                {
+                    // each pair is reported from its lower indexed leaf only
+                    if (aHit <= leaf)
+                        return;
+                    auto const& lhs = iNodes[leaf];
+                    auto const& rhs = iNodes[aHit];
+                    if ((lhs.mask & rhs.mask) != 0 || !aabb_intersects(lhs.aabb, rhs.aabb))
+                        return;
+                    // an earlier collision handler may have destroyed either entity
+                    if (infos.entity_record(lhs.entity).destroyed || infos.entity_record(rhs.entity).destroyed)
+                        return;
+                    aCollisionAction(std::min(lhs.entity, rhs.entity), std::max(lhs.entity, rhs.entity));
+                });
+            }
+        }
+        template <typename ResultContainer>
+        void pick(const vector_type& aPoint, ResultContainer& aResult, std::function<bool(entity_id aMatch, const vector_type& aPoint)> aColliderPredicate = [](entity_id, const vector_type&) { return true; }) const
+        {
+            auto const& infos = iEcs.component<entity_info>();
+            aabb_type const point{ aPoint, aPoint };
+            query(point, [&](node_index aHit)
+            {
+                auto const& hit = iNodes[aHit];
+                if (aabb_intersects(hit.aabb, point) && !infos.entity_record(hit.entity).destroyed && aColliderPredicate(hit.entity, aPoint))
+                    aResult.insert(aResult.end(), hit.entity);
+            });
+        }
+        template <typename Visitor>
+        void visit_aabbs(const Visitor& aVisitor) const
+        {
+            for (auto const& n : iNodes)
+                if (n.height >= 0)
+                    aVisitor(n.fatAabb);
+        }
+    public:
+        std::uint32_t count() const
+        {
+            return iCount;
+        }
+        std::uint32_t depth() const
+        {
+            return iRoot != NullNode ? static_cast<std::uint32_t>(iNodes[iRoot].height) + 1u : 0u;
+        }
+    private:
+        void update_proxy(entity_id aEntity, const collider_type& aCollider)
+        {
+            auto const& current = *aCollider.currentAabb;
+            auto existing = iProxies.find(aEntity);
+            if (existing == iProxies.end())
+            {
+                auto const leaf = allocate_node();
+                iNodes[leaf].entity = aEntity;
+                iNodes[leaf].aabb = current;
+                iNodes[leaf].fatAabb = detail::broadphase_aabb_fattened(current, iMargin, vector_type{});
+                iNodes[leaf].mask = aCollider.mask;
+                iNodes[leaf].updateId = iUpdateId;
+                insert_leaf(leaf);
+                iProxies.emplace(aEntity, leaf);
+            }
+            else
+            {
+                auto const leaf = existing->second;
+                iNodes[leaf].aabb = current;
+                iNodes[leaf].mask = aCollider.mask;
+                iNodes[leaf].updateId = iUpdateId;
+                if (!detail::broadphase_aabb_contains(iNodes[leaf].fatAabb, current))
+                {
+                    remove_leaf(leaf);
+                    iNodes[leaf].fatAabb = detail::broadphase_aabb_fattened(current, iMargin,
+                        aCollider.previousAabb ? vector_type{ current.min - aCollider.previousAabb->min } : vector_type{});
+                    insert_leaf(leaf);
+                }
+            }
+        }
+        void remove_proxy(entity_id aEntity)
+        {
+            auto existing = iProxies.find(aEntity);
+            if (existing == iProxies.end())
+                return;
+            remove_leaf(existing->second);
+            free_node(existing->second);
+            iProxies.erase(existing);
+        }
+        template <typename Visitor>
+        void query(const aabb_type& aAabb, const Visitor& aVisitor) const
+        {
+            if (iRoot == NullNode)
+                return;
+            thread_local std::vector<node_index> stack;
+            stack.clear();
+            stack.push_back(iRoot);
+            while (!stack.empty())
+            {
+                auto const index = stack.back();
+                stack.pop_back();
+                auto const& n = iNodes[index];
+                if (!aabb_intersects(n.fatAabb, aAabb))
+                    continue;
+                if (n.is_leaf())
+                    aVisitor(index);
+                else
+                {
+                    stack.push_back(n.left);
+                    stack.push_back(n.right);
+                }
+            }
+        }
+        node_index allocate_node()
+        {
+            node_index result;
+            if (iFreeList != NullNode)
+            {
+                result = iFreeList;
+                iFreeList = iNodes[result].parent;
+            }
+            else
+            {
+                result = static_cast<node_index>(iNodes.size());
+                iNodes.emplace_back();
+            }
+            auto& n = iNodes[result];
+            n.parent = NullNode;
+            n.left = NullNode;
+            n.right = NullNode;
+            n.height = 0;
+            n.mask = 0u;
+            n.updateId = 0u;
+            ++iCount;
+            return result;
+        }
+        void free_node(node_index aNode)
+        {
+            iNodes[aNode].parent = iFreeList;
+            iNodes[aNode].height = -1;
+            iFreeList = aNode;
+            --iCount;
+        }
+        float insertion_cost(node_index aChild, const aabb_type& aLeafAabb) const
+        {
+            auto const& child = iNodes[aChild];
+            auto const combined = detail::broadphase_aabb_cost(aabb_union(aLeafAabb, child.fatAabb));
+            return child.is_leaf() ? combined : combined - detail::broadphase_aabb_cost(child.fatAabb);
+        }
+        void insert_leaf(node_index aLeaf)
+        {
+            if (iRoot == NullNode)
+            {
+                iRoot = aLeaf;
+                iNodes[iRoot].parent = NullNode;
+                return;
+            }
+            auto const leafAabb = iNodes[aLeaf].fatAabb;
+            node_index index = iRoot;
+            while (!iNodes[index].is_leaf())
+            {
+                auto const& n = iNodes[index];
+                auto const area = detail::broadphase_aabb_cost(n.fatAabb);
+                auto const combinedArea = detail::broadphase_aabb_cost(aabb_union(n.fatAabb, leafAabb));
+                // cost of a new parent for this node and the leaf, and the minimum cost of pushing the leaf further down
+                auto const cost = 2.0f * combinedArea;
+                auto const inheritanceCost = 2.0f * (combinedArea - area);
+                auto const costLeft = insertion_cost(n.left, leafAabb) + inheritanceCost;
+                auto const costRight = insertion_cost(n.right, leafAabb) + inheritanceCost;
+                if (cost < costLeft && cost < costRight)
+                    break;
+                index = (costLeft < costRight ? n.left : n.right);
+            }
+            auto const sibling = index;
+            auto const oldParent = iNodes[sibling].parent;
+            auto const newParent = allocate_node();
+            iNodes[newParent].parent = oldParent;
+            iNodes[newParent].fatAabb = aabb_union(leafAabb, iNodes[sibling].fatAabb);
+            iNodes[newParent].height = iNodes[sibling].height + 1;
+            iNodes[newParent].left = sibling;
+            iNodes[newParent].right = aLeaf;
+            iNodes[sibling].parent = newParent;
+            iNodes[aLeaf].parent = newParent;
+            if (oldParent != NullNode)
+            {
+                if (iNodes[oldParent].left == sibling)
+                    iNodes[oldParent].left = newParent;
+                else
+                    iNodes[oldParent].right = newParent;
+            }
+            else
+                iRoot = newParent;
+            refit(iNodes[aLeaf].parent);
+        }
+        void remove_leaf(node_index aLeaf)
+        {
+            if (aLeaf == iRoot)
+            {
+                iRoot = NullNode;
+                return;
+            }
+            auto const parent = iNodes[aLeaf].parent;
+            auto const grandParent = iNodes[parent].parent;
+            auto const sibling = (iNodes[parent].left == aLeaf ? iNodes[parent].right : iNodes[parent].left);
+            if (grandParent != NullNode)
+            {
+                if (iNodes[grandParent].left == parent)
+                    iNodes[grandParent].left = sibling;
+                else
+                    iNodes[grandParent].right = sibling;
+                iNodes[sibling].parent = grandParent;
+                free_node(parent);
+                refit(grandParent);
+            }
+            else
+            {
+                iRoot = sibling;
+                iNodes[sibling].parent = NullNode;
+                free_node(parent);
+            }
+            iNodes[aLeaf].parent = NullNode;
+        }
+        // walks up from aIndex rebalancing and recomputing bounds and heights
+        void refit(node_index aIndex)
+        {
+            while (aIndex != NullNode)
+            {
+                aIndex = balance(aIndex);
+                auto& n = iNodes[aIndex];
+                n.height = 1 + std::max(iNodes[n.left].height, iNodes[n.right].height);
+                n.fatAabb = aabb_union(iNodes[n.left].fatAabb, iNodes[n.right].fatAabb);
+                aIndex = n.parent;
+            }
+        }
+        // if aA is unbalanced rotates its taller child up; returns the index of the subtree's new root
+        node_index balance(node_index aA)
+        {
+            auto& a = iNodes[aA];
+            if (a.is_leaf() || a.height < 2)
+                return aA;
+            auto const iB = a.left;
+            auto const iC = a.right;
+            auto& b = iNodes[iB];
+            auto& c = iNodes[iC];
+            auto const difference = c.height - b.height;
+            if (difference > 1)
+            {
+                auto const iF = c.left;
+                auto const iG = c.right;
+                auto& f = iNodes[iF];
+                auto& g = iNodes[iG];
+                c.left = aA;
+                c.parent = a.parent;
+                a.parent = iC;
+                replace_child(c.parent, aA, iC);
+                if (f.height > g.height)
+                {
+                    c.right = iF;
+                    a.right = iG;
+                    g.parent = aA;
+                    a.fatAabb = aabb_union(b.fatAabb, g.fatAabb);
+                    c.fatAabb = aabb_union(a.fatAabb, f.fatAabb);
+                    a.height = 1 + std::max(b.height, g.height);
+                    c.height = 1 + std::max(a.height, f.height);
+                }
+                else
+                {
+                    c.right = iG;
+                    a.right = iF;
+                    f.parent = aA;
+                    a.fatAabb = aabb_union(b.fatAabb, f.fatAabb);
+                    c.fatAabb = aabb_union(a.fatAabb, g.fatAabb);
+                    a.height = 1 + std::max(b.height, f.height);
+                    c.height = 1 + std::max(a.height, g.height);
+                }
+                return iC;
+            }
+            if (difference < -1)
+            {
+                auto const iD = b.left;
+                auto const iE = b.right;
+                auto& d = iNodes[iD];
+                auto& e = iNodes[iE];
+                b.left = aA;
+                b.parent = a.parent;
+                a.parent = iB;
+                replace_child(b.parent, aA, iB);
+                if (d.height > e.height)
+                {
+                    b.right = iD;
+                    a.left = iE;
+                    e.parent = aA;
+                    a.fatAabb = aabb_union(c.fatAabb, e.fatAabb);
+                    b.fatAabb = aabb_union(a.fatAabb, d.fatAabb);
+                    a.height = 1 + std::max(c.height, e.height);
+                    b.height = 1 + std::max(a.height, d.height);
+                }
+                else
+                {
+                    b.right = iE;
+                    a.left = iD;
+                    d.parent = aA;
+                    a.fatAabb = aabb_union(c.fatAabb, d.fatAabb);
+                    b.fatAabb = aabb_union(a.fatAabb, e.fatAabb);
+                    a.height = 1 + std::max(c.height, d.height);
+                    b.height = 1 + std::max(a.height, e.height);
+                }
+                return iB;
+            }
+            return aA;
+        }
+        void replace_child(node_index aParent, node_index aOldChild, node_index aNewChild)
+        {
+            if (aParent == NullNode)
+            {
+                iRoot = aNewChild;
+                return;
+            }
+            if (iNodes[aParent].left == aOldChild)
+                iNodes[aParent].left = aNewChild;
+            else
+                iNodes[aParent].right = aNewChild;
+        }
+    private:
+        i_ecs& iEcs;
+        float iMargin;
+        std::vector<node> iNodes;
+        node_index iRoot = NullNode;
+        node_index iFreeList = NullNode;
+        std::uint32_t iCount = 0u;
+        std::uint32_t iUpdateId = 0u;
+        std::unordered_map<entity_id, node_index> iProxies;
+    };
+}
@@ -21,8 +21,13 @@
 
 #include <neogfx/neogfx.hpp>
 
+#include <atomic>
+#include <functional>
+#include <variant>
+
 #include <neolib/ecs/ecs.hpp>
 
+#include <neogfx/core/mpsc_queue.hpp>
 #include <neogfx/gfx/i_vertex_provider.hpp>
 
 namespace neogfx
@@ -34,6 +39,8 @@ namespace neogfx
         class ecs : public neolib::ecs::ecs, public i_vertex_provider
         {
             typedef neolib::ecs::ecs base_type;
+        public:
+            typedef std::function<void(ecs&)> deferred_command;
         public:
             ecs(ecs_flags aCreationFlags = ecs_flags::Default);
             ~ecs();
@@ -41,12 +48,74 @@ namespace neogfx
             bool run_threaded(const system_id& aSystemId) const final;
         public:
             void destroy_entity(entity_id aEntityId, bool aNotify = true) final;
+        public:
+            // Entities created or destroyed through these only appear or disappear when apply_deferred() is called at
+            // a frame barrier, so systems iterating components never see records of dead entities and a burst of
+            // spawns is added in one go. Creation may be deferred from any thread without locking. A deferred destroy
+            // marks the entity_info record destroyed straight away so the caller must have write access to entity_info
+            // (hold its component lock or be scheduled with entity_info in its write set); with no frame barrier
+            // registered the entity is destroyed asynchronously instead.
+            void defer_destroy_entity(entity_id aEntityId);
+            template <typename... ComponentData>
+            void defer_create_entity(const entity_archetype_id& aArchetypeId, ComponentData&&... aComponentData)
+            {
+                defer([aArchetypeId, ... componentData = std::forward<ComponentData>(aComponentData)](ecs& aEcs) mutable
+                {
+                    aEcs.create_entity(aArchetypeId, std::move(componentData)...);
+                });
+            }
+            // aArchetype must outlive the command
+            template <typename... ComponentData>
+            void defer_create_entity(const i_entity_archetype& aArchetype, ComponentData&&... aComponentData)
+            {
+                defer([&aArchetype, ... componentData = std::forward<ComponentData>(aComponentData)](ecs& aEcs) mutable
+                {
+                    aEcs.create_entity(aArchetype, std::move(componentData)...);
+                });
+            }
+            void defer(deferred_command aCommand);
+            std::size_t apply_deferred();
+            // registered by whatever calls apply_deferred() each frame (frame_scheduler, simple_physics when chained)
+            void add_frame_barrier();
+            void remove_frame_barrier();
+            bool has_frame_barrier() const;
         public:
             bool cacheable() const final;
             const game::component<game::mesh_render_cache>& cache() const final;
             game::component<game::mesh_render_cache>& cache() final;
+        private:
+            mpsc_queue<std::variant<entity_id, deferred_command>> iDeferred;
+            std::atomic<std::uint32_t> iFrameBarriers = 0u;
         };
 
+        // deferred if aEcs is a neogfx ECS, otherwise the entity is destroyed asynchronously
+        inline void defer_destroy_entity(i_ecs& aEcs, entity_id aEntityId)
+        {
+            if (auto neogfxEcs = dynamic_cast<ecs*>(&aEcs))
+                neogfxEcs->defer_destroy_entity(aEntityId);
+            else
+                aEcs.async_destroy_entity(aEntityId, false);
+        }
+
+        inline std::size_t apply_deferred(i_ecs& aEcs)
+        {
+            if (auto neogfxEcs = dynamic_cast<ecs*>(&aEcs))
+                return neogfxEcs->apply_deferred();
+            return 0u;
+        }
+
+        inline void add_frame_barrier(i_ecs& aEcs)
+        {
+            if (auto neogfxEcs = dynamic_cast<ecs*>(&aEcs))
+                neogfxEcs->add_frame_barrier();
+        }
+
+        inline void remove_frame_barrier(i_ecs& aEcs)
+        {
+            if (auto neogfxEcs = dynamic_cast<ecs*>(&aEcs))
+                neogfxEcs->remove_frame_barrier();
+        }
+
         template <typename... Systems>
         std::shared_ptr<ecs> make_ecs(ecs_flags aCreationFlags = ecs_flags::Default)
         {
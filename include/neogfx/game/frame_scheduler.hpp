@@ -0,0 +1,124 @@
+// frame_scheduler.hpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2024 Leigh Johnston.  All Rights Reserved.
+
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+
+#include <neolib/core/uuid.hpp>
+#include <neolib/task/thread_pool.hpp>
+
+#include <neogfx/core/event.hpp>
+#include <neogfx/game/i_ecs.hpp>
+#include <neogfx/game/i_system.hpp>
+
+namespace neogfx::game
+{
+    typedef std::vector<neolib::uuid> component_set;
+
+    template <typename... Components>
+    inline component_set components()
+    {
+        return component_set{ Components::meta::id()... };
+    }
+
+    struct system_execution
+    {
+        i_system const* system;
+        std::thread::id thread;
+        std::chrono::steady_clock::time_point start;
+        std::chrono::steady_clock::time_point end;
+    };
+
+    struct frame_timeline
+    {
+        std::uint64_t frame;
+        std::chrono::steady_clock::time_point start;
+        std::chrono::steady_clock::time_point end;
+        std::vector<system_execution> systems;
+    };
+
+    // Runs a frame's systems as a dependency graph: each system declares the components (and shared components)
+    // it reads and writes and a system that conflicts with an earlier registered one runs after it, otherwise they
+    // run in parallel on the scheduler's own thread pool (systems may themselves wait on work queued to the default
+    // pool so sharing it could deadlock). Create the ECS with ecs_flags::NoThreads so that systems are only
+    // applied by the scheduler.
+    class frame_scheduler
+    {
+    public:
+        define_event(FrameCompleted, frame_completed, frame_timeline const&)
+    public:
+        struct system_already_scheduled : std::logic_error { system_already_scheduled() : std::logic_error("neogfx::game::frame_scheduler::system_already_scheduled") {} };
+        struct system_not_scheduled : std::logic_error { system_not_scheduled() : std::logic_error("neogfx::game::frame_scheduler::system_not_scheduled") {} };
+        struct cyclic_dependency : std::logic_error { cyclic_dependency() : std::logic_error("neogfx::game::frame_scheduler::cyclic_dependency") {} };
+    private:
+        struct node
+        {
+            i_system* system;
+            component_set reads;
+            component_set writes;
+            std::function<void()> task;
+            std::vector<i_system const*> after;
+            std::vector<std::size_t> successors;
+            std::size_t pending;
+        };
+    public:
+        frame_scheduler(i_ecs& aEcs);
+        ~frame_scheduler();
+    public:
+        // aTask defaults to the system's apply()
+        void add(i_system& aSystem, component_set const& aReads, component_set const& aWrites, std::function<void()> aTask = {});
+        template <typename System>
+        void add(component_set const& aReads, component_set const& aWrites, std::function<void()> aTask = {})
+        {
+            add(iEcs.system<System>(), aReads, aWrites, aTask);
+        }
+        void remove(i_system const& aSystem);
+        // explicit ordering for systems that communicate other than through components
+        void add_dependency(i_system const& aBefore, i_system const& aAfter);
+        // time, simple_physics, animator and collision_detector with the components they use
+        void add_standard_systems();
+        bool scheduled(i_system const& aSystem) const;
+    public:
+        void run_frame();
+        frame_timeline const& last_frame() const;
+    private:
+        std::size_t index_of(i_system const& aSystem) const;
+        void build_graph();
+        void run_node(std::size_t aNode);
+    private:
+        i_ecs& iEcs;
+        std::vector<node> iNodes;
+        std::uint64_t iFrame;
+        frame_timeline iTimeline;
+        std::mutex iMutex;
+        std::condition_variable iCompleted;
+        std::vector<std::size_t> iFinished;
+        std::exception_ptr iException;
+        neolib::thread_pool iThreadPool;
+    };
+}
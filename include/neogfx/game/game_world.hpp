@@ -24,6 +24,8 @@
 
 #include <neogfx/core/event.hpp>
 #include <neogfx/game/system.hpp>
+#include <neogfx/game/broadphase.hpp>
+#include <neogfx/game/barnes_hut.hpp>
 
 namespace neogfx::game
 {
@@ -45,6 +47,14 @@ namespace neogfx::game
         bool universal_gravitation_enabled() const;
         void enable_universal_gravitation();
         void disable_universal_gravitation();
+        game::gravitation_solver gravitation_solver() const;
+        void set_gravitation_solver(game::gravitation_solver aSolver);
+        float barnes_hut_theta() const;
+        void set_barnes_hut_theta(float aTheta);
+        bool multithreaded_gravitation() const;
+        void set_multithreaded_gravitation(bool aMultithreaded);
+        broadphase_type broadphase() const;
+        void set_broadphase(broadphase_type aBroadphase);
     public:
         struct meta
         {
@@ -61,5 +71,9 @@ namespace neogfx::game
         };
     private:
         bool iUniversalGravitationEnabled;
+        game::gravitation_solver iGravitationSolver;
+        float iBarnesHutTheta;
+        bool iMultithreadedGravitation;
+        broadphase_type iBroadphase;
     };
 }
\ No newline at end of file
@@ -39,6 +39,9 @@ namespace neogfx::game
         i32 layer;
         std::optional<game::filter> filter;
         bool barrier;
+        // drawing order within the layer doesn't matter so consecutive order independent renderers may be regrouped
+        // by texture in order to batch
+        bool orderIndependent;
 
         struct meta : i_component_data::meta
         {
@@ -54,7 +57,7 @@ namespace neogfx::game
             }
             static std::uint32_t field_count()
             {
-                return 4;
+                return 6;
             }
             static component_data_field_type field_type(std::uint32_t aFieldIndex)
             {
@@ -69,6 +72,7 @@ namespace neogfx::game
                 case 3:
                     return component_data_field_type::ComponentData | component_data_field_type::Optional;
                 case 4:
+                case 5:
                     return component_data_field_type::Bool;
                 default:
                     throw invalid_field_index();
@@ -87,6 +91,7 @@ namespace neogfx::game
                 case 2:
                     return filter::meta::id();
                 case 4:
+                case 5:
                     return neolib::uuid{};
                 default:
                     throw invalid_field_index();
@@ -100,7 +105,8 @@ namespace neogfx::game
                     "Patches",
                     "Layer",
                     "Filter",
-                    "Barrier"
+                    "Barrier",
+                    "Order Independent"
                 };
                 return sFieldNames[aFieldIndex];
             }
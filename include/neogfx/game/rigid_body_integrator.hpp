@@ -0,0 +1,88 @@
+// rigid_body_integrator.hpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2024 Leigh Johnston.  All Rights Reserved.
+
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+
+#include <vector>
+
+#include <neogfx/core/numerical.hpp>
+#include <neogfx/game/i_ecs.hpp>
+#include <neogfx/game/barnes_hut.hpp>
+
+namespace neogfx::game
+{
+    // Integrates rigid bodies in structure of arrays form: the live bodies are gathered once, advanced over any
+    // number of steps by loops over contiguous floats and then scattered back to the rigid_body component.
+    class rigid_body_integrator
+    {
+    public:
+        struct gravitation
+        {
+            vec3f uniform;
+            bool universal;
+            float constant;
+            gravitation_solver solver;
+            bool multithreaded;
+        };
+    public:
+        rigid_body_integrator();
+    public:
+        std::size_t size() const;
+        // gathers the bodies of entities not destroyed; the caller must hold the entity_info and rigid_body locks until scatter
+        void gather(i_ecs& aEcs);
+        void step(float aElapsedTime, gravitation const& aGravitation);
+        // writes the bodies back, appending entities whose position or angle has changed to aMoved
+        void scatter(i_ecs& aEcs, std::vector<entity_id>& aMoved) const;
+    public:
+        game::barnes_hut& barnes_hut();
+    private:
+        void apply_gravitation(gravitation const& aGravitation);
+        void apply_thrust();
+    private:
+        std::vector<std::uint32_t> iAlive;      // indices into the rigid_body component data
+        std::vector<std::uint32_t> iThrusting;  // bodies with an acceleration of their own (rotated by their angle)
+        std::vector<std::uint32_t> iMassive;
+        std::vector<float> iPositionX;
+        std::vector<float> iPositionY;
+        std::vector<float> iPositionZ;
+        std::vector<float> iVelocityX;
+        std::vector<float> iVelocityY;
+        std::vector<float> iVelocityZ;
+        std::vector<float> iAccelerationX;
+        std::vector<float> iAccelerationY;
+        std::vector<float> iAccelerationZ;
+        std::vector<float> iAngleX;
+        std::vector<float> iAngleY;
+        std::vector<float> iAngleZ;
+        std::vector<float> iSpinX;
+        std::vector<float> iSpinY;
+        std::vector<float> iSpinZ;
+        std::vector<float> iMass;
+        std::vector<float> iMassiveX;
+        std::vector<float> iMassiveY;
+        std::vector<float> iMassiveZ;
+        std::vector<float> iMassiveMass;
+        std::vector<vec3f> iLocalAcceleration;
+        std::vector<vec3f> iPositions;
+        std::vector<vec3f> iUniversal;
+        game::barnes_hut iBarnesHut;
+    };
+}
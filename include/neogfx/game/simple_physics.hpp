@@ -26,6 +26,7 @@
 #include <neogfx/game/mesh_filter.hpp>
 #include <neogfx/game/rigid_body.hpp>
 #include <neogfx/game/mesh_render_cache.hpp>
+#include <neogfx/game/rigid_body_integrator.hpp>
 
 namespace neogfx::game
 {
@@ -45,6 +46,15 @@ namespace neogfx::game
         void disable_universal_gravitation();
     public:
         void yield_after(std::chrono::duration<double, std::milli> aTime);
+        // Whether each physics step also updates colliders and animations and advances time (the default) or leaves
+        // that to a frame_scheduler.
+        bool chained_systems() const;
+        void set_chained_systems(bool aChainedSystems);
+        // Integrate up to aSteps fixed timesteps between gathering and scattering rigid bodies; ApplyingPhysics and
+        // PhysicsApplied are then triggered once per batch rather than once per step. A recording snapshot_history
+        // forces single steps so that it sees every tick.
+        std::uint32_t maximum_batch_steps() const;
+        void set_maximum_batch_steps(std::uint32_t aSteps);
     public:
         struct meta
         {
@@ -59,7 +69,14 @@ namespace neogfx::game
                 return sName;
             }
         };
+    private:
+        template <typename... Components>
+        bool integrate();
     private:
         std::chrono::duration<double, std::milli> iYieldTime = std::chrono::duration<double, std::milli>{ 1.0 };
+        bool iChainedSystems = true;
+        std::uint32_t iMaximumBatchSteps = 1u;
+        rigid_body_integrator iIntegrator;
+        std::vector<entity_id> iMoved;
     };
 }
\ No newline at end of file
@@ -0,0 +1,370 @@
+// sort_and_sweep.hpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2024 Leigh Johnston.  All Rights Reserved.
+
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+
+#include <vector>
+#include <array>
+#include <unordered_map>
+#include <functional>
+#include <numeric>
+#include <limits>
+#include <algorithm>
+
+#include <neogfx/game/i_ecs.hpp>
+#include <neogfx/game/entity_info.hpp>
+#include <neogfx/game/broadphase.hpp>
+
+namespace neogfx::game
+{
+    // Collider bounds held in flat arrays (structure of arrays) sorted on the lower bound along one axis. Colliders
+    // only move a little each cycle so keeping the arrays sorted is an insertion sort over an almost sorted array;
+    // the sweep then only compares colliders whose intervals along that axis overlap. The incremental update only
+    // touches the entries of colliders that changed, moving each to its new place, and leaves removed colliders as
+    // vacant entries until there are enough to be worth compacting; the sweep axis is only chosen again by a full
+    // update.
+    template <typename Collider>
+    class sort_and_sweep
+    {
+    public:
+        typedef Collider collider_type;
+        typedef typename decltype(collider_type::currentAabb)::value_type aabb_type;
+        typedef typename detail::broadphase_traits<aabb_type>::vector_type vector_type;
+        static constexpr std::size_t dimensions = detail::broadphase_traits<aabb_type>::dimensions;
+    public:
+        sort_and_sweep(i_ecs& aEcs) :
+            iEcs{ aEcs },
+            iAxis{ 0u }
+        {
+        }
+    public:
+        std::size_t axis() const
+        {
+            return iAxis;
+        }
+        void clear()
+        {
+            iMin.clear();
+            iMax.clear();
+            iBounds.clear();
+            iMasks.clear();
+            iEntities.clear();
+            iIndices.clear();
+            iVacant = 0u;
+        }
+        void update()
+        {
+            auto const& infos = iEcs.component<entity_info>();
+            auto const& colliders = iEcs.component<collider_type>();
+            std::array<double, dimensions> sum = {};
+            std::array<double, dimensions> sumOfSquares = {};
+            std::size_t live = 0u;
+            auto accumulate = [&](aabb_type const& aAabb)
+            {
+                ++live;
+                for (std::size_t a = 0u; a < dimensions; ++a)
+                {
+                    double const center = (aAabb.min[a] + aAabb.max[a]) / 2.0;
+                    sum[a] += center;
+                    sumOfSquares[a] += center * center;
+                }
+            };
+            // refresh existing entries in place (keeping last cycle's order), dropping those whose entity has gone
+            std::size_t out = 0u;
+            for (std::size_t in = 0u; in < iEntities.size(); ++in)
+            {
+                auto const entity = iEntities[in];
+                if (entity == null_entity || !colliders.has_entity_record(entity))
+                {
+                    iIndices.erase(entity);
+                    continue;
+                }
+                auto const& collider = colliders.entity_record(entity);
+                bool const isLive = !infos.entity_record(entity).destroyed && collider.currentAabb;
+                assign(out++, entity, collider, isLive);
+                if (isLive)
+                    accumulate(*collider.currentAabb);
+            }
+            resize(out);
+            iVacant = 0u;
+            if (iIndices.size() != colliders.entities().size())
+                for (auto entity : colliders.entities())
+                    if (iIndices.try_emplace(entity, 0u).second)
+                    {
+                        auto const& collider = colliders.entity_record(entity);
+                        bool const isLive = !infos.entity_record(entity).destroyed && collider.currentAabb;
+                        resize(iEntities.size() + 1u);
+                        assign(iEntities.size() - 1u, entity, collider, isLive);
+                        if (isLive)
+                            accumulate(*collider.currentAabb);
+                    }
+            // sweep along the axis with the greatest spread; switching axis needs a full sort
+            std::size_t bestAxis = iAxis;
+            if (live > 1u)
+            {
+                auto variance = [&](std::size_t a) { return sumOfSquares[a] / live - (sum[a] / live) * (sum[a] / live); };
+                for (std::size_t a = 0u; a < dimensions; ++a)
+                    if (variance(a) > variance(bestAxis) * 2.0)
+                        bestAxis = a;
+            }
+            if (bestAxis != iAxis)
+            {
+                iAxis = bestAxis;
+                for (std::size_t i = 0u; i < iEntities.size(); ++i)
+                    if (iMin[i] <= iMax[i])
+                    {
+                        iMin[i] = iBounds[i].min[iAxis];
+                        iMax[i] = iBounds[i].max[iAxis];
+                    }
+                full_sort();
+            }
+            else
+                insertion_sort();
+            reindex();
+        }
+        // aMoved includes colliders added since the last update and may include entities without this collider
+        void update(std::vector<entity_id> const& aMoved, std::vector<entity_id> const& aRemoved)
+        {
+            for (auto entity : aRemoved)
+                vacate(entity);
+            if (!aMoved.empty())
+            {
+                auto const& infos = iEcs.component<entity_info>();
+                auto const& colliders = iEcs.component<collider_type>();
+                for (auto entity : aMoved)
+                {
+                    if (!colliders.has_entity_record(entity))
+                    {
+                        vacate(entity);
+                        continue;
+                    }
+                    auto const& collider = colliders.entity_record(entity);
+                    bool const isLive = !infos.entity_record(entity).destroyed && collider.currentAabb;
+                    auto existing = iIndices.find(entity);
+                    if (existing == iIndices.end())
+                    {
+                        resize(iEntities.size() + 1u);
+                        existing = iIndices.emplace(entity, iEntities.size() - 1u).first;
+                    }
+                    assign(existing->second, entity, collider, isLive);
+                    sift(existing->second);
+                }
+            }
+            if (iVacant > iEntities.size() / 2u)
+                compact();
+        }
+        template <typename CollisionAction>
+        void collisions(CollisionAction aCollisionAction) const
+        {
+            collisions(0u, partition_size(), aCollisionAction);
+        }
+        std::size_t partition_size() const
+        {
+            return iEntities.size();
+        }
+        // sweeps from the entries in [aFirst, aLast) only so disjoint ranges can be swept concurrently
+        template <typename CollisionAction>
+        void collisions(std::size_t aFirst, std::size_t aLast, CollisionAction aCollisionAction) const
+        {
+            auto const& infos = iEcs.component<entity_info>();
+            auto const count = iEntities.size();
+            for (std::size_t i = aFirst; i < aLast; ++i)
+            {
+                auto const maxI = iMax[i];
+                for (std::size_t j = i + 1u; j < count && iMin[j] <= maxI; ++j)
+                {
+                    if ((iMasks[i] & iMasks[j]) != 0 || !aabb_intersects(iBounds[i], iBounds[j]))
+                        continue;
+                    // an earlier collision handler may have destroyed either entity
+                    if (infos.entity_record(iEntities[i]).destroyed || infos.entity_record(iEntities[j]).destroyed)
+                        continue;
+                    aCollisionAction(std::min(iEntities[i], iEntities[j]), std::max(iEntities[i], iEntities[j]));
+                }
+            }
+        }
+        template <typename ResultContainer>
+        void pick(const vector_type& aPoint, ResultContainer& aResult, std::function<bool(entity_id aMatch, const vector_type& aPoint)> aColliderPredicate = [](entity_id, const vector_type&) { return true; }) const
+        {
+            auto const& infos = iEcs.component<entity_info>();
+            aabb_type const point{ aPoint, aPoint };
+            auto const end = static_cast<std::size_t>(std::distance(iMin.begin(), std::upper_bound(iMin.begin(), iMin.end(), aPoint[iAxis])));
+            for (std::size_t i = 0u; i < end; ++i)
+                if (iMax[i] >= aPoint[iAxis] && aabb_intersects(iBounds[i], point) &&
+                    !infos.entity_record(iEntities[i]).destroyed && aColliderPredicate(iEntities[i], aPoint))
+                    aResult.insert(aResult.end(), iEntities[i]);
+        }
+        template <typename Visitor>
+        void visit_aabbs(const Visitor& aVisitor) const
+        {
+            for (std::size_t i = 0u; i < iEntities.size(); ++i)
+                if (iMin[i] <= iMax[i])
+                    aVisitor(iBounds[i]);
+        }
+    public:
+        std::uint32_t count() const
+        {
+            return static_cast<std::uint32_t>(iEntities.size() - iVacant);
+        }
+    private:
+        void resize(std::size_t aSize)
+        {
+            iMin.resize(aSize);
+            iMax.resize(aSize);
+            iBounds.resize(aSize);
+            iMasks.resize(aSize);
+            iEntities.resize(aSize);
+        }
+        // entries without bounds get an empty interval at +infinity: they sort last and never overlap anything
+        void assign(std::size_t aIndex, entity_id aEntity, const collider_type& aCollider, bool aLive)
+        {
+            iEntities[aIndex] = aEntity;
+            iMasks[aIndex] = aCollider.mask;
+            if (aLive)
+            {
+                iBounds[aIndex] = *aCollider.currentAabb;
+                iMin[aIndex] = aCollider.currentAabb->min[iAxis];
+                iMax[aIndex] = aCollider.currentAabb->max[iAxis];
+            }
+            else
+            {
+                iMin[aIndex] = std::numeric_limits<float>::infinity();
+                iMax[aIndex] = -std::numeric_limits<float>::infinity();
+            }
+        }
+        void vacate(entity_id aEntity)
+        {
+            auto const existing = iIndices.find(aEntity);
+            if (existing == iIndices.end())
+                return;
+            auto const index = existing->second;
+            iIndices.erase(existing);
+            iEntities[index] = null_entity;
+            iMin[index] = std::numeric_limits<float>::infinity();
+            iMax[index] = -std::numeric_limits<float>::infinity();
+            ++iVacant;
+            sift(index);
+        }
+        // moves one entry to its place in otherwise sorted arrays
+        void sift(std::size_t aIndex)
+        {
+            auto index = aIndex;
+            for (; index > 0u && iMin[index - 1u] > iMin[index]; --index)
+                swap_entries(index - 1u, index);
+            for (; index + 1u < iEntities.size() && iMin[index + 1u] < iMin[index]; ++index)
+                swap_entries(index, index + 1u);
+        }
+        void swap_entries(std::size_t aLeft, std::size_t aRight)
+        {
+            std::swap(iMin[aLeft], iMin[aRight]);
+            std::swap(iMax[aLeft], iMax[aRight]);
+            std::swap(iBounds[aLeft], iBounds[aRight]);
+            std::swap(iMasks[aLeft], iMasks[aRight]);
+            std::swap(iEntities[aLeft], iEntities[aRight]);
+            if (iEntities[aLeft] != null_entity)
+                iIndices[iEntities[aLeft]] = aLeft;
+            if (iEntities[aRight] != null_entity)
+                iIndices[iEntities[aRight]] = aRight;
+        }
+        void compact()
+        {
+            std::size_t out = 0u;
+            for (std::size_t in = 0u; in < iEntities.size(); ++in)
+                if (iEntities[in] != null_entity)
+                {
+                    if (out != in)
+                    {
+                        iMin[out] = iMin[in];
+                        iMax[out] = iMax[in];
+                        iBounds[out] = iBounds[in];
+                        iMasks[out] = iMasks[in];
+                        iEntities[out] = iEntities[in];
+                    }
+                    ++out;
+                }
+            resize(out);
+            iVacant = 0u;
+            reindex();
+        }
+        void reindex()
+        {
+            for (std::size_t i = 0u; i < iEntities.size(); ++i)
+                iIndices[iEntities[i]] = i;
+        }
+        void insertion_sort()
+        {
+            for (std::size_t i = 1u; i < iEntities.size(); ++i)
+            {
+                if (!(iMin[i] < iMin[i - 1u]))
+                    continue;
+                auto const min = iMin[i];
+                auto const max = iMax[i];
+                auto const bounds = iBounds[i];
+                auto const mask = iMasks[i];
+                auto const entity = iEntities[i];
+                std::size_t j = i;
+                for (; j > 0u && iMin[j - 1u] > min; --j)
+                {
+                    iMin[j] = iMin[j - 1u];
+                    iMax[j] = iMax[j - 1u];
+                    iBounds[j] = iBounds[j - 1u];
+                    iMasks[j] = iMasks[j - 1u];
+                    iEntities[j] = iEntities[j - 1u];
+                }
+                iMin[j] = min;
+                iMax[j] = max;
+                iBounds[j] = bounds;
+                iMasks[j] = mask;
+                iEntities[j] = entity;
+            }
+        }
+        void full_sort()
+        {
+            thread_local std::vector<std::uint32_t> order;
+            order.resize(iEntities.size());
+            std::iota(order.begin(), order.end(), 0u);
+            std::sort(order.begin(), order.end(), [&](std::uint32_t lhs, std::uint32_t rhs) { return iMin[lhs] < iMin[rhs]; });
+            permute(iMin, order);
+            permute(iMax, order);
+            permute(iBounds, order);
+            permute(iMasks, order);
+            permute(iEntities, order);
+        }
+        template <typename T>
+        static void permute(std::vector<T>& aValues, std::vector<std::uint32_t> const& aOrder)
+        {
+            std::vector<T> permuted;
+            permuted.reserve(aValues.size());
+            for (auto i : aOrder)
+                permuted.push_back(aValues[i]);
+            aValues.swap(permuted);
+        }
+    private:
+        i_ecs& iEcs;
+        std::size_t iAxis;
+        std::vector<float> iMin;
+        std::vector<float> iMax;
+        std::vector<aabb_type> iBounds;
+        std::vector<std::uint64_t> iMasks;
+        std::vector<entity_id> iEntities;
+        std::unordered_map<entity_id, std::size_t> iIndices;
+        std::size_t iVacant = 0u;
+    };
+}
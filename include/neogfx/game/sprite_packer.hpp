@@ -0,0 +1,65 @@
+// sprite_packer.hpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2024 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <neogfx/gfx/i_texture.hpp>
+#include <neogfx/gfx/i_texture_atlas.hpp>
+#include <neogfx/game/i_ecs.hpp>
+#include <neogfx/game/texture.hpp>
+
+namespace neogfx::game
+{
+    // Copies the standalone textures referenced by mesh renderers (and shared textures) into the pages of a texture
+    // atlas and points their materials at the copies so that sprites with different images can be drawn in the same
+    // batch. A material's texture coordinates are relative to its texture so they remain valid. Must be called on
+    // the rendering thread and must outlive the materials it has repointed.
+    class sprite_packer
+    {
+    private:
+        struct packed
+        {
+            ref_ptr<i_texture> source; // keeps the source texture id from being reused
+            game::texture texture;
+        };
+    public:
+        sprite_packer(size const& aPageSize = size{ 2048.0, 2048.0 });
+        ~sprite_packer();
+    public:
+        // returns the number of textures that were repointed to atlas copies
+        std::size_t pack(i_ecs& aEcs);
+        void clear();
+        std::size_t packed_count() const;
+        std::uint32_t page_count() const;
+    private:
+        void release_unused(std::unordered_set<texture_id> const& aInUse);
+        bool repack(game::texture& aTexture);
+    private:
+        size iPageSize;
+        std::unique_ptr<i_texture_atlas> iAtlas;
+        std::unordered_map<texture_id, packed> iPacked;
+        std::unordered_set<texture_id> iUnpackable;
+    };
+}
@@ -0,0 +1,112 @@
+// world_snapshot.hpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2024 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <tuple>
+#include <optional>
+
+#include <neogfx/core/event.hpp>
+#include <neogfx/game/i_ecs.hpp>
+#include <neogfx/game/entity_info.hpp>
+#include <neogfx/game/clock.hpp>
+#include <neogfx/game/rigid_body.hpp>
+#include <neogfx/game/box_collider.hpp>
+#include <neogfx/game/animation_filter.hpp>
+
+namespace neogfx::game
+{
+    // A component's records and their entities split into fixed size chunks; a chunk that is unchanged since the
+    // previous snapshot is shared with it rather than copied.
+    template <typename Data>
+    struct component_snapshot
+    {
+        static constexpr std::size_t ChunkSize = 256u;
+        struct chunk
+        {
+            std::vector<entity_id> entities;
+            std::vector<Data> records;
+        };
+        bool present = false;
+        std::size_t size = 0u;
+        std::vector<std::shared_ptr<chunk const>> chunks;
+    };
+
+    class world_snapshot
+    {
+        friend class snapshot_history;
+    public:
+        step_time time() const;
+        // bytes of component data held by this snapshot and not shared with the one before it
+        std::size_t unique_bytes() const;
+    private:
+        game::clock iClock;
+        std::tuple<
+            component_snapshot<entity_info>,
+            component_snapshot<rigid_body>,
+            component_snapshot<box_collider>,
+            component_snapshot<box_collider_2d>,
+            component_snapshot<animation_filter>> iComponents;
+        std::size_t iUniqueBytes = 0u;
+    };
+
+    // Snapshots of the simulation state (the world clock, entity_info, rigid_body, box_collider, box_collider_2d
+    // and animation_filter) for rollback and exact replays. Restoring a snapshot winds the world clock back so the
+    // physics system resimulates the ticks since; entities created since the snapshot are left alone and entities
+    // destroyed since are not recreated.
+    class snapshot_history
+    {
+    public:
+        struct no_snapshot : std::logic_error { no_snapshot() : std::logic_error("neogfx::game::snapshot_history::no_snapshot") {} };
+    public:
+        snapshot_history(i_ecs& aEcs, std::size_t aCapacity = 256u);
+        ~snapshot_history();
+    public:
+        std::size_t capacity() const;
+        void set_capacity(std::size_t aCapacity);
+        std::size_t size() const;
+        void clear();
+        world_snapshot const& latest() const;
+        world_snapshot const& ticks_ago(std::size_t aTicks) const;
+    public:
+        // takes a snapshot at the start of every physics tick; while recording physics is limited to one step
+        // per batch so that no tick is skipped
+        bool recording() const;
+        void start_recording();
+        void stop_recording();
+        world_snapshot const& take();
+        void restore(world_snapshot const& aSnapshot);
+        // restores the snapshot aTicks before the latest and forgets the ones after it
+        void rollback(std::size_t aTicks);
+        // applies physics until the world clock has caught up with system time again
+        bool resimulate();
+    private:
+        i_ecs& iEcs;
+        std::size_t iCapacity;
+        std::deque<world_snapshot> iSnapshots;
+        bool iRecording = false;
+        std::optional<std::uint32_t> iSavedBatchSteps;
+        sink iSink;
+    };
+}
@@ -88,6 +88,7 @@ namespace neogfx
     public:
         struct texture_empty : std::logic_error { texture_empty() : std::logic_error("neogfx::i_texture::texture_empty") {} };
         struct not_sub_texture : std::logic_error { not_sub_texture() : std::logic_error("neogfx::i_texture::not_sub_texture") {} };
+        struct incompatible_texture : std::logic_error { incompatible_texture() : std::logic_error("neogfx::i_texture::incompatible_texture") {} };
     public:
         typedef i_texture abstract_type;
     public:
@@ -116,6 +117,7 @@ namespace neogfx
         virtual void set_pixels(const i_image& aImage, const rect& aImagePart) = 0;
         virtual void set_pixel(const point& aPosition, const color& aColor) = 0;
         virtual color get_pixel(const point& aPosition) const = 0;
+        virtual void copy_pixels(const rect& aSourceRect, i_texture& aDestination, const point& aDestinationPosition) const = 0;
         virtual i_vector<texture_line_segment> const& intersection(texture_line_segment const& aLine, rect const& aBoundingBox, vec2 const& aSampleSize = { 1.0, 1.0 }, scalar aTolerance = 0.0) const = 0;
     public:
         virtual void bind(std::uint32_t aTextureUnit) const = 0;
@@ -40,5 +40,10 @@ namespace neogfx
         virtual i_sub_texture& create_sub_texture(const i_image& aImage) = 0;
         virtual i_sub_texture& create_sub_texture(const i_image& aImage, const rect& aImagePart) = 0;
         virtual void destroy_sub_texture(i_sub_texture& aSubTexture) = 0;
+    public:
+        virtual void touch(texture_id aSubTextureId) const = 0;
+        virtual std::uint64_t last_use(texture_id aSubTextureId) const = 0;
+        virtual std::uint32_t page_count() const = 0;
+        virtual std::uint32_t defragment(std::uint32_t aMaxMoves = 64u) = 0;
     };
 }
\ No newline at end of file
@@ -65,6 +65,7 @@ namespace neogfx
         void set_pixels(i_image const& aImage, rect const& aImagePart) final;
         void set_pixel(point const& aPosition, color const& aColor) final;
         color get_pixel(point const& aPosition) const final;
+        void copy_pixels(rect const& aSourceRect, i_texture& aDestination, point const& aDestinationPosition) const final;
         i_vector<texture_line_segment> const& intersection(texture_line_segment const& aLine, rect const& aBoundingBox, vec2 const& aSampleSize = { 1.0, 1.0 }, scalar aTolerance = 0.0) const final;
     public:
         void bind(std::uint32_t aTextureUnit) const final;
@@ -80,6 +81,9 @@ namespace neogfx
         void add_ref(long aCount = 1) const noexcept final;
         void release(long aCount = 1) const final;
         long use_count() const noexcept final;
+        // implementation
+    public:
+        void relocate(i_texture& aAtlasTexture, rect const& aAtlasLocation);
         // attributes
     private:
         bool iChild = false;
@@ -273,6 +273,8 @@ namespace neogfx
     public:
         bool has_fallback() const;
         font fallback() const;
+        bool has_fallback(char32_t aCodePoint) const;
+        font fallback(char32_t aCodePoint) const;
         // operations
     public:
         i_string const& family_name() const;
@@ -0,0 +1,73 @@
+// font_index.hpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2024 Leigh Johnston.  All Rights Reserved.
+
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+
+#include <string>
+#include <vector>
+#include <optional>
+
+#include <neogfx/gfx/text/font.hpp>
+
+namespace neogfx
+{
+    // Persistent index of the installed font files: one entry per face with its family, style and character
+    // coverage so that fonts can be listed, matched and chosen as fallbacks without opening the files.
+    class font_index
+    {
+    public:
+        struct failed_to_save : std::runtime_error { failed_to_save() : std::runtime_error("neogfx::font_index::failed_to_save") {} };
+    public:
+        using code_point_range = std::pair<char32_t, char32_t>; // inclusive
+        using coverage_ranges = std::vector<code_point_range>;
+        struct face
+        {
+            std::string path;
+            std::uint64_t fileSize;
+            std::int64_t lastWriteTime;
+            std::int32_t faceIndex;
+            std::string familyName;
+            std::string styleName;
+            font_style style;
+            coverage_ranges coverage;
+
+            bool covers(char32_t aCodePoint) const;
+        };
+        using face_list = std::vector<face>;
+    public:
+        font_index() = default;
+    public:
+        bool empty() const;
+        face_list const& faces() const;
+        // families having a face that covers aCodePoint, in index order, excluding aExcludeFamily
+        std::vector<std::string> covering_families(char32_t aCodePoint, std::string const& aExcludeFamily = {}) const;
+        bool family_covers(std::string const& aFamilyName, char32_t aCodePoint) const;
+    public:
+        bool load(std::string const& aIndexPath);
+        void save(std::string const& aIndexPath) const;
+        // scans aDirectories with a private FreeType instance so may be called from any thread; entries of
+        // aPrevious whose file size and modification time are unchanged are reused without opening the file
+        static font_index scan(std::vector<std::string> const& aDirectories, font_index const& aPrevious);
+        static std::string default_index_path();
+    private:
+        face_list iFaces;
+    };
+}
@@ -23,6 +23,10 @@
 
 #include <unordered_map>
 #include <set>
+#include <map>
+#include <future>
+#include <mutex>
+#include <optional>
 
 #include <neolib/core/jar.hpp>
 #include <neolib/core/string_ci.hpp>
@@ -30,6 +34,7 @@
 #include <neogfx/gfx/texture_atlas.hpp>
 #include <neogfx/gfx/text/emoji_atlas.hpp>
 #include <neogfx/gfx/text/i_font_manager.hpp>
+#include <neogfx/gfx/text/font_index.hpp>
 
 typedef struct FT_LibraryRec_* FT_Library;
 
@@ -70,6 +75,8 @@ namespace neogfx
         i_native_font_face& create_default_font(const i_device_resolution& aDevice) final;
         bool has_fallback_font(const i_native_font_face& aExistingFont) const final;
         i_native_font_face& create_fallback_font(const i_native_font_face& aExistingFont) final;
+        bool has_fallback_font(const i_native_font_face& aExistingFont, char32_t aCodePoint) const final;
+        i_native_font_face& create_fallback_font(const i_native_font_face& aExistingFont, char32_t aCodePoint) final;
         i_native_font_face& create_font(i_string const& aFamilyName, neogfx::font_style aStyle, font::point_size aSize, const i_device_resolution& aDevice) final;
         i_native_font_face& create_font(i_string const& aFamilyName, neogfx::font_style aStyle, i_string const& aStyleName, font::point_size aSize, const i_device_resolution& aDevice) final;
         i_native_font_face& create_font(const font_info& aInfo, const i_device_resolution& aDevice) final;
@@ -110,6 +117,11 @@ namespace neogfx
         i_native_font& find_font(i_string const& aFamilyName, i_string const& aStyleName, font::point_size aSize);
         i_native_font& find_font(font_info const& aFontInfo);
         i_native_font& find_best_font(i_string const& aFamilyName, neogfx::font_style aStyle, font::point_size aSize);
+        std::optional<string> coverage_fallback_family(i_string const& aFamilyName, char32_t aCodePoint) const;
+    private:
+        void update_font_index(bool aWait) const;
+        void add_indexed_fonts() const;
+        void finalize_font_families() const;
     private:
         i_native_font_face& add_font(const ref_ptr<i_native_font_face>& aNewFont);
         void cleanup();
@@ -117,8 +129,15 @@ namespace neogfx
         mutable std::unordered_map<system_font_role, optional<font_info>> iDefaultSystemFontInfo;
         mutable std::optional<fallback_font_info> iDefaultFallbackFontInfo;
         FT_Library iFontLib;
-        native_font_list iNativeFonts;
-        font_family_list iFontFamilies;
+        mutable native_font_list iNativeFonts;
+        mutable font_family_list iFontFamilies;
+        mutable font_index iFontIndex;
+        mutable std::optional<std::future<font_index>> iFontIndexScan;
+        mutable std::set<std::string> iIndexedFontFiles;
+        mutable std::map<std::pair<string, char32_t>, std::optional<string>> iCoverageFallbacks;
+        // guards the font index and the family lists built from it; font queries (including coverage fallbacks
+        // during shaping) may arrive from thread pool threads
+        mutable std::recursive_mutex iFontIndexMutex;
     private:
         id_cache iIdCache;
         std::unique_ptr<i_glyph_text_factory> iGlyphTextFactory;
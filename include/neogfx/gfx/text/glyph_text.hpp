@@ -22,6 +22,11 @@
 #include <neogfx/neogfx.hpp>
 
 #include <optional>
+#include <array>
+#include <memory>
+#include <algorithm>
+#include <limits>
+#include <cmath>
 
 #include <neolib/core/allocator.hpp>
 #include <neolib/core/vecarray.hpp>
@@ -250,6 +255,230 @@ namespace neogfx
         g.flags = static_cast<glyph_char::flags_e>(aMnemonic ? g.flags | glyph_char::Mnemonic : g.flags & ~glyph_char::Mnemonic);
     }
 
+    // Compact form of glyph_char for large glyph runs (documents, terminal scrollback): cell and shape are axis
+    // aligned so only the cell origin is kept at full precision; advance, height and shape offset/size are 16-bit
+    // fixed point (1/16 pixel) and the outline shape, which only outlined fonts have, is stored out of line.
+    // The fixed point fields are glyph-local sizes and offsets limited to [-2048, 2048) pixels; larger values
+    // (glyphs of fonts over ~1500 points) are clamped, so such text should stay in glyph_char form.
+    struct compact_glyph_char
+    {
+        using value_type = glyph_char::value_type;
+        using cluster_index = glyph_char::cluster_index;
+        using cluster_range = glyph_char::cluster_range;
+        using fixed_type = std::int16_t;
+        using fixed_vector = std::array<fixed_type, 2>;
+        static constexpr float FixedScale = 16.0f;
+
+        value_type value;
+        cluster_range clusters;
+        character_type type;
+        glyph_char::flags_e flags;
+        font_id font;
+        vec2f cellOrigin;
+        fixed_vector cellSize;
+        fixed_vector shapeOffset;
+        fixed_vector shapeSize;
+        std::unique_ptr<quadf_2d> outlineShape;
+
+        compact_glyph_char() :
+            value{}, clusters{}, type{}, flags{ glyph_char::Default }, font{}, cellOrigin{}, cellSize{}, shapeOffset{}, shapeSize{}
+        {
+        }
+        explicit compact_glyph_char(glyph_char const& aGlyphChar) :
+            value{ aGlyphChar.value },
+            clusters{ aGlyphChar.clusters },
+            type{ aGlyphChar.type },
+            flags{ aGlyphChar.flags },
+            font{ aGlyphChar.font },
+            cellOrigin{ aGlyphChar.cell[0] },
+            cellSize{ to_fixed(aGlyphChar.cell[2] - aGlyphChar.cell[0]) },
+            shapeOffset{ to_fixed(aGlyphChar.shape[0]) },
+            shapeSize{ to_fixed(aGlyphChar.shape[2] - aGlyphChar.shape[0]) },
+            outlineShape{ aGlyphChar.outlineShape ? std::make_unique<quadf_2d>(aGlyphChar.outlineShape.value()) : nullptr }
+        {
+        }
+        compact_glyph_char(compact_glyph_char const& aOther) :
+            value{ aOther.value },
+            clusters{ aOther.clusters },
+            type{ aOther.type },
+            flags{ aOther.flags },
+            font{ aOther.font },
+            cellOrigin{ aOther.cellOrigin },
+            cellSize{ aOther.cellSize },
+            shapeOffset{ aOther.shapeOffset },
+            shapeSize{ aOther.shapeSize },
+            outlineShape{ aOther.outlineShape ? std::make_unique<quadf_2d>(*aOther.outlineShape) : nullptr }
+        {
+        }
+        compact_glyph_char(compact_glyph_char&& aOther) = default;
+        compact_glyph_char& operator=(compact_glyph_char const& aOther)
+        {
+            if (&aOther != this)
+                *this = compact_glyph_char{ aOther };
+            return *this;
+        }
+        compact_glyph_char& operator=(compact_glyph_char&& aOther) = default;
+
+        quadf_2d cell() const
+        {
+            auto const extents = cell_extents();
+            return quadf_2d{
+                cellOrigin,
+                cellOrigin + vec2f{ extents.x, 0.0f },
+                cellOrigin + extents,
+                cellOrigin + vec2f{ 0.0f, extents.y } };
+        }
+        quadf_2d shape() const
+        {
+            auto const p0 = from_fixed(shapeOffset);
+            auto const p2 = p0 + from_fixed(shapeSize);
+            return quadf_2d{ p0, vec2f{ p2.x, p0.y }, p2, vec2f{ p0.x, p2.y } };
+        }
+        std::optional<quadf_2d> outline_shape() const
+        {
+            if (outlineShape)
+                return *outlineShape;
+            return {};
+        }
+        vec2f cell_extents() const
+        {
+            return from_fixed(cellSize);
+        }
+        void set_cell_height(float aHeight)
+        {
+            cellSize[1] = to_fixed(aHeight);
+        }
+        void offset_shape(vec2f const& aOffset)
+        {
+            shapeOffset = to_fixed(from_fixed(shapeOffset) + aOffset);
+            if (outlineShape)
+                *outlineShape += aOffset;
+        }
+        glyph_char to_glyph_char() const
+        {
+            return glyph_char{ value, clusters, type, flags, font, cell(), shape(), outline_shape() };
+        }
+
+        static fixed_type to_fixed(float aValue)
+        {
+            return static_cast<fixed_type>(std::clamp(std::round(aValue * FixedScale),
+                static_cast<float>(std::numeric_limits<fixed_type>::min()), static_cast<float>(std::numeric_limits<fixed_type>::max())));
+        }
+        static fixed_vector to_fixed(vec2f const& aValue)
+        {
+            return fixed_vector{ to_fixed(aValue.x), to_fixed(aValue.y) };
+        }
+        static float from_fixed(fixed_type aValue)
+        {
+            return static_cast<float>(aValue) / FixedScale;
+        }
+        static vec2f from_fixed(fixed_vector const& aValue)
+        {
+            return vec2f{ from_fixed(aValue[0]), from_fixed(aValue[1]) };
+        }
+    };
+
+    inline bool operator==(const compact_glyph_char& lhs, const compact_glyph_char& rhs)
+    {
+        return lhs.type.category == rhs.type.category && lhs.value == rhs.value;
+    }
+
+    inline bool has_font(compact_glyph_char const& g)
+    {
+        return g.font != font_id{};
+    }
+
+    inline text_category category(compact_glyph_char const& g)
+    {
+        return g.type.category;
+    }
+
+    inline text_direction direction(compact_glyph_char const& g)
+    {
+        return g.type.direction;
+    }
+
+    inline bool is_whitespace(compact_glyph_char const& g)
+    {
+        return category(g) == text_category::Whitespace;
+    }
+
+    inline bool is_line_breaking_whitespace(compact_glyph_char const& g)
+    {
+        return is_whitespace(g) && (g.value == U'\r' || g.value == U'\n');
+    }
+
+    inline bool is_emoji(compact_glyph_char const& g)
+    {
+        return category(g) == text_category::Emoji;
+    }
+
+    inline bool category_has_no_direction(compact_glyph_char const& g)
+    {
+        return category(g) != text_category::LTR && category(g) != text_category::RTL;
+    }
+
+    inline bool underline(compact_glyph_char const& g)
+    {
+        return (g.flags & glyph_char::Underline) == glyph_char::Underline;
+    }
+
+    inline bool subpixel(compact_glyph_char const& g)
+    {
+        return (g.flags & glyph_char::Subpixel) == glyph_char::Subpixel;
+    }
+
+    inline bool mnemonic(compact_glyph_char const& g)
+    {
+        return (g.flags & glyph_char::Mnemonic) == glyph_char::Mnemonic;
+    }
+
+    // geometry accessors shared by glyph_char and compact_glyph_char so glyph text containers can hold either
+
+    inline quadf_2d const& glyph_cell(glyph_char const& g)
+    {
+        return g.cell;
+    }
+
+    inline quadf_2d glyph_cell(compact_glyph_char const& g)
+    {
+        return g.cell();
+    }
+
+    inline void set_cell_height(glyph_char& g, float aHeight)
+    {
+        g.cell[2].y = g.cell[1].y + aHeight;
+        g.cell[3].y = g.cell[0].y + aHeight;
+        g.cellExtents = std::nullopt;
+    }
+
+    inline void set_cell_height(compact_glyph_char& g, float aHeight)
+    {
+        g.set_cell_height(aHeight);
+    }
+
+    inline void offset_shape(glyph_char& g, vec2f const& aOffset)
+    {
+        g.shape += aOffset;
+        if (g.outlineShape)
+            g.outlineShape.value() += aOffset;
+    }
+
+    inline void offset_shape(compact_glyph_char& g, vec2f const& aOffset)
+    {
+        g.offset_shape(aOffset);
+    }
+
+    inline glyph_char const& to_glyph_char(glyph_char const& g)
+    {
+        return g;
+    }
+
+    inline glyph_char to_glyph_char(compact_glyph_char const& g)
+    {
+        return g.to_glyph_char();
+    }
+
     template <typename Iterator>
     inline std::pair<Iterator, Iterator> word_break(Iterator aBegin, Iterator aFrom, Iterator aEnd, bool aConsumeWhitespace = false)
     {
@@ -470,6 +699,11 @@ namespace neogfx
     extern template class basic_glyph_text_content<glyph_text_container, const glyph_char*, glyph_char*>;
     using glyph_text_content = basic_glyph_text_content<glyph_text_container, const glyph_char*, glyph_char*>;
 
+    using i_compact_glyph_text = i_basic_glyph_text<compact_glyph_char>;
+    using compact_glyph_text_container = neolib::vecarray<compact_glyph_char, GLYPH_TEXT_SMALL_BUFFER_SIZE, -1>;
+    extern template class basic_glyph_text_content<compact_glyph_text_container, const compact_glyph_char*, compact_glyph_char*>;
+    using compact_glyph_text_content = basic_glyph_text_content<compact_glyph_text_container, const compact_glyph_char*, compact_glyph_char*>;
+
     class glyph_text
     {
     public:
@@ -584,6 +818,9 @@ namespace neogfx
 
     typedef std::optional<glyph_text> optional_glyph_text;
 
+    // Rendering takes glyph_char so compact glyph text is expanded just before it is drawn.
+    glyph_text expand_glyph_text(i_compact_glyph_text const& aText);
+
     class i_graphics_context;
 
     class i_font_selector
@@ -611,6 +848,44 @@ namespace neogfx
         function_type iSelectorFunction;
     };
     
+    // The graphics context state that shaping depends on, captured so that text can be shaped away from the UI thread.
+    struct glyph_shaping_context
+    {
+        std::optional<char32_t> mnemonic;
+        std::optional<char32_t> passwordMask;
+        std::optional<scalar> tabStop;
+        bool extendedTabStops = false;
+        bool subpixelRendering = false;
+        logical_coordinate_system coordinateSystem = logical_coordinate_system::AutomaticGui;
+    };
+
+    // HarfBuzz output for text shaped away from the UI thread: glyph cells are laid out from the glyph advances but no glyph
+    // has been rasterized yet; i_glyph_text_factory::resolve_glyph_text turns it into glyph text on the UI thread.
+    struct shaped_glyph_text
+    {
+        using size_type = i_glyph_text::size_type;
+
+        std::vector<glyph_char> glyphs;
+        std::vector<vec2f> offsets;
+        std::vector<size_type> lineBreaks;
+        font_id majorFont = {};
+        logical_coordinate_system coordinateSystem = logical_coordinate_system::AutomaticGui;
+
+        size_type size() const
+        {
+            return glyphs.size();
+        }
+        std::vector<size_type>& line_breaks()
+        {
+            return lineBreaks;
+        }
+        template <typename... Args>
+        glyph_char& emplace_back(Args&&... aArgs)
+        {
+            return glyphs.emplace_back(std::forward<Args>(aArgs)...);
+        }
+    };
+
     class i_glyph_text_factory
     {
     public:
@@ -620,6 +895,12 @@ namespace neogfx
         virtual glyph_text create_glyph_text(font const& aFont) = 0;
         virtual glyph_text to_glyph_text(i_graphics_context const& aContext, char32_t const* aUtf32Begin, char32_t const* aUtf32End, i_font_selector const& aFontSelector, bool aAlignBaselines = true) = 0;
         virtual glyph_text to_glyph_text(i_graphics_context const& aContext, char const* aUtf8Begin, char const* aUtf8End, i_font_selector const& aFontSelector, bool aAlignBaselines = true) = 0;
+    public:
+        virtual glyph_shaping_context shaping_context(i_graphics_context const& aContext) const = 0;
+        // Thread safe as long as the selected fonts outlive the call; returns std::nullopt if the text needs fallback fonts 
+        // or emoji, which can only be resolved by to_glyph_text on the UI thread.
+        virtual std::optional<shaped_glyph_text> shape_glyph_text(glyph_shaping_context const& aContext, char32_t const* aUtf32Begin, char32_t const* aUtf32End, i_font_selector const& aFontSelector) = 0;
+        virtual glyph_text resolve_glyph_text(shaped_glyph_text const& aShapedText) = 0;
     public:
         glyph_text to_glyph_text(i_graphics_context const& aContext, char32_t const* aUtf32Begin, char32_t const* aUtf32End, std::function<font(std::size_t)> aFontSelector, bool aAlignBaselines = true)
         {
@@ -641,5 +922,9 @@ namespace neogfx
         {
             return to_glyph_text(aContext, aString.c_str(), aString.c_str() + aString.size(), font_selector{ aFontSelector }, aAlignBaselines);
         }
+        std::optional<shaped_glyph_text> shape_glyph_text(glyph_shaping_context const& aContext, std::u32string_view const& aString, std::function<font(std::size_t)> aFontSelector)
+        {
+            return shape_glyph_text(aContext, aString.data(), aString.data() + aString.size(), font_selector{ aFontSelector });
+        }
     };
 }
\ No newline at end of file
@@ -283,7 +283,8 @@ namespace neogfx
     template <typename Container, typename ConstIterator, typename Iterator>
     inline size basic_glyph_text_content<Container, ConstIterator, Iterator>::extents(const_reference aGlyphChar) const
     {
-        return rect{ to_aabb_2d(aGlyphChar.cell.begin(), aGlyphChar.cell.end()) }.extents().ceil();
+        auto const& cell = glyph_cell(aGlyphChar);
+        return rect{ to_aabb_2d(cell.begin(), cell.end()) }.extents().ceil();
     }
 
     template <typename Container, typename ConstIterator, typename Iterator>
@@ -291,13 +292,13 @@ namespace neogfx
     {
         if (aBegin == aEnd)
             return neogfx::size{ 0.0, major_font().height() };
-        auto const& firstGlyph = *aBegin;
-        auto const& lastGlyph = *std::prev(aEnd);
+        auto const& firstCell = glyph_cell(*aBegin);
+        auto const& lastCell = glyph_cell(*std::prev(aEnd));
         quad_2d const quadExtents{ 
-            firstGlyph.cell[0],
-            lastGlyph.cell[1],
-            lastGlyph.cell[3],
-            firstGlyph.cell[3] };
+            firstCell[0],
+            lastCell[1],
+            lastCell[3],
+            firstCell[3] };
         rect const boundingRect{ to_aabb_2d(quadExtents.begin(), quadExtents.end()) };
         return boundingRect.extents().ceil();
     }
@@ -361,9 +362,7 @@ namespace neogfx
             auto const& gf = glyph_font(g);
             auto const& existingExtents = g.cell_extents();
             auto shapeOffset = vec2f{ 0.0f, cyMax - (existingExtents.y + static_cast<float>(gf.descender())) };
-            g.cell[2].y = g.cell[1].y + yMax;
-            g.cell[3].y = g.cell[0].y + yMax;
-            g.cellExtents = std::nullopt;
+            set_cell_height(g, yMax);
             if ((g.flags & (glyph_char::Superscript | glyph_char::Subscript)) != glyph_char::Default)
             {
                 scalar const ascender = gf.ascender();
@@ -390,9 +389,7 @@ namespace neogfx
                         shapeOffset += vec2f{ 0.0f, belowBaselineDelta };
                 }
             }
-            g.shape += shapeOffset;
-            if (g.outlineShape)
-                g.outlineShape.value() += shapeOffset;
+            offset_shape(g, shapeOffset);
         }
         return result;
     }
@@ -428,7 +425,7 @@ namespace neogfx
     template <typename Container, typename ConstIterator, typename Iterator>
     inline const i_glyph& basic_glyph_text_content<Container, ConstIterator, Iterator>::glyph(const_reference aGlyphChar) const
     {
-        return glyph_font(aGlyphChar).glyph(aGlyphChar);
+        return glyph_font(aGlyphChar).glyph(to_glyph_char(aGlyphChar));
     }
 
     template <typename Container, typename ConstIterator, typename Iterator>
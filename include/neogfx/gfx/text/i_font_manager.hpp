@@ -71,6 +71,8 @@ namespace neogfx
         virtual i_native_font_face& create_default_font(const i_device_resolution& aDevice) = 0;
         virtual bool has_fallback_font(i_native_font_face const& aExistingFont) const = 0;
         virtual i_native_font_face& create_fallback_font(i_native_font_face const& aExistingFont) = 0;
+        virtual bool has_fallback_font(i_native_font_face const& aExistingFont, char32_t aCodePoint) const = 0;
+        virtual i_native_font_face& create_fallback_font(i_native_font_face const& aExistingFont, char32_t aCodePoint) = 0;
         virtual i_native_font_face& create_font(i_string const& aFamilyName, neogfx::font_style aStyle, font::point_size aSize, const i_device_resolution& aDevice) = 0;
         virtual i_native_font_face& create_font(i_string const& aFamilyName, neogfx::font_style aStyle, i_string const& aStyleName, font::point_size aSize, const i_device_resolution& aDevice) = 0;
         virtual i_native_font_face& create_font(const font_info& aInfo, const i_device_resolution& aDevice) = 0;
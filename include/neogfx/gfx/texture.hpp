@@ -69,6 +69,7 @@ namespace neogfx
         void set_pixels(const i_image& aImage, const rect& aImagePart) final;
         void set_pixel(const point& aPosition, const color& aColor) final;
         color get_pixel(const point& aPosition) const final;
+        void copy_pixels(const rect& aSourceRect, i_texture& aDestination, const point& aDestinationPosition) const final;
         i_vector<texture_line_segment> const& intersection(texture_line_segment const& aLine, rect const& aBoundingBox, vec2 const& aSampleSize = { 1.0, 1.0 }, scalar aTolerance = 0.0) const final;
     public:
         void bind(std::uint32_t aTextureUnit) const final;
@@ -22,6 +22,7 @@
 #include <neogfx/neogfx.hpp>
 
 #include <unordered_map>
+#include <vector>
 #include <set>
 #include <tuple>
 
@@ -50,10 +51,10 @@ namespace neogfx
             };
             rect_pack pack;
             std::set<rect, fragment_less_than> used;
-            std::set<rect, fragment_less_than> freed; // todo: use this when bin pack is full
+            std::set<rect, fragment_less_than> freed;
             bool insert(const size& aSize, rect& aResult)
             {
-                if (pack.insert(aSize, aResult))
+                if (pack.insert(aSize, aResult) || reuse(aSize, aResult))
                 {
                     used.insert(aResult);
                     return true;
@@ -61,13 +62,54 @@ namespace neogfx
                 else
                     return false;
             }
+            void erase(const rect& aSpace)
+            {
+                auto existing = used.find(aSpace);
+                if (existing != used.end())
+                {
+                    used.erase(existing);
+                    freed.insert(aSpace);
+                }
+            }
+            dimension used_area() const
+            {
+                dimension result = 0.0;
+                for (auto const& space : used)
+                    result += space.cx * space.cy;
+                return result;
+            }
+            // best fit from the freed spaces (ordered by area); what is left over is split guillotine
+            // fashion along the longer leftover edge and returned to the freed spaces
+            bool reuse(const size& aSize, rect& aResult)
+            {
+                for (auto space = freed.lower_bound(rect{ point{ -1.0, -1.0 }, aSize }); space != freed.end(); ++space)
+                {
+                    if (space->cx < aSize.cx || space->cy < aSize.cy)
+                        continue;
+                    auto const found = *space;
+                    freed.erase(space);
+                    aResult = rect{ found.top_left(), aSize };
+                    auto const rightWidth = found.cx - aSize.cx;
+                    auto const bottomHeight = found.cy - aSize.cy;
+                    bool const splitVertically = (rightWidth > bottomHeight);
+                    rect const right{ point{ found.x + aSize.cx, found.y }, size{ rightWidth, splitVertically ? found.cy : aSize.cy } };
+                    rect const bottom{ point{ found.x, found.y + aSize.cy }, size{ splitVertically ? aSize.cx : found.cx, bottomHeight } };
+                    if (right.cx > 0.0 && right.cy > 0.0)
+                        freed.insert(right);
+                    if (bottom.cx > 0.0 && bottom.cy > 0.0)
+                        freed.insert(bottom);
+                    return true;
+                }
+                return false;
+            }
         };
         typedef std::pair<texture, fragments> page;
         typedef std::list<page> pages;
         struct entry
         {
             pages::iterator page;
-            ref_ptr<i_sub_texture> texture;
+            ref_ptr<neogfx::sub_texture> texture;
+            mutable std::uint64_t lastUse = 0u;
 
             template <typename... Args>
             entry(pages::iterator page, Args&&... args) :
@@ -83,14 +125,23 @@ namespace neogfx
         i_sub_texture& create_sub_texture(const i_image& aImage) override;
         i_sub_texture& create_sub_texture(const i_image& aImage, const rect& aImagePart) override;
         void destroy_sub_texture(i_sub_texture& aSubTexture) override;
+    public:
+        void touch(texture_id aSubTextureId) const override;
+        std::uint64_t last_use(texture_id aSubTextureId) const override;
+        std::uint32_t page_count() const override;
+        std::uint32_t defragment(std::uint32_t aMaxMoves = 64u) override;
     private:
         const size& page_size() const;
+        static bool page_matches(const page& aPage, dimension aDpiScaleFactor, texture_sampling aSampling, texture_data_format aDataFormat);
         pages::iterator create_page(dimension aDpiScaleFactor, texture_sampling aSampling, texture_data_format aDataFormat);
         std::pair<pages::iterator, rect> allocate_space(const size& aSize, dimension aDpiScaleFactor, texture_sampling aSampling, texture_data_format aDataFormat);
+        bool relocate(entry& aEntry, const std::vector<pages::iterator>& aTargets);
+        bool release_page_if_empty(pages::iterator aPage);
     private:
         i_texture_manager& iTextureManager;
         size iPageSize;
         pages iPages;
         entries iEntries;
+        mutable std::uint64_t iUseClock = 0u;
     };
 }
\ No newline at end of file
@@ -49,6 +49,7 @@ namespace neogfx
         std::unique_ptr<i_texture_atlas> create_texture_atlas(size const& aSize = size{ 1024.0, 1024.0 }) override;
     private:
         void add_sub_texture(i_sub_texture& aSubTexture) override;
+        void remove_sub_texture(i_sub_texture& aSubTexture) override;
     protected:
         const texture_list& textures() const;
         texture_list& textures();
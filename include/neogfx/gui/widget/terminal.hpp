@@ -48,7 +48,8 @@ namespace neogfx
         struct buffer_line
         {
             std::u32string text;
-            mutable optional_glyph_text glyphs;
+            mutable std::optional<compact_glyph_text_content> glyphs;
+            mutable optional_glyph_text expanded; // only kept while the line is visible
             std::vector<attribute> attributes;
         };
         struct scrolling_region { coordinate_type top; coordinate_type bottom; };
@@ -26,6 +26,7 @@
 #include <neolib/core/gap_vector.hpp>
 #include <neolib/core/jar.hpp>
 
+#include <neogfx/core/piece_table.hpp>
 #include <neogfx/app/i_clipboard.hpp>
 #include <neogfx/gfx/text/glyph_text.hpp>
 #include <neogfx/gui/window/context_menu.hpp>
@@ -52,6 +53,7 @@ namespace neogfx
         ShowPassword    = 0x00000200,
 
         ParseURIs       = 0x00001000,
+        ParallelShaping = 0x00002000,
 
         OnlyAccept      = 0x00010000,
 
@@ -93,6 +95,7 @@ declare_enum_string(neogfx::text_edit_caps, OverwriteMode)
 declare_enum_string(neogfx::text_edit_caps, Password)
 declare_enum_string(neogfx::text_edit_caps, ShowPassword)
 declare_enum_string(neogfx::text_edit_caps, ParseURIs)
+declare_enum_string(neogfx::text_edit_caps, ParallelShaping)
 declare_enum_string(neogfx::text_edit_caps, OnlyAccept)
 end_declare_enum(neogfx::text_edit_caps)
 
@@ -299,7 +302,7 @@ namespace neogfx
             document_char(char32_t aCharacter) : character{ aCharacter }, style{ neolib::invalid_cookie<neolib::cookie> } {}
             document_char(char32_t aCharacter, neolib::cookie aStyle) : character{ aCharacter }, style{ aStyle } {}
         };
-        using document_text = neolib::gap_vector<document_char>;
+        using document_text = piece_table<char32_t, style_cookie, document_char>;
 
         using glyph_container_type = neolib::gap_vector<glyph_char>;
         using document_glyphs = basic_glyph_text_content<glyph_container_type>;
@@ -373,6 +376,7 @@ namespace neogfx
         };
 
         using glyph_paragraphs = neolib::gap_vector<glyph_paragraph, 16>;
+        using column_delimiters = std::vector<std::u32string::difference_type>;
 
         struct glyph_column;
 
@@ -475,6 +479,7 @@ namespace neogfx
 
     private:
         class dragger;
+        class paragraph_shaper;
 
     public:
         using position_type = document_text::difference_type;
@@ -658,6 +663,9 @@ namespace neogfx
         std::optional<glyph_lines::const_iterator> next_line(std::optional<glyph_lines::const_iterator> const& aFrom) const;
         std::optional<glyph_lines::const_iterator> previous_line(std::optional<glyph_lines::const_iterator> const& aFrom) const;
         void refresh_paragraph(document_text::const_iterator aWhere, ptrdiff_t aDelta);
+        neogfx::font const& character_font(document_text::const_iterator aParagraph, std::u32string::size_type aSourceIndex, column_delimiters const& aColumnDelimiters) const;
+        bool shaping_in_progress() const;
+        void finish_shaping();
         void refresh_columns();
         void refresh_lines();
         void animate();
@@ -702,6 +710,7 @@ namespace neogfx
         basic_point<std::optional<dimension>> iCursorHint;
         widget_timer iAnimator;
         std::unique_ptr<dragger> iDragger;
+        std::unique_ptr<paragraph_shaper> iParagraphShaper;
         std::unique_ptr<neogfx::context_menu> iMenu;
         std::uint32_t iSuppressTextChangedNotification;
         std::uint32_t iWantedToNotifyTextChanged;
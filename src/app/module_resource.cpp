@@ -63,7 +63,7 @@ namespace neogfx
 
     bool module_resource::is_empty() const
     {
-        return size() != 0;
+        return size() == 0;
     }
 
     const void* module_resource::cdata() const
@@ -19,12 +19,11 @@
 
 #include <neogfx/neogfx.hpp>
 
-#include <sstream>
+#include <fstream>
 #include <filesystem>
 #include <openssl/sha.h>
 
 #include <neolib/io/uri.hpp>
-#include <neolib/file/zip.hpp>
 #include <neogfx/app/resource.hpp>
 
 namespace neogfx
@@ -33,56 +32,30 @@ namespace neogfx
         iManager{aManager}, iUri{aUri}, iSize{0}
     {
         neolib::uri uri{aUri};
-        if (uri.scheme() == "file")
+        if (uri.scheme() == "file" && uri.fragment().empty()) // individual asset file
         {
-            if (uri.fragment().empty()) // individual asset file
-            { 
-                iData.resize(static_cast<std::size_t>(std::filesystem::file_size(uri.path())));
-                std::ifstream input(uri.path(), std::ios::binary | std::ios::in);
-                input.read(reinterpret_cast<char*>(data()), iData.size());
-                iSize = iData.size();
+            try
+            {
+                iFile.emplace(uri.path());
+                iSize = iFile->size();
             }
-            else // asset archive
+            catch (mapped_file::failed_to_open_file const&)
             {
-                neolib::zip archive{uri.path()};
-                for (std::size_t i = 0; i < archive.file_count(); ++i)
-                {
-                    if (archive.file_path(i) == uri.fragment())
-                    {
-                        archive.extract_to(i, iData.as_std_vector());
-                        iSize = iData.size();
-                    }
-                }
+                read(uri.path());
             }
-        }
-        else if (uri.scheme().empty())
-        {
-            if (!uri.fragment().empty()) // asset archive
+            catch (mapped_file::failed_to_map_file const&)
             {
-                auto assetArchive = aManager.load_resource(string{ ":/" + uri.path() });
-                neolib::zip archive{assetArchive->cdata(), assetArchive->size()};
-                for (std::size_t i = 0; i < archive.file_count(); ++i)
-                {
-                    if (archive.file_path(i) == uri.fragment())
-                    {
-                        archive.extract_to(i, iData.as_std_vector());
-                        iSize = iData.size();
-                    }
-                    else
-                    {
-                        neolib::uri otherResource(uri);
-                        otherResource.set_fragment(archive.file_path(i));
-                        std::ostringstream oss;
-                        oss << otherResource;
-                        neolib::zip::buffer_type buffer;
-                        archive.extract_to(i, buffer);
-                        aManager.add_resource(string{ oss.str() }, & buffer[0], buffer.size());
-                    }
-                }
+                read(uri.path());
             }
         }
     }
 
+    resource::resource(i_resource_manager& aManager, std::string const& aUri, data_type::std_type&& aData) :
+        iManager{aManager}, iUri{aUri}, iSize{aData.size()}
+    {
+        iData.as_std_vector() = std::move(aData);
+    }
+
     resource::resource(i_resource_manager& aManager, std::string const& aUri, const void* aData, std::size_t aSize) : 
         iManager{aManager}, iUri{aUri}, iSize{aSize}, iData{reinterpret_cast<const std::uint8_t*>(aData), reinterpret_cast<const std::uint8_t*>(aData) + aSize}
     {
@@ -95,14 +68,14 @@ namespace neogfx
 
     bool resource::available() const
     {
-        return iSize != 0 && iData.size() == iSize;
+        return iSize != 0 && size() == iSize;
     }
 
     bool resource::downloading() const
     {
         if (iSize == 0)
             return false;
-        else if (iData.size() != iSize)
+        else if (size() != iSize)
             return true;
         else
             return false;
@@ -112,8 +85,8 @@ namespace neogfx
     {
         if (iSize == 0)
             return 0.0;
-        else if (iData.size() != iSize)
-            return 100.0 * iData.size() / iSize;
+        else if (size() != iSize)
+            return 100.0 * size() / iSize;
         else
             return 100.0;
     }
@@ -138,13 +111,15 @@ namespace neogfx
 
     bool resource::is_empty() const
     {
-        return iData.empty();
+        return size() == 0;
     }
     
     const void* resource::cdata() const
     {
-        if (iData.empty())
+        if (is_empty())
             throw no_data();
+        if (iFile && !iCopied)
+            return iFile->data();
         return &iData[0];
     }
 
@@ -155,11 +130,21 @@ namespace neogfx
     
     void* resource::data()
     {
+        // a mapping is read-only so writable access takes a copy; the mapping is kept so that pointers already
+        // obtained from cdata() and bytes() stay valid
+        if (iFile && !iCopied)
+        {
+            auto const* const bytes = reinterpret_cast<std::uint8_t const*>(iFile->data());
+            iData.as_std_vector().assign(bytes, bytes + iFile->size());
+            iCopied = true;
+        }
         return const_cast<void*>(to_const(*this).data());
     }
 
     std::size_t resource::size() const
     {
+        if (iFile && !iCopied)
+            return iFile->size();
         return iData.size();
     }
 
@@ -173,4 +158,12 @@ namespace neogfx
         }
         return *iHash;
     }
+
+    void resource::read(std::string const& aPath)
+    {
+        iData.resize(static_cast<std::size_t>(std::filesystem::file_size(aPath)));
+        std::ifstream input(aPath, std::ios::binary | std::ios::in);
+        input.read(reinterpret_cast<char*>(iData.as_std_vector().data()), iData.size());
+        iSize = iData.size();
+    }
 }
\ No newline at end of file
@@ -0,0 +1,124 @@
+// resource_archive.cpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2024 Leigh Johnston.  All Rights Reserved.
+
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <neogfx/neogfx.hpp>
+
+#include <neogfx/app/resource_archive.hpp>
+
+namespace neogfx
+{
+    resource_archive::resource_archive(std::string const& aPath, std::size_t aCacheCapacity) :
+        iZip{ aPath },
+        iCacheCapacity{ aCacheCapacity }
+    {
+        build_index();
+    }
+
+    resource_archive::resource_archive(i_ref_ptr<i_resource> const& aArchive, std::size_t aCacheCapacity) :
+        iArchive{ aArchive },
+        iZip{ aArchive->cdata(), aArchive->size() },
+        iCacheCapacity{ aCacheCapacity }
+    {
+        build_index();
+    }
+
+    std::size_t resource_archive::entry_count() const
+    {
+        return iIndex.size();
+    }
+
+    bool resource_archive::contains(std::string const& aPath) const
+    {
+        return iIndex.find(aPath) != iIndex.end();
+    }
+
+    void resource_archive::extract(std::string const& aPath, buffer_type& aOutput)
+    {
+        auto const entry = iIndex.find(aPath);
+        if (entry == iIndex.end())
+            throw entry_not_found(aPath);
+        auto const index = entry->second;
+        std::scoped_lock<std::mutex> lock{ iMutex };
+        auto const cached = iCacheIndex.find(index);
+        if (cached != iCacheIndex.end())
+        {
+            ++iCacheHits;
+            iCache.splice(iCache.begin(), iCache, cached->second);
+            aOutput = cached->second->data;
+            return;
+        }
+        ++iCacheMisses;
+        iZip.extract_to(index, aOutput);
+        if (aOutput.size() <= iCacheCapacity)
+        {
+            iCache.push_front(cached_entry{ index, aOutput });
+            iCacheIndex.emplace(index, iCache.begin());
+            iCacheSize += aOutput.size();
+            trim_cache();
+        }
+    }
+
+    std::size_t resource_archive::cache_capacity() const
+    {
+        std::scoped_lock<std::mutex> lock{ iMutex };
+        return iCacheCapacity;
+    }
+
+    void resource_archive::set_cache_capacity(std::size_t aCapacity)
+    {
+        std::scoped_lock<std::mutex> lock{ iMutex };
+        iCacheCapacity = aCapacity;
+        trim_cache();
+    }
+
+    std::size_t resource_archive::cache_size() const
+    {
+        std::scoped_lock<std::mutex> lock{ iMutex };
+        return iCacheSize;
+    }
+
+    std::uint64_t resource_archive::cache_hits() const
+    {
+        std::scoped_lock<std::mutex> lock{ iMutex };
+        return iCacheHits;
+    }
+
+    std::uint64_t resource_archive::cache_misses() const
+    {
+        std::scoped_lock<std::mutex> lock{ iMutex };
+        return iCacheMisses;
+    }
+
+    void resource_archive::build_index()
+    {
+        iIndex.reserve(iZip.file_count());
+        for (std::size_t i = 0; i < iZip.file_count(); ++i)
+            iIndex.emplace(iZip.file_path(i), i);
+    }
+
+    void resource_archive::trim_cache()
+    {
+        while (iCacheSize > iCacheCapacity)
+        {
+            iCacheSize -= iCache.back().data.size();
+            iCacheIndex.erase(iCache.back().index);
+            iCache.pop_back();
+        }
+    }
+}
@@ -31,7 +31,8 @@ template<> neogfx::i_resource_manager& services::start_service<neogfx::i_resourc
 
 namespace neogfx
 {    
-    resource_manager::resource_manager()
+    resource_manager::resource_manager() :
+        iArchiveCacheCapacity{ resource_archive::DefaultCacheCapacity }
     {
     }
     
@@ -56,7 +57,8 @@ namespace neogfx
 
     void resource_manager::add_module_resource(i_string const& aUri, const void* aResourceData, std::size_t aResourceSize)
     {
-        iResources.insert(aUri, decltype(iResources)::mapped_type{ ref_ptr<i_resource>{ make_ref<resource>(*this, aUri, aResourceData, aResourceSize) } });
+        // module resources are in the module's read-only data so are referenced rather than copied
+        iResources.insert(aUri, decltype(iResources)::mapped_type{ ref_ptr<i_resource>{ make_ref<module_resource>(aUri.to_std_string(), aResourceData, aResourceSize) } });
     }
 
     void resource_manager::load_resource(i_string const& aUri, i_ref_ptr<i_resource>& aResult)
@@ -79,9 +81,21 @@ namespace neogfx
                 }
             }
         }
-        if (neolib::uri{ aUri }.scheme().empty() && iResources.as_std_map().find(aUri.to_std_string_view().substr(0, aUri.to_std_string_view().rfind('#'))) == iResources.as_std_map().end())
+        neolib::uri const uri{ aUri };
+        if (uri.scheme().empty() && iResources.as_std_map().find(aUri.to_std_string_view().substr(0, aUri.to_std_string_view().rfind('#'))) == iResources.as_std_map().end())
             throw embedded_resource_not_found(aUri);
-        auto newResource = make_ref<resource>(*this, aUri);
+        ref_ptr<resource> newResource;
+        if (!uri.fragment().empty() && (uri.scheme().empty() || uri.scheme() == "file"))
+        {
+            // only the requested entry is decompressed; a missing entry gives an empty resource
+            auto& entryArchive = archive(std::string{ aUri.to_std_string_view().substr(0, aUri.to_std_string_view().rfind('#')) });
+            resource::data_type::std_type entryData;
+            if (entryArchive.contains(uri.fragment()))
+                entryArchive.extract(uri.fragment(), entryData);
+            newResource = make_ref<resource>(*this, aUri.to_std_string(), std::move(entryData));
+        }
+        else
+            newResource = make_ref<resource>(*this, aUri);
         iResources[aUri] = decltype(iResources)::mapped_type{ weak_ref_ptr<i_resource>{ newResource } };
         aResult = newResource;
     }
@@ -103,6 +117,7 @@ namespace neogfx
         resources.as_std_map().swap(iResources.as_std_map());
         decltype(iResourceArchives) resourceArchives;
         resourceArchives.as_std_map().swap(iResourceArchives.as_std_map());
+        iArchives.clear();
     }
 
     neolib::i_map<i_string, neolib::i_variant<i_ref_ptr<i_resource>, i_weak_ref_ptr<i_resource>>> const& resource_manager::resources()
@@ -114,4 +129,30 @@ namespace neogfx
     {
         return iResourceArchives;
     }
+
+    resource_archive& resource_manager::archive(std::string const& aArchiveUri)
+    {
+        auto existing = iArchives.find(aArchiveUri);
+        if (existing != iArchives.end())
+            return *existing->second;
+        neolib::uri const uri{ aArchiveUri };
+        std::unique_ptr<resource_archive> newArchive;
+        if (uri.scheme() == "file")
+            newArchive = std::make_unique<resource_archive>(uri.path(), iArchiveCacheCapacity);
+        else
+            newArchive = std::make_unique<resource_archive>(load_resource(":/" + uri.path()), iArchiveCacheCapacity);
+        return *iArchives.emplace(aArchiveUri, std::move(newArchive)).first->second;
+    }
+
+    std::size_t resource_manager::archive_cache_capacity() const
+    {
+        return iArchiveCacheCapacity;
+    }
+
+    void resource_manager::set_archive_cache_capacity(std::size_t aCapacity)
+    {
+        iArchiveCacheCapacity = aCapacity;
+        for (auto& a : iArchives)
+            a.second->set_cache_capacity(aCapacity);
+    }
 }
\ No newline at end of file
@@ -0,0 +1,79 @@
+// audio_capture.cpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2024 Leigh Johnston.  All Rights Reserved.
+
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <neogfx/neogfx.hpp>
+
+#include <algorithm>
+
+#include <neogfx/audio/audio_capture.hpp>
+
+namespace neogfx
+{
+    audio_capture::audio_capture(audio_data_format const& aDataFormat, audio_frame_count aCapacity) :
+        iDataFormat{ aDataFormat },
+        iChannels{ std::max<std::size_t>(static_cast<std::size_t>(aDataFormat.channels), 1u) },
+        iBuffer{ static_cast<std::size_t>(aCapacity != 0ULL ? aCapacity : aDataFormat.sampleRate / 2u) * iChannels },
+        iOverruns{ 0u },
+        iDroppedFrames{ 0u }
+    {
+    }
+
+    audio_data_format const& audio_capture::data_format() const
+    {
+        return iDataFormat;
+    }
+
+    audio_frame_count audio_capture::capacity() const
+    {
+        return iBuffer.capacity() / iChannels;
+    }
+
+    void audio_capture::write(float const* aInput, audio_frame_count aFrameCount)
+    {
+        // only whole frames are written so the consumer never sees a partial frame
+        auto const space = (iBuffer.capacity() - iBuffer.size()) / iChannels;
+        auto const frames = std::min(static_cast<std::size_t>(aFrameCount), space);
+        iBuffer.push(aInput, frames * iChannels);
+        if (frames < aFrameCount)
+        {
+            iOverruns.fetch_add(1u, std::memory_order_relaxed);
+            iDroppedFrames.fetch_add(aFrameCount - frames, std::memory_order_relaxed);
+        }
+    }
+
+    audio_frame_count audio_capture::available() const
+    {
+        return iBuffer.size() / iChannels;
+    }
+
+    audio_frame_count audio_capture::read(float* aOutput, audio_frame_count aMaxFrames)
+    {
+        return iBuffer.pop(aOutput, static_cast<std::size_t>(aMaxFrames) * iChannels) / iChannels;
+    }
+
+    std::uint64_t audio_capture::overruns() const
+    {
+        return iOverruns.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t audio_capture::dropped_frames() const
+    {
+        return iDroppedFrames.load(std::memory_order_relaxed);
+    }
+}
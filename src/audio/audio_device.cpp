@@ -106,25 +106,26 @@ namespace neogfx
 	}
 
 	audio_device::audio_device(audio_context aContext, i_audio_device_info const& aDeviceInfo, audio_data_format const& aDataFormat) :
-		iInfo{ aDeviceInfo }, iDataFormat{ aDataFormat }
+		iInfo{ aDeviceInfo }, iDataFormat{ aDataFormat }, iMixer{ aDataFormat }
 	{
+		if (aDeviceInfo.type() != audio_device_type::Playback)
+			iCapture.emplace(aDataFormat);
+
 		auto callback = [](ma_device* pDevice, void* pOutput, const void* pInput, ma_uint32 frameCount)
 		{
 			auto& device = *static_cast<audio_device*>(pDevice->pUserData);
-			std::unique_lock lock{ device.iMutex };
-			for (auto& source : device.iSources)
-			{
-				// todo: channel mapping
-				if (source.expiryTime > std::chrono::steady_clock::now())
-					source.bitstream->generate(audio_channel::Left | audio_channel::Right, frameCount, static_cast<float*>(pOutput));
-			}
+			if (pInput != nullptr && device.iCapture)
+				device.iCapture->write(static_cast<float const*>(pInput), frameCount);
+			if (pOutput != nullptr)
+				device.iMixer.mix(static_cast<float*>(pOutput), frameCount);
 		};
 
 		iConfig = ma_device_config_init(from_audio_device_type(aDeviceInfo.type()));
 		auto& config = *std::any_cast<ma_device_config>(&iConfig);
-		config.playback.format = from_audio_sample_format(aDataFormat.sampleFormat);
+		// the mixer renders and capture stores F32; miniaudio converts to and from the device's format
+		config.playback.format = ma_format_f32;
 		config.playback.channels = aDataFormat.channels;
-		config.capture.format = from_audio_sample_format(aDataFormat.sampleFormat);
+		config.capture.format = ma_format_f32;
 		config.capture.channels = aDataFormat.channels;
 		config.sampleRate = static_cast<decltype(config.sampleRate)>(aDataFormat.sampleRate);
 		config.dataCallback = callback;
@@ -162,9 +163,24 @@ namespace neogfx
 
 	void audio_device::play(i_audio_bitstream& aBitstream, std::chrono::duration<double> const& aDuration)
 	{
-		std::unique_lock lock{ iMutex };
-		iSources.push_back(source{
-			ref_ptr<i_audio_bitstream>{ ref_ptr<i_audio_bitstream>{}, &aBitstream },
-			std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::milliseconds>(aDuration) });
+		if (!iMixer.play(aBitstream, static_cast<audio_frame_count>(aDuration.count() * iDataFormat.sampleRate)))
+			throw command_queue_full();
+	}
+
+	audio_mixer const& audio_device::mixer() const
+	{
+		return iMixer;
+	}
+
+	audio_mixer& audio_device::mixer()
+	{
+		return iMixer;
+	}
+
+	audio_capture& audio_device::capture()
+	{
+		if (!iCapture)
+			throw not_a_capture_device();
+		return *iCapture;
 	}
 }
\ No newline at end of file
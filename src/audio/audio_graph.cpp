@@ -0,0 +1,410 @@
+// audio_graph.cpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2024 Leigh Johnston.  All Rights Reserved.
+
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <neogfx/neogfx.hpp>
+
+#include <algorithm>
+#include <future>
+#include <numeric>
+#include <neolib/task/thread_pool.hpp>
+
+#include <neogfx/audio/audio_graph.hpp>
+
+namespace neogfx
+{
+    audio_node::audio_node(std::string const& aName) :
+        iName{ aName }
+    {
+    }
+
+    audio_node_id audio_node::id() const
+    {
+        return iId;
+    }
+
+    std::string const& audio_node::name() const
+    {
+        return iName;
+    }
+
+    void audio_node::prepare(audio_sample_rate, audio_frame_count)
+    {
+    }
+
+    void audio_node::reset()
+    {
+    }
+
+    audio_graph::audio_graph(audio_sample_rate aSampleRate, audio_frame_count aBlockSize, bool aMultithreaded) :
+        iSampleRate{ aSampleRate },
+        iBlockSize{ std::max<audio_frame_count>(aBlockSize, 1ULL) },
+        iMultithreaded{ aMultithreaded }
+    {
+    }
+
+    audio_graph::~audio_graph()
+    {
+    }
+
+    audio_sample_rate audio_graph::sample_rate() const
+    {
+        return iSampleRate;
+    }
+
+    audio_frame_count audio_graph::block_size() const
+    {
+        return iBlockSize;
+    }
+
+    bool audio_graph::multithreaded() const
+    {
+        return iMultithreaded;
+    }
+
+    void audio_graph::set_multithreaded(bool aMultithreaded)
+    {
+        iMultithreaded = aMultithreaded;
+    }
+
+    audio_node& audio_graph::add(std::unique_ptr<audio_node> aNode)
+    {
+        aNode->iId = static_cast<audio_node_id>(iNodes.size());
+        iNodes.push_back(std::make_shared<node_entry>());
+        iNodes.back()->node = std::move(aNode);
+        iChanged = true;
+        return *iNodes.back()->node;
+    }
+
+    void audio_graph::remove(audio_node const& aNode)
+    {
+        auto& e = entry(aNode);
+        for (auto input : e.inputs)
+            std::erase(iNodes[input]->outputs, aNode.id());
+        for (auto output : e.outputs)
+            std::erase(iNodes[output]->inputs, aNode.id());
+        // a snapshot may still be processing the node so the entry is replaced rather than emptied
+        iNodes[aNode.id()] = std::make_shared<node_entry>();
+        iChanged = true;
+    }
+
+    void audio_graph::connect(audio_node const& aFrom, audio_node const& aTo)
+    {
+        auto& from = entry(aFrom);
+        auto& to = entry(aTo);
+        if (std::find(from.outputs.begin(), from.outputs.end(), aTo.id()) != from.outputs.end())
+            return;
+        // the connection would close a cycle if aFrom can already be reached from aTo
+        std::vector<audio_node_id> pending{ aTo.id() };
+        std::vector<bool> visited(iNodes.size());
+        while (!pending.empty())
+        {
+            auto const next = pending.back();
+            pending.pop_back();
+            if (next == aFrom.id())
+                throw cycle_detected();
+            if (visited[next])
+                continue;
+            visited[next] = true;
+            pending.insert(pending.end(), iNodes[next]->outputs.begin(), iNodes[next]->outputs.end());
+        }
+        from.outputs.push_back(aTo.id());
+        to.inputs.push_back(aFrom.id());
+        iChanged = true;
+    }
+
+    void audio_graph::disconnect(audio_node const& aFrom, audio_node const& aTo)
+    {
+        std::erase(entry(aFrom).outputs, aTo.id());
+        std::erase(entry(aTo).inputs, aFrom.id());
+        iChanged = true;
+    }
+
+    std::vector<audio_node*> audio_graph::nodes() const
+    {
+        std::vector<audio_node*> result;
+        for (auto const& e : iNodes)
+            if (e->node)
+                result.push_back(e->node.get());
+        return result;
+    }
+
+    void audio_graph::prepare()
+    {
+        // Kahn's algorithm, taking ready nodes in id order so that the result only depends on the graph
+        std::vector<std::size_t> pendingInputs(iNodes.size());
+        std::vector<audio_node_id> sorted;
+        for (audio_node_id n = 0u; n < iNodes.size(); ++n)
+            if (iNodes[n]->node)
+            {
+                pendingInputs[n] = iNodes[n]->inputs.size();
+                if (pendingInputs[n] == 0u)
+                    sorted.push_back(n);
+            }
+        for (std::size_t next = 0u; next < sorted.size(); ++next)
+            for (auto output : iNodes[sorted[next]]->outputs)
+                if (--pendingInputs[output] == 0u)
+                    sorted.push_back(output);
+        if (sorted.size() != nodes().size())
+            throw cycle_detected();
+
+        // independent subgraphs are the connected components, ignoring the direction of connections
+        std::vector<audio_node_id> parent(iNodes.size());
+        std::iota(parent.begin(), parent.end(), 0u);
+        auto root = [&](audio_node_id aNode)
+        {
+            while (parent[aNode] != aNode)
+                aNode = parent[aNode] = parent[parent[aNode]];
+            return aNode;
+        };
+        for (auto n : sorted)
+            for (auto output : iNodes[n]->outputs)
+                parent[root(output)] = root(n);
+        auto snapshot = std::make_unique<prepared_graph>();
+        auto const samples = static_cast<std::size_t>(iBlockSize) * 2u;
+        std::vector<std::size_t> subgraphOf(iNodes.size(), iNodes.size());
+        std::vector<std::size_t> indexOf(iNodes.size());
+        for (auto n : sorted)
+        {
+            auto& subgraph = subgraphOf[root(n)];
+            if (subgraph == iNodes.size())
+            {
+                subgraph = snapshot->subgraphs.size();
+                snapshot->subgraphs.emplace_back();
+            }
+            auto& subgraphNodes = snapshot->subgraphs[subgraph];
+            indexOf[n] = subgraphNodes.size();
+            auto& p = subgraphNodes.emplace_back();
+            p.entry = iNodes[n];
+            // inputs come first in topological order and are in the same subgraph
+            for (auto input : p.entry->inputs)
+                p.inputs.push_back(indexOf[input]);
+            p.outputBuffer.assign(samples, 0.0f);
+            if (p.inputs.size() > 1u)
+                p.inputBuffer.assign(samples, 0.0f);
+            if (p.entry->outputs.empty())
+                snapshot->terminals.emplace_back(subgraph, indexOf[n]);
+            // the sample rate and block size never change so a node that is already playing isn't prepared again
+            if (!p.entry->prepared)
+            {
+                p.entry->node->prepare(iSampleRate, iBlockSize);
+                p.entry->prepared = true;
+            }
+        }
+        std::sort(snapshot->terminals.begin(), snapshot->terminals.end());
+
+        iSnapshots.push_back(std::move(snapshot));
+        iPublished.store(iSnapshots.back().get());
+        iChanged = false;
+        release_retired();
+    }
+
+    bool audio_graph::prepared() const
+    {
+        return !iChanged;
+    }
+
+    std::size_t audio_graph::release_retired()
+    {
+        auto const published = iPublished.load();
+        auto const inUse = iInUse.load();
+        return std::erase_if(iSnapshots, [&](auto const& aSnapshot) { return aSnapshot.get() != published && aSnapshot.get() != inUse; });
+    }
+
+    void audio_graph::reset()
+    {
+        for (auto const& e : iNodes)
+            if (e->node)
+                e->node->reset();
+    }
+
+    void audio_graph::process(float* aOutput, audio_frame_count aFrameCount)
+    {
+        if (iChanged)
+            throw not_prepared();
+        process(*iPublished.load(), aOutput, aFrameCount, iMultithreaded);
+    }
+
+    audio_node_timing audio_graph::timing(audio_node const& aNode) const
+    {
+        auto const& e = entry(aNode);
+        return audio_node_timing{
+            std::chrono::nanoseconds{ e.lastNanoseconds.load(std::memory_order_relaxed) },
+            std::chrono::nanoseconds{ e.totalNanoseconds.load(std::memory_order_relaxed) },
+            e.blocks.load(std::memory_order_relaxed) };
+    }
+
+    void audio_graph::reset_timings()
+    {
+        for (auto const& e : iNodes)
+        {
+            e->lastNanoseconds = 0;
+            e->totalNanoseconds = 0;
+            e->blocks = 0u;
+        }
+    }
+
+    audio_graph::node_entry& audio_graph::entry(audio_node const& aNode) const
+    {
+        if (aNode.id() >= iNodes.size() || iNodes[aNode.id()]->node.get() != &aNode)
+            throw node_not_found();
+        return *iNodes[aNode.id()];
+    }
+
+    audio_graph::prepared_graph* audio_graph::acquire_snapshot()
+    {
+        // the control thread only releases a snapshot that is neither published nor in use, so the snapshot is
+        // safe once it has been marked in use and is still the published one
+        prepared_graph* snapshot;
+        do
+        {
+            snapshot = iPublished.load();
+            iInUse.store(snapshot);
+        } while (snapshot != iPublished.load());
+        return snapshot;
+    }
+
+    void audio_graph::release_snapshot()
+    {
+        iInUse.store(nullptr);
+    }
+
+    void audio_graph::process(prepared_graph& aGraph, float* aOutput, audio_frame_count aFrameCount, bool aMultithreaded)
+    {
+        for (audio_frame_count frame = 0ULL; frame < aFrameCount; frame += iBlockSize)
+            process_block(aGraph, aOutput + frame * 2u, std::min(iBlockSize, aFrameCount - frame), aMultithreaded);
+    }
+
+    void audio_graph::process_block(prepared_graph& aGraph, float* aOutput, audio_frame_count aFrameCount, bool aMultithreaded)
+    {
+        auto& subgraphs = aGraph.subgraphs;
+        if (aMultithreaded && subgraphs.size() > 1u)
+        {
+            // all but the first subgraph go to the pool, this thread processes the first
+            thread_local std::vector<std::future<void>> processing;
+            processing.clear();
+            for (std::size_t s = 1u; s < subgraphs.size(); ++s)
+                processing.push_back(neolib::thread_pool::default_thread_pool().run([this, &subgraphs, s, aFrameCount]() { process_subgraph(subgraphs[s], aFrameCount); }));
+            std::exception_ptr exception;
+            try
+            {
+                process_subgraph(subgraphs[0], aFrameCount);
+            }
+            catch (...)
+            {
+                exception = std::current_exception();
+            }
+            for (auto& p : processing)
+                p.wait();
+            if (exception)
+                std::rethrow_exception(exception);
+            for (auto& p : processing)
+                p.get();
+        }
+        else
+            for (auto& subgraph : subgraphs)
+                process_subgraph(subgraph, aFrameCount);
+
+        auto const samples = static_cast<std::size_t>(aFrameCount) * 2u;
+        std::fill(aOutput, aOutput + samples, 0.0f);
+        for (auto const& terminal : aGraph.terminals)
+        {
+            float const* const output = subgraphs[terminal.first][terminal.second].outputBuffer.data();
+            for (std::size_t i = 0u; i < samples; ++i)
+                aOutput[i] += output[i];
+        }
+    }
+
+    void audio_graph::process_subgraph(std::vector<prepared_node>& aSubgraph, audio_frame_count aFrameCount)
+    {
+        auto const samples = static_cast<std::size_t>(aFrameCount) * 2u;
+        for (auto& p : aSubgraph)
+        {
+            auto& e = *p.entry;
+            float const* input = nullptr;
+            if (p.inputs.size() == 1u)
+                input = aSubgraph[p.inputs[0]].outputBuffer.data();
+            else if (p.inputs.size() > 1u)
+            {
+                float* const sum = p.inputBuffer.data();
+                std::fill(sum, sum + samples, 0.0f);
+                for (auto i : p.inputs)
+                {
+                    float const* const output = aSubgraph[i].outputBuffer.data();
+                    for (std::size_t s = 0u; s < samples; ++s)
+                        sum[s] += output[s];
+                }
+                input = sum;
+            }
+            auto const start = std::chrono::steady_clock::now();
+            e.node->process(input, p.outputBuffer.data(), aFrameCount);
+            auto const elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+            e.lastNanoseconds.store(elapsed, std::memory_order_relaxed);
+            e.totalNanoseconds.fetch_add(elapsed, std::memory_order_relaxed);
+            e.blocks.fetch_add(1u, std::memory_order_relaxed);
+        }
+    }
+
+    audio_graph_bitstream::audio_graph_bitstream(audio_graph& aGraph, audio_frame_count aLength) :
+        audio_bitstream{ aGraph.sample_rate() },
+        iGraph{ aGraph },
+        iLength{ aLength },
+        iBuffer(static_cast<std::size_t>(aGraph.block_size()) * 2u)
+    {
+        if (!iGraph.prepared())
+            iGraph.prepare();
+    }
+
+    audio_frame_count audio_graph_bitstream::length() const
+    {
+        return iLength;
+    }
+
+    void audio_graph_bitstream::generate(audio_channel aChannel, audio_frame_count aFrameCount, float* aOutputFrames)
+    {
+        // never prepare or go to the thread pool here, this is called on the audio thread
+        auto* const graph = iGraph.acquire_snapshot();
+        if (!graph)
+            return;
+        auto const channels = static_cast<std::size_t>(channel_count(aChannel));
+        auto const gain = amplitude();
+        for (audio_frame_count frame = 0ULL; frame < aFrameCount; frame += iGraph.block_size())
+        {
+            auto const count = static_cast<std::size_t>(std::min(iGraph.block_size(), aFrameCount - frame));
+            iGraph.process(*graph, iBuffer.data(), count, false);
+            auto* const output = aOutputFrames + static_cast<std::size_t>(frame) * channels;
+            if (channels == 2u)
+                for (std::size_t i = 0u; i < count * 2u; ++i)
+                    output[i] += iBuffer[i] * gain;
+            else
+                for (std::size_t i = 0u; i < count; ++i)
+                {
+                    auto const mono = (iBuffer[i * 2u] + iBuffer[i * 2u + 1u]) * 0.5f * gain;
+                    for (std::size_t c = 0u; c < channels; ++c)
+                        output[i * channels + c] += mono;
+                }
+        }
+        iGraph.release_snapshot();
+    }
+
+    void audio_graph_bitstream::generate_from(audio_channel aChannel, audio_frame_index, audio_frame_count aFrameCount, float* aOutputFrames)
+    {
+        // a graph is a live stream and cannot seek
+        generate(aChannel, aFrameCount, aOutputFrames);
+    }
+}
@@ -19,6 +19,8 @@
 
 #include <neogfx/neogfx.hpp>
 
+#include <algorithm>
+
 #include <neogfx/audio/i_audio.hpp>
 #include <neogfx/audio/i_audio_instrument_atlas.hpp>
 #include <neogfx/audio/audio_instrument.hpp>
@@ -28,6 +30,8 @@ namespace neogfx
     audio_instrument::audio_instrument(audio_sample_rate aSampleRate, neogfx::instrument aInstrument, float aAmplitude) :
         audio_bitstream{ aSampleRate, aAmplitude }, iInstrument{ aInstrument }
     {
+        // most likely to be ready by the time the first note is played
+        service<i_audio>().instrument_atlas().load_instrument_async(iInstrument, sample_rate());
     }
 
     audio_instrument::audio_instrument(i_audio_device const& aDevice, neogfx::instrument aInstrument, float aAmplitude) :
@@ -37,7 +41,7 @@ namespace neogfx
 
     audio_instrument::time_point audio_instrument::play_note(note aNote, std::chrono::duration<double> const& aDuration, float aAmplitude)
     {
-        return play_note(iInputCursor, aNote, aDuration);
+        return play_note(iInputCursor, aNote, aDuration, aAmplitude);
     }
 
     audio_instrument::time_point audio_instrument::play_note(std::chrono::duration<double> const& aWhen, note aNote, std::chrono::duration<double> const& aDuration, float aAmplitude)
@@ -47,26 +51,32 @@ namespace neogfx
         
     audio_instrument::time_point audio_instrument::play_note(time_point aWhen, note aNote, std::chrono::duration<double> const& aDuration, float aAmplitude)
     {
-        auto noteLength = service<i_audio>().instrument_atlas().instrument(iInstrument, sample_rate(), aNote).length();
+        // waits for the instrument to load here, on the composing thread, rather than in generate_from()
+        auto const noteLength = service<i_audio>().instrument_atlas().instrument(iInstrument, sample_rate(), aNote).length();
 
-        iComposition.emplace_back(aNote, noteLength, aAmplitude, aWhen, static_cast<time_interval>(aDuration.count() * sample_rate()));
-        iInputCursor = aWhen + iComposition.back().duration;
+        part const newPart{ aNote, noteLength, aAmplitude, aWhen, static_cast<time_interval>(aDuration.count() * sample_rate()) };
+        auto const position = std::upper_bound(iComposition.begin(), iComposition.end(), aWhen,
+            [](time_point aStart, part const& aPart) { return aStart < aPart.start; });
+        // keep the play cursor on the same part
+        if (static_cast<std::size_t>(std::distance(iComposition.begin(), position)) < iNextPart)
+            ++iNextPart;
+        iComposition.insert(position, newPart);
+        iLongestNote = std::max(iLongestNote, noteLength);
+        iInputCursor = aWhen + newPart.duration;
+        iLength = std::max(iLength, iInputCursor);
         return iInputCursor;
     }
 
     audio_instrument::time_point audio_instrument::rest(std::chrono::duration<double> const& aDuration)
     {
-        iComposition.emplace_back(std::nullopt, std::nullopt, std::nullopt, iInputCursor, static_cast<time_interval>(aDuration.count() * sample_rate()));
-        iInputCursor += iComposition.back().duration;
+        iInputCursor += static_cast<time_interval>(aDuration.count() * sample_rate());
+        iLength = std::max(iLength, iInputCursor);
         return iInputCursor;
     }
 
     audio_frame_count audio_instrument::length() const
     {
-        if (!iComposition.empty())
-            return iComposition.back().start + iComposition.back().duration;
-        else
-            return 0ULL;
+        return iLength;
     }
 
     void audio_instrument::generate(audio_channel aChannel, audio_frame_count aFrameCount, float* aOutputFrames)
@@ -76,22 +86,99 @@ namespace neogfx
 
     void audio_instrument::generate_from(audio_channel aChannel, audio_frame_index aFrameFrom, audio_frame_count aFrameCount, float* aOutputFrames)
     {
-        for (auto next = iComposition.begin(); next != iComposition.end(); ++next)
+        if (aFrameFrom != iOutputCursor)
+            seek(aFrameFrom);
+        auto const blockEnd = aFrameFrom + aFrameCount;
+        while (iNextPart < iComposition.size() && iComposition[iNextPart].start < blockEnd)
+            iVoices.push_back(start_voice(iComposition[iNextPart++]));
+        for (auto const& v : iVoices)
+            render_voice(v, aChannel, aFrameFrom, aFrameCount, aOutputFrames);
+        std::erase_if(iVoices, [&](voice const& v) { return v.end <= blockEnd; });
+        iOutputCursor = blockEnd;
+    }
+
+    void audio_instrument::seek(time_point aPosition)
+    {
+        // only notes starting within the longest note of aPosition can still be sounding
+        auto const earliest = aPosition > iLongestNote ? aPosition - iLongestNote : 0ULL;
+        auto next = std::lower_bound(iComposition.begin(), iComposition.end(), earliest,
+            [](part const& aPart, time_point aStart) { return aPart.start < aStart; });
+        iVoices.clear();
+        for (; next != iComposition.end() && next->start < aPosition; ++next)
+        {
+            auto v = start_voice(*next);
+            if (v.end > aPosition)
+                iVoices.push_back(v);
+        }
+        iNextPart = static_cast<std::size_t>(std::distance(iComposition.begin(), next));
+        iOutputCursor = aPosition;
+    }
+
+    audio_instrument::voice audio_instrument::start_voice(part const& aPart) const
+    {
+        voice result{ aPart, aPart.start + aPart.noteLength, {}, 0u };
+        auto const peak = amplitude() * aPart.amplitude;
+        auto add_ramp = [&](time_interval aBegin, time_interval aEnd, float aFrom, float aTo)
+        {
+            if (aBegin < aEnd)
+                result.ramps[result.rampCount++] = ramp{ aBegin, aEnd, aFrom, aTo };
+        };
+        if (!has_envelope())
+        {
+            add_ramp(0u, aPart.noteLength, peak, peak);
+            return result;
+        }
+        // attack, decay, sustain then release ending with the note's duration (the same shape as apply_envelope)
+        auto const frames = [&](float aSeconds) { return static_cast<time_interval>(aSeconds * sample_rate()); };
+        auto const duration = aPart.duration;
+        auto const sustain = peak * envelope().sustain;
+        auto const attack = frames(envelope().attack);
+        auto const decay = frames(envelope().decay);
+        auto const release = std::min(frames(envelope().release), duration);
+        auto const attackEnd = std::min(attack, duration);
+        auto const decayEnd = std::min(attackEnd + decay, duration);
+        auto const releaseBegin = std::max(decayEnd, duration - release);
+        add_ramp(0u, attackEnd, 0.0f, attack != 0u ? peak * attackEnd / attack : peak);
+        add_ramp(attackEnd, decayEnd, peak, decay != 0u ? peak + (sustain - peak) * (decayEnd - attackEnd) / decay : sustain);
+        add_ramp(decayEnd, releaseBegin, sustain, sustain);
+        add_ramp(releaseBegin, duration, sustain, 0.0f);
+        result.end = aPart.start + std::min(aPart.noteLength, duration);
+        return result;
+    }
+
+    void audio_instrument::render_voice(voice const& aVoice, audio_channel aChannel, audio_frame_index aFrameFrom, audio_frame_count aFrameCount, float* aOutputFrames) const
+    {
+        auto const from = std::max(aFrameFrom, aVoice.part.start);
+        auto const to = std::min(aFrameFrom + aFrameCount, aVoice.end);
+        if (from >= to)
+            return;
+        // this is usually the audio thread so only an already loaded instrument is used
+        auto const noteStream = service<i_audio>().instrument_atlas().find_instrument(iInstrument, sample_rate(), aVoice.part.note);
+        if (noteStream == nullptr)
+            return;
+        auto const offset = from - aVoice.part.start;
+        auto const count = static_cast<std::size_t>(to - from);
+        thread_local std::vector<float> buffer;
+        buffer.resize(count);
+        noteStream->generate_from(aChannel, offset, count, buffer.data());
+        for (std::size_t r = 0u; r < aVoice.rampCount; ++r)
         {
-            if (aFrameFrom < next->start || aFrameFrom > next->start + next->noteLength.value())
+            auto const& ramp = aVoice.ramps[r];
+            auto const begin = std::max(ramp.begin, offset);
+            auto const end = std::min(ramp.end, offset + count);
+            if (begin >= end)
                 continue;
-            auto pos = aFrameFrom - next->start;
-            auto count = std::min(next->noteLength.value() - pos, aFrameCount);
-            thread_local std::vector<float> buffer;
-            buffer.resize(count);
-            if (next->note)
-                service<i_audio>().instrument_atlas().instrument(iInstrument, sample_rate(), next->note.value()).generate_from(
-                    aChannel, pos, count, buffer.data());
-            auto output = aOutputFrames;
-            for (auto const& sample : buffer)
-                for (int channel = 0; channel < channel_count(aChannel); ++channel)
-                    (*output++) += (sample * next->amplitude.value() * apply_envelope(pos + &sample - &buffer[0], next->duration));
+            auto const slope = (ramp.to - ramp.from) / static_cast<float>(ramp.end - ramp.begin);
+            auto const gain = ramp.from + slope * static_cast<float>(begin - ramp.begin);
+            auto* const samples = buffer.data() + (begin - offset);
+            auto const rampCount = static_cast<std::size_t>(end - begin);
+            for (std::size_t i = 0u; i < rampCount; ++i)
+                samples[i] *= gain + slope * static_cast<float>(i);
         }
-        iOutputCursor += aFrameCount;
+        auto const channels = static_cast<std::size_t>(channel_count(aChannel));
+        auto* const output = aOutputFrames + static_cast<std::size_t>(from - aFrameFrom) * channels;
+        for (std::size_t i = 0u; i < count; ++i)
+            for (std::size_t channel = 0u; channel < channels; ++channel)
+                output[i * channels + channel] += buffer[i];
     }
 }
\ No newline at end of file
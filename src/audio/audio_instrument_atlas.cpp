@@ -21,6 +21,7 @@
 
 #include <sstream>
 #include <filesystem>
+#include <span>
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/json_parser.hpp>
 
@@ -32,20 +33,17 @@
 #include <neolib/core/string_utils.hpp>
 #include <neolib/file/file.hpp>
 #include <neolib/file/zip.hpp>
+#include <neolib/task/thread_pool.hpp>
 #include <neogfx/audio/audio_instrument_atlas.hpp>
 #include <neogfx/audio/audio_bitstream.hpp>
 #include <neogfx/audio/audio_oscillator.hpp>
-
-struct smbContext;
-smbContext* smbCreateContext(long fftFrameSize);
-void smbDestroyContext(smbContext* context);
-void smbPitchShift(smbContext* context, float pitchShift, long numSampsToProcess, long fftFrameSize, long osamp, float sampleRate, float* indata, float* outdata);
+#include <neogfx/audio/audio_resampler.hpp>
 
 namespace neogfx
 {
 	audio_instrument_atlas::audio_instrument_atlas()
 	{
-		auto atlasFile = neolib::program_directory() + "/music.zip";
+		auto const atlasFile = atlas_file();
 
 		if (std::filesystem::exists(atlasFile))
 		{
@@ -109,18 +107,6 @@ namespace neogfx
 		}
 	}
 
-	bool audio_instrument_atlas::load_instrument(neogfx::instrument aInstrument, audio_sample_rate aSampleRate)
-	{
-		if (iSamples.find(aInstrument) == iSamples.end())
-			return false;
-		for (auto key = note::MIDI0; key <= note::Ab9; key = static_cast<note>(static_cast<std::uint32_t>(key) + 1))
-		{
-			if (iSamples[aInstrument].find(key) != iSamples[aInstrument].end())
-				(void)instrument(aInstrument, aSampleRate, key);
-		}
-		return true;
-	}
-
 	class pure_tone : public audio_bitstream<i_audio_bitstream>
 	{
 	public:
@@ -140,73 +126,273 @@ namespace neogfx
 		}
 		void generate_from(audio_channel aChannel, audio_frame_index aFrameFrom, audio_frame_count aFrameCount, float* aOutputFrames) override
 		{
-			iOscillator.generate_from(aFrameFrom, aFrameCount, aOutputFrames);
+			// notes are shared so a fresh oscillator makes the output depend only on aFrameFrom, not on who played the note last
+			audio_oscillator oscillator{ sample_rate(), iOscillator.frequency() };
+			oscillator.generate_from(aFrameFrom, aFrameCount, aOutputFrames);
 		}
 	private:
 		audio_oscillator iOscillator;
 	};
 
-	class sample : public audio_bitstream<i_audio_bitstream>
+	// a note played by resampling the zone that covers it
+	class resampled_note : public audio_bitstream<i_audio_bitstream>
 	{
 	public:
-		sample(audio_sample_rate aSampleRate, std::vector<float>&& aPcmFrames) :
+		resampled_note(audio_sample_rate aSampleRate, audio_sample_bank::zone const& aZone, note aNote) :
 			audio_bitstream<i_audio_bitstream>{ aSampleRate },
-			iPcmFrames{ aPcmFrames }
+			iSource{ aZone.pcm },
+			iResampler{ static_cast<double>(frequency(aNote)) / frequency(aZone.pitchCentre) * aZone.sampleRate / aSampleRate }
 		{
 		}
 	public:
 		audio_frame_count length() const override
 		{
-			return iPcmFrames.size();
+			return iResampler.length(iSource.size());
 		}
 		void generate(audio_channel aChannel, audio_frame_count aFrameCount, float* aOutputFrames) override
 		{
-			generate_from(aChannel, iCursor, aFrameCount, aOutputFrames);
+			generate_from(aChannel, iCursor.load(std::memory_order_relaxed), aFrameCount, aOutputFrames);
 		}
 		void generate_from(audio_channel aChannel, audio_frame_index aFrameFrom, audio_frame_count aFrameCount, float* aOutputFrames) override
 		{
-			std::fill(aOutputFrames, aOutputFrames + aFrameCount, 0.0f);
-			if (aFrameFrom >= iPcmFrames.size())
-				return;
-			auto count = std::min(iPcmFrames.size() - aFrameFrom, aFrameCount);
-			std::copy(std::next(iPcmFrames.begin(), aFrameFrom), std::next(iPcmFrames.begin(), aFrameFrom + count), aOutputFrames);
-			iCursor = aFrameFrom + count;
+			auto const count = aFrameFrom < length() ? std::min(length() - aFrameFrom, aFrameCount) : 0u;
+			iResampler.generate_from(iSource, aFrameFrom, count, aOutputFrames);
+			std::fill(aOutputFrames + count, aOutputFrames + aFrameCount, 0.0f);
+			iCursor.store(aFrameFrom + count, std::memory_order_relaxed);
 		}
 	private:
-		std::vector<float> iPcmFrames;
-		audio_frame_index iCursor = 0ULL;
+		std::span<float const> iSource; // the sample bank (usually memory mapped)
+		audio_resampler iResampler;
+		std::atomic<audio_frame_index> iCursor = 0ULL; // notes can be played by several threads at once
 	};
 
+	audio_instrument_atlas::~audio_instrument_atlas()
+	{
+		std::vector<std::shared_future<void>> loading;
+		{
+			std::scoped_lock lock{ iMutex };
+			for (auto const& l : iLoading)
+				loading.push_back(l.second);
+		}
+		for (auto const& l : loading)
+			l.wait();
+	}
+
+	bool audio_instrument_atlas::load_instrument(neogfx::instrument aInstrument, audio_sample_rate aSampleRate)
+	{
+		if (!known(aInstrument))
+			return false;
+		if (!instrument_loaded(aInstrument, aSampleRate))
+			start_loading(instrument_key{ aInstrument, aSampleRate }, false).get();
+		return true;
+	}
+
+	void audio_instrument_atlas::load_instrument_async(neogfx::instrument aInstrument, audio_sample_rate aSampleRate)
+	{
+		if (known(aInstrument) && !instrument_loaded(aInstrument, aSampleRate))
+			start_loading(instrument_key{ aInstrument, aSampleRate }, true);
+	}
+
+	bool audio_instrument_atlas::instrument_loaded(neogfx::instrument aInstrument, audio_sample_rate aSampleRate) const
+	{
+		return find_loaded(aInstrument, aSampleRate) != nullptr;
+	}
+
+	bool audio_instrument_atlas::bake_instrument(neogfx::instrument aInstrument)
+	{
+		if (iSamples.find(aInstrument) == iSamples.end())
+			return false;
+		audio_sample_bank::save(audio_sample_bank::default_path(aInstrument), aInstrument, atlas_stamp(), bake(aInstrument));
+		return true;
+	}
+
 	i_audio_bitstream& audio_instrument_atlas::instrument(neogfx::instrument aInstrument, audio_sample_rate aSampleRate, note aNote)
 	{
-		note_key const key{ aInstrument, aSampleRate, aNote };
+		auto loaded = find_loaded(aInstrument, aSampleRate);
+		if (loaded == nullptr)
+		{
+			if (!known(aInstrument))
+				throw audio_instrument_not_found(aInstrument);
+			start_loading(instrument_key{ aInstrument, aSampleRate }, false).get();
+			loaded = find_loaded(aInstrument, aSampleRate);
+		}
+		if (static_cast<std::size_t>(aNote) >= loaded->notes.size() || loaded->notes[static_cast<std::size_t>(aNote)] == nullptr)
+			throw audio_instrument_note_not_found(aInstrument, aNote);
+		return *loaded->notes[static_cast<std::size_t>(aNote)];
+	}
+
+	i_audio_bitstream* audio_instrument_atlas::find_instrument(neogfx::instrument aInstrument, audio_sample_rate aSampleRate, note aNote) const
+	{
+		auto const loaded = find_loaded(aInstrument, aSampleRate);
+		if (loaded == nullptr || static_cast<std::size_t>(aNote) >= loaded->notes.size())
+			return nullptr;
+		return loaded->notes[static_cast<std::size_t>(aNote)];
+	}
+
+	bool audio_instrument_atlas::known(neogfx::instrument aInstrument) const
+	{
+		return aInstrument == neogfx::instrument::PureTone || iSamples.find(aInstrument) != iSamples.end();
+	}
+
+	audio_instrument_atlas::loaded_instrument const* audio_instrument_atlas::find_loaded(neogfx::instrument aInstrument, audio_sample_rate aSampleRate) const
+	{
+		if (static_cast<std::size_t>(aInstrument) >= InstrumentCount)
+			return nullptr;
+		// slots are claimed in order and never released so the first free one ends the search
+		for (auto const& slot : iSampleRates)
+		{
+			auto const sampleRate = slot.sampleRate.load(std::memory_order_acquire);
+			if (sampleRate == aSampleRate)
+				return slot.instruments[static_cast<std::size_t>(aInstrument)].load(std::memory_order_acquire);
+			if (sampleRate == 0u)
+				break;
+		}
+		return nullptr;
+	}
+
+	std::shared_future<void> audio_instrument_atlas::start_loading(instrument_key const& aKey, bool aAsync)
+	{
+		auto loaded = std::make_shared<std::promise<void>>();
+		{
+			std::scoped_lock lock{ iMutex };
+			auto existing = iLoading.find(aKey);
+			if (existing != iLoading.end())
+				return existing->second;
+			iLoading[aKey] = loaded->get_future().share();
+		}
+		auto task = [this, aKey, loaded]()
+		{
+			try
+			{
+				load(aKey);
+				loaded->set_value();
+			}
+			catch (...)
+			{
+				loaded->set_exception(std::current_exception());
+			}
+		};
+		if (aAsync)
+			neolib::thread_pool::default_thread_pool().run(task);
+		else
+			task();
+		std::scoped_lock lock{ iMutex };
+		return iLoading[aKey];
+	}
+
+	void audio_instrument_atlas::load(instrument_key const& aKey)
+	{
+		auto const [instrumentId, sampleRate] = aKey;
+		auto loaded = std::make_unique<loaded_instrument>();
+		auto add_note = [&](note aNote, ref_ptr<i_audio_bitstream> aBitstream)
+		{
+			loaded->notes[static_cast<std::size_t>(aNote)] = &*aBitstream;
+			loaded->bitstreams.push_back(aBitstream);
+		};
 
-		auto existing = iNotes.find(key);
-		if (existing != iNotes.end())
-			return *existing->second;
+		if (instrumentId == neogfx::instrument::PureTone)
+		{
+			for (auto key = note::MIDI0; key <= note::Ab9; key = static_cast<note>(static_cast<std::uint32_t>(key) + 1))
+				add_note(key, make_ref<pure_tone>(sampleRate, frequency(key)));
+		}
+		else
+		{
+			loaded->samples = samples(instrumentId);
+			for (auto const& zone : loaded->samples->zones)
+				for (auto key = zone.low; key <= zone.high; key = static_cast<note>(static_cast<std::uint32_t>(key) + 1))
+					if (loaded->notes[static_cast<std::size_t>(key)] == nullptr)
+						add_note(key, make_ref<resampled_note>(sampleRate, zone, key));
+		}
 
-		if (aInstrument == neogfx::instrument::PureTone)
+		std::scoped_lock lock{ iMutex };
+		auto slot = std::find_if(iSampleRates.begin(), iSampleRates.end(), [&](sample_rate_slot const& s)
+			{ return s.sampleRate.load(std::memory_order_relaxed) == sampleRate; });
+		if (slot == iSampleRates.end())
 		{
-			iNotes[key] = make_ref<pure_tone>(aSampleRate, frequency(aNote));
-			return *iNotes[key];
+			slot = std::find_if(iSampleRates.begin(), iSampleRates.end(), [&](sample_rate_slot const& s)
+				{ return s.sampleRate.load(std::memory_order_relaxed) == 0u; });
+			if (slot == iSampleRates.end())
+				throw too_many_sample_rates();
+			slot->sampleRate.store(sampleRate, std::memory_order_release);
 		}
+		slot->instruments[static_cast<std::size_t>(instrumentId)].store(loaded.get(), std::memory_order_release);
+		iLoaded.push_back(std::move(loaded));
+	}
 
-		auto existingInstrument = iSamples.find(aInstrument);
-		if (existingInstrument == iSamples.end())
+	std::shared_ptr<audio_instrument_atlas::instrument_samples const> audio_instrument_atlas::samples(neogfx::instrument aInstrument)
+	{
+		{
+			std::scoped_lock lock{ iMutex };
+			auto existing = iInstrumentSamples.find(aInstrument);
+			if (existing != iInstrumentSamples.end())
+				return existing->second;
+		}
+		if (iSamples.find(aInstrument) == iSamples.end())
 			throw audio_instrument_not_found(aInstrument);
-		auto existingNote = existingInstrument->second.find(aNote);
-		if (existingNote == iSamples[aInstrument].end())
-			throw audio_instrument_note_not_found(aInstrument, aNote);
-		auto atlasFile = neolib::program_directory() + "/music.zip";
+		auto result = std::make_shared<instrument_samples>();
+		auto const bankFile = audio_sample_bank::default_path(aInstrument);
+		auto const stamp = atlas_stamp();
+		try
+		{
+			result->bank.emplace(bankFile, aInstrument, stamp);
+		}
+		catch (std::runtime_error const&)
+		{
+			// missing, out of date or damaged: bake it now
+			auto baked = bake(aInstrument);
+			try
+			{
+				audio_sample_bank::save(bankFile, aInstrument, stamp, baked);
+				result->bank.emplace(bankFile, aInstrument, stamp);
+			}
+			catch (std::exception const&)
+			{
+				result->bank = std::nullopt;
+				result->unsaved = std::move(baked);
+			}
+		}
+		if (result->bank)
+			result->zones = result->bank->zones();
+		else
+			for (auto const& baked : result->unsaved)
+				result->zones.push_back(audio_sample_bank::zone{ baked.low, baked.pitchCentre, baked.high, baked.sampleRate, baked.pcm });
+		// another sample rate may have loaded the same instrument meanwhile, in which case its samples are used
+		std::scoped_lock lock{ iMutex };
+		return iInstrumentSamples.try_emplace(aInstrument, std::move(result)).first->second;
+	}
+
+	std::vector<audio_sample_bank::baked_zone> audio_instrument_atlas::bake(neogfx::instrument aInstrument) const
+	{
+		std::vector<audio_sample_bank::baked_zone> result;
+		// consecutive keys played from the same sample form a zone
+		for (auto const& [key, info] : iSamples.at(aInstrument))
+		{
+			if (!result.empty() && info.sampleFile == iSamples.at(aInstrument).at(result.back().low).sampleFile &&
+				info.midiKeyPitchCentre == result.back().pitchCentre &&
+				static_cast<std::uint32_t>(key) == static_cast<std::uint32_t>(result.back().high) + 1u)
+			{
+				result.back().high = key;
+				continue;
+			}
+			auto decoded = decode(info.sampleFile);
+			result.push_back(audio_sample_bank::baked_zone{ key, info.midiKeyPitchCentre, key, decoded.second, std::move(decoded.first) });
+		}
+		return result;
+	}
+
+	std::pair<std::vector<float>, audio_sample_rate> audio_instrument_atlas::decode(std::string const& aSampleFile) const
+	{
+		auto const atlasFile = atlas_file();
 		if (!std::filesystem::exists(atlasFile))
 			throw audio_instrument_atlas_file_found();
 		thread_local neolib::zip zipFile(atlasFile);
 		thread_local std::vector<std::uint8_t> buffer;
 		buffer.clear();
-		zipFile.extract_to(zipFile.index_of(existingNote->second.sampleFile), buffer);
+		zipFile.extract_to(zipFile.index_of(aSampleFile), buffer);
 
+		// decoded at the sample's own rate; it is resampled when played
 		ma_decoder decoder;
-		ma_decoder_config config = ma_decoder_config_init(ma_format_f32, 1, static_cast<ma_uint32>(aSampleRate));
+		ma_decoder_config config = ma_decoder_config_init(ma_format_f32, 1, 0);
 		ma_result result = ma_decoder_init_memory(buffer.data(), buffer.size(), &config, &decoder);
 		if (result != MA_SUCCESS)
 			throw audio_instrument_sample_decode_failure();
@@ -222,17 +408,26 @@ namespace neogfx
 			if (framesRead < partSample.size())
 				break;
 		}
+		audio_sample_rate const sampleRate = decoder.outputSampleRate;
+		ma_decoder_uninit(&decoder);
 
-		if (aNote != existingNote->second.midiKeyPitchCentre)
-		{
-			auto context = smbCreateContext(4096);
-			auto const frequencyShift = frequency(aNote) / frequency(existingNote->second.midiKeyPitchCentre);
-			smbPitchShift(context, frequencyShift, static_cast<long>(entireSample.size()), 4096, 32, static_cast<float>(aSampleRate), entireSample.data(), entireSample.data());
-			smbDestroyContext(context);
-		}
+		return { std::move(entireSample), sampleRate };
+	}
 
-		iNotes[key] = make_ref<sample>(aSampleRate, std::move(entireSample));
+	std::string audio_instrument_atlas::atlas_file()
+	{
+		return neolib::program_directory() + "/music.zip";
+	}
 
-		return *iNotes[key];
+	audio_sample_bank::source_stamp audio_instrument_atlas::atlas_stamp()
+	{
+		std::error_code ec;
+		auto const atlasFile = std::filesystem::path{ atlas_file() };
+		auto const size = std::filesystem::file_size(atlasFile, ec);
+		if (ec)
+			return audio_sample_bank::source_stamp{};
+		auto const lastWriteTime = std::filesystem::last_write_time(atlasFile, ec);
+		return audio_sample_bank::source_stamp{ static_cast<std::uint64_t>(size),
+			ec ? 0 : static_cast<std::int64_t>(lastWriteTime.time_since_epoch().count()) };
 	}
 }
\ No newline at end of file
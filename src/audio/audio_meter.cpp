@@ -0,0 +1,218 @@
+// audio_meter.cpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2024 Leigh Johnston.  All Rights Reserved.
+
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <neogfx/neogfx.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <boost/math/constants/constants.hpp>
+#include <ffts/ffts.h>
+
+#include <neogfx/audio/audio_meter.hpp>
+
+namespace neogfx
+{
+    namespace
+    {
+        // Accumulates Lanes frames at a time into independent accumulators so the inner loop is a contiguous run
+        // of Lanes * Channels floats that the compiler vectorises; lane j belongs to channel j % Channels.
+        template <std::size_t Channels>
+        std::size_t accumulate(float const* aInput, std::size_t aFrameCount, float* aPeaks, float* aSums)
+        {
+            std::size_t constexpr Lanes = 8u;
+            std::size_t constexpr Width = Lanes * Channels;
+            float peaks[Width] = {};
+            float sums[Width] = {};
+            std::size_t const blocks = aFrameCount / Lanes;
+            for (std::size_t b = 0u; b < blocks; ++b)
+            {
+                float const* const block = aInput + b * Width;
+                for (std::size_t j = 0u; j < Width; ++j)
+                {
+                    auto const x = block[j];
+                    peaks[j] = std::max(peaks[j], std::abs(x));
+                    sums[j] += x * x;
+                }
+            }
+            for (std::size_t j = 0u; j < Width; ++j)
+            {
+                aPeaks[j % Channels] = std::max(aPeaks[j % Channels], peaks[j]);
+                aSums[j % Channels] += sums[j];
+            }
+            return blocks * Lanes;
+        }
+    }
+
+    audio_level_meter::audio_level_meter(std::uint32_t aChannels, audio_sample_rate aSampleRate, float aRmsWindow, float aPeakFall) :
+        iChannels{ std::max(aChannels, 1u) },
+        iSampleRate{ aSampleRate },
+        iRmsWindow{ aRmsWindow },
+        iPeakFall{ aPeakFall },
+        iLevels(iChannels),
+        iMeanSquares(iChannels),
+        iBlockPeaks(iChannels),
+        iBlockSums(iChannels)
+    {
+        reset();
+    }
+
+    std::uint32_t audio_level_meter::channels() const
+    {
+        return iChannels;
+    }
+
+    audio_level_meter::levels const& audio_level_meter::channel(std::uint32_t aChannel) const
+    {
+        return iLevels.at(aChannel);
+    }
+
+    void audio_level_meter::process(float const* aInput, audio_frame_count aFrameCount)
+    {
+        if (aFrameCount == 0ULL)
+            return;
+        auto const frames = static_cast<std::size_t>(aFrameCount);
+        std::fill(iBlockPeaks.begin(), iBlockPeaks.end(), 0.0f);
+        std::fill(iBlockSums.begin(), iBlockSums.end(), 0.0f);
+        std::size_t done = 0u;
+        if (iChannels == 1u)
+            done = accumulate<1u>(aInput, frames, iBlockPeaks.data(), iBlockSums.data());
+        else if (iChannels == 2u)
+            done = accumulate<2u>(aInput, frames, iBlockPeaks.data(), iBlockSums.data());
+        for (std::size_t i = done; i < frames; ++i)
+            for (std::size_t c = 0u; c < iChannels; ++c)
+            {
+                auto const x = aInput[i * iChannels + c];
+                iBlockPeaks[c] = std::max(iBlockPeaks[c], std::abs(x));
+                iBlockSums[c] += x * x;
+            }
+
+        auto const seconds = static_cast<double>(frames) / static_cast<double>(iSampleRate);
+        auto const fall = static_cast<float>(std::pow(10.0, -iPeakFall * seconds / 20.0));
+        auto const smoothing = static_cast<float>(std::exp(-seconds / std::max(static_cast<double>(iRmsWindow), 0.001)));
+        for (std::size_t c = 0u; c < iChannels; ++c)
+        {
+            iMeanSquares[c] = iMeanSquares[c] * smoothing + iBlockSums[c] / static_cast<float>(frames) * (1.0f - smoothing);
+            iLevels[c].peak = std::max(iBlockPeaks[c], iLevels[c].peak * fall);
+            iLevels[c].rms = std::sqrt(iMeanSquares[c]);
+        }
+    }
+
+    void audio_level_meter::reset()
+    {
+        std::fill(iLevels.begin(), iLevels.end(), levels{ 0.0f, 0.0f });
+        std::fill(iMeanSquares.begin(), iMeanSquares.end(), 0.0f);
+    }
+
+    float audio_level_meter::to_decibels(float aLevel)
+    {
+        return aLevel > 0.0f ? 20.0f * std::log10(aLevel) : -std::numeric_limits<float>::infinity();
+    }
+
+    audio_spectrum::audio_spectrum(std::uint32_t aChannels, audio_sample_rate aSampleRate, std::size_t aSize) :
+        iChannels{ std::max(aChannels, 1u) },
+        iSampleRate{ aSampleRate },
+        iSize{ aSize },
+        iPlan{ nullptr },
+        iWindow(aSize),
+        iScale{ 0.0f },
+        iHistory(aSize),
+        iInput(aSize),
+        iOutput((aSize / 2u + 1u) * 2u),
+        iMagnitudes(aSize / 2u + 1u)
+    {
+        if (aSize < 4u || (aSize & (aSize - 1u)) != 0u)
+            throw invalid_size();
+        iPlan = ffts_init_1d_real(aSize, FFTS_FORWARD);
+        if (iPlan == nullptr)
+            throw failed_to_create_plan();
+        float sum = 0.0f;
+        for (std::size_t i = 0u; i < aSize; ++i)
+        {
+            iWindow[i] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * boost::math::constants::pi<double>() * i / aSize));
+            sum += iWindow[i];
+        }
+        // a sine's energy is split between its positive and negative frequency bins
+        iScale = 2.0f / sum;
+    }
+
+    audio_spectrum::~audio_spectrum()
+    {
+        ffts_free(iPlan);
+    }
+
+    std::size_t audio_spectrum::size() const
+    {
+        return iSize;
+    }
+
+    float audio_spectrum::bin_frequency(std::size_t aBin) const
+    {
+        return static_cast<float>(static_cast<double>(aBin) * iSampleRate / iSize);
+    }
+
+    std::span<float const> audio_spectrum::magnitudes() const
+    {
+        return iMagnitudes;
+    }
+
+    bool audio_spectrum::process(float const* aInput, audio_frame_count aFrameCount)
+    {
+        bool updated = false;
+        auto const gain = 1.0f / static_cast<float>(iChannels);
+        for (std::size_t i = 0u; i < static_cast<std::size_t>(aFrameCount); ++i)
+        {
+            float mono = 0.0f;
+            for (std::size_t c = 0u; c < iChannels; ++c)
+                mono += aInput[i * iChannels + c];
+            iHistory[iFill++] = mono * gain;
+            if (iFill == iSize)
+            {
+                transform();
+                updated = true;
+                // the second half is the first half of the next transform
+                std::copy(iHistory.begin() + iSize / 2u, iHistory.end(), iHistory.begin());
+                iFill = iSize / 2u;
+            }
+        }
+        return updated;
+    }
+
+    void audio_spectrum::reset()
+    {
+        iFill = 0u;
+        std::fill(iMagnitudes.begin(), iMagnitudes.end(), 0.0f);
+    }
+
+    void audio_spectrum::transform()
+    {
+        for (std::size_t i = 0u; i < iSize; ++i)
+            iInput[i] = iHistory[i] * iWindow[i];
+        ffts_execute(iPlan, iInput.data(), iOutput.data());
+        for (std::size_t k = 0u; k < iMagnitudes.size(); ++k)
+        {
+            auto const re = iOutput[k * 2u];
+            auto const im = iOutput[k * 2u + 1u];
+            iMagnitudes[k] = std::sqrt(re * re + im * im) * iScale;
+        }
+        // DC and Nyquist have no mirror image
+        iMagnitudes.front() *= 0.5f;
+        iMagnitudes.back() *= 0.5f;
+    }
+}
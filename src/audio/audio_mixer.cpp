@@ -0,0 +1,201 @@
+// audio_mixer.cpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2024 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <neogfx/neogfx.hpp>
+
+#include <chrono>
+#include <algorithm>
+
+#include <neogfx/audio/audio_mixer.hpp>
+
+namespace neogfx
+{
+    audio_mixer::audio_mixer(audio_data_format const& aDataFormat, std::size_t aMaxVoices, std::size_t aCommandCapacity, audio_frame_count aMaxBlockFrames) :
+        iDataFormat{ aDataFormat },
+        iMaxBlockFrames{ std::max<audio_frame_count>(aMaxBlockFrames, 1u) },
+        iCommands{ aCommandCapacity },
+        // every reference held is in the command queue or the voice table when it expires so this never fills
+        iExpired{ iCommands.capacity() + aMaxVoices },
+        iVoices(aMaxVoices),
+        iVoiceCount{ 0u },
+        iScratch(static_cast<std::size_t>(iMaxBlockFrames * 2u)),
+        iActiveVoices{ 0u },
+        iPosition{ 0u },
+        iOverbudgetCallbacks{ 0u },
+        iDropped{ 0u }
+    {
+    }
+
+    audio_mixer::~audio_mixer()
+    {
+        // the audio thread has stopped so whatever it still holds can be released here
+        while (auto next = iCommands.pop())
+            if (next->bitstream != nullptr)
+                next->bitstream->release();
+        for (std::size_t v = 0u; v < iVoiceCount; ++v)
+            iVoices[v].bitstream->release();
+        do_release_expired();
+    }
+
+    audio_data_format const& audio_mixer::data_format() const
+    {
+        return iDataFormat;
+    }
+
+    std::size_t audio_mixer::max_voices() const
+    {
+        return iVoices.size();
+    }
+
+    bool audio_mixer::play(i_audio_bitstream& aBitstream, audio_frame_count aDuration, float aGain)
+    {
+        std::scoped_lock<std::mutex> lock{ iControlMutex };
+        do_release_expired();
+        aBitstream.add_ref();
+        if (iCommands.push(command{ command::Play, &aBitstream, aDuration, aGain }))
+            return true;
+        aBitstream.release();
+        ++iDropped;
+        return false;
+    }
+
+    bool audio_mixer::stop_all()
+    {
+        std::scoped_lock<std::mutex> lock{ iControlMutex };
+        return iCommands.push(command{ command::StopAll, nullptr, 0u, 0.0f });
+    }
+
+    std::size_t audio_mixer::release_expired()
+    {
+        std::scoped_lock<std::mutex> lock{ iControlMutex };
+        return do_release_expired();
+    }
+
+    void audio_mixer::mix(float* aOutput, audio_frame_count aFrameCount)
+    {
+        auto const start = std::chrono::steady_clock::now();
+
+        std::fill(aOutput, aOutput + aFrameCount * iDataFormat.channels, 0.0f);
+        apply_commands();
+        for (audio_frame_count done = 0u; done < aFrameCount;)
+        {
+            auto const block = std::min(aFrameCount - done, iMaxBlockFrames);
+            mix_block(aOutput + done * iDataFormat.channels, block);
+            done += block;
+        }
+        iActiveVoices.store(iVoiceCount, std::memory_order_relaxed);
+        iPosition.fetch_add(aFrameCount, std::memory_order_relaxed);
+
+        auto const budget = std::chrono::duration<double>{ static_cast<double>(aFrameCount) / iDataFormat.sampleRate };
+        if (std::chrono::steady_clock::now() - start > budget)
+            iOverbudgetCallbacks.fetch_add(1u, std::memory_order_relaxed);
+    }
+
+    std::size_t audio_mixer::active_voices() const
+    {
+        return iActiveVoices.load(std::memory_order_relaxed);
+    }
+
+    audio_frame_index audio_mixer::position() const
+    {
+        return iPosition.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t audio_mixer::overbudget_callbacks() const
+    {
+        return iOverbudgetCallbacks.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t audio_mixer::dropped() const
+    {
+        return iDropped.load(std::memory_order_relaxed);
+    }
+
+    void audio_mixer::apply_commands()
+    {
+        while (auto next = iCommands.pop())
+        {
+            switch (next->type)
+            {
+            case command::Play:
+                if (iVoiceCount < iVoices.size())
+                    iVoices[iVoiceCount++] = voice{ next->bitstream, next->duration, next->gain };
+                else
+                {
+                    expire(next->bitstream);
+                    iDropped.fetch_add(1u, std::memory_order_relaxed);
+                }
+                break;
+            case command::StopAll:
+                while (iVoiceCount > 0u)
+                    expire(iVoices[--iVoiceCount].bitstream);
+                break;
+            }
+        }
+    }
+
+    void audio_mixer::mix_block(float* aOutput, audio_frame_count aFrameCount)
+    {
+        auto const channels = iDataFormat.channels;
+        for (std::size_t v = 0u; v < iVoiceCount;)
+        {
+            auto& voice = iVoices[v];
+            auto const frames = std::min(voice.remaining, aFrameCount);
+            // bitstreams add to their output and are generated as stereo then mapped to the output channels
+            std::fill(iScratch.begin(), iScratch.begin() + frames * 2u, 0.0f);
+            voice.bitstream->generate(audio_channel::Left | audio_channel::Right, frames, iScratch.data());
+            float const* source = iScratch.data();
+            float* output = aOutput;
+            if (channels == 1u)
+                for (audio_frame_count f = 0u; f < frames; ++f, source += 2, ++output)
+                    *output += (source[0] + source[1]) * 0.5f * voice.gain;
+            else
+                for (audio_frame_count f = 0u; f < frames; ++f, source += 2, output += channels)
+                {
+                    output[0] += source[0] * voice.gain;
+                    output[1] += source[1] * voice.gain;
+                }
+            voice.remaining -= frames;
+            if (voice.remaining == 0u)
+            {
+                expire(voice.bitstream);
+                voice = iVoices[--iVoiceCount];
+            }
+            else
+                ++v;
+        }
+    }
+
+    void audio_mixer::expire(i_audio_bitstream* aBitstream)
+    {
+        // cannot fail, see the constructor
+        iExpired.push(aBitstream);
+    }
+
+    std::size_t audio_mixer::do_release_expired()
+    {
+        std::size_t released = 0u;
+        while (auto next = iExpired.pop())
+        {
+            (*next)->release();
+            ++released;
+        }
+        return released;
+    }
+}
@@ -0,0 +1,540 @@
+// audio_nodes.cpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2024 Leigh Johnston.  All Rights Reserved.
+
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <neogfx/neogfx.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <boost/math/constants/constants.hpp>
+
+#include <neogfx/audio/audio_nodes.hpp>
+
+namespace neogfx
+{
+    namespace
+    {
+        void silence(float* aOutput, audio_frame_count aFrameCount)
+        {
+            std::fill(aOutput, aOutput + static_cast<std::size_t>(aFrameCount) * 2u, 0.0f);
+        }
+    }
+
+    audio_source_node::audio_source_node(i_audio_bitstream& aSource) :
+        audio_source_node{ ref_ptr<i_audio_bitstream>{ ref_ptr<i_audio_bitstream>{}, &aSource } }
+    {
+    }
+
+    audio_source_node::audio_source_node(i_ref_ptr<i_audio_bitstream> const& aSource) :
+        audio_node{ "source" },
+        iSource{ aSource }
+    {
+    }
+
+    i_audio_bitstream& audio_source_node::source() const
+    {
+        return *iSource;
+    }
+
+    void audio_source_node::process(float const*, float* aOutput, audio_frame_count aFrameCount)
+    {
+        // bitstreams differ as to whether they add to or overwrite their output
+        silence(aOutput, aFrameCount);
+        iSource->generate(audio_channel::Left | audio_channel::Right, aFrameCount, aOutput);
+    }
+
+    audio_gain_node::audio_gain_node(float aGain) :
+        audio_node{ "gain" },
+        iGain{ aGain },
+        iCurrentGain{ aGain }
+    {
+    }
+
+    float audio_gain_node::gain() const
+    {
+        return iGain;
+    }
+
+    void audio_gain_node::set_gain(float aGain)
+    {
+        iGain = aGain;
+    }
+
+    void audio_gain_node::reset()
+    {
+        iCurrentGain = iGain;
+    }
+
+    void audio_gain_node::process(float const* aInput, float* aOutput, audio_frame_count aFrameCount)
+    {
+        auto const target = iGain.load(std::memory_order_relaxed);
+        if (aInput == nullptr)
+        {
+            silence(aOutput, aFrameCount);
+            iCurrentGain = target;
+            return;
+        }
+        auto const frames = static_cast<std::size_t>(aFrameCount);
+        auto const start = iCurrentGain;
+        auto const step = (target - start) / static_cast<float>(frames);
+        for (std::size_t i = 0u; i < frames; ++i)
+        {
+            auto const g = start + step * static_cast<float>(i + 1u);
+            aOutput[i * 2u] = aInput[i * 2u] * g;
+            aOutput[i * 2u + 1u] = aInput[i * 2u + 1u] * g;
+        }
+        iCurrentGain = target;
+    }
+
+    audio_pan_node::audio_pan_node(float aPan) :
+        audio_node{ "pan" },
+        iPan{ std::clamp(aPan, -1.0f, 1.0f) }
+    {
+        reset();
+    }
+
+    float audio_pan_node::pan() const
+    {
+        return iPan;
+    }
+
+    void audio_pan_node::set_pan(float aPan)
+    {
+        iPan = std::clamp(aPan, -1.0f, 1.0f);
+    }
+
+    void audio_pan_node::reset()
+    {
+        auto const angle = (iPan + 1.0f) * boost::math::constants::pi<float>() / 4.0f;
+        iCurrentGains = { std::cos(angle) * boost::math::constants::root_two<float>(), std::sin(angle) * boost::math::constants::root_two<float>() };
+    }
+
+    void audio_pan_node::process(float const* aInput, float* aOutput, audio_frame_count aFrameCount)
+    {
+        auto const start = iCurrentGains;
+        reset();
+        if (aInput == nullptr)
+        {
+            silence(aOutput, aFrameCount);
+            return;
+        }
+        auto const frames = static_cast<std::size_t>(aFrameCount);
+        auto const stepLeft = (iCurrentGains[0] - start[0]) / static_cast<float>(frames);
+        auto const stepRight = (iCurrentGains[1] - start[1]) / static_cast<float>(frames);
+        for (std::size_t i = 0u; i < frames; ++i)
+        {
+            auto const t = static_cast<float>(i + 1u);
+            aOutput[i * 2u] = aInput[i * 2u] * (start[0] + stepLeft * t);
+            aOutput[i * 2u + 1u] = aInput[i * 2u + 1u] * (start[1] + stepRight * t);
+        }
+    }
+
+    audio_biquad_node::audio_biquad_node(audio_filter_type aType, float aFrequency, float aQ, float aGain) :
+        audio_node{ "biquad" },
+        iType{ aType },
+        iFrequency{ aFrequency },
+        iQ{ aQ },
+        iGain{ aGain }
+    {
+    }
+
+    audio_filter_type audio_biquad_node::type() const
+    {
+        return iType;
+    }
+
+    float audio_biquad_node::frequency() const
+    {
+        return iFrequency;
+    }
+
+    float audio_biquad_node::q() const
+    {
+        return iQ;
+    }
+
+    float audio_biquad_node::gain() const
+    {
+        return iGain;
+    }
+
+    void audio_biquad_node::set(audio_filter_type aType, float aFrequency, float aQ, float aGain)
+    {
+        iType = aType;
+        iFrequency = aFrequency;
+        iQ = aQ;
+        iGain = aGain;
+        iChanged = true;
+    }
+
+    void audio_biquad_node::prepare(audio_sample_rate aSampleRate, audio_frame_count)
+    {
+        iSampleRate = static_cast<double>(aSampleRate);
+        iChanged = true;
+    }
+
+    void audio_biquad_node::reset()
+    {
+        iState = {};
+    }
+
+    void audio_biquad_node::process(float const* aInput, float* aOutput, audio_frame_count aFrameCount)
+    {
+        if (iChanged.exchange(false))
+            update_coefficients();
+        if (aInput == nullptr)
+        {
+            silence(aOutput, aFrameCount);
+            reset();
+            return;
+        }
+        auto const frames = static_cast<std::size_t>(aFrameCount);
+        for (std::size_t c = 0u; c < 2u; ++c)
+        {
+            auto z1 = iState[c][0];
+            auto z2 = iState[c][1];
+            for (std::size_t i = 0u; i < frames; ++i)
+            {
+                auto const x = aInput[i * 2u + c];
+                auto const y = iB0 * x + z1;
+                z1 = iB1 * x - iA1 * y + z2;
+                z2 = iB2 * x - iA2 * y;
+                aOutput[i * 2u + c] = y;
+            }
+            iState[c] = { z1, z2 };
+        }
+    }
+
+    void audio_biquad_node::update_coefficients()
+    {
+        auto const frequency = std::clamp(static_cast<double>(iFrequency), 1.0, iSampleRate * 0.49);
+        auto const w0 = 2.0 * boost::math::constants::pi<double>() * frequency / iSampleRate;
+        auto const cosW0 = std::cos(w0);
+        auto const alpha = std::sin(w0) / (2.0 * std::max(static_cast<double>(iQ), 0.01));
+        auto const a = std::pow(10.0, static_cast<double>(iGain) / 40.0);
+        auto const shelf = 2.0 * std::sqrt(a) * alpha;
+        double b0, b1, b2, a0, a1, a2;
+        switch (iType.load())
+        {
+        case audio_filter_type::LowPass:
+        default:
+            b0 = (1.0 - cosW0) / 2.0; b1 = 1.0 - cosW0; b2 = b0;
+            a0 = 1.0 + alpha; a1 = -2.0 * cosW0; a2 = 1.0 - alpha;
+            break;
+        case audio_filter_type::HighPass:
+            b0 = (1.0 + cosW0) / 2.0; b1 = -(1.0 + cosW0); b2 = b0;
+            a0 = 1.0 + alpha; a1 = -2.0 * cosW0; a2 = 1.0 - alpha;
+            break;
+        case audio_filter_type::BandPass:
+            b0 = alpha; b1 = 0.0; b2 = -alpha;
+            a0 = 1.0 + alpha; a1 = -2.0 * cosW0; a2 = 1.0 - alpha;
+            break;
+        case audio_filter_type::Notch:
+            b0 = 1.0; b1 = -2.0 * cosW0; b2 = 1.0;
+            a0 = 1.0 + alpha; a1 = -2.0 * cosW0; a2 = 1.0 - alpha;
+            break;
+        case audio_filter_type::Peak:
+            b0 = 1.0 + alpha * a; b1 = -2.0 * cosW0; b2 = 1.0 - alpha * a;
+            a0 = 1.0 + alpha / a; a1 = -2.0 * cosW0; a2 = 1.0 - alpha / a;
+            break;
+        case audio_filter_type::LowShelf:
+            b0 = a * ((a + 1.0) - (a - 1.0) * cosW0 + shelf);
+            b1 = 2.0 * a * ((a - 1.0) - (a + 1.0) * cosW0);
+            b2 = a * ((a + 1.0) - (a - 1.0) * cosW0 - shelf);
+            a0 = (a + 1.0) + (a - 1.0) * cosW0 + shelf;
+            a1 = -2.0 * ((a - 1.0) + (a + 1.0) * cosW0);
+            a2 = (a + 1.0) + (a - 1.0) * cosW0 - shelf;
+            break;
+        case audio_filter_type::HighShelf:
+            b0 = a * ((a + 1.0) + (a - 1.0) * cosW0 + shelf);
+            b1 = -2.0 * a * ((a - 1.0) + (a + 1.0) * cosW0);
+            b2 = a * ((a + 1.0) + (a - 1.0) * cosW0 - shelf);
+            a0 = (a + 1.0) - (a - 1.0) * cosW0 + shelf;
+            a1 = 2.0 * ((a - 1.0) - (a + 1.0) * cosW0);
+            a2 = (a + 1.0) - (a - 1.0) * cosW0 - shelf;
+            break;
+        }
+        iB0 = static_cast<float>(b0 / a0);
+        iB1 = static_cast<float>(b1 / a0);
+        iB2 = static_cast<float>(b2 / a0);
+        iA1 = static_cast<float>(a1 / a0);
+        iA2 = static_cast<float>(a2 / a0);
+    }
+
+    audio_delay_node::audio_delay_node(float aMaximumDelay, float aDelay, float aFeedback, float aMix) :
+        audio_node{ "delay" },
+        iMaximumDelay{ aMaximumDelay },
+        iDelay{ std::clamp(aDelay, 0.0f, aMaximumDelay) },
+        iFeedback{ aFeedback },
+        iMix{ aMix }
+    {
+    }
+
+    float audio_delay_node::maximum_delay() const
+    {
+        return iMaximumDelay;
+    }
+
+    float audio_delay_node::delay() const
+    {
+        return iDelay;
+    }
+
+    void audio_delay_node::set_delay(float aDelay)
+    {
+        iDelay = std::clamp(aDelay, 0.0f, iMaximumDelay);
+    }
+
+    float audio_delay_node::feedback() const
+    {
+        return iFeedback;
+    }
+
+    void audio_delay_node::set_feedback(float aFeedback)
+    {
+        iFeedback = aFeedback;
+    }
+
+    float audio_delay_node::mix() const
+    {
+        return iMix;
+    }
+
+    void audio_delay_node::set_mix(float aMix)
+    {
+        iMix = aMix;
+    }
+
+    void audio_delay_node::prepare(audio_sample_rate aSampleRate, audio_frame_count)
+    {
+        iSampleRate = aSampleRate;
+        auto const frames = static_cast<std::size_t>(std::ceil(iMaximumDelay * static_cast<float>(aSampleRate))) + 2u;
+        iLine.assign(frames * 2u, 0.0f);
+        iWrite = 0u;
+    }
+
+    void audio_delay_node::reset()
+    {
+        std::fill(iLine.begin(), iLine.end(), 0.0f);
+        iWrite = 0u;
+    }
+
+    void audio_delay_node::process(float const* aInput, float* aOutput, audio_frame_count aFrameCount)
+    {
+        auto const lineFrames = iLine.size() / 2u;
+        auto const delay = std::clamp<std::size_t>(
+            static_cast<std::size_t>(std::lround(iDelay.load(std::memory_order_relaxed) * static_cast<float>(iSampleRate))), 1u, lineFrames - 1u);
+        auto const feedback = iFeedback.load(std::memory_order_relaxed);
+        auto const mix = iMix.load(std::memory_order_relaxed);
+        auto read = (iWrite + lineFrames - delay) % lineFrames;
+        float* const line = iLine.data();
+        for (std::size_t i = 0u; i < static_cast<std::size_t>(aFrameCount); ++i)
+        {
+            for (std::size_t c = 0u; c < 2u; ++c)
+            {
+                auto const dry = aInput != nullptr ? aInput[i * 2u + c] : 0.0f;
+                auto const delayed = line[read * 2u + c];
+                aOutput[i * 2u + c] = dry * (1.0f - mix) + delayed * mix;
+                line[iWrite * 2u + c] = dry + delayed * feedback;
+            }
+            if (++read == lineFrames)
+                read = 0u;
+            if (++iWrite == lineFrames)
+                iWrite = 0u;
+        }
+    }
+
+    audio_reverb_node::audio_reverb_node(float aSend, float aRoomSize, float aDamping) :
+        audio_node{ "reverb" },
+        iSend{ aSend },
+        iRoomSize{ aRoomSize },
+        iDamping{ aDamping }
+    {
+    }
+
+    float audio_reverb_node::send() const
+    {
+        return iSend;
+    }
+
+    void audio_reverb_node::set_send(float aSend)
+    {
+        iSend = aSend;
+    }
+
+    float audio_reverb_node::room_size() const
+    {
+        return iRoomSize;
+    }
+
+    void audio_reverb_node::set_room_size(float aRoomSize)
+    {
+        iRoomSize = std::clamp(aRoomSize, 0.0f, 1.0f);
+    }
+
+    float audio_reverb_node::damping() const
+    {
+        return iDamping;
+    }
+
+    void audio_reverb_node::set_damping(float aDamping)
+    {
+        iDamping = std::clamp(aDamping, 0.0f, 1.0f);
+    }
+
+    void audio_reverb_node::prepare(audio_sample_rate aSampleRate, audio_frame_count)
+    {
+        // mutually prime lengths (in frames at 44.1 kHz) so that the echoes do not reinforce each other; the right
+        // channel's are slightly longer to decorrelate the channels
+        static constexpr std::array<std::size_t, Combs> sCombLengths = { 1116u, 1188u, 1277u, 1356u };
+        static constexpr std::array<std::size_t, Allpasses> sAllpassLengths = { 556u, 441u };
+        static constexpr std::size_t sStereoSpread = 23u;
+        auto const scale = static_cast<double>(aSampleRate) / 44100.0;
+        for (std::size_t c = 0u; c < 2u; ++c)
+        {
+            for (std::size_t i = 0u; i < Combs; ++i)
+                iCombs[c][i].buffer.resize(std::max<std::size_t>(static_cast<std::size_t>((sCombLengths[i] + sStereoSpread * c) * scale), 1u));
+            for (std::size_t i = 0u; i < Allpasses; ++i)
+                iAllpasses[c][i].buffer.resize(std::max<std::size_t>(static_cast<std::size_t>((sAllpassLengths[i] + sStereoSpread * c) * scale), 1u));
+        }
+        reset();
+    }
+
+    void audio_reverb_node::reset()
+    {
+        for (auto& channel : iCombs)
+            for (auto& c : channel)
+            {
+                std::fill(c.buffer.begin(), c.buffer.end(), 0.0f);
+                c.index = 0u;
+                c.store = 0.0f;
+            }
+        for (auto& channel : iAllpasses)
+            for (auto& a : channel)
+            {
+                std::fill(a.buffer.begin(), a.buffer.end(), 0.0f);
+                a.index = 0u;
+            }
+    }
+
+    void audio_reverb_node::process(float const* aInput, float* aOutput, audio_frame_count aFrameCount)
+    {
+        static constexpr float sInputGain = 0.03f;
+        static constexpr float sAllpassFeedback = 0.5f;
+        auto const send = iSend.load(std::memory_order_relaxed) * sInputGain;
+        auto const feedback = 0.7f + 0.28f * iRoomSize.load(std::memory_order_relaxed);
+        auto const damping = 0.4f * iDamping.load(std::memory_order_relaxed);
+        auto const frames = static_cast<std::size_t>(aFrameCount);
+        for (std::size_t c = 0u; c < 2u; ++c)
+        {
+            auto& combs = iCombs[c];
+            auto& allpasses = iAllpasses[c];
+            for (std::size_t i = 0u; i < frames; ++i)
+            {
+                auto const input = aInput != nullptr ? (aInput[i * 2u] + aInput[i * 2u + 1u]) * send : 0.0f;
+                float wet = 0.0f;
+                for (auto& comb : combs)
+                {
+                    auto const delayed = comb.buffer[comb.index];
+                    comb.store = delayed * (1.0f - damping) + comb.store * damping;
+                    comb.buffer[comb.index] = input + comb.store * feedback;
+                    if (++comb.index == comb.buffer.size())
+                        comb.index = 0u;
+                    wet += delayed;
+                }
+                for (auto& allpass : allpasses)
+                {
+                    auto const delayed = allpass.buffer[allpass.index];
+                    allpass.buffer[allpass.index] = wet + delayed * sAllpassFeedback;
+                    if (++allpass.index == allpass.buffer.size())
+                        allpass.index = 0u;
+                    wet = delayed - wet;
+                }
+                aOutput[i * 2u + c] = wet;
+            }
+        }
+    }
+
+    audio_limiter_node::audio_limiter_node(float aThreshold, float aRelease) :
+        audio_node{ "limiter" },
+        iThreshold{ aThreshold },
+        iRelease{ aRelease }
+    {
+    }
+
+    float audio_limiter_node::threshold() const
+    {
+        return iThreshold;
+    }
+
+    void audio_limiter_node::set_threshold(float aThreshold)
+    {
+        iThreshold = aThreshold;
+    }
+
+    float audio_limiter_node::release() const
+    {
+        return iRelease;
+    }
+
+    void audio_limiter_node::set_release(float aRelease)
+    {
+        iRelease = aRelease;
+    }
+
+    float audio_limiter_node::gain_reduction() const
+    {
+        return iReportedGain;
+    }
+
+    void audio_limiter_node::prepare(audio_sample_rate aSampleRate, audio_frame_count)
+    {
+        iSampleRate = aSampleRate;
+        reset();
+    }
+
+    void audio_limiter_node::reset()
+    {
+        iGain = 1.0f;
+        iReportedGain = 1.0f;
+    }
+
+    void audio_limiter_node::process(float const* aInput, float* aOutput, audio_frame_count aFrameCount)
+    {
+        if (aInput == nullptr)
+        {
+            silence(aOutput, aFrameCount);
+            return;
+        }
+        auto const threshold = iThreshold.load(std::memory_order_relaxed);
+        auto const release = static_cast<float>(std::exp(-1.0 / (std::max(static_cast<double>(iRelease), 0.0001) * static_cast<double>(iSampleRate))));
+        auto gain = iGain;
+        for (std::size_t i = 0u; i < static_cast<std::size_t>(aFrameCount); ++i)
+        {
+            auto const left = aInput[i * 2u];
+            auto const right = aInput[i * 2u + 1u];
+            auto const peak = std::max(std::abs(left), std::abs(right));
+            auto const target = peak > threshold ? threshold / peak : 1.0f;
+            gain = target < gain ? target : target + (gain - target) * release;
+            aOutput[i * 2u] = left * gain;
+            aOutput[i * 2u + 1u] = right * gain;
+        }
+        iGain = gain;
+        iReportedGain.store(gain, std::memory_order_relaxed);
+    }
+}
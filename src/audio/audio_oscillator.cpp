@@ -19,11 +19,58 @@
 
 #include <neogfx/neogfx.hpp>
 
+#include <cmath>
+#include <algorithm>
+#include <limits>
 #include <neogfx/core/numerical.hpp>
 #include <neogfx/audio/audio_oscillator.hpp>
 
 namespace neogfx
 {
+    namespace
+    {
+        constexpr std::size_t BlockSize = 256u;
+
+        // the kernels below are branch free so that the compiler can vectorise the loops calling them
+
+        // sin(2 pi phase) for phase in [0, 1): folded to [-pi/2, pi/2] then a degree 9 polynomial (error < 4e-6)
+        inline float polynomial_sine(float aPhase)
+        {
+            auto y = 2.0f * aPhase - 1.0f;
+            y = std::copysign(0.5f - std::abs(std::abs(y) - 0.5f), y);
+            auto const z = math::pi<float>() * y;
+            auto const z2 = z * z;
+            auto p = std::fma(z2, 1.0f / 362880.0f, -1.0f / 5040.0f);
+            p = std::fma(z2, p, 1.0f / 120.0f);
+            p = std::fma(z2, p, -1.0f / 6.0f);
+            p = std::fma(z2, p, 1.0f);
+            return -z * p;
+        }
+
+        inline float wrap(float aPhase)
+        {
+            return aPhase - std::floor(aPhase);
+        }
+
+        // residual of a band-limited step at phase 0, aIncrement being the phase increment per sample
+        inline float poly_blep(float aPhase, float aIncrement)
+        {
+            auto const before = (aPhase - 1.0f) / aIncrement;
+            auto const after = aPhase / aIncrement;
+            return aPhase < aIncrement ? after + after - after * after - 1.0f :
+                aPhase > 1.0f - aIncrement ? before * before + before + before + 1.0f : 0.0f;
+        }
+
+        // residual of a band-limited change of slope at phase 0
+        inline float poly_blamp(float aPhase, float aIncrement)
+        {
+            auto const before = (aPhase - 1.0f) / aIncrement + 1.0f;
+            auto const after = aPhase / aIncrement - 1.0f;
+            return aPhase < aIncrement ? -after * after * after / 3.0f :
+                aPhase > 1.0f - aIncrement ? before * before * before / 3.0f : 0.0f;
+        }
+    }
+
     audio_oscillator::audio_oscillator(audio_sample_rate aSampleRate, float aFrequency, float aAmplitude, oscillator_function aFunction) :
         iSampleRate{ aSampleRate }, iFrequency{ aFrequency }, iAmplitude{ aAmplitude }, iFunction{ aFunction }
     {
@@ -51,8 +98,8 @@ namespace neogfx
 
     void audio_oscillator::set_frequency(float aFrequency)
     {
+        // the phase carries on from where it was so changing frequency does not click
         iFrequency = aFrequency;
-        iCursor = 0ULL;
     }
 
     float audio_oscillator::amplitude() const
@@ -75,14 +122,12 @@ namespace neogfx
         iFunction = aFunction;
         if (iFunction != oscillator_function::Custom)
             iCustomFunction = nullptr;
-        iCursor = 0ULL;
     }
 
     void audio_oscillator::set_function(std::function<float(float)> const& aFunction)
     {
         iFunction = oscillator_function::Custom;
         iCustomFunction = aFunction;
-        iCursor = 0ULL;
     }
 
     void audio_oscillator::generate(audio_sample_count aSampleCount, float* aOutputSamples)
@@ -92,33 +137,97 @@ namespace neogfx
 
     void audio_oscillator::generate_from(audio_sample_index aSampleFrom, audio_sample_count aSampleCount, float* aOutputSamples)
     {
-        iCursor = aSampleFrom;
+        render(aSampleFrom, aSampleCount, [&](float const* aBlock, std::size_t aCount)
+        {
+            std::copy(aBlock, aBlock + aCount, aOutputSamples);
+            aOutputSamples += aCount;
+        });
+    }
+
+    void audio_oscillator::mix(audio_sample_count aSampleCount, float aGain, std::uint32_t aChannels, float* aOutputFrames)
+    {
+        mix_from(iCursor, aSampleCount, aGain, aChannels, aOutputFrames);
+    }
+
+    void audio_oscillator::mix_from(audio_sample_index aSampleFrom, audio_sample_count aSampleCount, float aGain, std::uint32_t aChannels, float* aOutputFrames)
+    {
+        render(aSampleFrom, aSampleCount, [&](float const* aBlock, std::size_t aCount)
+        {
+            if (aChannels == 2u)
+                for (std::size_t i = 0u; i < aCount; ++i)
+                {
+                    aOutputFrames[i * 2u] = std::fma(aBlock[i], aGain, aOutputFrames[i * 2u]);
+                    aOutputFrames[i * 2u + 1u] = std::fma(aBlock[i], aGain, aOutputFrames[i * 2u + 1u]);
+                }
+            else
+                for (std::size_t i = 0u; i < aCount; ++i)
+                    for (std::uint32_t channel = 0u; channel < aChannels; ++channel)
+                        aOutputFrames[i * aChannels + channel] = std::fma(aBlock[i], aGain, aOutputFrames[i * aChannels + channel]);
+            aOutputFrames += aCount * aChannels;
+        });
+    }
+
+    template <typename Output>
+    void audio_oscillator::render(audio_sample_index aSampleFrom, audio_sample_count aSampleCount, Output aOutput)
+    {
+        auto const increment = static_cast<double>(frequency()) / sample_rate();
+        // contiguous calls carry the phase on, otherwise it is calculated from the sample index
+        if (aSampleFrom != iCursor)
+            iPhase = increment * aSampleFrom - std::floor(increment * aSampleFrom);
+        alignas(32) float block[BlockSize];
+        for (audio_sample_count done = 0u; done < aSampleCount;)
+        {
+            auto const count = static_cast<std::size_t>(std::min<audio_sample_count>(aSampleCount - done, BlockSize));
+            shape(static_cast<float>(iPhase), static_cast<float>(increment), count, block);
+            aOutput(block, count);
+            iPhase += increment * count;
+            iPhase -= std::floor(iPhase);
+            done += count;
+        }
+        iCursor = aSampleFrom + aSampleCount;
+    }
 
+    std::size_t audio_oscillator::shape(float aPhase, float aIncrement, std::size_t aCount, float* aOutput) const
+    {
+        auto const a = amplitude();
+        auto const dt = std::clamp(aIncrement, std::numeric_limits<float>::min(), 0.5f);
         switch (function())
         {
         case oscillator_function::Custom:
-            // todo
+            for (std::size_t i = 0u; i < aCount; ++i)
+                aOutput[i] = iCustomFunction ? iCustomFunction(wrap(aPhase + aIncrement * i) * math::two_pi<float>()) * a : 0.0f;
             break;
         case oscillator_function::Sine:
-            for (auto cursor = iCursor; cursor < iCursor + aSampleCount; ++cursor)
-            {
-                auto x = static_cast<float>(cursor) / sample_rate() * math::two_pi<float>() * frequency();
-                *(aOutputSamples++) = std::sin(x) * amplitude();
-            }
+            for (std::size_t i = 0u; i < aCount; ++i)
+                aOutput[i] = polynomial_sine(wrap(aPhase + aIncrement * i)) * a;
             break;
         case oscillator_function::Square:
-            // todo
+            for (std::size_t i = 0u; i < aCount; ++i)
+            {
+                auto const phase = wrap(aPhase + aIncrement * i);
+                auto const naive = phase < 0.5f ? 1.0f : -1.0f;
+                aOutput[i] = (naive + poly_blep(phase, dt) - poly_blep(wrap(phase + 0.5f), dt)) * a;
+            }
             break;
         case oscillator_function::Triangle:
-            // todo
+            for (std::size_t i = 0u; i < aCount; ++i)
+            {
+                auto const phase = wrap(aPhase + aIncrement * i);
+                auto const naive = 4.0f * std::abs(phase - 0.5f) - 1.0f;
+                aOutput[i] = (naive + 4.0f * dt * (poly_blamp(wrap(phase + 0.5f), dt) - poly_blamp(phase, dt))) * a;
+            }
             break;
         case oscillator_function::Sawtooth:
-            // todo
+            for (std::size_t i = 0u; i < aCount; ++i)
+            {
+                auto const phase = wrap(aPhase + aIncrement * i);
+                aOutput[i] = (2.0f * phase - 1.0f - poly_blep(phase, dt)) * a;
+            }
             break;
         default:
+            std::fill(aOutput, aOutput + aCount, 0.0f);
             break;
         }
-
-        iCursor += aSampleCount;
+        return aCount;
     }
 }
\ No newline at end of file
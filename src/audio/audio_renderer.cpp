@@ -0,0 +1,270 @@
+// audio_renderer.cpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2024 Leigh Johnston.  All Rights Reserved.
+
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <neogfx/neogfx.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <future>
+
+#include <neolib/task/thread_pool.hpp>
+
+#include <neogfx/audio/audio_renderer.hpp>
+
+namespace neogfx
+{
+    namespace
+    {
+        std::uint32_t bytes_per_sample(audio_sample_format aSampleFormat)
+        {
+            switch (aSampleFormat)
+            {
+            case audio_sample_format::U8:
+                return 1u;
+            case audio_sample_format::S16:
+                return 2u;
+            case audio_sample_format::S24:
+                return 3u;
+            case audio_sample_format::S32:
+            case audio_sample_format::F32:
+                return 4u;
+            default:
+                throw audio_renderer::unsupported_sample_format();
+            }
+        }
+
+        template <typename T>
+        void write_value(std::ostream& aStream, T const& aValue)
+        {
+            aStream.write(reinterpret_cast<char const*>(&aValue), sizeof(T));
+        }
+
+        void write_wav_header(std::ostream& aStream, audio_data_format const& aDataFormat, audio_frame_count aFrameCount)
+        {
+            auto const sampleBytes = bytes_per_sample(aDataFormat.sampleFormat);
+            auto const blockAlign = static_cast<std::uint16_t>(sampleBytes * aDataFormat.channels);
+            auto const dataBytes = static_cast<std::uint32_t>(aFrameCount * blockAlign);
+            aStream.write("RIFF", 4);
+            write_value(aStream, static_cast<std::uint32_t>(36u + dataBytes));
+            aStream.write("WAVEfmt ", 8);
+            write_value(aStream, static_cast<std::uint32_t>(16u));
+            write_value(aStream, static_cast<std::uint16_t>(aDataFormat.sampleFormat == audio_sample_format::F32 ? 3u : 1u));
+            write_value(aStream, static_cast<std::uint16_t>(aDataFormat.channels));
+            write_value(aStream, static_cast<std::uint32_t>(aDataFormat.sampleRate));
+            write_value(aStream, static_cast<std::uint32_t>(aDataFormat.sampleRate * blockAlign));
+            write_value(aStream, blockAlign);
+            write_value(aStream, static_cast<std::uint16_t>(sampleBytes * 8u));
+            aStream.write("data", 4);
+            write_value(aStream, dataBytes);
+        }
+
+        // samples are written little endian, which is the byte order of every platform neoGFX supports
+        void write_samples(std::ostream& aStream, audio_sample_format aSampleFormat, float const* aSamples, std::size_t aCount)
+        {
+            thread_local std::vector<char> buffer;
+            auto const sampleBytes = bytes_per_sample(aSampleFormat);
+            buffer.resize(aCount * sampleBytes);
+            auto* out = buffer.data();
+            for (std::size_t i = 0u; i < aCount; ++i)
+            {
+                auto const sample = std::clamp(aSamples[i], -1.0f, 1.0f);
+                switch (aSampleFormat)
+                {
+                case audio_sample_format::U8:
+                    *out++ = static_cast<char>(static_cast<std::uint8_t>(std::lround(sample * 127.0f) + 128));
+                    break;
+                case audio_sample_format::S16:
+                    {
+                        auto const value = static_cast<std::int16_t>(std::lround(sample * 32767.0f));
+                        std::memcpy(out, &value, 2u);
+                        out += 2;
+                    }
+                    break;
+                case audio_sample_format::S24:
+                    {
+                        auto const value = static_cast<std::int32_t>(std::lround(sample * 8388607.0f));
+                        std::memcpy(out, &value, 3u);
+                        out += 3;
+                    }
+                    break;
+                case audio_sample_format::S32:
+                    {
+                        auto const value = static_cast<std::int32_t>(std::llround(static_cast<double>(sample) * 2147483647.0));
+                        std::memcpy(out, &value, 4u);
+                        out += 4;
+                    }
+                    break;
+                case audio_sample_format::F32:
+                    std::memcpy(out, &aSamples[i], 4u);
+                    out += 4;
+                    break;
+                default:
+                    break;
+                }
+            }
+            aStream.write(buffer.data(), buffer.size());
+        }
+    }
+
+    audio_renderer::audio_renderer(audio_data_format const& aDataFormat, audio_frame_count aBlockSize, bool aMultithreaded) :
+        iDataFormat{ aDataFormat },
+        iBlockSize{ aBlockSize },
+        iMultithreaded{ aMultithreaded }
+    {
+        bytes_per_sample(aDataFormat.sampleFormat);
+    }
+
+    audio_data_format const& audio_renderer::data_format() const
+    {
+        return iDataFormat;
+    }
+
+    bool audio_renderer::multithreaded() const
+    {
+        return iMultithreaded;
+    }
+
+    void audio_renderer::set_multithreaded(bool aMultithreaded)
+    {
+        iMultithreaded = aMultithreaded;
+    }
+
+    void audio_renderer::add_track(i_audio_track& aTrack)
+    {
+        add_track(ref_ptr<i_audio_track>{ ref_ptr<i_audio_track>{}, &aTrack });
+    }
+
+    void audio_renderer::add_track(i_ref_ptr<i_audio_track> const& aTrack)
+    {
+        iTracks.push_back(aTrack);
+    }
+
+    void audio_renderer::clear()
+    {
+        iTracks.clear();
+    }
+
+    audio_frame_count audio_renderer::length() const
+    {
+        audio_frame_count result = 0ULL;
+        for (auto const& t : iTracks)
+            result = std::max(result, t->length());
+        return result;
+    }
+
+    audio_renderer::statistics audio_renderer::render(std::string const& aPath, audio_file_format aFileFormat)
+    {
+        std::ofstream output{ aPath, std::ios::out | std::ios::binary | std::ios::trunc };
+        if (!output)
+            throw failed_to_write();
+        return render(output, aFileFormat);
+    }
+
+    audio_renderer::statistics audio_renderer::render(std::ostream& aOutput, audio_file_format aFileFormat)
+    {
+        if (aFileFormat == audio_file_format::Wav)
+            write_wav_header(aOutput, iDataFormat, length());
+        auto const result = render([&](float const* aFrames, audio_frame_count aFrameCount)
+        {
+            write_samples(aOutput, iDataFormat.sampleFormat, aFrames, static_cast<std::size_t>(aFrameCount * iDataFormat.channels));
+        });
+        if (!aOutput)
+            throw failed_to_write();
+        return result;
+    }
+
+    audio_renderer::statistics audio_renderer::render(std::vector<float>& aOutput)
+    {
+        aOutput.clear();
+        aOutput.reserve(static_cast<std::size_t>(length() * iDataFormat.channels));
+        return render([&](float const* aFrames, audio_frame_count aFrameCount)
+        {
+            aOutput.insert(aOutput.end(), aFrames, aFrames + aFrameCount * iDataFormat.channels);
+        });
+    }
+
+    audio_renderer::statistics audio_renderer::render(std::function<void(float const*, audio_frame_count)> const& aSink)
+    {
+        auto const start = std::chrono::steady_clock::now();
+        auto const total = length();
+        auto const channels = static_cast<std::size_t>(iDataFormat.channels);
+        iTrackBuffers.resize(iTracks.size());
+        for (auto& buffer : iTrackBuffers)
+            buffer.resize(static_cast<std::size_t>(iBlockSize * 2u));
+        iMix.resize(static_cast<std::size_t>(iBlockSize * 2u));
+        iOutput.resize(static_cast<std::size_t>(iBlockSize * channels));
+
+        std::vector<std::future<void>> rendering;
+        for (audio_frame_index frame = 0u; frame < total; frame += iBlockSize)
+        {
+            auto const frames = std::min(iBlockSize, total - frame);
+            auto const samples = static_cast<std::size_t>(frames * 2u);
+            // the calling thread renders the first track while the thread pool renders the rest
+            rendering.clear();
+            if (iMultithreaded)
+                for (std::size_t t = 1u; t < iTracks.size(); ++t)
+                    rendering.push_back(neolib::thread_pool::default_thread_pool().run([this, t, frame, frames]() { render_track(t, frame, frames); }));
+            for (std::size_t t = 0u; t < iTracks.size(); ++t)
+                if (t == 0u || !iMultithreaded)
+                    render_track(t, frame, frames);
+            for (auto& r : rendering)
+                r.get();
+
+            // mix down in track order so that the result does not depend on which thread finished first
+            std::fill(iMix.begin(), iMix.begin() + samples, 0.0f);
+            for (auto const& buffer : iTrackBuffers)
+            {
+                float* const mix = iMix.data();
+                float const* const track = buffer.data();
+                for (std::size_t i = 0u; i < samples; ++i)
+                    mix[i] += track[i];
+            }
+
+            float const* source = iMix.data();
+            float* output = iOutput.data();
+            if (channels == 1u)
+                for (audio_frame_count f = 0u; f < frames; ++f, source += 2)
+                    *output++ = (source[0] + source[1]) * 0.5f;
+            else
+            {
+                std::fill(iOutput.begin(), iOutput.begin() + frames * channels, 0.0f);
+                for (audio_frame_count f = 0u; f < frames; ++f, source += 2, output += channels)
+                {
+                    output[0] = source[0];
+                    output[1] = source[1];
+                }
+            }
+            aSink(iOutput.data(), frames);
+        }
+
+        statistics result{ total, std::chrono::steady_clock::now() - start, 0.0 };
+        if (result.elapsed.count() > 0.0)
+            result.realTimeFactor = static_cast<double>(total) / iDataFormat.sampleRate / result.elapsed.count();
+        return result;
+    }
+
+    void audio_renderer::render_track(std::size_t aTrack, audio_frame_index aFrameFrom, audio_frame_count aFrameCount)
+    {
+        auto& buffer = iTrackBuffers[aTrack];
+        std::fill(buffer.begin(), buffer.begin() + aFrameCount * 2u, 0.0f);
+        iTracks[aTrack]->generate_from(audio_channel::Left | audio_channel::Right, aFrameFrom, aFrameCount, buffer.data());
+    }
+}
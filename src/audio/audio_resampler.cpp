@@ -0,0 +1,141 @@
+// audio_resampler.cpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2024 Leigh Johnston.  All Rights Reserved.
+
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <neogfx/neogfx.hpp>
+
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <boost/math/constants/constants.hpp>
+
+#include <neogfx/audio/audio_resampler.hpp>
+
+namespace neogfx
+{
+    namespace
+    {
+        // stop band attenuation of about 80 dB
+        constexpr double KaiserBeta = 8.0;
+        // cutoffs are rounded down to a multiple of this so that few kernels are needed
+        constexpr double CutoffQuantum = 1.0 / 32.0;
+
+        double bessel_i0(double aValue)
+        {
+            double result = 1.0;
+            double term = 1.0;
+            for (int k = 1; k < 32; ++k)
+            {
+                auto const factor = aValue / (2.0 * k);
+                term *= factor * factor;
+                result += term;
+            }
+            return result;
+        }
+    }
+
+    audio_resampler::audio_resampler(double aStep) :
+        iStep{ aStep },
+        iKernel{ kernel_for(aStep) }
+    {
+    }
+
+    double audio_resampler::step() const
+    {
+        return iStep;
+    }
+
+    audio_frame_count audio_resampler::length(std::size_t aSourceFrames) const
+    {
+        if (aSourceFrames == 0u)
+            return 0u;
+        return static_cast<audio_frame_count>(std::floor((aSourceFrames - 1u) / iStep)) + 1u;
+    }
+
+    void audio_resampler::generate_from(std::span<float const> aSource, audio_frame_index aFrameFrom, audio_frame_count aFrameCount, float* aOutputFrames) const
+    {
+        auto const sourceFrames = static_cast<std::ptrdiff_t>(aSource.size());
+        auto const* const coefficients = iKernel->data();
+        auto position = aFrameFrom * iStep;
+        for (audio_frame_count frame = 0u; frame < aFrameCount; ++frame, position += iStep)
+        {
+            auto const whole = static_cast<std::ptrdiff_t>(std::floor(position));
+            auto const phase = (position - whole) * Phases;
+            auto const row = static_cast<std::size_t>(phase);
+            auto const between = static_cast<float>(phase - row);
+            auto const* const c0 = coefficients + row * Taps;
+            auto const* const c1 = c0 + Taps;
+            auto const first = whole - static_cast<std::ptrdiff_t>(Taps / 2u) + 1;
+            float result = 0.0f;
+            if (first >= 0 && first + static_cast<std::ptrdiff_t>(Taps) <= sourceFrames)
+            {
+                auto const* const source = aSource.data() + first;
+                for (std::size_t tap = 0u; tap < Taps; ++tap)
+                    result += source[tap] * (c0[tap] + between * (c1[tap] - c0[tap]));
+            }
+            else if (first < sourceFrames && first + static_cast<std::ptrdiff_t>(Taps) > 0)
+            {
+                for (std::size_t tap = 0u; tap < Taps; ++tap)
+                {
+                    auto const index = first + static_cast<std::ptrdiff_t>(tap);
+                    if (index >= 0 && index < sourceFrames)
+                        result += aSource[index] * (c0[tap] + between * (c1[tap] - c0[tap]));
+                }
+            }
+            aOutputFrames[frame] = result;
+        }
+    }
+
+    std::shared_ptr<audio_resampler::kernel const> audio_resampler::kernel_for(double aStep)
+    {
+        auto const quanta = std::max(1, static_cast<int>(std::floor(std::min(1.0, 1.0 / aStep) / CutoffQuantum)));
+        static std::mutex sMutex;
+        static std::map<int, std::shared_ptr<kernel const>> sKernels;
+        std::scoped_lock lock{ sMutex };
+        auto existing = sKernels.find(quanta);
+        if (existing != sKernels.end())
+            return existing->second;
+
+        auto const cutoff = quanta * CutoffQuantum;
+        auto const pi = boost::math::constants::pi<double>();
+        auto const halfWidth = Taps / 2.0;
+        auto const normalizer = bessel_i0(KaiserBeta);
+        auto result = std::make_shared<kernel>((Phases + 1u) * Taps);
+        for (std::size_t row = 0u; row <= Phases; ++row)
+        {
+            auto const fraction = static_cast<double>(row) / Phases;
+            double sum = 0.0;
+            for (std::size_t tap = 0u; tap < Taps; ++tap)
+            {
+                auto const distance = (static_cast<double>(tap) - halfWidth + 1.0) - fraction;
+                auto const x = distance * cutoff;
+                auto const sinc = std::abs(x) < 1e-9 ? 1.0 : std::sin(pi * x) / (pi * x);
+                auto const w = distance / halfWidth;
+                auto const window = std::abs(w) >= 1.0 ? 0.0 : bessel_i0(KaiserBeta * std::sqrt(1.0 - w * w)) / normalizer;
+                auto const coefficient = cutoff * sinc * window;
+                (*result)[row * Taps + tap] = static_cast<float>(coefficient);
+                sum += coefficient;
+            }
+            // unity gain at DC for every phase
+            for (std::size_t tap = 0u; tap < Taps; ++tap)
+                (*result)[row * Taps + tap] = static_cast<float>((*result)[row * Taps + tap] / sum);
+        }
+        sKernels.emplace(quanta, result);
+        return result;
+    }
+}
@@ -0,0 +1,166 @@
+// audio_sample_bank.cpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2024 Leigh Johnston.  All Rights Reserved.
+
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <neogfx/neogfx.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <cstring>
+
+#include <neolib/file/file.hpp>
+
+#include <neogfx/audio/audio_sample_bank.hpp>
+
+namespace neogfx
+{
+    namespace
+    {
+        // header, zone table then the PCM of each zone starting on a 64 byte boundary
+        constexpr char BankMagic[8] = { 'N', 'G', 'F', 'X', 'S', 'B', 'N', 'K' };
+        constexpr std::uint32_t BankVersion = 2u;
+        constexpr std::uint32_t MaxZones = 0x1000u;
+        constexpr std::uint64_t PcmAlignment = 64u;
+
+        struct bank_header
+        {
+            char magic[8];
+            std::uint32_t version;
+            std::uint32_t instrument;
+            std::uint32_t zoneCount;
+            std::uint32_t reserved;
+            std::uint64_t sourceSize;
+            std::int64_t sourceLastWriteTime;
+        };
+
+        struct bank_zone
+        {
+            std::uint32_t low;
+            std::uint32_t pitchCentre;
+            std::uint32_t high;
+            std::uint32_t sampleRate;
+            std::uint64_t offset; // bytes from the start of the file
+            std::uint64_t frames;
+        };
+
+        template <typename T>
+        void write_value(std::ostream& aStream, T const& aValue)
+        {
+            aStream.write(reinterpret_cast<char const*>(&aValue), sizeof(T));
+        }
+
+        std::uint64_t aligned(std::uint64_t aOffset)
+        {
+            return (aOffset + PcmAlignment - 1u) / PcmAlignment * PcmAlignment;
+        }
+    }
+
+    audio_sample_bank::audio_sample_bank(std::string const& aPath, neogfx::instrument aInstrument, source_stamp const& aSource) :
+        iFile{ aPath },
+        iInstrument{ aInstrument }
+    {
+        auto const bytes = iFile.bytes();
+        bank_header header;
+        if (bytes.size() < sizeof(header))
+            throw invalid_bank();
+        std::memcpy(&header, bytes.data(), sizeof(header));
+        if (!std::equal(std::begin(BankMagic), std::end(BankMagic), std::begin(header.magic)) ||
+            header.version != BankVersion ||
+            header.instrument != static_cast<std::uint32_t>(aInstrument) ||
+            source_stamp{ header.sourceSize, header.sourceLastWriteTime } != aSource ||
+            header.zoneCount > MaxZones ||
+            bytes.size() < sizeof(header) + header.zoneCount * sizeof(bank_zone))
+            throw invalid_bank();
+        iZones.reserve(header.zoneCount);
+        for (std::uint32_t index = 0u; index < header.zoneCount; ++index)
+        {
+            bank_zone entry;
+            std::memcpy(&entry, bytes.data() + sizeof(header) + index * sizeof(bank_zone), sizeof(entry));
+            if (entry.low > entry.high || entry.high > static_cast<std::uint32_t>(note::Ab9) || entry.sampleRate == 0u ||
+                entry.offset % alignof(float) != 0u || entry.offset > bytes.size() || entry.frames > (bytes.size() - entry.offset) / sizeof(float))
+                throw invalid_bank();
+            iZones.push_back(zone{
+                static_cast<note>(entry.low),
+                static_cast<note>(entry.pitchCentre),
+                static_cast<note>(entry.high),
+                entry.sampleRate,
+                std::span<float const>{ reinterpret_cast<float const*>(bytes.data() + entry.offset), static_cast<std::size_t>(entry.frames) } });
+        }
+    }
+
+    void audio_sample_bank::save(std::string const& aPath, neogfx::instrument aInstrument, source_stamp const& aSource, std::vector<baked_zone> const& aZones)
+    {
+        std::filesystem::create_directories(std::filesystem::path{ aPath }.parent_path());
+        auto const temporaryPath = aPath + ".tmp";
+        {
+            std::ofstream output{ temporaryPath, std::ios::out | std::ios::binary | std::ios::trunc };
+            if (!output)
+                throw failed_to_save();
+            bank_header header{};
+            std::copy(std::begin(BankMagic), std::end(BankMagic), std::begin(header.magic));
+            header.version = BankVersion;
+            header.instrument = static_cast<std::uint32_t>(aInstrument);
+            header.zoneCount = static_cast<std::uint32_t>(aZones.size());
+            header.sourceSize = aSource.size;
+            header.sourceLastWriteTime = aSource.lastWriteTime;
+            write_value(output, header);
+            auto offset = aligned(sizeof(header) + aZones.size() * sizeof(bank_zone));
+            for (auto const& z : aZones)
+            {
+                write_value(output, bank_zone{
+                    static_cast<std::uint32_t>(z.low),
+                    static_cast<std::uint32_t>(z.pitchCentre),
+                    static_cast<std::uint32_t>(z.high),
+                    static_cast<std::uint32_t>(z.sampleRate),
+                    offset,
+                    z.pcm.size() });
+                offset = aligned(offset + z.pcm.size() * sizeof(float));
+            }
+            for (auto const& z : aZones)
+            {
+                output.seekp(static_cast<std::streamoff>(aligned(static_cast<std::uint64_t>(output.tellp()))));
+                output.write(reinterpret_cast<char const*>(z.pcm.data()), z.pcm.size() * sizeof(float));
+            }
+            if (!output)
+                throw failed_to_save();
+        }
+        // fails on Windows while the bank being replaced is mapped
+        std::error_code error;
+        std::filesystem::rename(temporaryPath, aPath, error);
+        if (error)
+        {
+            std::filesystem::remove(temporaryPath, error);
+            throw failed_to_save();
+        }
+    }
+
+    std::string audio_sample_bank::default_path(neogfx::instrument aInstrument)
+    {
+        return neolib::user_settings_directory() + "/neogfx/instruments/" + std::to_string(static_cast<std::uint32_t>(aInstrument)) + ".bank";
+    }
+
+    neogfx::instrument audio_sample_bank::instrument() const
+    {
+        return iInstrument;
+    }
+
+    std::vector<audio_sample_bank::zone> const& audio_sample_bank::zones() const
+    {
+        return iZones;
+    }
+}
@@ -0,0 +1,110 @@
+// audio_track.cpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2024 Leigh Johnston.  All Rights Reserved.
+
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <neogfx/neogfx.hpp>
+
+#include <algorithm>
+
+#include <neogfx/audio/audio_track.hpp>
+
+namespace neogfx
+{
+    audio_track::audio_track(audio_sample_rate aSampleRate, float aAmplitude) :
+        audio_bitstream{ aSampleRate, aAmplitude }
+    {
+    }
+
+    audio_track::audio_track(i_audio_device const& aDevice, float aAmplitude) :
+        audio_track{ aDevice.data_format().sampleRate, aAmplitude }
+    {
+    }
+
+    std::uint32_t audio_track::clip_count() const
+    {
+        return static_cast<std::uint32_t>(iClips.size());
+    }
+
+    i_audio_bitstream& audio_track::clip(std::uint32_t aIndex) const
+    {
+        return *iClips.at(aIndex).bitstream;
+    }
+
+    audio_frame_index audio_track::clip_start(std::uint32_t aIndex) const
+    {
+        return iClips.at(aIndex).start;
+    }
+
+    i_audio_bitstream& audio_track::add_clip(i_audio_bitstream& aBitstream, audio_frame_index aStart, audio_frame_count aLength)
+    {
+        return add_clip(ref_ptr<i_audio_bitstream>{ ref_ptr<i_audio_bitstream>{}, &aBitstream }, aStart, aLength);
+    }
+
+    i_audio_bitstream& audio_track::add_clip(i_ref_ptr<i_audio_bitstream> const& aBitstream, audio_frame_index aStart, audio_frame_count aLength)
+    {
+        auto const position = std::upper_bound(iClips.begin(), iClips.end(), aStart,
+            [](audio_frame_index aClipStart, clip_info const& aClip) { return aClipStart < aClip.start; });
+        return *iClips.insert(position, clip_info{ aBitstream, aStart, aLength != 0ULL ? aLength : aBitstream->length() })->bitstream;
+    }
+
+    void audio_track::remove_clip(i_audio_bitstream const& aBitstream)
+    {
+        auto existing = std::find_if(iClips.begin(), iClips.end(), [&](clip_info const& c) { return c.bitstream.ptr() == &aBitstream; });
+        if (existing == iClips.end())
+            throw clip_not_found();
+        iClips.erase(existing);
+    }
+
+    audio_frame_count audio_track::length() const
+    {
+        audio_frame_count result = 0ULL;
+        for (auto const& c : iClips)
+            result = std::max(result, c.start + c.length);
+        return result;
+    }
+
+    void audio_track::generate(audio_channel aChannel, audio_frame_count aFrameCount, float* aOutputFrames)
+    {
+        generate_from(aChannel, iCursor, aFrameCount, aOutputFrames);
+    }
+
+    void audio_track::generate_from(audio_channel aChannel, audio_frame_index aFrameFrom, audio_frame_count aFrameCount, float* aOutputFrames)
+    {
+        auto const channels = static_cast<std::size_t>(channel_count(aChannel));
+        auto const blockEnd = aFrameFrom + aFrameCount;
+        for (auto const& c : iClips)
+        {
+            if (c.start >= blockEnd)
+                break;
+            auto const from = std::max(aFrameFrom, c.start);
+            auto const to = std::min(blockEnd, c.start + c.length);
+            if (from >= to)
+                continue;
+            // bitstreams differ as to whether they add to or overwrite their output so each clip gets a clean buffer
+            auto const count = static_cast<std::size_t>(to - from);
+            thread_local std::vector<float> buffer;
+            buffer.assign(count * channels, 0.0f);
+            c.bitstream->generate_from(aChannel, from - c.start, count, buffer.data());
+            auto* const output = aOutputFrames + static_cast<std::size_t>(from - aFrameFrom) * channels;
+            auto const gain = amplitude();
+            for (std::size_t i = 0u; i < count * channels; ++i)
+                output[i] += buffer[i] * gain;
+        }
+        iCursor = blockEnd;
+    }
+}
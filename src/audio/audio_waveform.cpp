@@ -82,19 +82,10 @@ namespace neogfx
 
     void audio_waveform::generate(audio_channel aChannel, audio_frame_count aFrameCount, float* aOutputFrames)
     {
+        // each oscillator accumulates straight into the interleaved output
         for (auto const& o : iOscillators)
         {
-            thread_local std::vector<float> componentResult;
-            componentResult.resize(aFrameCount);
-
-            o->generate(aFrameCount, componentResult.data());
-
-            auto outputSample = aOutputFrames;
-            for (auto sampleComponent : componentResult)
-            {
-                for (int channel = 0; channel < channel_count(aChannel); ++channel)
-                    *(outputSample++) += (sampleComponent * amplitude());
-            }
+            o->mix(aFrameCount, amplitude(), static_cast<std::uint32_t>(channel_count(aChannel)), aOutputFrames);
         }
     }
         
@@ -102,17 +93,7 @@ namespace neogfx
     {
         for (auto const& o : iOscillators)
         {
-            thread_local std::vector<float> componentResult;
-            componentResult.resize(aFrameCount);
-
-            o->generate_from(aFrameFrom, aFrameCount, componentResult.data());
-
-            auto outputSample = aOutputFrames;
-            for (auto sampleComponent : componentResult)
-            {
-                for (int channel = 0; channel < channel_count(aChannel); ++channel)
-                    *(outputSample++) += (sampleComponent * amplitude());
-            }
+            o->mix_from(aFrameFrom, aFrameCount, amplitude(), static_cast<std::uint32_t>(channel_count(aChannel)), aOutputFrames);
         }
     }
 }
\ No newline at end of file
@@ -0,0 +1,126 @@
+// mapped_file.cpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2024 Leigh Johnston.  All Rights Reserved.
+
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <neogfx/neogfx.hpp>
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <neolib/core/string_utf.hpp>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <neogfx/core/mapped_file.hpp>
+
+namespace neogfx
+{
+    mapped_file::mapped_file(std::string const& aPath) :
+        iPath{ aPath }
+    {
+#ifdef _WIN32
+        iFile = ::CreateFileW(reinterpret_cast<LPCWSTR>(neolib::utf8_to_utf16(aPath).c_str()), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (iFile == INVALID_HANDLE_VALUE)
+        {
+            iFile = nullptr;
+            throw failed_to_open_file();
+        }
+        LARGE_INTEGER size;
+        if (!::GetFileSizeEx(iFile, &size))
+        {
+            ::CloseHandle(iFile);
+            throw failed_to_open_file();
+        }
+        iSize = static_cast<std::size_t>(size.QuadPart);
+        // an empty file cannot be mapped but is still a valid (empty) view
+        if (iSize == 0u)
+            return;
+        iMapping = ::CreateFileMappingW(iFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (iMapping != nullptr)
+            iData = ::MapViewOfFile(iMapping, FILE_MAP_READ, 0, 0, 0);
+        if (iData == nullptr)
+        {
+            if (iMapping != nullptr)
+                ::CloseHandle(iMapping);
+            ::CloseHandle(iFile);
+            throw failed_to_map_file();
+        }
+#else
+        auto const file = ::open(aPath.c_str(), O_RDONLY);
+        if (file == -1)
+            throw failed_to_open_file();
+        struct stat status;
+        if (::fstat(file, &status) != 0)
+        {
+            ::close(file);
+            throw failed_to_open_file();
+        }
+        iSize = static_cast<std::size_t>(status.st_size);
+        if (iSize != 0u)
+        {
+            auto const data = ::mmap(nullptr, iSize, PROT_READ, MAP_SHARED, file, 0);
+            if (data == MAP_FAILED)
+            {
+                ::close(file);
+                throw failed_to_map_file();
+            }
+            iData = data;
+        }
+        // the mapping keeps its own reference to the file
+        ::close(file);
+#endif
+    }
+
+    mapped_file::~mapped_file()
+    {
+#ifdef _WIN32
+        if (iData != nullptr)
+            ::UnmapViewOfFile(iData);
+        if (iMapping != nullptr)
+            ::CloseHandle(iMapping);
+        if (iFile != nullptr)
+            ::CloseHandle(iFile);
+#else
+        if (iData != nullptr)
+            ::munmap(const_cast<void*>(iData), iSize);
+#endif
+    }
+
+    std::string const& mapped_file::path() const
+    {
+        return iPath;
+    }
+
+    std::size_t mapped_file::size() const
+    {
+        return iSize;
+    }
+
+    std::byte const* mapped_file::data() const
+    {
+        return static_cast<std::byte const*>(iData);
+    }
+
+    std::span<std::byte const> mapped_file::bytes() const
+    {
+        return std::span<std::byte const>{ data(), iData != nullptr ? iSize : 0u };
+    }
+}
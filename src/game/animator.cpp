@@ -19,6 +19,7 @@
 
 #include <neogfx/neogfx.hpp>
 
+#include <algorithm>
 #include <neogfx/core/async_thread.hpp>
 #include <neogfx/game/ecs.hpp>
 #include <neogfx/game/game_world.hpp>
@@ -28,6 +29,7 @@
 #include <neogfx/game/animator.hpp>
 #include <neogfx/game/game_world.hpp>
 #include <neogfx/game/simple_physics.hpp>
+#include <neogfx/game/collision_detector.hpp>
 #include <neogfx/game/animation_filter.hpp>
 #include <neogfx/game/mesh_render_cache.hpp>
 
@@ -74,12 +76,19 @@ namespace neogfx::game
         Animate(now);
 
         std::scoped_lock<decltype(iLock)> lock{ iLock };
+        // defer_destroy_entity() writes entity_info
+        scoped_component_lock<entity_info> lockInfos{ ecs() };
 
         auto& infos = ecs().component<entity_info>();
         auto& filters = ecs().component<animation_filter>();
         auto& cache = ecs().component<mesh_render_cache>();
+        auto* const collisionDetector = ecs().system_instantiated<collision_detector>() ? &ecs().system<collision_detector>() : nullptr;
         auto const& worldClock = ecs().shared_component<game::clock>()[0];
 
+        ++iTick;
+        animation const* lastAnimation = nullptr;
+        frame_table* lastTable = nullptr;
+
         for (auto entity : filters.entities())
         {
             auto const& info = infos.entity_record(entity);
@@ -88,18 +97,70 @@ namespace neogfx::game
             auto& filter = filters.entity_record(entity);
             if (!filter.currentFrameStartTime)
                 filter.currentFrameStartTime = info.creationTime;
-            auto const& frames = (filter.animation ? filter.animation->frames : filter.sharedAnimation.ptr->frames);
-            while (*filter.currentFrameStartTime + to_step_time(frames[filter.currentFrame].duration, worldClock.timestep) < now)
+            auto const& animation = (filter.animation ? *filter.animation : *filter.sharedAnimation.ptr);
+            if (&animation != lastAnimation)
+            {
+                lastAnimation = &animation;
+                lastTable = &table(animation, worldClock.timestep);
+            }
+            auto& frames = *lastTable;
+            if (frames.total <= 0 || filter.currentFrame >= frames.ends.size())
+                continue;
+
+            // a frame lasts until its end time has passed so the current frame is the first whose end is not before now
+            auto const cycleStart = *filter.currentFrameStartTime - (filter.currentFrame > 0u ? frames.ends[filter.currentFrame - 1u] : 0);
+            if (frames.lastCycleStart != cycleStart)
+            {
+                auto const elapsed = now - cycleStart;
+                frames.lastCycleStart = cycleStart;
+                frames.lastCycle = elapsed > 0 ? (elapsed - 1) / frames.total : 0;
+                auto const intoCycle = elapsed - frames.lastCycle * frames.total;
+                frames.lastFrame = static_cast<u32>(std::distance(frames.ends.begin(),
+                    std::lower_bound(frames.ends.begin(), frames.ends.end(), intoCycle)));
+            }
+            if (frames.lastCycle > 0 && filter.autoDestroy)
             {
-                *filter.currentFrameStartTime += to_step_time(frames[filter.currentFrame % frames.size()].duration, worldClock.timestep);
-                filter.currentFrame = (filter.currentFrame + 1u) % frames.size();
-                if (filter.currentFrame == 0 && filter.autoDestroy)
-                {
-                    ecs().async_destroy_entity(entity, false);
-                    break;
-                }
-                set_render_cache_dirty(cache, entity);
+                filter.currentFrame = 0u;
+                defer_destroy_entity(ecs(), entity);
+                continue;
             }
+            *filter.currentFrameStartTime = cycleStart + frames.lastCycle * frames.total +
+                (frames.lastFrame > 0u ? frames.ends[frames.lastFrame - 1u] : 0);
+            if (filter.currentFrame == frames.lastFrame)
+                continue;
+            filter.currentFrame = frames.lastFrame;
+            set_render_cache_dirty(cache, entity);
+            if (collisionDetector)
+                collisionDetector->set_collider_dirty(entity);
+        }
+
+        // forget the tables of animations no longer in use
+        std::erase_if(iFrameTables, [&](auto const& aEntry) { return aEntry.second.tick != iTick; });
+    }
+
+    animator::frame_table& animator::table(animation const& aAnimation, step_time aTimestep)
+    {
+        auto& result = iFrameTables[&aAnimation];
+        if (result.tick == iTick)
+            return result;
+        result.tick = iTick;
+        result.lastCycleStart = std::nullopt;
+        // an animation's frames can be edited in place so the table is checked once per tick
+        bool const valid = !result.ends.empty() && result.timestep == aTimestep && result.durations.size() == aAnimation.frames.size() &&
+            std::equal(result.durations.begin(), result.durations.end(), aAnimation.frames.begin(),
+                [](scalar aDuration, animation_frame const& aFrame) { return aDuration == aFrame.duration; });
+        if (valid)
+            return result;
+        result.timestep = aTimestep;
+        result.durations.clear();
+        result.ends.clear();
+        result.total = 0;
+        for (auto const& frame : aAnimation.frames)
+        {
+            result.durations.push_back(frame.duration);
+            result.total += to_step_time(frame.duration, aTimestep);
+            result.ends.push_back(result.total);
         }
+        return result;
     }
 }
\ No newline at end of file
@@ -0,0 +1,256 @@
+// barnes_hut.cpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2024 Leigh Johnston.  All Rights Reserved.
+
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <neogfx/neogfx.hpp>
+
+#include <array>
+#include <cmath>
+#include <limits>
+#include <thread>
+#include <future>
+#include <algorithm>
+#include <neolib/task/thread_pool.hpp>
+#include <neogfx/game/barnes_hut.hpp>
+
+namespace neogfx::game
+{
+    barnes_hut::barnes_hut(float aTheta) :
+        iTheta{ aTheta },
+        iDepth{ 0u }
+    {
+    }
+
+    float barnes_hut::theta() const
+    {
+        return iTheta;
+    }
+
+    void barnes_hut::set_theta(float aTheta)
+    {
+        iTheta = aTheta;
+    }
+
+    void barnes_hut::solve(std::vector<vec3f> const& aPositions, std::vector<float> const& aMasses, float aGravitationalConstant,
+        std::vector<vec3f>& aAccelerations, bool aMultithreaded)
+    {
+        std::size_t const MinimumBatchSize = 256u;
+
+        aAccelerations.assign(aPositions.size(), vec3f{});
+        build(aPositions, aMasses);
+        if (iNodes.empty())
+            return;
+
+        auto evaluate = [&](std::size_t aFirst, std::size_t aLast)
+        {
+            thread_local std::vector<std::uint32_t> stack;
+            for (auto i = aFirst; i < aLast; ++i)
+                aAccelerations[i] = acceleration(aPositions[i], stack) * aGravitationalConstant;
+        };
+
+        auto const threads = aMultithreaded ? std::max<std::size_t>(std::thread::hardware_concurrency(), 1u) : 1u;
+        auto const batches = std::min(threads, aPositions.size() / MinimumBatchSize);
+        if (batches <= 1u)
+        {
+            evaluate(0u, aPositions.size());
+            return;
+        }
+        thread_local std::vector<std::future<void>> results;
+        results.clear();
+        for (std::size_t batch = 1u; batch < batches; ++batch)
+            results.push_back(neolib::thread_pool::default_thread_pool().run([&evaluate, &aPositions, batch, batches]()
+            {
+                evaluate(aPositions.size() * batch / batches, aPositions.size() * (batch + 1u) / batches);
+            }));
+        evaluate(0u, aPositions.size() / batches);
+        for (auto& result : results)
+            result.get();
+    }
+
+    std::uint32_t barnes_hut::node_count() const
+    {
+        return static_cast<std::uint32_t>(iNodes.size());
+    }
+
+    std::uint32_t barnes_hut::depth() const
+    {
+        return iDepth;
+    }
+
+    void barnes_hut::build(std::vector<vec3f> const& aPositions, std::vector<float> const& aMasses)
+    {
+        iNodes.clear();
+        iOrder.clear();
+        iDepth = 0u;
+
+        vec3f minimum{ std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+        vec3f maximum{ std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest() };
+        for (std::uint32_t i = 0u; i < aPositions.size(); ++i)
+        {
+            if (aMasses[i] <= 0.0f)
+                continue;
+            iOrder.push_back(i);
+            for (std::uint32_t a = 0u; a < 3u; ++a)
+            {
+                minimum[a] = std::min(minimum[a], aPositions[i][a]);
+                maximum[a] = std::max(maximum[a], aPositions[i][a]);
+            }
+        }
+        if (iOrder.empty())
+            return;
+
+        iScratch.resize(iOrder.size());
+        auto const extents = maximum - minimum;
+        auto const halfSize = std::max({ extents[0], extents[1], extents[2], std::numeric_limits<float>::min() }) / 2.0f;
+        iNodes.push_back(node{ (minimum + maximum) / 2.0f, halfSize });
+        build_node(aPositions, aMasses, 0u, 0u, static_cast<std::uint32_t>(iOrder.size()), 0u);
+
+        iX.resize(iOrder.size());
+        iY.resize(iOrder.size());
+        iZ.resize(iOrder.size());
+        iMass.resize(iOrder.size());
+        for (std::size_t i = 0u; i < iOrder.size(); ++i)
+        {
+            auto const& position = aPositions[iOrder[i]];
+            iX[i] = position[0];
+            iY[i] = position[1];
+            iZ[i] = position[2];
+            iMass[i] = aMasses[iOrder[i]];
+        }
+    }
+
+    void barnes_hut::build_node(std::vector<vec3f> const& aPositions, std::vector<float> const& aMasses, std::uint32_t aNode, std::uint32_t aFirst, std::uint32_t aLast, std::uint32_t aDepth)
+    {
+        iDepth = std::max(iDepth, aDepth + 1u);
+
+        float mass = 0.0f;
+        vec3f weighted;
+        for (auto i = aFirst; i < aLast; ++i)
+        {
+            mass += aMasses[iOrder[i]];
+            weighted += aPositions[iOrder[i]] * aMasses[iOrder[i]];
+        }
+        iNodes[aNode].mass = mass;
+        iNodes[aNode].centreOfMass = weighted / mass;
+
+        if (aLast - aFirst <= LeafSize || aDepth >= MaxDepth)
+        {
+            iNodes[aNode].firstBody = aFirst;
+            iNodes[aNode].bodyCount = aLast - aFirst;
+            return;
+        }
+
+        // counting sort of the node's bodies by octant
+        auto const centre = iNodes[aNode].centre;
+        auto const childHalfSize = iNodes[aNode].halfSize / 2.0f;
+        auto octant = [&](std::uint32_t aBody)
+        {
+            auto const& position = aPositions[aBody];
+            return (position[0] >= centre[0] ? 1u : 0u) | (position[1] >= centre[1] ? 2u : 0u) | (position[2] >= centre[2] ? 4u : 0u);
+        };
+        std::array<std::uint32_t, 9u> offsets = {};
+        for (auto i = aFirst; i < aLast; ++i)
+            ++offsets[octant(iOrder[i]) + 1u];
+        for (std::uint32_t o = 1u; o < offsets.size(); ++o)
+            offsets[o] += offsets[o - 1u];
+        auto next = offsets;
+        for (auto i = aFirst; i < aLast; ++i)
+            iScratch[aFirst + next[octant(iOrder[i])]++] = iOrder[i];
+        std::copy(std::next(iScratch.begin(), aFirst), std::next(iScratch.begin(), aLast), std::next(iOrder.begin(), aFirst));
+
+        auto const firstChild = static_cast<std::uint32_t>(iNodes.size());
+        for (std::uint32_t o = 0u; o < 8u; ++o)
+        {
+            if (offsets[o] == offsets[o + 1u])
+                continue;
+            vec3f const childCentre{
+                centre[0] + ((o & 1u) ? childHalfSize : -childHalfSize),
+                centre[1] + ((o & 2u) ? childHalfSize : -childHalfSize),
+                centre[2] + ((o & 4u) ? childHalfSize : -childHalfSize) };
+            iNodes.push_back(node{ childCentre, childHalfSize });
+        }
+        iNodes[aNode].firstChild = firstChild;
+        iNodes[aNode].childCount = static_cast<std::uint32_t>(iNodes.size()) - firstChild;
+        auto child = firstChild;
+        for (std::uint32_t o = 0u; o < 8u; ++o)
+        {
+            if (offsets[o] == offsets[o + 1u])
+                continue;
+            build_node(aPositions, aMasses, child++, aFirst + offsets[o], aFirst + offsets[o + 1u], aDepth + 1u);
+        }
+    }
+
+    vec3f barnes_hut::acceleration(vec3f const& aPosition, std::vector<std::uint32_t>& aStack) const
+    {
+        auto const px = aPosition[0];
+        auto const py = aPosition[1];
+        auto const pz = aPosition[2];
+        auto const theta2 = iTheta * iTheta;
+        float ax = 0.0f;
+        float ay = 0.0f;
+        float az = 0.0f;
+        aStack.clear();
+        aStack.push_back(0u);
+        while (!aStack.empty())
+        {
+            auto const& n = iNodes[aStack.back()];
+            aStack.pop_back();
+            if (n.firstChild == 0u)
+            {
+                // direct summation over the leaf: no branches so the compiler can vectorise it; a body's
+                // interaction with itself has zero distance and so contributes nothing
+                auto const first = n.firstBody;
+                auto const last = n.firstBody + n.bodyCount;
+                for (auto j = first; j < last; ++j)
+                {
+                    auto const dx = iX[j] - px;
+                    auto const dy = iY[j] - py;
+                    auto const dz = iZ[j] - pz;
+                    auto const r2 = dx * dx + dy * dy + dz * dz;
+                    auto const inverseR3 = r2 > 0.0f ? 1.0f / (r2 * std::sqrt(r2)) : 0.0f;
+                    auto const s = iMass[j] * inverseR3;
+                    ax += dx * s;
+                    ay += dy * s;
+                    az += dz * s;
+                }
+                continue;
+            }
+            auto const dx = n.centreOfMass[0] - px;
+            auto const dy = n.centreOfMass[1] - py;
+            auto const dz = n.centreOfMass[2] - pz;
+            auto const r2 = dx * dx + dy * dy + dz * dz;
+            auto const size = n.halfSize * 2.0f;
+            // a large theta must not approximate a body by a cell containing it, so such cells are always opened
+            bool const contains =
+                std::abs(px - n.centre[0]) <= n.halfSize &&
+                std::abs(py - n.centre[1]) <= n.halfSize &&
+                std::abs(pz - n.centre[2]) <= n.halfSize;
+            if (!contains && size * size < theta2 * r2)
+            {
+                auto const s = n.mass / (r2 * std::sqrt(r2));
+                ax += dx * s;
+                ay += dy * s;
+                az += dz * s;
+            }
+            else
+                for (auto child = n.firstChild; child < n.firstChild + n.childCount; ++child)
+                    aStack.push_back(child);
+        }
+        return vec3f{ ax, ay, az };
+    }
+}
@@ -212,6 +212,23 @@ namespace neogfx::game
         }
     }
 
+    bool canvas::sprite_packing() const
+    {
+        return iSpritePacking;
+    }
+
+    void canvas::enable_sprite_packing()
+    {
+        iSpritePacking = true;
+        update();
+    }
+
+    void canvas::disable_sprite_packing()
+    {
+        // packed textures stay where they are as materials may still refer to them
+        iSpritePacking = false;
+    }
+
     void canvas::init()
     {
         iUpdater.emplace(*this, [this](widget_timer& aTimer)
@@ -235,6 +252,12 @@ namespace neogfx::game
         {
             if (have_ecs() && ecs().component_registered<mesh_renderer>())
             {
+                if (iSpritePacking)
+                {
+                    if (!iSpritePacker)
+                        iSpritePacker.emplace();
+                    iSpritePacker->pack(ecs());
+                }
                 aGc.clear_depth_buffer();
                 scoped_component_lock<mesh_renderer> lgMeshRenderer{ ecs() };
                 RenderingEntities(aGc, 0);
@@ -19,22 +19,36 @@
 
 #include <neogfx/neogfx.hpp>
 
+#include <algorithm>
+#include <iterator>
+#include <thread>
+#include <future>
 #include <neogfx/core/async_thread.hpp>
 #include <neogfx/game/ecs.hpp>
 #include <neogfx/game/ecs_helpers.hpp>
 #include <neogfx/game/entity_info.hpp>
 #include <neogfx/game/simple_physics.hpp>
+#include <neogfx/game/game_world.hpp>
 #include <neogfx/game/collision_detector.hpp>
 
 namespace neogfx::game
 {
     collision_detector::collision_detector(i_ecs& aEcs) :
         system<entity_info, box_collider, box_collider_2d>{ aEcs },
+        iBroadphase{ aEcs.system_instantiated<game_world>() ? aEcs.system<game_world>().broadphase() : broadphase_type::Tree },
         iBroadphaseTree{ aEcs },
         iBroadphase2dTree{ aEcs },
-        iCollidersUpdated{ false }
+        iSortAndSweep{ aEcs },
+        iSortAndSweep2d{ aEcs },
+        iDynamicTree{ aEcs },
+        iDynamicTree2d{ aEcs },
+        iCollidersUpdated{ false },
+        iCollisionDelivery{ game::collision_delivery::PerPair },
+        iAllCollidersDirty{ true },
+        iAllCollidersMoved{ true }
     {
         Collision.set_trigger_type(neolib::trigger_type::SynchronousDontQueue);
+        CollisionBatch.set_trigger_type(neolib::trigger_type::SynchronousDontQueue);
         start_thread_if();
     }
 
@@ -54,12 +68,26 @@ namespace neogfx::game
 
     std::optional<entity_id> collision_detector::entity_at(const vec3& aPoint) const
     {
+        std::scoped_lock<std::recursive_mutex> broadphaseLock{ iBroadphaseMutex };
+        auto const broadphase = iBroadphase.load();
+
         if (ecs().component_instantiated<box_collider>())
         {
             scoped_component_lock<entity_info, box_collider> lock{ ecs() };
             thread_local std::vector<entity_id> hits;
             hits.clear();
-            iBroadphaseTree.pick(aPoint, hits);
+            switch (broadphase)
+            {
+            case broadphase_type::Tree:
+                iBroadphaseTree.pick(aPoint, hits);
+                break;
+            case broadphase_type::SortAndSweep:
+                iSortAndSweep.pick(aPoint, hits);
+                break;
+            case broadphase_type::DynamicAabbTree:
+                iDynamicTree.pick(aPoint, hits);
+                break;
+            }
             if (!hits.empty())
                 return hits[0];
         }
@@ -69,7 +97,18 @@ namespace neogfx::game
             scoped_component_lock<entity_info, box_collider_2d> lock{ ecs() };
             thread_local std::vector<entity_id> hits;
             hits.clear();
-            iBroadphase2dTree.pick(aPoint.xy, hits);
+            switch (broadphase)
+            {
+            case broadphase_type::Tree:
+                iBroadphase2dTree.pick(aPoint.xy, hits);
+                break;
+            case broadphase_type::SortAndSweep:
+                iSortAndSweep2d.pick(aPoint.xy, hits);
+                break;
+            case broadphase_type::DynamicAabbTree:
+                iDynamicTree2d.pick(aPoint.xy, hits);
+                break;
+            }
             if (!hits.empty())
                 return hits[0];
         }
@@ -100,120 +139,344 @@ namespace neogfx::game
             update_colliders();
         if (!iCollidersUpdated)
             return;
+        std::scoped_lock<std::recursive_mutex> lock{ iBroadphaseMutex };
+        auto const broadphase = iBroadphase.load();
         if ((aCycle & collision_detection_cycle::UpdateTrees) == collision_detection_cycle::UpdateTrees)
-            update_trees();
+            update_trees(broadphase);
         if ((aCycle & collision_detection_cycle::DetectCollisions) == collision_detection_cycle::DetectCollisions)
-            detect_collisions();
+            detect_collisions(broadphase);
+    }
+
+    void collision_detector::set_collider_dirty(entity_id aEntity)
+    {
+        std::scoped_lock<std::mutex> lock{ iDirtyMutex };
+        iDirtyColliders.push_back(aEntity);
+    }
+
+    void collision_detector::set_all_colliders_dirty()
+    {
+        std::scoped_lock<std::mutex> lock{ iDirtyMutex };
+        iAllCollidersDirty = true;
     }
 
     void collision_detector::update_colliders()
     {
+        thread_local std::vector<entity_id> dirty;
+        dirty.clear();
+        bool all = !ecs().system_instantiated<simple_physics>();
+        {
+            std::scoped_lock<std::mutex> lock{ iDirtyMutex };
+            dirty.swap(iDirtyColliders);
+            all = all || iAllCollidersDirty;
+            iAllCollidersDirty = false;
+        }
+        std::sort(dirty.begin(), dirty.end());
+        dirty.erase(std::unique(dirty.begin(), dirty.end()), dirty.end());
+
         if (ecs().component_instantiated<box_collider>())
+            update_colliders<box_collider>(dirty, all, iKnownColliders,
+                [](mesh const& aMesh) { return to_aabb(aMesh.vertices); });
+
+        if (ecs().component_instantiated<box_collider_2d>())
+            update_colliders<box_collider_2d>(dirty, all, iKnownColliders2d,
+                [](mesh const& aMesh) { return to_aabb_2d(aMesh.vertices); });
+
+        iCollidersUpdated = true;
+    }
+
+    template <typename Collider, typename AabbFunction>
+    void collision_detector::update_colliders(std::vector<entity_id> const& aDirty, bool aAll, std::vector<entity_id>& aKnown, AabbFunction aToAabb)
+    {
+        scoped_component_lock<entity_info, Collider, mesh_filter, animation_filter, rigid_body> lock{ ecs() };
+        auto const& infos = ecs().component<entity_info>();
+        auto const& meshFilters = ecs().component<mesh_filter>();
+        auto const& animatedMeshFilters = ecs().component<animation_filter>();
+        auto const& rigidBodies = ecs().component<rigid_body>();
+        auto& colliders = ecs().component<Collider>();
+        auto update = [&](entity_id aEntity)
         {
-            scoped_component_lock<entity_info, box_collider, mesh_filter, animation_filter, rigid_body> lock{ ecs() };
-            auto const& meshFilters = ecs().component<mesh_filter>();
-            auto const& animatedMeshFilters = ecs().component<animation_filter>();
-            auto const& rigidBodies = ecs().component<rigid_body>();
-            auto& boxColliders = ecs().component<box_collider>();
-            for (auto entity : boxColliders.entities())
+            auto const& meshFilter = meshFilters.has_entity_record(aEntity) ?
+                meshFilters.entity_record(aEntity) : current_animation_frame(animatedMeshFilters.entity_record(aEntity));
+            auto& collider = colliders.entity_record(aEntity);
+            collider.previousAabb = collider.currentAabb;
+            auto const& untransformed = (meshFilter.mesh != std::nullopt ?
+                *meshFilter.mesh : *meshFilter.sharedMesh.ptr);
+            if (!collider.untransformedAabb)
+                collider.untransformedAabb = aToAabb(untransformed);
+            collider.currentAabb = aabb_transform(*collider.untransformedAabb,
+                (animatedMeshFilters.has_entity_record(aEntity) ?
+                    to_transformation_matrix(animatedMeshFilters.entity_record(aEntity)) : mat44f::identity()),
+                (meshFilter.transformation ?
+                    *meshFilter.transformation : mat44f::identity()),
+                (rigidBodies.has_entity_record(aEntity) ?
+                    to_transformation_matrix(rigidBodies.entity_record(aEntity)) : mat44f::identity()));
+            if (!collider.previousAabb)
+                collider.previousAabb = collider.currentAabb;
+        };
+        if (aAll)
+            for (auto entity : colliders.entities())
             {
-                auto const& info = ecs().component<entity_info>().entity_record(entity);
-                if (info.destroyed)
+                if (infos.entity_record(entity).destroyed)
                     continue; // todo: add support for skip iterators
-                // todo: only update collider AABBs if rigid_body changes require it
-                auto const& meshFilter = meshFilters.has_entity_record(entity) ?
-                    meshFilters.entity_record(entity) : current_animation_frame(animatedMeshFilters.entity_record(entity));
-                auto& collider = boxColliders.entity_record(entity);
-                collider.previousAabb = collider.currentAabb;
-                auto const& untransformed = (meshFilter.mesh != std::nullopt ?
-                    *meshFilter.mesh : *meshFilter.sharedMesh.ptr);
-                if (!collider.untransformedAabb)
-                    collider.untransformedAabb = to_aabb(untransformed.vertices);
-                collider.currentAabb = aabb_transform(*collider.untransformedAabb,
-                    (animatedMeshFilters.has_entity_record(entity) ?
-                        to_transformation_matrix(animatedMeshFilters.entity_record(entity)) : mat44f::identity()),
-                    (meshFilter.transformation ?
-                        *meshFilter.transformation : mat44f::identity()),
-                    (rigidBodies.has_entity_record(entity) ?
-                        to_transformation_matrix(rigidBodies.entity_record(entity)) : mat44f::identity()));
-                if (!collider.previousAabb)
-                    collider.previousAabb = collider.currentAabb;
+                update(entity);
             }
+        // colliders added and removed since the last cycle: comparing the entity list is cheap next to recalculating
+        // bounds and, unlike comparing counts, catches an add and a remove in the same cycle
+        thread_local std::vector<entity_id> added;
+        thread_local std::vector<entity_id> removed;
+        added.clear();
+        removed.clear();
+        auto const& entities = colliders.entities();
+        if (!std::equal(entities.begin(), entities.end(), aKnown.begin(), aKnown.end()))
+        {
+            thread_local std::vector<entity_id> current;
+            current.assign(entities.begin(), entities.end());
+            std::sort(current.begin(), current.end());
+            std::sort(aKnown.begin(), aKnown.end());
+            std::set_difference(current.begin(), current.end(), aKnown.begin(), aKnown.end(), std::back_inserter(added));
+            std::set_difference(aKnown.begin(), aKnown.end(), current.begin(), current.end(), std::back_inserter(removed));
+            aKnown.assign(entities.begin(), entities.end());
         }
-
-        if (ecs().component_instantiated<box_collider_2d>())
+        thread_local std::vector<entity_id> moved;
+        moved.clear();
+        if (!aAll)
         {
-            scoped_component_lock<entity_info, box_collider_2d, mesh_filter, animation_filter, rigid_body> lock{ ecs() };
-            auto const& meshFilters = ecs().component<mesh_filter>();
-            auto const& animatedMeshFilters = ecs().component<animation_filter>();
-            auto const& rigidBodies = ecs().component<rigid_body>();
-            auto& boxColliders2d = ecs().component<box_collider_2d>();
-            for (auto entity : boxColliders2d.entities())
+            for (auto entity : aDirty)
             {
-                auto const& info = ecs().component<entity_info>().entity_record(entity);
-                if (info.destroyed)
-                    continue; // todo: add support for skip iterators
-                // todo: only update collider AABBs if rigid_body changes require it
-                auto const& meshFilter = meshFilters.has_entity_record(entity) ?
-                    meshFilters.entity_record(entity) : current_animation_frame(animatedMeshFilters.entity_record(entity));
-                auto& collider = boxColliders2d.entity_record(entity);
-                collider.previousAabb = collider.currentAabb;
-                auto const& untransformed = (meshFilter.mesh != std::nullopt ?
-                    *meshFilter.mesh : *meshFilter.sharedMesh.ptr);
-                if (!collider.untransformedAabb)
-                    collider.untransformedAabb = to_aabb_2d(untransformed.vertices);
-                collider.currentAabb = aabb_transform(*collider.untransformedAabb, 
-                    (animatedMeshFilters.has_entity_record(entity) ?
-                        to_transformation_matrix(animatedMeshFilters.entity_record(entity)) : mat44f::identity()),
-                    (meshFilter.transformation ?
-                        *meshFilter.transformation : mat44f::identity()),
-                    (rigidBodies.has_entity_record(entity) ?
-                        to_transformation_matrix(rigidBodies.entity_record(entity)) : mat44f::identity()));
-                if (!collider.previousAabb)
-                    collider.previousAabb = collider.currentAabb;
+                if (!colliders.has_entity_record(entity) || infos.entity_record(entity).destroyed)
+                    continue;
+                update(entity);
+                moved.push_back(entity);
+            }
+            // new colliders have no bounds yet
+            for (auto entity : added)
+            {
+                if (infos.entity_record(entity).destroyed)
+                    continue;
+                update(entity);
+                moved.push_back(entity);
             }
         }
-
-        iCollidersUpdated = true;
+        std::scoped_lock<std::mutex> dirtyLock{ iDirtyMutex };
+        if (aAll)
+            iAllCollidersMoved = true;
+        else
+        {
+            iMovedColliders.insert(iMovedColliders.end(), moved.begin(), moved.end());
+            iRemovedColliders.insert(iRemovedColliders.end(), removed.begin(), removed.end());
+        }
     }
 
-    void collision_detector::update_trees()
+    void collision_detector::update_trees(broadphase_type aBroadphase)
     {
+        thread_local std::vector<entity_id> moved;
+        thread_local std::vector<entity_id> removed;
+        moved.clear();
+        removed.clear();
+        bool all = false;
+        {
+            std::scoped_lock<std::mutex> lock{ iDirtyMutex };
+            moved.swap(iMovedColliders);
+            removed.swap(iRemovedColliders);
+            all = iAllCollidersMoved;
+            iAllCollidersMoved = false;
+        }
+        if (!all && moved.empty() && removed.empty())
+            return;
+        std::sort(moved.begin(), moved.end());
+        moved.erase(std::unique(moved.begin(), moved.end()), moved.end());
+
         if (ecs().component_instantiated<box_collider>())
         {
             scoped_component_lock<entity_info, box_collider> lock{ ecs() };
-            iBroadphaseTree.full_update();
+            switch (aBroadphase)
+            {
+            case broadphase_type::Tree:
+                iBroadphaseTree.full_update();
+                break;
+            case broadphase_type::SortAndSweep:
+                if (all)
+                    iSortAndSweep.update();
+                else
+                    iSortAndSweep.update(moved, removed);
+                break;
+            case broadphase_type::DynamicAabbTree:
+                if (all)
+                    iDynamicTree.update();
+                else
+                    iDynamicTree.update(moved, removed);
+                break;
+            }
         }
 
         if (ecs().component_instantiated<box_collider_2d>())
         {
             scoped_component_lock<entity_info, box_collider_2d> lock{ ecs() };
-            iBroadphase2dTree.full_update();
+            switch (aBroadphase)
+            {
+            case broadphase_type::Tree:
+                iBroadphase2dTree.full_update();
+                break;
+            case broadphase_type::SortAndSweep:
+                if (all)
+                    iSortAndSweep2d.update();
+                else
+                    iSortAndSweep2d.update(moved, removed);
+                break;
+            case broadphase_type::DynamicAabbTree:
+                if (all)
+                    iDynamicTree2d.update();
+                else
+                    iDynamicTree2d.update(moved, removed);
+                break;
+            }
         }
     }
 
-    void collision_detector::detect_collisions()
+    void collision_detector::detect_collisions(broadphase_type aBroadphase)
     {
+        bool const batch = (iCollisionDelivery == game::collision_delivery::Batch);
+        if (batch)
+            iCollisionPairs.clear();
+        auto const collision = [this, batch](entity_id e1, entity_id e2)
+        {
+            if (batch)
+                iCollisionPairs.emplace_back(e1, e2);
+            else
+                Collision(e1, e2);
+        };
+
         if (ecs().component_instantiated<box_collider>())
         {
             scoped_component_lock<entity_info, box_collider> lock{ ecs() };
-            iBroadphaseTree.collisions([this](entity_id e1, entity_id e2)
+            switch (aBroadphase)
             {
-                Collision(e1, e2);
-            });
+            case broadphase_type::Tree:
+                // the octree marks colliders as it visits them so can't be shared between threads
+                iBroadphaseTree.collisions(collision);
+                break;
+            case broadphase_type::SortAndSweep:
+                if (batch)
+                    gather_collisions(iSortAndSweep);
+                else
+                    iSortAndSweep.collisions(collision);
+                break;
+            case broadphase_type::DynamicAabbTree:
+                if (batch)
+                    gather_collisions(iDynamicTree);
+                else
+                    iDynamicTree.collisions(collision);
+                break;
+            }
         }
 
         if (ecs().component_instantiated<box_collider_2d>())
         {
             scoped_component_lock<entity_info, box_collider_2d> lock{ ecs() };
-            iBroadphase2dTree.full_update();
-            iBroadphase2dTree.collisions([this](entity_id e1, entity_id e2)
+            switch (aBroadphase)
             {
-                Collision(e1, e2);
-            });
+            case broadphase_type::Tree:
+                iBroadphase2dTree.collisions(collision);
+                break;
+            case broadphase_type::SortAndSweep:
+                if (batch)
+                    gather_collisions(iSortAndSweep2d);
+                else
+                    iSortAndSweep2d.collisions(collision);
+                break;
+            case broadphase_type::DynamicAabbTree:
+                if (batch)
+                    gather_collisions(iDynamicTree2d);
+                else
+                    iDynamicTree2d.collisions(collision);
+                break;
+            }
         }
 
         iCollidersUpdated = false;
+
+        if (batch)
+        {
+            std::sort(iCollisionPairs.begin(), iCollisionPairs.end());
+            iCollisionPairs.erase(std::unique(iCollisionPairs.begin(), iCollisionPairs.end()), iCollisionPairs.end());
+            if (!iCollisionPairs.empty())
+                CollisionBatch(iCollisionPairs);
+        }
+    }
+
+    template <typename Broadphase>
+    void collision_detector::gather_collisions(Broadphase const& aBroadphase)
+    {
+        std::size_t const MinimumPartitionSize = 1024u;
+        auto const size = aBroadphase.partition_size();
+        auto const threads = std::max<std::size_t>(std::thread::hardware_concurrency(), 1u);
+        // more partitions than threads as the work per partition is uneven
+        auto const partitions = std::min(threads * 4u, (size + MinimumPartitionSize - 1u) / MinimumPartitionSize);
+        if (threads == 1u || partitions <= 1u)
+        {
+            aBroadphase.collisions([this](entity_id e1, entity_id e2) { iCollisionPairs.emplace_back(e1, e2); });
+            return;
+        }
+        if (iCollisionPairBuffers.size() < partitions)
+            iCollisionPairBuffers.resize(partitions);
+        if (!iCollisionPool)
+            iCollisionPool = std::make_unique<neolib::thread_pool>(threads);
+        thread_local std::vector<std::future<void>> results;
+        results.clear();
+        for (std::size_t partition = 0u; partition < partitions; ++partition)
+        {
+            auto& buffer = iCollisionPairBuffers[partition];
+            buffer.clear();
+            auto const first = size * partition / partitions;
+            auto const last = size * (partition + 1u) / partitions;
+            results.push_back(iCollisionPool->run([&aBroadphase, &buffer, first, last]()
+            {
+                aBroadphase.collisions(first, last, [&buffer](entity_id e1, entity_id e2) { buffer.emplace_back(e1, e2); });
+            }));
+        }
+        for (auto& result : results)
+            result.get();
+        for (std::size_t partition = 0u; partition < partitions; ++partition)
+            iCollisionPairs.insert(iCollisionPairs.end(), iCollisionPairBuffers[partition].begin(), iCollisionPairBuffers[partition].end());
+    }
+
+    game::collision_delivery collision_detector::collision_delivery() const
+    {
+        return iCollisionDelivery;
+    }
+
+    void collision_detector::set_collision_delivery(game::collision_delivery aDelivery)
+    {
+        iCollisionDelivery = aDelivery;
+    }
+
+    broadphase_type collision_detector::broadphase() const
+    {
+        return iBroadphase;
+    }
+
+    void collision_detector::set_broadphase(broadphase_type aBroadphase)
+    {
+        std::scoped_lock<std::recursive_mutex> lock{ iBroadphaseMutex };
+        if (iBroadphase == aBroadphase)
+            return;
+        // the incoming broadphase is built from scratch on the next cycle
+        switch (aBroadphase)
+        {
+        case broadphase_type::Tree:
+            break;
+        case broadphase_type::SortAndSweep:
+            iSortAndSweep.clear();
+            iSortAndSweep2d.clear();
+            break;
+        case broadphase_type::DynamicAabbTree:
+            iDynamicTree.clear();
+            iDynamicTree2d.clear();
+            break;
+        }
+        iBroadphase = aBroadphase;
+        std::scoped_lock<std::mutex> dirtyLock{ iDirtyMutex };
+        iAllCollidersMoved = true;
     }
 
     const aabb_octree<box_collider>& collision_detector::broadphase_tree() const
@@ -225,4 +488,14 @@ namespace neogfx::game
     {
         return iBroadphase2dTree;
     }
+
+    const dynamic_aabb_tree<box_collider>& collision_detector::broadphase_dynamic_tree() const
+    {
+        return iDynamicTree;
+    }
+
+    const dynamic_aabb_tree<box_collider_2d>& collision_detector::broadphase_dynamic_2d_tree() const
+    {
+        return iDynamicTree2d;
+    }
 }
\ No newline at end of file
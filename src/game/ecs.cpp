@@ -65,6 +65,60 @@ namespace neogfx
             base_type::destroy_entity(aEntityId, aNotify);
         }
 
+        void ecs::defer_destroy_entity(entity_id aEntityId)
+        {
+            if (!has_frame_barrier())
+            {
+                async_destroy_entity(aEntityId, false);
+                return;
+            }
+            // flagged now so that systems skip the entity until the barrier and so that it is only queued once
+            auto& info = component<entity_info>().entity_record(aEntityId);
+            if (info.destroyed)
+                return;
+            info.destroyed = true;
+            iDeferred.push(aEntityId);
+        }
+
+        void ecs::defer(deferred_command aCommand)
+        {
+            iDeferred.push(std::move(aCommand));
+        }
+
+        std::size_t ecs::apply_deferred()
+        {
+            std::size_t applied = 0u;
+            while (auto command = iDeferred.pop())
+            {
+                ++applied;
+                if (std::holds_alternative<entity_id>(*command))
+                {
+                    auto const entity = std::get<entity_id>(*command);
+                    // the same entity may have been queued for destruction more than once
+                    if (component_instantiated<entity_info>() && component<entity_info>().has_entity_record(entity))
+                        destroy_entity(entity, false);
+                }
+                else
+                    std::get<deferred_command>(*command)(*this);
+            }
+            return applied;
+        }
+
+        void ecs::add_frame_barrier()
+        {
+            ++iFrameBarriers;
+        }
+
+        void ecs::remove_frame_barrier()
+        {
+            --iFrameBarriers;
+        }
+
+        bool ecs::has_frame_barrier() const
+        {
+            return iFrameBarriers != 0u;
+        }
+
         bool ecs::cacheable() const
         {
             return true;
@@ -0,0 +1,244 @@
+// frame_scheduler.cpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2024 Leigh Johnston.  All Rights Reserved.
+
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <neogfx/neogfx.hpp>
+
+#include <algorithm>
+#include <neogfx/game/ecs.hpp>
+#include <neogfx/game/entity_info.hpp>
+#include <neogfx/game/clock.hpp>
+#include <neogfx/game/time.hpp>
+#include <neogfx/game/physics.hpp>
+#include <neogfx/game/simple_physics.hpp>
+#include <neogfx/game/animator.hpp>
+#include <neogfx/game/collision_detector.hpp>
+#include <neogfx/game/frame_scheduler.hpp>
+
+namespace neogfx::game
+{
+    namespace
+    {
+        bool intersects(component_set const& aLhs, component_set const& aRhs)
+        {
+            for (auto const& id : aLhs)
+                if (std::find(aRhs.begin(), aRhs.end(), id) != aRhs.end())
+                    return true;
+            return false;
+        }
+    }
+
+    frame_scheduler::frame_scheduler(i_ecs& aEcs) :
+        iEcs{ aEcs },
+        iFrame{ 0u },
+        iTimeline{}
+    {
+        FrameCompleted.set_trigger_type(neolib::trigger_type::SynchronousDontQueue);
+        add_frame_barrier(iEcs);
+    }
+
+    frame_scheduler::~frame_scheduler()
+    {
+        remove_frame_barrier(iEcs);
+    }
+
+    void frame_scheduler::add(i_system& aSystem, component_set const& aReads, component_set const& aWrites, std::function<void()> aTask)
+    {
+        if (scheduled(aSystem))
+            throw system_already_scheduled();
+        if (!aTask)
+            aTask = [&aSystem]()
+            {
+                if (aSystem.can_apply())
+                    aSystem.apply();
+            };
+        iNodes.push_back(node{ &aSystem, aReads, aWrites, aTask });
+    }
+
+    void frame_scheduler::remove(i_system const& aSystem)
+    {
+        auto const index = index_of(aSystem);
+        iNodes.erase(std::next(iNodes.begin(), index));
+        for (auto& n : iNodes)
+            n.after.erase(std::remove(n.after.begin(), n.after.end(), &aSystem), n.after.end());
+    }
+
+    void frame_scheduler::add_dependency(i_system const& aBefore, i_system const& aAfter)
+    {
+        index_of(aBefore);
+        iNodes[index_of(aAfter)].after.push_back(&aBefore);
+    }
+
+    void frame_scheduler::add_standard_systems()
+    {
+        // these four form a strict chain (time -> physics -> animator -> collision detector) through the clock and the
+        // rigid body and animation components; systems added alongside them are what run in parallel
+        add<game::time>(components<>(), components<game::clock>());
+        // collider updates and animation are scheduled separately rather than chained from the physics step
+        iEcs.system<simple_physics>().set_chained_systems(false);
+        add<simple_physics>(
+            components<entity_info, physics>(),
+            components<rigid_body, mesh_render_cache, game::clock>());
+        // the animator writes entity_info as expired animations are destroyed (deferred) straight away
+        add<animator>(
+            components<game::clock>(),
+            components<entity_info, animation_filter, mesh_render_cache>());
+        add<collision_detector>(
+            components<entity_info, mesh_filter, animation_filter, rigid_body>(),
+            components<box_collider, box_collider_2d>(),
+            [this]()
+            {
+                auto& collisionDetector = iEcs.system<collision_detector>();
+                if (!collisionDetector.paused())
+                    collisionDetector.run_cycle(collision_detection_cycle::Default);
+            });
+    }
+
+    bool frame_scheduler::scheduled(i_system const& aSystem) const
+    {
+        return std::find_if(iNodes.begin(), iNodes.end(), [&](node const& n) { return n.system == &aSystem; }) != iNodes.end();
+    }
+
+    void frame_scheduler::run_frame()
+    {
+        // no system is running so entities queued for creation/destruction last frame can be applied here
+        apply_deferred(iEcs);
+
+        build_graph();
+
+        iTimeline.frame = ++iFrame;
+        iTimeline.start = std::chrono::steady_clock::now();
+        iTimeline.systems.assign(iNodes.size(), system_execution{});
+        iException = nullptr;
+
+        std::vector<std::size_t> ready;
+        for (std::size_t n = 0u; n < iNodes.size(); ++n)
+            if (iNodes[n].pending == 0u)
+                ready.push_back(n);
+        std::size_t remaining = iNodes.size();
+        std::size_t running = 0u;
+
+        std::unique_lock<std::mutex> lock{ iMutex };
+        iFinished.clear();
+        while (remaining != 0u)
+        {
+            if (ready.empty() && running == 0u)
+                throw cyclic_dependency();
+            // all but one of the ready systems go to the pool, this thread runs the other
+            while (ready.size() > 1u)
+            {
+                auto const n = ready.back();
+                ready.pop_back();
+                ++running;
+                iThreadPool.run([this, n]() { run_node(n); });
+            }
+            if (!ready.empty())
+            {
+                auto const n = ready.back();
+                ready.pop_back();
+                ++running;
+                lock.unlock();
+                run_node(n);
+                lock.lock();
+            }
+            iCompleted.wait(lock, [this]() { return !iFinished.empty(); });
+            for (auto n : iFinished)
+            {
+                --running;
+                --remaining;
+                for (auto successor : iNodes[n].successors)
+                    if (--iNodes[successor].pending == 0u)
+                        ready.push_back(successor);
+            }
+            iFinished.clear();
+        }
+        lock.unlock();
+
+        iTimeline.end = std::chrono::steady_clock::now();
+        if (iException)
+            std::rethrow_exception(iException);
+        FrameCompleted(iTimeline);
+    }
+
+    frame_timeline const& frame_scheduler::last_frame() const
+    {
+        return iTimeline;
+    }
+
+    std::size_t frame_scheduler::index_of(i_system const& aSystem) const
+    {
+        auto existing = std::find_if(iNodes.begin(), iNodes.end(), [&](node const& n) { return n.system == &aSystem; });
+        if (existing == iNodes.end())
+            throw system_not_scheduled();
+        return static_cast<std::size_t>(std::distance(iNodes.begin(), existing));
+    }
+
+    void frame_scheduler::build_graph()
+    {
+        for (auto& n : iNodes)
+        {
+            n.successors.clear();
+            n.pending = 0u;
+        }
+        auto add_edge = [&](std::size_t aBefore, std::size_t aAfter)
+        {
+            auto& successors = iNodes[aBefore].successors;
+            if (std::find(successors.begin(), successors.end(), aAfter) != successors.end())
+                return;
+            successors.push_back(aAfter);
+            ++iNodes[aAfter].pending;
+        };
+        for (std::size_t later = 0u; later < iNodes.size(); ++later)
+        {
+            auto const& l = iNodes[later];
+            // a writer conflicts with any reader or writer of the same component; registration order decides who goes first
+            for (std::size_t earlier = 0u; earlier < later; ++earlier)
+            {
+                auto const& e = iNodes[earlier];
+                if (intersects(e.writes, l.writes) || intersects(e.writes, l.reads) || intersects(e.reads, l.writes))
+                    add_edge(earlier, later);
+            }
+            for (auto before : l.after)
+                add_edge(index_of(*before), later);
+        }
+    }
+
+    void frame_scheduler::run_node(std::size_t aNode)
+    {
+        auto& n = iNodes[aNode];
+        auto& execution = iTimeline.systems[aNode];
+        execution.system = n.system;
+        execution.thread = std::this_thread::get_id();
+        execution.start = std::chrono::steady_clock::now();
+        try
+        {
+            if (!n.system->paused())
+                n.task();
+        }
+        catch (...)
+        {
+            std::scoped_lock<std::mutex> lock{ iMutex };
+            if (!iException)
+                iException = std::current_exception();
+        }
+        execution.end = std::chrono::steady_clock::now();
+        std::scoped_lock<std::mutex> lock{ iMutex };
+        iFinished.push_back(aNode);
+        iCompleted.notify_one();
+    }
+}
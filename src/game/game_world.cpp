@@ -24,11 +24,17 @@
 #include <neogfx/game/time.hpp>
 #include <neogfx/game/clock.hpp>
 #include <neogfx/game/game_world.hpp>
+#include <neogfx/game/collision_detector.hpp>
 
 namespace neogfx::game
 {
     game_world::game_world(game::i_ecs& aEcs) :
-        game::system<>{ aEcs }, iUniversalGravitationEnabled{ false }
+        game::system<>{ aEcs },
+        iUniversalGravitationEnabled{ false },
+        iGravitationSolver{ game::gravitation_solver::Direct },
+        iBarnesHutTheta{ 0.5f },
+        iMultithreadedGravitation{ true },
+        iBroadphase{ broadphase_type::Tree }
     {
         ApplyingPhysics.set_trigger_type(neolib::trigger_type::SynchronousDontQueue);
         PhysicsApplied.set_trigger_type(neolib::trigger_type::SynchronousDontQueue);
@@ -75,4 +81,46 @@ namespace neogfx::game
         iUniversalGravitationEnabled = false;
     }
 
+    game::gravitation_solver game_world::gravitation_solver() const
+    {
+        return iGravitationSolver;
+    }
+
+    void game_world::set_gravitation_solver(game::gravitation_solver aSolver)
+    {
+        iGravitationSolver = aSolver;
+    }
+
+    float game_world::barnes_hut_theta() const
+    {
+        return iBarnesHutTheta;
+    }
+
+    void game_world::set_barnes_hut_theta(float aTheta)
+    {
+        iBarnesHutTheta = aTheta;
+    }
+
+    bool game_world::multithreaded_gravitation() const
+    {
+        return iMultithreadedGravitation;
+    }
+
+    void game_world::set_multithreaded_gravitation(bool aMultithreaded)
+    {
+        iMultithreadedGravitation = aMultithreaded;
+    }
+
+    broadphase_type game_world::broadphase() const
+    {
+        return iBroadphase;
+    }
+
+    void game_world::set_broadphase(broadphase_type aBroadphase)
+    {
+        iBroadphase = aBroadphase;
+        if (ecs().system_instantiated<collision_detector>())
+            ecs().system<collision_detector>().set_broadphase(aBroadphase);
+    }
+
 }
\ No newline at end of file
@@ -0,0 +1,222 @@
+// rigid_body_integrator.cpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2024 Leigh Johnston.  All Rights Reserved.
+
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <neogfx/neogfx.hpp>
+
+#include <cmath>
+#include <boost/math/constants/constants.hpp>
+#include <neogfx/game/ecs.hpp>
+#include <neogfx/game/entity_info.hpp>
+#include <neogfx/game/rigid_body.hpp>
+#include <neogfx/game/rigid_body_integrator.hpp>
+
+namespace neogfx::game
+{
+    rigid_body_integrator::rigid_body_integrator()
+    {
+    }
+
+    std::size_t rigid_body_integrator::size() const
+    {
+        return iAlive.size();
+    }
+
+    void rigid_body_integrator::gather(i_ecs& aEcs)
+    {
+        auto const& infos = aEcs.component<entity_info>();
+        auto const& rigidBodies = aEcs.component<rigid_body>();
+        auto const& bodies = rigidBodies.component_data();
+
+        iAlive.clear();
+        iThrusting.clear();
+        iMassive.clear();
+        iLocalAcceleration.clear();
+        for (std::uint32_t index = 0u; index < bodies.size(); ++index)
+            if (!infos.entity_record(rigidBodies.entity(bodies[index])).destroyed)
+                iAlive.push_back(index);
+
+        auto const count = iAlive.size();
+        for (auto* v : { &iPositionX, &iPositionY, &iPositionZ, &iVelocityX, &iVelocityY, &iVelocityZ,
+            &iAccelerationX, &iAccelerationY, &iAccelerationZ, &iAngleX, &iAngleY, &iAngleZ, &iSpinX, &iSpinY, &iSpinZ, &iMass })
+            v->resize(count);
+        for (std::uint32_t i = 0u; i < count; ++i)
+        {
+            auto const& body = bodies[iAlive[i]];
+            iPositionX[i] = body.position[0];
+            iPositionY[i] = body.position[1];
+            iPositionZ[i] = body.position[2];
+            iVelocityX[i] = body.velocity[0];
+            iVelocityY[i] = body.velocity[1];
+            iVelocityZ[i] = body.velocity[2];
+            iAngleX[i] = body.angle[0];
+            iAngleY[i] = body.angle[1];
+            iAngleZ[i] = body.angle[2];
+            iSpinX[i] = body.spin[0];
+            iSpinY[i] = body.spin[1];
+            iSpinZ[i] = body.spin[2];
+            iMass[i] = body.mass;
+            if (body.acceleration != vec3f{})
+            {
+                iThrusting.push_back(i);
+                iLocalAcceleration.push_back(body.acceleration);
+            }
+            if (body.mass != 0.0f)
+                iMassive.push_back(i);
+        }
+    }
+
+    void rigid_body_integrator::step(float aElapsedTime, gravitation const& aGravitation)
+    {
+        apply_gravitation(aGravitation);
+        apply_thrust();
+
+        // v = u + at; s = (u + v)t / 2
+        auto const count = iAlive.size();
+        auto const dt = aElapsedTime;
+        float* const px = iPositionX.data();
+        float* const py = iPositionY.data();
+        float* const pz = iPositionZ.data();
+        float* const vx = iVelocityX.data();
+        float* const vy = iVelocityY.data();
+        float* const vz = iVelocityZ.data();
+        float const* const ax = iAccelerationX.data();
+        float const* const ay = iAccelerationY.data();
+        float const* const az = iAccelerationZ.data();
+        for (std::size_t i = 0u; i < count; ++i)
+        {
+            auto const v0x = vx[i];
+            auto const v0y = vy[i];
+            auto const v0z = vz[i];
+            vx[i] = v0x + ax[i] * dt;
+            vy[i] = v0y + ay[i] * dt;
+            vz[i] = v0z + az[i] * dt;
+            px[i] += dt * (v0x + vx[i]) / 2.0f;
+            py[i] += dt * (v0y + vy[i]) / 2.0f;
+            pz[i] += dt * (v0z + vz[i]) / 2.0f;
+        }
+
+        auto const twoPi = 2.0f * boost::math::constants::pi<float>();
+        for (std::size_t i = 0u; i < count; ++i)
+        {
+            iAngleX[i] = std::fmod(iAngleX[i] + iSpinX[i] * dt, twoPi);
+            iAngleY[i] = std::fmod(iAngleY[i] + iSpinY[i] * dt, twoPi);
+            iAngleZ[i] = std::fmod(iAngleZ[i] + iSpinZ[i] * dt, twoPi);
+        }
+    }
+
+    void rigid_body_integrator::scatter(i_ecs& aEcs, std::vector<entity_id>& aMoved) const
+    {
+        auto& rigidBodies = aEcs.component<rigid_body>();
+        auto& bodies = rigidBodies.component_data();
+        for (std::uint32_t i = 0u; i < iAlive.size(); ++i)
+        {
+            auto& body = bodies[iAlive[i]];
+            vec3f const position{ iPositionX[i], iPositionY[i], iPositionZ[i] };
+            vec3f const angle{ iAngleX[i], iAngleY[i], iAngleZ[i] };
+            if (body.position != position || body.angle != angle)
+                aMoved.push_back(rigidBodies.entity(body));
+            body.position = position;
+            body.velocity = vec3f{ iVelocityX[i], iVelocityY[i], iVelocityZ[i] };
+            body.angle = angle;
+        }
+    }
+
+    game::barnes_hut& rigid_body_integrator::barnes_hut()
+    {
+        return iBarnesHut;
+    }
+
+    void rigid_body_integrator::apply_gravitation(gravitation const& aGravitation)
+    {
+        auto const count = iAlive.size();
+        if (aGravitation.universal && aGravitation.solver == gravitation_solver::BarnesHut)
+        {
+            iPositions.resize(count);
+            for (std::size_t i = 0u; i < count; ++i)
+                iPositions[i] = vec3f{ iPositionX[i], iPositionY[i], iPositionZ[i] };
+            iBarnesHut.solve(iPositions, iMass, aGravitation.constant, iUniversal, aGravitation.multithreaded);
+        }
+        else if (aGravitation.universal)
+        {
+            // direct summation: a = G * sum(m * d / |d|^3); a body's interaction with itself has zero distance and
+            // so contributes nothing
+            auto const massive = iMassive.size();
+            for (auto* v : { &iMassiveX, &iMassiveY, &iMassiveZ, &iMassiveMass })
+                v->resize(massive);
+            for (std::size_t m = 0u; m < massive; ++m)
+            {
+                iMassiveX[m] = iPositionX[iMassive[m]];
+                iMassiveY[m] = iPositionY[iMassive[m]];
+                iMassiveZ[m] = iPositionZ[iMassive[m]];
+                iMassiveMass[m] = iMass[iMassive[m]];
+            }
+            iUniversal.resize(count);
+            for (std::size_t i = 0u; i < count; ++i)
+            {
+                auto const x = iPositionX[i];
+                auto const y = iPositionY[i];
+                auto const z = iPositionZ[i];
+                float sx = 0.0f;
+                float sy = 0.0f;
+                float sz = 0.0f;
+                for (std::size_t j = 0u; j < massive; ++j)
+                {
+                    auto const dx = iMassiveX[j] - x;
+                    auto const dy = iMassiveY[j] - y;
+                    auto const dz = iMassiveZ[j] - z;
+                    auto const r2 = dx * dx + dy * dy + dz * dz;
+                    auto const s = r2 > 0.0f ? iMassiveMass[j] / (r2 * std::sqrt(r2)) : 0.0f;
+                    sx += dx * s;
+                    sy += dy * s;
+                    sz += dz * s;
+                }
+                iUniversal[i] = vec3f{ sx, sy, sz } * aGravitation.constant;
+            }
+        }
+
+        // massless bodies are not subject to gravity
+        for (std::size_t i = 0u; i < count; ++i)
+        {
+            auto const subject = iMass[i] != 0.0f ? 1.0f : 0.0f;
+            iAccelerationX[i] = aGravitation.uniform[0] * subject;
+            iAccelerationY[i] = aGravitation.uniform[1] * subject;
+            iAccelerationZ[i] = aGravitation.uniform[2] * subject;
+        }
+        if (aGravitation.universal)
+            for (std::size_t i = 0u; i < count; ++i)
+            {
+                auto const subject = iMass[i] != 0.0f ? 1.0f : 0.0f;
+                iAccelerationX[i] += iUniversal[i][0] * subject;
+                iAccelerationY[i] += iUniversal[i][1] * subject;
+                iAccelerationZ[i] += iUniversal[i][2] * subject;
+            }
+    }
+
+    void rigid_body_integrator::apply_thrust()
+    {
+        for (std::size_t t = 0u; t < iThrusting.size(); ++t)
+        {
+            auto const i = iThrusting[t];
+            auto const thrust = rotation_matrix(vec3f{ iAngleX[i], iAngleY[i], iAngleZ[i] }) * iLocalAcceleration[t];
+            iAccelerationX[i] += thrust[0];
+            iAccelerationY[i] += thrust[1];
+            iAccelerationZ[i] += thrust[2];
+        }
+    }
+}
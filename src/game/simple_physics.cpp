@@ -40,11 +40,15 @@ namespace neogfx::game
             ecs().register_shared_component<physics>();
         if (ecs().shared_component<physics>().component_data().empty())
             ecs().populate_shared<physics>("Standard Universe", physics{ 6.67408e-11f });
+        if (iChainedSystems)
+            add_frame_barrier(ecs());
         start_thread_if();
     }
 
     simple_physics::~simple_physics()
     {
+        if (iChainedSystems)
+            remove_frame_barrier(ecs());
     }
 
     const system_id& simple_physics::id() const
@@ -66,14 +70,31 @@ namespace neogfx::game
 
         start_update();
 
-        std::optional<scoped_component_lock<entity_info, mesh_render_cache, box_collider, box_collider_2d, mesh_filter, rigid_body>> lock{ ecs() };
+        // without a frame scheduler the physics step is the frame barrier for deferred entity creation/destruction
+        if (iChainedSystems)
+            apply_deferred(ecs());
+
+        // when chained the collider and animation updates run inside the physics step so their components are locked too
+        bool const didWork = iChainedSystems ?
+            integrate<entity_info, mesh_render_cache, box_collider, box_collider_2d, mesh_filter, rigid_body>() :
+            integrate<entity_info, mesh_render_cache, rigid_body>();
+
+        end_update();
+
+        return didWork;
+    }
+
+    template <typename... Components>
+    bool simple_physics::integrate()
+    {
+        std::optional<scoped_component_lock<Components...>> lock{ ecs() };
 
         auto const now = ecs().system<game::time>().system_time();
         auto& worldClock = ecs().shared_component<game::clock>()[0];
         auto const& physicalConstants = ecs().shared_component<physics>()[0];
         auto const uniformGravity = physicalConstants.uniformGravity != std::nullopt ?
             *physicalConstants.uniformGravity : vec3f{};
-        auto& rigidBodies = ecs().component<rigid_body>();
+        auto* const collisionDetector = ecs().system_instantiated<collision_detector>() ? &ecs().system<collision_detector>() : nullptr;
         bool didWork = false;
         auto currentTimestep = worldClock.timestep;
         auto nextTime = worldClock.time + currentTimestep;
@@ -89,55 +110,55 @@ namespace neogfx::game
             }
             start_update(1);
             didWork = true;
-            ecs().system<game_world>().ApplyingPhysics(worldClock.time);
+            auto& world = ecs().system<game_world>();
+            world.ApplyingPhysics(worldClock.time);
             start_update(2);
-            bool useUniversalGravitation = (universal_gravitation_enabled() && physicalConstants.gravitationalConstant != 0.0);
-            if (useUniversalGravitation)
-                rigidBodies.sort([](const rigid_body& lhs, const rigid_body& rhs) { return lhs.mass > rhs.mass; });
-            auto firstMassless = useUniversalGravitation ?
-                std::find_if(rigidBodies.component_data().begin(), rigidBodies.component_data().end(), [](const rigid_body& body) { return body.mass == 0.0; }) :
-                rigidBodies.component_data().begin();
-            for (auto& rigidBody1 : rigidBodies.component_data())
+            rigid_body_integrator::gravitation const gravitation
+            {
+                uniformGravity,
+                universal_gravitation_enabled() && physicalConstants.gravitationalConstant != 0.0,
+                physicalConstants.gravitationalConstant,
+                world.gravitation_solver(),
+                world.multithreaded_gravitation()
+            };
+            iIntegrator.barnes_hut().set_theta(world.barnes_hut_theta());
+            iIntegrator.gather(ecs());
+            // GCSE-level physics (Newtonian) going on here... :)
+            // v = u + at
+            // F = ma; a = F/m
+            auto batchTime = worldClock.time;
+            for (std::uint32_t step = 0u; step < iMaximumBatchSteps; ++step)
             {
-                auto entity1 = rigidBodies.entity(rigidBody1);
-                auto const& entity1Info = ecs().component<entity_info>().entity_record(entity1);
-                if (entity1Info.destroyed)
-                    continue; // todo: add support for skip iterators
-                vec3f totalForce = rigidBody1.mass * uniformGravity;
-                if (useUniversalGravitation)
+                if (step != 0u)
                 {
-                    for (auto iterRigidBody2 = rigidBodies.component_data().begin(); iterRigidBody2 != firstMassless; ++iterRigidBody2)
-                    {
-                        auto& rigidBody2 = *iterRigidBody2;
-                        auto entity2 = rigidBodies.entity(rigidBody2);
-                        auto const& entity2Info = ecs().component<entity_info>().entity_record(entity2);
-                        if (entity2Info.destroyed)
-                            continue; // todo: add support for skip iterators
-                        vec3f distance = rigidBody1.position - rigidBody2.position;
-                        if (distance.magnitude() > 0.0f) // avoid division by zero or rigidBody1 == rigidBody2
-                            totalForce += -physicalConstants.gravitationalConstant * rigidBody2.mass * rigidBody1.mass * distance / std::pow(distance.magnitude(), 3.0f);
-                    }
+                    if (nextTime > now)
+                        break;
+                    shared_component_scoped_lock<game::clock> lockClock{ ecs() };
+                    worldClock.time = nextTime;
+                    currentTimestep = std::min(static_cast<i64>(currentTimestep * worldClock.timestepGrowth), std::max(worldClock.timestep, worldClock.maximumTimestep));
+                    nextTime += currentTimestep;
                 }
-                // GCSE-level physics (Newtonian) going on here... :)
-                // v = u + at
-                // F = ma; a = F/m
-                auto v0 = rigidBody1.velocity;
-                auto p0 = rigidBody1.position;
-                auto a0 = rigidBody1.angle;
-                auto elapsedTime = static_cast<float>(from_step_time(nextTime - worldClock.time));
-                rigidBody1.velocity = v0 + ((rigidBody1.mass == 0.0f ? vec3f{} : totalForce / rigidBody1.mass) + (rotation_matrix(rigidBody1.angle) * rigidBody1.acceleration)).scale(vec3f{ elapsedTime, elapsedTime, elapsedTime });
-                rigidBody1.position = rigidBody1.position + vec3f{ 1.0f, 1.0f, 1.0f }.scale(elapsedTime * (v0 + rigidBody1.velocity) / 2.0f);
-                rigidBody1.angle = (rigidBody1.angle + rigidBody1.spin * elapsedTime) % (2.0f * boost::math::constants::pi<float>());
-                if (p0 != rigidBody1.position || a0 != rigidBody1.angle)
-                    set_render_cache_dirty(ecs(), entity1);
+                iIntegrator.step(static_cast<float>(from_step_time(nextTime - worldClock.time)), gravitation);
+                batchTime = worldClock.time;
+            }
+            iMoved.clear();
+            iIntegrator.scatter(ecs(), iMoved);
+            for (auto entity : iMoved)
+            {
+                set_render_cache_dirty(ecs(), entity);
+                if (collisionDetector)
+                    collisionDetector->set_collider_dirty(entity);
             }
             end_update(2);
-            if (ecs().system_instantiated<collision_detector>() && !ecs().system<collision_detector>().paused())
-                ecs().system<collision_detector>().run_cycle(collision_detection_cycle::UpdateColliders);
-            if (ecs().system_instantiated<animator>() && ecs().system<animator>().can_apply())
-                ecs().system<animator>().apply();
-            ecs().system<game::time>().apply();
-            ecs().system<game_world>().PhysicsApplied(worldClock.time);
+            if (iChainedSystems)
+            {
+                if (collisionDetector && !collisionDetector->paused())
+                    collisionDetector->run_cycle(collision_detection_cycle::UpdateColliders);
+                if (ecs().system_instantiated<animator>() && ecs().system<animator>().can_apply())
+                    ecs().system<animator>().apply();
+                ecs().system<game::time>().apply();
+            }
+            world.PhysicsApplied(batchTime);
             shared_component_scoped_lock<game::clock> lockClock{ ecs() };
             worldClock.time = nextTime;
             currentTimestep = std::min(static_cast<i64>(currentTimestep * worldClock.timestepGrowth), std::max(worldClock.timestep, worldClock.maximumTimestep));
@@ -147,8 +168,6 @@ namespace neogfx::game
 
         lock.reset();
 
-        end_update();
-
         return didWork;
     }
 
@@ -171,4 +190,30 @@ namespace neogfx::game
     {
         iYieldTime = aTime;
     }
+
+    bool simple_physics::chained_systems() const
+    {
+        return iChainedSystems;
+    }
+
+    void simple_physics::set_chained_systems(bool aChainedSystems)
+    {
+        if (iChainedSystems == aChainedSystems)
+            return;
+        if (aChainedSystems)
+            add_frame_barrier(ecs());
+        else
+            remove_frame_barrier(ecs());
+        iChainedSystems = aChainedSystems;
+    }
+
+    std::uint32_t simple_physics::maximum_batch_steps() const
+    {
+        return iMaximumBatchSteps;
+    }
+
+    void simple_physics::set_maximum_batch_steps(std::uint32_t aSteps)
+    {
+        iMaximumBatchSteps = std::max(aSteps, 1u);
+    }
 }
\ No newline at end of file
@@ -0,0 +1,159 @@
+// sprite_packer.cpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2024 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <neogfx/neogfx.hpp>
+
+#include <neogfx/gfx/i_texture_manager.hpp>
+#include <neogfx/game/ecs_helpers.hpp>
+#include <neogfx/game/mesh_renderer.hpp>
+#include <neogfx/game/mesh_render_cache.hpp>
+#include <neogfx/game/sprite_packer.hpp>
+
+namespace neogfx::game
+{
+    sprite_packer::sprite_packer(size const& aPageSize) :
+        iPageSize{ aPageSize }
+    {
+    }
+
+    sprite_packer::~sprite_packer()
+    {
+    }
+
+    std::size_t sprite_packer::pack(i_ecs& aEcs)
+    {
+        std::size_t result = 0u;
+        thread_local std::unordered_set<texture_id> inUse;
+        inUse.clear();
+        bool sharedTexturesPacked = false;
+        if (aEcs.shared_component_registered<game::texture>())
+            for (auto& sharedTexture : aEcs.shared_component<game::texture>().component_data())
+            {
+                if (repack(sharedTexture.second))
+                {
+                    ++result;
+                    sharedTexturesPacked = true;
+                }
+                inUse.insert(sharedTexture.second.id.cookie());
+            }
+        if (!aEcs.component_instantiated<mesh_renderer>())
+        {
+            release_unused(inUse);
+            return result;
+        }
+
+        scoped_component_lock<mesh_renderer, mesh_render_cache> lock{ aEcs };
+        auto& renderers = aEcs.component<mesh_renderer>();
+        auto* const cache = aEcs.component_instantiated<mesh_render_cache>() ? &aEcs.component<mesh_render_cache>() : nullptr;
+        for (auto entity : renderers.entities())
+        {
+            auto& renderer = renderers.entity_record_no_lock(entity);
+            bool changed = false;
+            auto repack_material = [&](game::material& aMaterial)
+            {
+                if (aMaterial.texture && repack(*aMaterial.texture))
+                {
+                    ++result;
+                    changed = true;
+                }
+                if (aMaterial.texture)
+                    inUse.insert(aMaterial.texture->id.cookie());
+                if (aMaterial.sharedTexture && sharedTexturesPacked)
+                    changed = true;
+            };
+            repack_material(renderer.material);
+            for (auto& patch : renderer.patches)
+                repack_material(patch.material);
+            // texture coordinates are fixed up when vertices are generated so cached vertices must be regenerated
+            if (changed && cache)
+                set_render_cache_dirty_no_lock(*cache, entity);
+        }
+        release_unused(inUse);
+        return result;
+    }
+
+    void sprite_packer::clear()
+    {
+        for (auto& p : iPacked)
+            iAtlas->destroy_sub_texture(iAtlas->sub_texture(p.second.texture.id.cookie()));
+        iPacked.clear();
+        iUnpackable.clear();
+        iAtlas = nullptr;
+    }
+
+    std::size_t sprite_packer::packed_count() const
+    {
+        return iPacked.size();
+    }
+
+    std::uint32_t sprite_packer::page_count() const
+    {
+        return iAtlas ? iAtlas->page_count() : 0u;
+    }
+
+    void sprite_packer::release_unused(std::unordered_set<texture_id> const& aInUse)
+    {
+        // copies no material refers to any more give their atlas space back and stop keeping their source alive
+        for (auto p = iPacked.begin(); p != iPacked.end();)
+        {
+            auto const copyId = p->second.texture.id.cookie();
+            if (aInUse.find(copyId) != aInUse.end())
+            {
+                ++p;
+                continue;
+            }
+            iAtlas->destroy_sub_texture(iAtlas->sub_texture(copyId));
+            p = iPacked.erase(p);
+        }
+    }
+
+    bool sprite_packer::repack(game::texture& aTexture)
+    {
+        // sub-textures are already on an atlas page
+        if (aTexture.type != texture_type::Texture)
+            return false;
+        auto const id = aTexture.id.cookie();
+        auto existing = iPacked.find(id);
+        if (existing != iPacked.end())
+        {
+            auto const sampling = aTexture.sampling;
+            aTexture = existing->second.texture;
+            aTexture.sampling = sampling;
+            return true;
+        }
+        if (iUnpackable.find(id) != iUnpackable.end())
+            return false;
+        auto source = service<i_texture_manager>().find_texture(id);
+        if (source->is_render_target() || source->is_empty() ||
+            source->sampling() == texture_sampling::Multisample || source->sampling() == texture_sampling::Data ||
+            source->extents().cx > iPageSize.cx / 2.0 || source->extents().cy > iPageSize.cy / 2.0)
+        {
+            iUnpackable.insert(id);
+            return false;
+        }
+        if (!iAtlas)
+            iAtlas = service<i_texture_manager>().create_texture_atlas(iPageSize);
+        auto& copy = iAtlas->create_sub_texture(source->extents(), source->dpi_scale_factor(), source->sampling(), source->data_format());
+        source->copy_pixels(rect{ point{}, source->extents() }, copy.atlas_texture(), copy.atlas_location().top_left());
+        auto const sampling = aTexture.sampling;
+        aTexture = iPacked.emplace(id, packed{ source, to_ecs_component(copy) }).first->second.texture;
+        aTexture.sampling = sampling;
+        return true;
+    }
+}
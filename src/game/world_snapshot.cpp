@@ -0,0 +1,266 @@
+// world_snapshot.cpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2024 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <neogfx/neogfx.hpp>
+
+#include <cstring>
+#include <algorithm>
+#include <type_traits>
+#include <neogfx/game/ecs.hpp>
+#include <neogfx/game/game_world.hpp>
+#include <neogfx/game/simple_physics.hpp>
+#include <neogfx/game/collision_detector.hpp>
+#include <neogfx/game/mesh_render_cache.hpp>
+#include <neogfx/game/world_snapshot.hpp>
+
+namespace neogfx::game
+{
+    namespace
+    {
+        template <typename T>
+        bool same(T const* aLhs, T const* aRhs, std::size_t aCount)
+        {
+            if constexpr (std::is_trivially_copyable_v<T>)
+                return std::memcmp(aLhs, aRhs, aCount * sizeof(T)) == 0;
+            else
+                return false;
+        }
+
+        template <typename T>
+        void assign(std::vector<T>& aDestination, T const* aSource, std::size_t aCount)
+        {
+            aDestination.resize(aCount);
+            if constexpr (std::is_trivially_copyable_v<T>)
+                std::memcpy(aDestination.data(), aSource, aCount * sizeof(T));
+            else
+                std::copy(aSource, aSource + aCount, aDestination.begin());
+        }
+
+        template <typename Data>
+        void capture(i_ecs& aEcs, component_snapshot<Data>& aSnapshot, component_snapshot<Data> const* aPrevious, std::size_t& aUniqueBytes)
+        {
+            typedef component_snapshot<Data> snapshot_type;
+            aSnapshot.present = aEcs.component_instantiated<Data>();
+            if (!aSnapshot.present)
+                return;
+            auto const& component = aEcs.component<Data>();
+            // entities() is parallel to component_data()
+            auto const& entities = component.entities();
+            auto const& records = component.component_data();
+            aSnapshot.size = records.size();
+            auto const chunkCount = (aSnapshot.size + snapshot_type::ChunkSize - 1u) / snapshot_type::ChunkSize;
+            aSnapshot.chunks.resize(chunkCount);
+            for (std::size_t c = 0u; c < chunkCount; ++c)
+            {
+                auto const first = c * snapshot_type::ChunkSize;
+                auto const count = std::min(snapshot_type::ChunkSize, aSnapshot.size - first);
+                if (aPrevious && aPrevious->present && c < aPrevious->chunks.size())
+                {
+                    auto const& previous = *aPrevious->chunks[c];
+                    if (previous.records.size() == count &&
+                        same(previous.entities.data(), &entities[first], count) &&
+                        same(previous.records.data(), &records[first], count))
+                    {
+                        aSnapshot.chunks[c] = aPrevious->chunks[c];
+                        continue;
+                    }
+                }
+                auto newChunk = std::make_shared<typename snapshot_type::chunk>();
+                assign(newChunk->entities, &entities[first], count);
+                assign(newChunk->records, &records[first], count);
+                aSnapshot.chunks[c] = newChunk;
+                aUniqueBytes += count * (sizeof(entity_id) + sizeof(Data));
+            }
+        }
+
+        template <typename Data>
+        void restore(i_ecs& aEcs, component_snapshot<Data> const& aSnapshot)
+        {
+            typedef component_snapshot<Data> snapshot_type;
+            if (!aSnapshot.present || !aEcs.component_instantiated<Data>())
+                return;
+            auto& component = aEcs.component<Data>();
+            auto const& entities = component.entities();
+            auto& records = component.component_data();
+            bool unchangedLayout = records.size() == aSnapshot.size;
+            for (std::size_t c = 0u; unchangedLayout && c < aSnapshot.chunks.size(); ++c)
+                unchangedLayout = std::equal(aSnapshot.chunks[c]->entities.begin(), aSnapshot.chunks[c]->entities.end(),
+                    std::next(entities.begin(), c * snapshot_type::ChunkSize));
+            for (std::size_t c = 0u; c < aSnapshot.chunks.size(); ++c)
+            {
+                auto const& chunk = *aSnapshot.chunks[c];
+                if (unchangedLayout)
+                {
+                    // same entities in the same slots: copy the records back wholesale
+                    auto* const destination = &records[c * snapshot_type::ChunkSize];
+                    if constexpr (std::is_trivially_copyable_v<Data>)
+                        std::memcpy(destination, chunk.records.data(), chunk.records.size() * sizeof(Data));
+                    else
+                        std::copy(chunk.records.begin(), chunk.records.end(), destination);
+                    continue;
+                }
+                for (std::size_t r = 0u; r < chunk.records.size(); ++r)
+                    if (chunk.entities[r] != null_entity && component.has_entity_record_no_lock(chunk.entities[r]))
+                        component.entity_record_no_lock(chunk.entities[r]) = chunk.records[r];
+            }
+        }
+    }
+
+    step_time world_snapshot::time() const
+    {
+        return iClock.time;
+    }
+
+    std::size_t world_snapshot::unique_bytes() const
+    {
+        return iUniqueBytes;
+    }
+
+    snapshot_history::snapshot_history(i_ecs& aEcs, std::size_t aCapacity) :
+        iEcs{ aEcs },
+        iCapacity{ std::max<std::size_t>(aCapacity, 1u) }
+    {
+    }
+
+    snapshot_history::~snapshot_history()
+    {
+    }
+
+    std::size_t snapshot_history::capacity() const
+    {
+        return iCapacity;
+    }
+
+    void snapshot_history::set_capacity(std::size_t aCapacity)
+    {
+        iCapacity = std::max<std::size_t>(aCapacity, 1u);
+        while (iSnapshots.size() > iCapacity)
+            iSnapshots.pop_front();
+    }
+
+    std::size_t snapshot_history::size() const
+    {
+        return iSnapshots.size();
+    }
+
+    void snapshot_history::clear()
+    {
+        iSnapshots.clear();
+    }
+
+    world_snapshot const& snapshot_history::latest() const
+    {
+        return ticks_ago(0u);
+    }
+
+    world_snapshot const& snapshot_history::ticks_ago(std::size_t aTicks) const
+    {
+        if (aTicks >= iSnapshots.size())
+            throw no_snapshot();
+        return iSnapshots[iSnapshots.size() - 1u - aTicks];
+    }
+
+    bool snapshot_history::recording() const
+    {
+        return iRecording;
+    }
+
+    void snapshot_history::start_recording()
+    {
+        if (recording())
+            return;
+        iRecording = true;
+        // PhysicsApplied is triggered before the world clock is advanced so the rigid bodies are a tick ahead of
+        // the clock at that point; record at the start of each tick instead, when the two agree.
+        iSink += !iEcs.system<game_world>().ApplyingPhysics([this](step_time)
+        {
+            take();
+        });
+        if (iEcs.system_instantiated<simple_physics>())
+        {
+            auto& physics = iEcs.system<simple_physics>();
+            iSavedBatchSteps = physics.maximum_batch_steps();
+            physics.set_maximum_batch_steps(1u);
+        }
+    }
+
+    void snapshot_history::stop_recording()
+    {
+        if (!recording())
+            return;
+        iRecording = false;
+        iSink.clear();
+        if (iSavedBatchSteps && iEcs.system_instantiated<simple_physics>())
+            iEcs.system<simple_physics>().set_maximum_batch_steps(*iSavedBatchSteps);
+        iSavedBatchSteps = std::nullopt;
+    }
+
+    world_snapshot const& snapshot_history::take()
+    {
+        scoped_component_lock<entity_info, rigid_body, box_collider, box_collider_2d, animation_filter> lock{ iEcs };
+        world_snapshot const* const previous = iSnapshots.empty() ? nullptr : &iSnapshots.back();
+        world_snapshot next;
+        {
+            shared_component_scoped_lock<game::clock> lockClock{ iEcs };
+            next.iClock = iEcs.shared_component<game::clock>()[0];
+        }
+        std::apply([&](auto&... aComponents)
+        {
+            (capture(iEcs, aComponents, previous ? &std::get<std::decay_t<decltype(aComponents)>>(previous->iComponents) : nullptr, next.iUniqueBytes), ...);
+        }, next.iComponents);
+        iSnapshots.push_back(std::move(next));
+        while (iSnapshots.size() > iCapacity)
+            iSnapshots.pop_front();
+        return iSnapshots.back();
+    }
+
+    void snapshot_history::restore(world_snapshot const& aSnapshot)
+    {
+        {
+            scoped_component_lock<entity_info, rigid_body, box_collider, box_collider_2d, animation_filter, mesh_render_cache> lock{ iEcs };
+            std::apply([&](auto const&... aComponents)
+            {
+                (game::restore(iEcs, aComponents), ...);
+            }, aSnapshot.iComponents);
+            if (iEcs.component_instantiated<mesh_render_cache>())
+                for (auto& cache : iEcs.component<mesh_render_cache>().component_data())
+                    if (cache.state == cache_state::Clean)
+                        cache.state = cache_state::Dirty;
+            shared_component_scoped_lock<game::clock> lockClock{ iEcs };
+            iEcs.shared_component<game::clock>()[0] = aSnapshot.iClock;
+        }
+        if (iEcs.system_instantiated<collision_detector>())
+            iEcs.system<collision_detector>().set_all_colliders_dirty();
+    }
+
+    void snapshot_history::rollback(std::size_t aTicks)
+    {
+        auto const& target = ticks_ago(aTicks);
+        restore(target);
+        // when recording the next tick records the restored state again
+        iSnapshots.erase(std::next(iSnapshots.begin(), iSnapshots.size() - aTicks - (recording() ? 1u : 0u)), iSnapshots.end());
+    }
+
+    bool snapshot_history::resimulate()
+    {
+        if (!iEcs.system_instantiated<simple_physics>() || !iEcs.system<simple_physics>().can_apply())
+            return false;
+        return iEcs.system<simple_physics>().apply();
+    }
+}
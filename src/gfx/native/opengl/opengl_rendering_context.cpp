@@ -1671,6 +1671,47 @@ namespace neogfx
                     drawables[meshRenderer.layer].back().transformation = transformation;
                 }
             }
+            // drawables keep their order within a layer except that each run of consecutive order independent ones is
+            // grouped by texture (atlas page), taking patch materials into account, so that it batches; the sort is
+            // stable so drawables sharing a texture keep their order
+            auto const texture_key = [](game::mesh_renderer const& aMeshRenderer) -> intptr_t
+            {
+                if (patch_drawable::has_texture(aMeshRenderer, aMeshRenderer.material))
+                    return service<i_texture_manager>().find_texture(patch_drawable::texture(aMeshRenderer, aMeshRenderer.material).id.cookie())->native_handle();
+                for (auto const& patch : aMeshRenderer.patches)
+                    if (patch_drawable::has_texture(aMeshRenderer, patch.material))
+                        return service<i_texture_manager>().find_texture(patch_drawable::texture(aMeshRenderer, patch.material).id.cookie())->native_handle();
+                return 0;
+            };
+            thread_local std::vector<std::pair<intptr_t, std::size_t>> order;
+            thread_local std::vector<mesh_drawable> sorted;
+            for (auto& layerDrawables : drawables)
+            {
+                bool regrouped = false;
+                order.clear();
+                for (std::size_t index = 0u; index < layerDrawables.size();)
+                {
+                    if (!layerDrawables[index].renderer->orderIndependent)
+                    {
+                        order.emplace_back(0, index++);
+                        continue;
+                    }
+                    auto const run = order.size();
+                    for (; index < layerDrawables.size() && layerDrawables[index].renderer->orderIndependent; ++index)
+                        order.emplace_back(texture_key(*layerDrawables[index].renderer), index);
+                    if (!std::is_sorted(std::next(order.begin(), run), order.end()))
+                    {
+                        std::stable_sort(std::next(order.begin(), run), order.end(), [](auto const& lhs, auto const& rhs) { return lhs.first < rhs.first; });
+                        regrouped = true;
+                    }
+                }
+                if (!regrouped)
+                    continue;
+                sorted.clear();
+                for (auto const& o : order)
+                    sorted.push_back(layerDrawables[o.second]);
+                layerDrawables.swap(sorted);
+            }
         }
         if (!drawables[aLayer].empty())
             draw_meshes(lock, dynamic_cast<i_vertex_provider&>(aEcs), &*drawables[aLayer].begin(), &*drawables[aLayer].begin() + drawables[aLayer].size(), aTransformation);
@@ -1985,6 +2026,7 @@ namespace neogfx
             case draw_glyphs_stage::GlyphFinal:
                 {
                     bool updateGlyphShader = true;
+                    auto const& glyphAtlas = rendering_engine().font_manager().glyph_atlas();
 
                     for (auto const& drawOp : std::ranges::subrange(aBegin, aEnd))
                     {
@@ -2003,6 +2045,8 @@ namespace neogfx
                             rendering_engine().default_shader_program().glyph_shader().set_first_glyph(*this, glyphText, glyphChar);
                         }
 
+                        glyphAtlas.touch(theGlyph.texture().atlas_id());
+
                         bool const subpixelRender = subpixel(glyphChar) && theGlyph.subpixel();
 
                         if (stage == draw_glyphs_stage::GlyphOutline)
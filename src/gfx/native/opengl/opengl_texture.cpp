@@ -493,6 +493,57 @@ namespace neogfx
         }
     }
 
+    template <typename T>
+    void opengl_texture<T>::copy_pixels(const rect& aSourceRect, i_texture& aDestination, const point& aDestinationPosition) const
+    {
+        auto destination = dynamic_cast<self_type*>(&aDestination.native_texture());
+        if (destination == nullptr || destination->data_format() != data_format())
+            throw incompatible_texture();
+        if (sampling() == texture_sampling::Multisample || destination->sampling() == texture_sampling::Multisample)
+            throw unsupported_sampling_type_for_function();
+        auto const adjustedRect = aSourceRect + (sampling() != texture_sampling::Data ? point{ 1.0, 1.0 } : point{ 0.0, 0.0 });
+        auto adjustedPosition = aDestinationPosition + (destination->sampling() != texture_sampling::Data ? point{ 1.0, 1.0 } : point{ 0.0, 0.0 });
+        if (aDestination.type() == texture_type::SubTexture)
+            adjustedPosition += aDestination.as_sub_texture().atlas_location().position();
+        // glCopyImageSubData is core from OpenGL 4.3 only; older contexts read the source through a framebuffer
+        static bool const copyImageSupported = (GLEW_VERSION_4_3 || GLEW_ARB_copy_image);
+        if (copyImageSupported)
+        {
+            glCheck(glCopyImageSubData(
+                iHandle, to_gl_enum(sampling()), 0, static_cast<GLint>(adjustedRect.x), static_cast<GLint>(adjustedRect.y), 0,
+                destination->iHandle, to_gl_enum(destination->sampling()), 0, static_cast<GLint>(adjustedPosition.x), static_cast<GLint>(adjustedPosition.y), 0,
+                static_cast<GLsizei>(adjustedRect.cx), static_cast<GLsizei>(adjustedRect.cy), 1));
+        }
+        else
+        {
+            GLint previousReadFramebuffer = 0;
+            GLint previousReadBuffer = 0;
+            glCheck(glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previousReadFramebuffer));
+            glCheck(glGetIntegerv(GL_READ_BUFFER, &previousReadBuffer));
+            GLuint readFramebuffer = 0;
+            glCheck(glGenFramebuffers(1, &readFramebuffer));
+            glCheck(glBindFramebuffer(GL_READ_FRAMEBUFFER, readFramebuffer));
+            glCheck(glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, to_gl_enum(sampling()), iHandle, 0));
+            glCheck(glReadBuffer(GL_COLOR_ATTACHMENT0));
+            destination->bind(1);
+            glCheck(glCopyTexSubImage2D(to_gl_enum(destination->sampling()), 0,
+                static_cast<GLint>(adjustedPosition.x), static_cast<GLint>(adjustedPosition.y),
+                static_cast<GLint>(adjustedRect.x), static_cast<GLint>(adjustedRect.y),
+                static_cast<GLsizei>(adjustedRect.cx), static_cast<GLsizei>(adjustedRect.cy)));
+            destination->unbind();
+            glCheck(glBindFramebuffer(GL_READ_FRAMEBUFFER, static_cast<GLuint>(previousReadFramebuffer)));
+            glCheck(glReadBuffer(static_cast<GLenum>(previousReadBuffer)));
+            glCheck(glDeleteFramebuffers(1, &readFramebuffer));
+        }
+        if (destination->sampling() == texture_sampling::NormalMipmap)
+        {
+            destination->bind(1);
+            glCheck(glGenerateMipmap(to_gl_enum(destination->sampling())));
+            destination->unbind();
+        }
+        destination->iPixelData.clear();
+    }
+
     template <typename T>
     void* opengl_texture<T>::handle() const
     {
@@ -73,6 +73,7 @@ namespace neogfx
         void set_pixels(const i_image& aImage, const rect& aImagePart) final;
         void set_pixel(const point& aPosition, const color& aColor) final;
         color get_pixel(const point& aPosition) const final;
+        void copy_pixels(const rect& aSourceRect, i_texture& aDestination, const point& aDestinationPosition) const final;
     public:
         void* handle() const final;
         bool is_resident() const final;
@@ -443,6 +443,12 @@ namespace neogfx
         }
     }
 
+    template <typename T>
+    void vulkan_texture<T>::copy_pixels(const rect& aSourceRect, i_texture& aDestination, const point& aDestinationPosition) const
+    {
+        TODO;
+    }
+
     template <typename T>
     void* vulkan_texture<T>::handle() const
     {
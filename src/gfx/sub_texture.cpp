@@ -229,6 +229,13 @@ namespace neogfx
         return native_texture().get_pixel(aPosition + atlas_location().position());
     }
 
+    void sub_texture::copy_pixels(rect const& aSourceRect, i_texture& aDestination, point const& aDestinationPosition) const
+    {
+        if (is_empty())
+            throw texture_empty();
+        native_texture().copy_pixels(aSourceRect + atlas_location().position(), aDestination, aDestinationPosition);
+    }
+
     i_vector<texture_line_segment> const& sub_texture::intersection(texture_line_segment const& aLine, rect const& aBoundingBox, vec2 const& aSampleSize, scalar aTolerance) const
     {
         auto existingResult = iIntersectionResultCache.find(std::make_tuple(aLine, aBoundingBox, aSampleSize, aTolerance));
@@ -284,4 +291,17 @@ namespace neogfx
     {
         return iAtlasLocation;
     }
+
+    void sub_texture::relocate(i_texture& aAtlasTexture, rect const& aAtlasLocation)
+    {
+        if (&aAtlasTexture != iAtlasTexture)
+        {
+            service<i_texture_manager>().add_ref(aAtlasTexture.id());
+            service<i_texture_manager>().release(atlas_texture().id());
+        }
+        iAtlasTexture = &aAtlasTexture;
+        iAtlasLocation = aAtlasLocation;
+        iStorageExtents = aAtlasTexture.storage_extents();
+        iIntersectionResultCache.clear();
+    }
 }
\ No newline at end of file
@@ -528,6 +528,18 @@ namespace neogfx
         return iInstance->fallback_font();
     }
 
+    bool font::has_fallback(char32_t aCodePoint) const
+    {
+        return service<i_font_manager>().has_fallback_font(native_font_face(), aCodePoint);
+    }
+
+    font font::fallback(char32_t aCodePoint) const
+    {
+        if (!has_fallback(aCodePoint))
+            throw no_fallback_font();
+        return font{ service<i_font_manager>().create_fallback_font(native_font_face(), aCodePoint) };
+    }
+
     i_string const& font::family_name() const
     {
         return native_font_face().family_name();
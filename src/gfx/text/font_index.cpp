@@ -0,0 +1,269 @@
+// font_index.cpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2024 Leigh Johnston.  All Rights Reserved.
+
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <neogfx/neogfx.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <algorithm>
+#include <unordered_map>
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include <neolib/file/file.hpp>
+
+#include <neogfx/gfx/text/font_index.hpp>
+#include "native/native_font.hpp"
+
+namespace neogfx
+{
+    namespace
+    {
+        constexpr char IndexMagic[8] = { 'N', 'G', 'F', 'O', 'N', 'T', 'I', 'X' };
+        constexpr std::uint32_t IndexVersion = 1u;
+        constexpr std::uint32_t MaxFaces = 0x100000u;
+        constexpr std::uint32_t MaxRanges = 0x110000u;
+
+        template <typename T>
+        void write_value(std::ostream& aStream, T const& aValue)
+        {
+            aStream.write(reinterpret_cast<char const*>(&aValue), sizeof(T));
+        }
+
+        void write_string(std::ostream& aStream, std::string const& aValue)
+        {
+            write_value(aStream, static_cast<std::uint32_t>(aValue.size()));
+            aStream.write(aValue.data(), aValue.size());
+        }
+
+        template <typename T>
+        bool read_value(std::istream& aStream, T& aValue)
+        {
+            return !!aStream.read(reinterpret_cast<char*>(&aValue), sizeof(T));
+        }
+
+        bool read_string(std::istream& aStream, std::string& aValue)
+        {
+            std::uint32_t length = 0u;
+            if (!read_value(aStream, length) || length > 0x10000u)
+                return false;
+            aValue.resize(length);
+            return !!aStream.read(aValue.data(), length);
+        }
+
+        font_index::coverage_ranges face_coverage(FT_Face aFace)
+        {
+            font_index::coverage_ranges result;
+            FT_UInt glyphIndex = 0;
+            FT_ULong codePoint = FT_Get_First_Char(aFace, &glyphIndex);
+            while (glyphIndex != 0)
+            {
+                auto const cp = static_cast<char32_t>(codePoint);
+                if (!result.empty() && result.back().second + 1 == cp)
+                    result.back().second = cp;
+                else
+                    result.emplace_back(cp, cp);
+                codePoint = FT_Get_Next_Char(aFace, codePoint, &glyphIndex);
+            }
+            return result;
+        }
+
+        bool is_font_file(FT_Library aFontLib, std::filesystem::path const& aPath)
+        {
+            FT_Face face = nullptr;
+            if (FT_New_Face(aFontLib, aPath.string().c_str(), 0, &face) != 0)
+                return false;
+            FT_Done_Face(face);
+            return true;
+        }
+
+        void scan_file(FT_Library aFontLib, std::filesystem::path const& aPath, std::uint64_t aFileSize, std::int64_t aLastWriteTime, font_index::face_list& aFaces)
+        {
+            auto const path = aPath.string();
+            FT_Long faceCount = 1;
+            for (FT_Long faceIndex = 0; faceIndex < faceCount; ++faceIndex)
+            {
+                FT_Face face = nullptr;
+                if (FT_New_Face(aFontLib, path.c_str(), faceIndex, &face) != 0)
+                    return;
+                if (faceIndex == 0)
+                    faceCount = face->num_faces;
+                if (face->family_name != nullptr)
+                    aFaces.push_back(font_index::face{
+                        path,
+                        aFileSize,
+                        aLastWriteTime,
+                        static_cast<std::int32_t>(faceIndex),
+                        face->family_name,
+                        face->style_name != nullptr ? face->style_name : "",
+                        native_face_style(face),
+                        face_coverage(face) });
+                FT_Done_Face(face);
+            }
+        }
+    }
+
+    bool font_index::face::covers(char32_t aCodePoint) const
+    {
+        auto const range = std::lower_bound(coverage.begin(), coverage.end(), aCodePoint,
+            [](code_point_range const& r, char32_t cp) { return r.second < cp; });
+        return range != coverage.end() && range->first <= aCodePoint;
+    }
+
+    bool font_index::empty() const
+    {
+        return iFaces.empty();
+    }
+
+    font_index::face_list const& font_index::faces() const
+    {
+        return iFaces;
+    }
+
+    std::vector<std::string> font_index::covering_families(char32_t aCodePoint, std::string const& aExcludeFamily) const
+    {
+        std::vector<std::string> result;
+        for (auto const& f : iFaces)
+            if (f.familyName != aExcludeFamily && f.covers(aCodePoint) &&
+                std::find(result.begin(), result.end(), f.familyName) == result.end())
+                result.push_back(f.familyName);
+        return result;
+    }
+
+    bool font_index::family_covers(std::string const& aFamilyName, char32_t aCodePoint) const
+    {
+        return std::any_of(iFaces.begin(), iFaces.end(),
+            [&](face const& f) { return f.familyName == aFamilyName && f.covers(aCodePoint); });
+    }
+
+    bool font_index::load(std::string const& aIndexPath)
+    {
+        iFaces.clear();
+        std::ifstream input{ aIndexPath, std::ios::in | std::ios::binary };
+        if (!input)
+            return false;
+        char magic[sizeof(IndexMagic)];
+        std::uint32_t version = 0u;
+        std::uint32_t faceCount = 0u;
+        if (!input.read(magic, sizeof(magic)) || !std::equal(std::begin(magic), std::end(magic), std::begin(IndexMagic)) ||
+            !read_value(input, version) || version != IndexVersion || !read_value(input, faceCount) || faceCount > MaxFaces)
+            return false;
+        face_list faces;
+        faces.reserve(faceCount);
+        for (std::uint32_t i = 0u; i < faceCount; ++i)
+        {
+            face f;
+            std::uint32_t style = 0u;
+            std::uint32_t rangeCount = 0u;
+            if (!read_string(input, f.path) || !read_value(input, f.fileSize) || !read_value(input, f.lastWriteTime) ||
+                !read_value(input, f.faceIndex) || !read_string(input, f.familyName) || !read_string(input, f.styleName) ||
+                !read_value(input, style) || !read_value(input, rangeCount) || rangeCount > MaxRanges)
+                return false;
+            f.style = static_cast<font_style>(style);
+            f.coverage.resize(rangeCount);
+            for (auto& range : f.coverage)
+                if (!read_value(input, range.first) || !read_value(input, range.second))
+                    return false;
+            faces.push_back(std::move(f));
+        }
+        iFaces = std::move(faces);
+        return true;
+    }
+
+    void font_index::save(std::string const& aIndexPath) const
+    {
+        std::filesystem::create_directories(std::filesystem::path{ aIndexPath }.parent_path());
+        auto const temporaryPath = aIndexPath + ".tmp";
+        {
+            std::ofstream output{ temporaryPath, std::ios::out | std::ios::binary | std::ios::trunc };
+            if (!output)
+                throw failed_to_save();
+            output.write(IndexMagic, sizeof(IndexMagic));
+            write_value(output, IndexVersion);
+            write_value(output, static_cast<std::uint32_t>(iFaces.size()));
+            for (auto const& f : iFaces)
+            {
+                write_string(output, f.path);
+                write_value(output, f.fileSize);
+                write_value(output, f.lastWriteTime);
+                write_value(output, f.faceIndex);
+                write_string(output, f.familyName);
+                write_string(output, f.styleName);
+                write_value(output, static_cast<std::uint32_t>(f.style));
+                write_value(output, static_cast<std::uint32_t>(f.coverage.size()));
+                for (auto const& range : f.coverage)
+                {
+                    write_value(output, range.first);
+                    write_value(output, range.second);
+                }
+            }
+            if (!output)
+                throw failed_to_save();
+        }
+        std::filesystem::rename(temporaryPath, aIndexPath);
+    }
+
+    font_index font_index::scan(std::vector<std::string> const& aDirectories, font_index const& aPrevious)
+    {
+        font_index result;
+        FT_Library fontLib = nullptr;
+        if (FT_Init_FreeType(&fontLib) != 0)
+            return aPrevious;
+        try
+        {
+            std::unordered_map<std::string, std::vector<face const*>> previous;
+            for (auto const& f : aPrevious.faces())
+                previous[f.path].push_back(&f);
+            for (auto const& directory : aDirectories)
+            {
+                std::error_code ec;
+                if (!std::filesystem::exists(directory, ec))
+                    continue;
+                for (std::filesystem::directory_iterator file{ directory, ec }; !ec && file != std::filesystem::directory_iterator{}; file.increment(ec))
+                {
+                    if (!file->is_regular_file(ec))
+                        continue;
+                    auto const fileSize = static_cast<std::uint64_t>(file->file_size(ec));
+                    auto const lastWriteTime = static_cast<std::int64_t>(file->last_write_time(ec).time_since_epoch().count());
+                    auto const existing = previous.find(file->path().string());
+                    if (existing != previous.end() && existing->second[0]->fileSize == fileSize && existing->second[0]->lastWriteTime == lastWriteTime)
+                    {
+                        for (auto const& f : existing->second)
+                            result.iFaces.push_back(*f);
+                        continue;
+                    }
+                    if (is_font_file(fontLib, file->path()))
+                        scan_file(fontLib, file->path(), fileSize, lastWriteTime, result.iFaces);
+                }
+            }
+        }
+        catch (...)
+        {
+            FT_Done_FreeType(fontLib);
+            throw;
+        }
+        FT_Done_FreeType(fontLib);
+        return result;
+    }
+
+    std::string font_index::default_index_path()
+    {
+        return neolib::user_settings_directory() + "/neogfx/font_index.bin";
+    }
+}
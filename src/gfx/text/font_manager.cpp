@@ -20,6 +20,8 @@
 #include <neogfx/neogfx.hpp>
 
 #include <filesystem>
+#include <chrono>
+#include <mutex>
 #include <neolib/core/string_utils.hpp>
 #include <neolib/core/string_utf.hpp>
 #include <ft2build.h>
@@ -43,6 +45,7 @@
 #endif
 
 #include <neolib/file/file.hpp>
+#include <neolib/task/thread_pool.hpp>
 
 #include <neogfx/app/i_app.hpp>
 #include <neogfx/gfx/i_rendering_engine.hpp>
@@ -194,6 +197,13 @@ namespace neogfx
         glyph_text create_glyph_text(font const& aFont) override;
         glyph_text to_glyph_text(i_graphics_context const& aGc, char const* aUtf8Begin, char const* aUtf8End, i_font_selector const& aFontSelector, bool aAlignBaselines = true) override;
         glyph_text to_glyph_text(i_graphics_context const& aGc, char32_t const* aUtf32Begin, char32_t const* aUtf32End, i_font_selector const& aFontSelector, bool aAlignBaselines = true) override;
+        glyph_shaping_context shaping_context(i_graphics_context const& aGc) const override;
+        std::optional<shaped_glyph_text> shape_glyph_text(glyph_shaping_context const& aContext, char32_t const* aUtf32Begin, char32_t const* aUtf32End, i_font_selector const& aFontSelector) override;
+        glyph_text resolve_glyph_text(shaped_glyph_text const& aShapedText) override;
+    private:
+        template <typename Result>
+        bool shape(Result& aResult, glyph_shaping_context const& aContext, char32_t const* aUtf32Begin, char32_t const* aUtf32End, i_font_selector const& aFontSelector, bool& aHasEmojis);
+        static void resolve_glyph(glyph_char& aGlyph, font const& aFont, vec2f const& aOffset, logical_coordinate_system aCoordinateSystem);
     };
 
     class glyph_shapes
@@ -204,17 +214,30 @@ namespace neogfx
         class glyphs
         {
         public:
-            glyphs(const i_graphics_context& aParent, const font& aFont, const glyph_text_factory::glyph_run& aGlyphRun) :
-                iParent{ aParent },
-                iFont{ static_cast<font_face_handle*>(aFont.native_font_face().handle())->harfbuzzFont },
+            glyphs(const font& aFont, const glyph_text_factory::glyph_run& aGlyphRun, bool aUiThread = true) :
+                iShapingFont{ aFont },
                 iGlyphRun{ aGlyphRun },
-                iBuf{ static_cast<font_face_handle*>(aFont.native_font_face().handle())->harfbuzzBuf },
                 iGlyphCount{ 0u }
             {
-                hb_buffer_set_direction(iBuf, aGlyphRun.direction == text_direction::RTL ? HB_DIRECTION_RTL : HB_DIRECTION_LTR);
-                hb_buffer_set_script(iBuf, aGlyphRun.script);
-                hb_buffer_set_cluster_level(iBuf, HB_BUFFER_CLUSTER_LEVEL_CHARACTERS);
-                hb_buffer_add_utf32(iBuf, reinterpret_cast<const std::uint32_t*>(aGlyphRun.start), static_cast<int>(aGlyphRun.end - aGlyphRun.start), 0, static_cast<int>(aGlyphRun.end - aGlyphRun.start));
+                auto const& handle = *static_cast<font_face_handle*>(aFont.native_font_face().handle());
+                hb_font_t* hbFont = handle.harfbuzzFont;
+                hb_buffer_t* hbBuf = handle.harfbuzzBuf;
+                if (!aUiThread)
+                {
+                    // the face's HarfBuzz font calls back into the face's kerning cache and its buffer is shared so shaping 
+                    // off the UI thread uses a private font over the immutable HarfBuzz face and a per-thread buffer...
+                    hbFont = hb_font_create(handle.harfbuzzFace);
+                    int xScale = 0;
+                    int yScale = 0;
+                    hb_font_get_scale(handle.harfbuzzFont, &xScale, &yScale);
+                    hb_font_set_scale(hbFont, xScale, yScale);
+                    thread_local std::unique_ptr<hb_buffer_t, decltype(&hb_buffer_destroy)> tBuf{ hb_buffer_create(), &hb_buffer_destroy };
+                    hbBuf = tBuf.get();
+                }
+                hb_buffer_set_direction(hbBuf, aGlyphRun.direction == text_direction::RTL ? HB_DIRECTION_RTL : HB_DIRECTION_LTR);
+                hb_buffer_set_script(hbBuf, aGlyphRun.script);
+                hb_buffer_set_cluster_level(hbBuf, HB_BUFFER_CLUSTER_LEVEL_CHARACTERS);
+                hb_buffer_add_utf32(hbBuf, reinterpret_cast<const std::uint32_t*>(aGlyphRun.start), static_cast<int>(aGlyphRun.end - aGlyphRun.start), 0, static_cast<int>(aGlyphRun.end - aGlyphRun.start));
                 scoped_kerning sk{ aFont.kerning() };
                 /// @todo add ligature support to neogfx::font...
                 static hb_feature_t features[2];
@@ -223,17 +246,16 @@ namespace neogfx
                     hb_feature_from_string("dlig=0", -1, &features[1]); 
                     return true;
                     }(features);
-                hb_shape(iFont, iBuf, features, 2);
+                hb_shape(hbFont, hbBuf, features, 2);
                 unsigned int glyphCount = 0;
-                auto glyphInfo = hb_buffer_get_glyph_infos(iBuf, &glyphCount);
+                auto glyphInfo = hb_buffer_get_glyph_infos(hbBuf, &glyphCount);
                 iGlyphInfo.assign(glyphInfo, glyphInfo + glyphCount);
-                auto glyphPos = hb_buffer_get_glyph_positions(iBuf, &glyphCount);
+                auto glyphPos = hb_buffer_get_glyph_positions(hbBuf, &glyphCount);
                 iGlyphPos.assign(glyphPos, glyphPos + glyphCount);
                 iGlyphCount = glyphCount;
-            }
-            ~glyphs()
-            {
-                hb_buffer_clear_contents(iBuf);
+                hb_buffer_clear_contents(hbBuf);
+                if (!aUiThread)
+                    hb_font_destroy(hbFont);
             }
         public:
             std::uint32_t glyph_count() const
@@ -248,6 +270,23 @@ namespace neogfx
             {
                 return iGlyphPos[aIndex];
             }
+            const font& shaping_font() const
+            {
+                return iShapingFont;
+            }
+            std::optional<char32_t> missing_code_point() const
+            {
+                for (std::uint32_t i = 0; i < glyph_count(); ++i)
+                {
+                    if (glyph_info(i).codepoint != 0)
+                        continue;
+                    auto const cp = std::next(iGlyphRun.start, glyph_info(i).cluster);
+                    auto const tc = get_text_category(service<i_font_manager>().emoji_atlas(), cp, iGlyphRun.end);
+                    if (tc != text_category::Whitespace && tc != text_category::Emoji)
+                        return *cp;
+                }
+                return {};
+            }
             bool needs_fallback_font() const
             {
                 for (std::uint32_t i = 0; i < glyph_count(); ++i)
@@ -259,10 +298,8 @@ namespace neogfx
                 return false;
             }
         private:
-            const i_graphics_context& iParent;
-            hb_font_t* iFont;
+            font iShapingFont;
             const glyph_text_factory::glyph_run& iGlyphRun;
-            hb_buffer_t* iBuf;
             std::uint32_t iGlyphCount;
             std::vector<hb_glyph_info_t> iGlyphInfo;
             std::vector<hb_glyph_position_t> iGlyphPos;
@@ -270,27 +307,48 @@ namespace neogfx
         typedef std::list<glyphs> glyphs_list;
         typedef std::vector<std::pair<glyphs_list::const_iterator, std::uint32_t>> result_type;
     public:
-        glyph_shapes(const i_graphics_context& aParent, const font& aFont, const glyph_text_factory::glyph_run& aGlyphRun)
+        glyph_shapes(const font& aFont, const glyph_text_factory::glyph_run& aGlyphRun, bool aUiThread = true) :
+            iComplete{ true }
         {
             thread_local std::vector<font> fontsTried;
             auto tryFont = aFont;
             fontsTried.push_back(aFont);
-            iGlyphsList.emplace_back(glyphs{ aParent, tryFont, aGlyphRun });
+            iGlyphsList.emplace_back(glyphs{ tryFont, aGlyphRun, aUiThread });
             while (iGlyphsList.back().needs_fallback_font())
             {
+                if (!aUiThread)
+                {
+                    // fallback fonts are created by the font manager on demand so a run that needs one is left to the UI thread
+                    fontsTried.clear();
+                    iComplete = false;
+                    return;
+                }
                 if (tryFont.has_fallback() && std::find(fontsTried.begin(), fontsTried.end(), tryFont.fallback()) == fontsTried.end())
                 {
                     tryFont = tryFont.fallback();
                     fontsTried.push_back(tryFont);
-                    iGlyphsList.emplace_back(glyphs{ aParent, tryFont, aGlyphRun });
+                    iGlyphsList.emplace_back(glyphs{ tryFont, aGlyphRun });
                 }
                 else
                 {
+                    // fallback chain exhausted so ask the font index for a family that covers a missing character
+                    auto const missing = iGlyphsList.back().missing_code_point();
+                    if (missing && aFont.has_fallback(*missing))
+                    {
+                        auto const coverageFont = aFont.fallback(*missing);
+                        if (std::find(fontsTried.begin(), fontsTried.end(), coverageFont) == fontsTried.end())
+                        {
+                            tryFont = coverageFont;
+                            fontsTried.push_back(tryFont);
+                            iGlyphsList.emplace_back(glyphs{ tryFont, aGlyphRun });
+                            continue;
+                        }
+                    }
                     std::u32string lastResort{ aGlyphRun.start, aGlyphRun.end };
                     for (std::uint32_t i = 0; i < iGlyphsList.back().glyph_count(); ++i)
                         if (iGlyphsList.back().glyph_info(i).codepoint == 0)
                             lastResort[iGlyphsList.back().glyph_info(i).cluster] = neolib::INVALID_CHAR32; // replacement character
-                    iGlyphsList.emplace_back(glyphs{ aParent, aFont, glyph_text_factory::glyph_run{
+                    iGlyphsList.emplace_back(glyphs{ aFont, glyph_text_factory::glyph_run{
                         &lastResort[0], &lastResort[0] + lastResort.size(), 
                         aGlyphRun.currentLineDirection, aGlyphRun.direction, 
                         aGlyphRun.mnemonic, aGlyphRun.script } });
@@ -333,6 +391,10 @@ namespace neogfx
             }
         }
     public:
+        bool complete() const
+        {
+            return iComplete;
+        }
         std::uint32_t glyph_count() const
         {
             return static_cast<std::uint32_t>(iResults.size());
@@ -349,6 +411,10 @@ namespace neogfx
         {
             return iResults[aIndex].first != iGlyphsList.begin();
         }
+        const font& glyph_font(std::uint32_t aIndex) const
+        {
+            return iResults[aIndex].first->shaping_font();
+        }
         std::uint32_t fallback_index(std::uint32_t aIndex) const
         {
             if (!using_fallback(aIndex))
@@ -358,6 +424,7 @@ namespace neogfx
     private:
         glyphs_list iGlyphsList;
         result_type iResults;
+        bool iComplete;
     };
 
     glyph_text glyph_text_factory::create_glyph_text()
@@ -393,17 +460,117 @@ namespace neogfx
         } }, aAlignBaselines);
     }
 
-    glyph_text glyph_text_factory::to_glyph_text(i_graphics_context const& aGc, char32_t const* aUtf32Begin, char32_t const* aUtf32End, i_font_selector const& aFontSelector, bool aAlignBaselines)
+    glyph_shaping_context glyph_text_factory::shaping_context(i_graphics_context const& aGc) const
     {
-        auto const& emojiAtlas = service<i_font_manager>().emoji_atlas();
+        glyph_shaping_context result;
+        if (aGc.mnemonic_set())
+            result.mnemonic = static_cast<char32_t>(aGc.mnemonic());
+        if (aGc.password())
+            result.passwordMask = neolib::utf8_to_utf32(aGc.password_mask())[0];
+        if (aGc.has_tab_stops())
+        {
+            result.tabStop = aGc.tab_stops().default_stop().pos;
+            result.extendedTabStops = !aGc.tab_stops().stops().empty() || aGc.tab_stops().default_stop().alignment != alignment::Left;
+        }
+        result.subpixelRendering = aGc.is_subpixel_rendering_on();
+        result.coordinateSystem = aGc.logical_coordinate_system();
+        return result;
+    }
 
-        auto refResult = make_ref<glyph_text_content>(aFontSelector.select_font(0));
+    std::optional<shaped_glyph_text> glyph_text_factory::shape_glyph_text(glyph_shaping_context const& aContext, char32_t const* aUtf32Begin, char32_t const* aUtf32End, i_font_selector const& aFontSelector)
+    {
+        std::optional<shaped_glyph_text> result{ std::in_place };
+        result->majorFont = aFontSelector.select_font(0).id();
+        result->coordinateSystem = aContext.coordinateSystem;
+        bool hasEmojis = false;
+        if (!shape(*result, aContext, aUtf32Begin, aUtf32End, aFontSelector, hasEmojis))
+            return {};
+        return result;
+    }
+
+    glyph_text glyph_text_factory::resolve_glyph_text(shaped_glyph_text const& aShapedText)
+    {
+        auto refResult = make_ref<glyph_text_content>(service<i_font_manager>().font_from_id(aShapedText.majorFont));
         auto& result = *refResult;
+        for (auto lineBreak : aShapedText.lineBreaks)
+            result.line_breaks().push_back(lineBreak);
+        for (std::size_t i = 0; i < aShapedText.glyphs.size(); ++i)
+        {
+            auto& newGlyph = result.emplace_back(aShapedText.glyphs[i]);
+            resolve_glyph(newGlyph, result.glyph_font(newGlyph), aShapedText.offsets[i], aShapedText.coordinateSystem);
+        }
+        return result;
+    }
+
+    void glyph_text_factory::resolve_glyph(glyph_char& aGlyph, font const& aFont, vec2f const& aOffset, logical_coordinate_system aCoordinateSystem)
+    {
+        auto const& fontGlyph = aFont.glyph(aGlyph);
+        auto const& fontGlyphExtents = fontGlyph.texture().extents().as<float>();
+        auto const& glyphMetrics = fontGlyph.metrics();
+        float const cellHeight = static_cast<float>(aFont.height());
+
+        // the cell was laid out from the glyph advance; it also has to cover the rasterized glyph
+        if (category(aGlyph) != text_category::Whitespace && fontGlyphExtents.cx > aGlyph.cell[1].x - aGlyph.cell[0].x)
+        {
+            aGlyph.cell[1].x = aGlyph.cell[0].x + fontGlyphExtents.cx;
+            aGlyph.cell[2].x = aGlyph.cell[0].x + fontGlyphExtents.cx;
+        }
+
+        aGlyph.shape = category(aGlyph) != text_category::Whitespace ?
+            quadf_2d{
+                aOffset,
+                aOffset + vec2f{ fontGlyphExtents.cx, 0.0f },
+                aOffset + vec2f{ fontGlyphExtents.cx, fontGlyphExtents.cy },
+                aOffset + vec2f{ 0.0f, fontGlyphExtents.cy } } :
+            quadf_2d{};
+
+        if (fontGlyph.has_outline_texture())
+        {
+            auto const& fontOutlineGlyphExtents = fontGlyph.outline_texture().extents().as<float>();
+            auto const adjustedOffset = aOffset - vec2f{
+                static_cast<float>(aFont.info().outline().radius), static_cast<float>(aFont.info().outline().radius) };
+            aGlyph.outlineShape = category(aGlyph) != text_category::Whitespace ?
+                quadf_2d{
+                    adjustedOffset,
+                    adjustedOffset + vec2f{ fontOutlineGlyphExtents.cx, 0.0f },
+                    adjustedOffset + vec2f{ fontOutlineGlyphExtents.cx, fontOutlineGlyphExtents.cy },
+                    adjustedOffset + vec2f{ 0.0f, fontOutlineGlyphExtents.cy } } :
+                quadf_2d{};
+        }
+
+        vec2f const shapeAdjust = vec2{
+            glyphMetrics.bearing.x,
+            glyphMetrics.bearing.y - glyphMetrics.extents.y + -aFont.descender() }.as<float>();
+        aGlyph.shape += shapeAdjust;
+        if (aGlyph.outlineShape)
+            aGlyph.outlineShape.value() += shapeAdjust;
+
+        if (aCoordinateSystem == logical_coordinate_system::AutomaticGui)
+        {
+            for (auto& v : aGlyph.shape)
+                v.y = -v.y + cellHeight;
+            if (aGlyph.outlineShape)
+                for (auto& v : aGlyph.outlineShape.value())
+                    v.y = -v.y + cellHeight;
+        }
+    }
+
+    template <typename Result>
+    bool glyph_text_factory::shape(Result& aResult, glyph_shaping_context const& aContext, char32_t const* aUtf32Begin, char32_t const* aUtf32End, i_font_selector const& aFontSelector, bool& aHasEmojis)
+    {
+        // Shaping into a shaped_glyph_text can happen on any thread so it must not rasterize glyphs (the glyph atlas
+        // belongs to the UI thread) or create fallback fonts; it fails instead and resolve_glyph_text does the rest on
+        // the UI thread. Copying the fonts it already has is fine.
+        constexpr bool Deferred = std::is_same_v<Result, shaped_glyph_text>;
+
+        auto const& emojiAtlas = service<i_font_manager>().emoji_atlas();
+
+        auto& result = aResult;
 
         if (aUtf32End == aUtf32Begin)
-            return result;
+            return true;
 
-        bool hasEmojis = false;
+        bool& hasEmojis = aHasEmojis;
 
         thread_local std::vector<character_type> textDirections;
         textDirections.clear();
@@ -418,10 +585,10 @@ namespace neogfx
         thread_local std::u32string adjustedCodepoints;
         adjustedCodepoints.clear();
 
-        if (!aGc.password())
+        if (!aContext.passwordMask)
             adjustedCodepoints.assign(aUtf32Begin, aUtf32End);
         else
-            adjustedCodepoints.assign(codePointCount, neolib::utf8_to_utf32(aGc.password_mask())[0]);
+            adjustedCodepoints.assign(codePointCount, *aContext.passwordMask);
 
         auto codePoints = &adjustedCodepoints[0];
 
@@ -429,8 +596,8 @@ namespace neogfx
         runs.clear();
 
         text_category previousCategory = get_text_category(emojiAtlas, codePoints, codePoints + codePointCount);
-        if (aGc.mnemonic_set() && codePoints[0] == static_cast<char32_t>(aGc.mnemonic()) && 
-            (codePointCount == 1 || codePoints[1] != static_cast<char32_t>(aGc.mnemonic())))
+        if (aContext.mnemonic && codePoints[0] == *aContext.mnemonic && 
+            (codePointCount == 1 || codePoints[1] != *aContext.mnemonic))
             previousCategory = text_category::Mnemonic;
         bool newLine = false;
         bool previousNewLine = false;
@@ -478,8 +645,8 @@ namespace neogfx
             
             text_category currentCategory = get_text_category(emojiAtlas, codePoints + codePointIndex, codePoints + codePointCount);
             
-            if (aGc.mnemonic_set() && codePoints[codePointIndex] == static_cast<char32_t>(aGc.mnemonic()) &&
-                (codePointCount - 1 == codePointIndex || codePoints[codePointIndex + 1] != static_cast<char32_t>(aGc.mnemonic())))
+            if (aContext.mnemonic && codePoints[codePointIndex] == *aContext.mnemonic &&
+                (codePointCount - 1 == codePointIndex || codePoints[codePointIndex + 1] != *aContext.mnemonic))
                 currentCategory = text_category::Mnemonic;
             
             previousNewLine = newLine;
@@ -557,6 +724,10 @@ namespace neogfx
 
         runs.emplace_back(runStart, &codePoints[lastCodePointIndex + 1], previousLineDirection, previousDirection, previousCategory == text_category::Mnemonic, previousScript);
 
+        if constexpr (Deferred)
+            if (hasEmojis)
+                return false;
+
         float lineStart = 0.0f;
         vec2f previousAdvance = {};
         quadf_2d previousCell = {};
@@ -581,7 +752,9 @@ namespace neogfx
             
             bool drawMnemonic = (i > 0 && runs[i - 1].mnemonic);
             std::string::size_type sourceClusterRunStart = runs[i].start - &codePoints[0];
-            glyph_shapes shapes{ aGc, aFontSelector.select_font(sourceClusterRunStart), runs[i] };
+            glyph_shapes shapes{ aFontSelector.select_font(sourceClusterRunStart), runs[i], !Deferred };
+            if (!shapes.complete())
+                return false;
 
             for (std::uint32_t j = 0; j < shapes.glyph_count(); ++j)
             {
@@ -608,13 +781,7 @@ namespace neogfx
                     result.line_breaks().push_back(result.size());
 
                 neogfx::font selectedFont = aFontSelector.select_font(startCluster);
-                neogfx::font font = selectedFont;
-                if (shapes.using_fallback(j))
-                {
-                    font = font.has_fallback() ? font.fallback() : selectedFont;
-                    for (auto fi = shapes.fallback_index(j); font != selectedFont && fi > 0; --fi)
-                        font = font.has_fallback() ? font.fallback() : selectedFont;
-                }
+                neogfx::font font = shapes.using_fallback(j) ? shapes.glyph_font(j) : selectedFont;
                     
                 auto const& glyphPosition = shapes.glyph_position(j);
 
@@ -645,7 +812,7 @@ namespace neogfx
                     set_superscript(newGlyph, true, (selectedFont.style() & font_style::BelowAscenderLine) == font_style::BelowAscenderLine);
                 if ((selectedFont.style() & font_style::Subscript) == font_style::Subscript)
                     set_subscript(newGlyph, true, (selectedFont.style() & font_style::AboveBaseline) == font_style::AboveBaseline);
-                if (aGc.is_subpixel_rendering_on() && !font.is_bitmap_font())
+                if (aContext.subpixelRendering && !font.is_bitmap_font())
                     set_subpixel(newGlyph, true);
                 if (drawMnemonic && ((j == 0 && runs[i].direction == text_direction::LTR) || (j == shapes.glyph_count() - 1 && runs[i].direction == text_direction::RTL)))
                     set_mnemonic(newGlyph, true);
@@ -657,88 +824,62 @@ namespace neogfx
                         lineStart = previousCell[0].x + previousAdvance.x;
                         advance = {};
                     }
-                    else if (newGlyph.value == U'\t' && aGc.has_tab_stops())
+                    else if (newGlyph.value == U'\t' && aContext.tabStop)
                     {
                         // todo: tab stop list and tab alignment
-                        if (!aGc.tab_stops().stops().empty() || aGc.tab_stops().default_stop().alignment != alignment::Left)
+                        if (aContext.extendedTabStops)
                             throw not_yet_implemented("Extended tab stop functionality not yet implemented");
-                        auto const tabStopPos = static_cast<float>(aGc.tab_stops().default_stop().pos);
+                        auto const tabStopPos = static_cast<float>(*aContext.tabStop);
                         advance.x = tabStopPos - std::fmod((previousCell[0] + previousAdvance).x - lineStart, tabStopPos);
                     }
                 }
 
-                if (category(newGlyph) != text_category::Emoji)
-                {
-                    auto const& fontGlyph = font.glyph(newGlyph);
-                    auto const& fontGlyphExtents = fontGlyph.texture().extents().as<float>();
-                    float const cellWidth = (category(newGlyph) != text_category::Whitespace ? std::max(advance.x, fontGlyphExtents.cx) : advance.x);
-                    auto const& glyphMetrics = fontGlyph.metrics();
-
-                    newGlyph.cell = quadf_2d{
-                        previousCell[0] + previousAdvance,
-                        previousCell[0] + previousAdvance + vec2f{ cellWidth, 0.0f },
-                        previousCell[0] + previousAdvance + vec2f{ cellWidth, cellHeight },
-                        previousCell[0] + previousAdvance + vec2f{ 0.0f, cellHeight } };
-
-                    newGlyph.shape = category(newGlyph) != text_category::Whitespace ? 
-                        quadf_2d{
-                            offset,
-                            offset + vec2f{ fontGlyphExtents.cx, 0.0f },
-                            offset + vec2f{ fontGlyphExtents.cx, fontGlyphExtents.cy },
-                            offset + vec2f{ 0.0f, fontGlyphExtents.cy } } : 
-                        quadf_2d{};
-
-                    if (fontGlyph.has_outline_texture())
-                    {
-                        auto const& fontOutlineGlyphExtents = fontGlyph.outline_texture().extents().as<float>();
-                        auto const adjustedOffset = offset - vec2f{ 
-                            static_cast<float>(font.info().outline().radius), static_cast<float>(font.info().outline().radius) };
-                        newGlyph.outlineShape = category(newGlyph) != text_category::Whitespace ?
-                            quadf_2d{
-                                adjustedOffset,
-                                adjustedOffset + vec2f{ fontOutlineGlyphExtents.cx, 0.0f },
-                                adjustedOffset + vec2f{ fontOutlineGlyphExtents.cx, fontOutlineGlyphExtents.cy },
-                                adjustedOffset + vec2f{ 0.0f, fontOutlineGlyphExtents.cy } } :
-                            quadf_2d{};
-                    }
-
-                    vec2f const shapeAdjust = vec2{
-                        glyphMetrics.bearing.x,
-                        glyphMetrics.bearing.y - glyphMetrics.extents.y + -font.descender() }.as<float>();
-                    newGlyph.shape += shapeAdjust;
-                    if (newGlyph.outlineShape)
-                        newGlyph.outlineShape.value() += shapeAdjust;
-                }
-                else
-                {
-                    float const cellWidth = advance.x;
+                float const cellWidth = advance.x;
 
-                    newGlyph.cell = quadf_2d{
-                        previousCell[0] + previousAdvance,
-                        previousCell[0] + previousAdvance + vec2f{ cellWidth, 0.0f },
-                        previousCell[0] + previousAdvance + vec2f{ cellWidth, cellHeight },
-                        previousCell[0] + previousAdvance + vec2f{ 0.0f, cellHeight } };
+                newGlyph.cell = quadf_2d{
+                    previousCell[0] + previousAdvance,
+                    previousCell[0] + previousAdvance + vec2f{ cellWidth, 0.0f },
+                    previousCell[0] + previousAdvance + vec2f{ cellWidth, cellHeight },
+                    previousCell[0] + previousAdvance + vec2f{ 0.0f, cellHeight } };
 
+                if (category(newGlyph) == text_category::Emoji)
+                {
                     newGlyph.shape = quadf_2d{
                         vec2f{ 0.0f, 0.0f },
                         vec2f{ cellWidth, 0.0f },
                         vec2f{ cellWidth, cellHeight },
                         vec2f{ 0.0f, cellHeight } };
-                }
-
-                if (aGc.logical_coordinate_system() == logical_coordinate_system::AutomaticGui)
-                {
-                    for (auto& v : newGlyph.shape)
-                        v.y = -v.y + cellHeight;
-                    if (newGlyph.outlineShape)
-                        for (auto& v : newGlyph.outlineShape.value())
+                    if (aContext.coordinateSystem == logical_coordinate_system::AutomaticGui)
+                        for (auto& v : newGlyph.shape)
                             v.y = -v.y + cellHeight;
                 }
+                else if constexpr (Deferred)
+                    result.offsets.push_back(offset);
+                else
+                    resolve_glyph(newGlyph, font, offset, aContext.coordinateSystem);
 
                 previousAdvance = advance;
                 previousCell = newGlyph.cell;
             }
         }
+        return true;
+    }
+
+    glyph_text glyph_text_factory::to_glyph_text(i_graphics_context const& aGc, char32_t const* aUtf32Begin, char32_t const* aUtf32End, i_font_selector const& aFontSelector, bool aAlignBaselines)
+    {
+        auto const& emojiAtlas = service<i_font_manager>().emoji_atlas();
+
+        auto refResult = make_ref<glyph_text_content>(aFontSelector.select_font(0));
+        auto& result = *refResult;
+
+        if (aUtf32End == aUtf32Begin)
+            return result;
+
+        bool hasEmojis = false;
+        shape(result, shaping_context(aGc), aUtf32Begin, aUtf32End, aFontSelector, hasEmojis);
+
+        std::u32string::size_type const codePointCount = aUtf32End - aUtf32Begin;
+
         if (hasEmojis)
         {
             auto refEmojiResult = make_ref<glyph_text_content>(aFontSelector.select_font(0));
@@ -831,33 +972,77 @@ namespace neogfx
         error = FT_Library_SetLcdFilter(iFontLib, FT_LCD_FILTER_NONE);
         if (error)
             throw error_initializing_font_library();
-        auto enumerate = [this](const std::string fontsDirectory)
-        {
-            if (std::filesystem::exists(fontsDirectory))
-                for (std::filesystem::directory_iterator file(fontsDirectory); file != std::filesystem::directory_iterator(); ++file)
-                {
-                    if (!std::filesystem::is_regular_file(file->status()))
-                        continue;
-                    try
-                    {
-                        if (is_font_file(string{ file->path().string() }))
-                        {
-                            auto font = iNativeFonts.emplace(iNativeFonts.end(), iFontLib, file->path().string());
-                            iFontFamilies[font->family_name()].push_back(font);
-                        }
-                    }
-                    catch (native_font::failed_to_load_font&)
-                    {
-                    }
-                    catch (...)
-                    {
-                        throw;
-                    }
-                }
-        };
-        enumerate(detail::platform_specific::get_system_font_directory());
+        std::vector<std::string> fontDirectories{ detail::platform_specific::get_system_font_directory() };
         for (auto const& path : detail::platform_specific::get_local_font_directories())
-            enumerate(path);
+            fontDirectories.push_back(path);
+        // Fonts are listed from the index saved by the previous run while a background scan brings it up to date;
+        // only when there is no index (first run) does the first font request have to wait for the scan.
+        if (iFontIndex.load(font_index::default_index_path()))
+            add_indexed_fonts();
+        iFontIndexScan = neolib::thread_pool::default_thread_pool().run(
+            [fontDirectories, previousIndex = iFontIndex]() { return font_index::scan(fontDirectories, previousIndex); });
+    }
+
+    font_manager::~font_manager()
+    {
+        if (iFontIndexScan)
+            iFontIndexScan->wait();
+        iIdCache.clear();
+        iFontFamilies.clear();
+        iNativeFonts.clear();
+        FT_Done_FreeType(iFontLib);
+    }
+
+    void font_manager::update_font_index(bool aWait) const
+    {
+        std::scoped_lock<std::recursive_mutex> lock{ iFontIndexMutex };
+        if (!iFontIndexScan)
+            return;
+        if (!aWait && iFontIndexScan->wait_for(std::chrono::seconds{ 0 }) != std::future_status::ready)
+            return;
+        try
+        {
+            iFontIndex = iFontIndexScan->get();
+        }
+        catch (...)
+        {
+            iFontIndexScan = std::nullopt;
+            return;
+        }
+        iFontIndexScan = std::nullopt;
+        iCoverageFallbacks.clear();
+        add_indexed_fonts();
+        try
+        {
+            iFontIndex.save(font_index::default_index_path());
+        }
+        catch (...)
+        {
+            // the index is a cache; it is rebuilt by the next scan
+        }
+    }
+
+    void font_manager::add_indexed_fonts() const
+    {
+        auto const& faces = iFontIndex.faces();
+        for (auto face = faces.begin(); face != faces.end();)
+        {
+            auto const fileEnd = std::find_if(face, faces.end(), [&](font_index::face const& f) { return f.path != face->path; });
+            if (iIndexedFontFiles.insert(face->path).second)
+            {
+                std::vector<native_font::indexed_face> indexedFaces;
+                for (auto const& f : std::ranges::subrange(face, fileEnd))
+                    indexedFaces.push_back(native_font::indexed_face{ f.faceIndex, f.style, f.styleName });
+                auto font = iNativeFonts.emplace(iNativeFonts.end(), iFontLib, face->path, face->familyName, indexedFaces);
+                iFontFamilies[font->family_name()].push_back(font);
+            }
+            face = fileEnd;
+        }
+        finalize_font_families();
+    }
+
+    void font_manager::finalize_font_families() const
+    {
         for (auto& family : iFontFamilies)
         {
             std::optional<native_font_list::iterator> bold;
@@ -895,14 +1080,6 @@ namespace neogfx
         }
     }
 
-    font_manager::~font_manager()
-    {
-        iIdCache.clear();
-        iFontFamilies.clear();
-        iNativeFonts.clear();
-        FT_Done_FreeType(iFontLib);
-    }
-
     void* font_manager::font_library_handle() const
     {
         return iFontLib;
@@ -922,6 +1099,18 @@ namespace neogfx
         return *iDefaultFallbackFontInfo;
     }
 
+    namespace
+    {
+        struct face_device_resolution : i_device_resolution
+        {
+            size iResolution;
+            face_device_resolution(const i_native_font_face& aFace) : iResolution{ aFace.horizontal_dpi(), aFace.vertical_dpi() } {}
+            dimension horizontal_dpi() const final { return iResolution.cx; }
+            dimension vertical_dpi() const final { return iResolution.cy; }
+            dimension ppi() const final { return iResolution.magnitude() / std::sqrt(2.0); }
+        };
+    }
+
     i_native_font_face& font_manager::create_default_font(const i_device_resolution& aDevice)
     {
         return create_font(service<i_app>().current_style().font_info(), aDevice);
@@ -938,14 +1127,9 @@ namespace neogfx
             throw no_fallback_font();
         if (aExistingFont.fallback_cached())
             return aExistingFont.fallback();
-        struct : i_device_resolution
-        {
-            size iResolution;
-            virtual dimension horizontal_dpi() const { return iResolution.cx; }
-            virtual dimension vertical_dpi() const { return iResolution.cy; }
-            virtual dimension ppi() const { return iResolution.magnitude() / std::sqrt(2.0); }
-        } deviceResolution;
-        deviceResolution.iResolution = size(aExistingFont.horizontal_dpi(), aExistingFont.vertical_dpi());
+        std::scoped_lock<std::recursive_mutex> lock{ iFontIndexMutex };
+        update_font_index(false);
+        face_device_resolution const deviceResolution{ aExistingFont };
         string fallbackFontFamily = aExistingFont.family_name();
         try
         {
@@ -963,6 +1147,19 @@ namespace neogfx
         return fallbackFont;
     }
 
+    bool font_manager::has_fallback_font(const i_native_font_face& aExistingFont, char32_t aCodePoint) const
+    {
+        return coverage_fallback_family(aExistingFont.family_name(), aCodePoint) != std::nullopt;
+    }
+
+    i_native_font_face& font_manager::create_fallback_font(const i_native_font_face& aExistingFont, char32_t aCodePoint)
+    {
+        auto const fallbackFontFamily = coverage_fallback_family(aExistingFont.family_name(), aCodePoint);
+        if (!fallbackFontFamily)
+            throw no_fallback_font();
+        return create_font(*fallbackFontFamily, (aExistingFont.style() & ~font_style::Emulated), aExistingFont.size(), face_device_resolution{ aExistingFont });
+    }
+
     i_native_font_face& font_manager::create_font(i_string const& aFamilyName, neogfx::font_style aStyle, font::point_size aSize, const i_device_resolution& aDevice)
     {
         if (aStyle == neogfx::font_style::Emulated)
@@ -1079,19 +1276,23 @@ namespace neogfx
 
     std::uint32_t font_manager::font_family_count() const
     {
+        std::scoped_lock<std::recursive_mutex> lock{ iFontIndexMutex };
+        update_font_index(iFontFamilies.empty());
         return static_cast<std::uint32_t>(iFontFamilies.size());
     }
 
     i_string const& font_manager::font_family(std::uint32_t aFamilyIndex) const
     {
-        if (aFamilyIndex < font_family_count())
+        std::scoped_lock<std::recursive_mutex> lock{ iFontIndexMutex };
+        if (aFamilyIndex < iFontFamilies.size())
             return std::next(iFontFamilies.begin(), aFamilyIndex)->first;
         throw bad_font_family_index();
     }
 
     std::uint32_t font_manager::font_style_count(std::uint32_t aFamilyIndex) const
     {
-        if (aFamilyIndex < font_family_count())
+        std::scoped_lock<std::recursive_mutex> lock{ iFontIndexMutex };
+        if (aFamilyIndex < iFontFamilies.size())
         {
             std::uint32_t styles = 0;
             for (auto& font : std::next(iFontFamilies.begin(), aFamilyIndex)->second)
@@ -1103,7 +1304,8 @@ namespace neogfx
 
     font_style font_manager::font_style(std::uint32_t aFamilyIndex, std::uint32_t aStyleIndex) const
     {
-        if (aFamilyIndex < font_family_count() && aStyleIndex < font_style_count(aFamilyIndex))
+        std::scoped_lock<std::recursive_mutex> lock{ iFontIndexMutex };
+        if (aFamilyIndex < iFontFamilies.size() && aStyleIndex < font_style_count(aFamilyIndex))
         {
             for (auto& font : std::next(iFontFamilies.begin(), aFamilyIndex)->second)
             {
@@ -1117,7 +1319,8 @@ namespace neogfx
 
     i_string const& font_manager::font_style_name(std::uint32_t aFamilyIndex, std::uint32_t aStyleIndex) const
     {
-        if (aFamilyIndex < font_family_count() && aStyleIndex < font_style_count(aFamilyIndex))
+        std::scoped_lock<std::recursive_mutex> lock{ iFontIndexMutex };
+        if (aFamilyIndex < iFontFamilies.size() && aStyleIndex < font_style_count(aFamilyIndex))
         {
             for (auto& font : std::next(iFontFamilies.begin(), aFamilyIndex)->second)
             {
@@ -1181,6 +1384,8 @@ namespace neogfx
 
     i_native_font& font_manager::find_font(i_string const& aFamilyName, i_string const& aStyleName, font::point_size aSize)
     {
+        std::scoped_lock<std::recursive_mutex> lock{ iFontIndexMutex };
+        update_font_index(iFontFamilies.find(aFamilyName) == iFontFamilies.end());
         auto family = iFontFamilies.find(aFamilyName);
         if (family == iFontFamilies.end() && default_system_font_info(system_font_role::Widget) != std::nullopt)
             family = iFontFamilies.find(default_system_font_info(system_font_role::Widget)->family_name());
@@ -1230,6 +1435,8 @@ namespace neogfx
     {
         if (aStyle == neogfx::font_style::Emulated)
             aStyle = neogfx::font_style::Normal;
+        std::scoped_lock<std::recursive_mutex> lock{ iFontIndexMutex };
+        update_font_index(iFontFamilies.find(aFamilyName) == iFontFamilies.end());
         auto family = iFontFamilies.find(aFamilyName);
         if (family == iFontFamilies.end() && default_system_font_info(system_font_role::Widget) != std::nullopt)
             family = iFontFamilies.find(default_system_font_info(system_font_role::Widget)->family_name());
@@ -1300,6 +1507,32 @@ namespace neogfx
         }
     }
 
+    std::optional<string> font_manager::coverage_fallback_family(i_string const& aFamilyName, char32_t aCodePoint) const
+    {
+        std::scoped_lock<std::recursive_mutex> lock{ iFontIndexMutex };
+        update_font_index(iFontIndex.empty());
+        auto existing = iCoverageFallbacks.find(std::make_pair(string{ aFamilyName }, aCodePoint));
+        if (existing == iCoverageFallbacks.end())
+        {
+            std::optional<string> result;
+            auto const candidates = iFontIndex.covering_families(aCodePoint, std::string{ aFamilyName.to_std_string_view() });
+            // prefer the configured fallback families, in order
+            try
+            {
+                for (string family = default_fallback_font_info().fallback_for(string{}); !result; family = default_fallback_font_info().fallback_for(family))
+                    if (std::find(candidates.begin(), candidates.end(), family.to_std_string_view()) != candidates.end())
+                        result = family;
+            }
+            catch (...)
+            {
+            }
+            if (!result && !candidates.empty())
+                result = string{ candidates.front() };
+            existing = iCoverageFallbacks.emplace(std::make_pair(string{ aFamilyName }, aCodePoint), result).first;
+        }
+        return existing->second;
+    }
+
     i_native_font_face& font_manager::add_font(const ref_ptr<i_native_font_face>& aNewFont)
     {
         if (!iIdCache.contains(aNewFont->id()))
@@ -1311,13 +1544,20 @@ namespace neogfx
 
     void font_manager::cleanup()
     {
+        bool released = false;
         for (auto i = iIdCache.begin(); i != iIdCache.end();)
         {
             auto& cacheEntry = *i;
             if (cacheEntry.native_font_face().use_count() == 1)
+            {
                 i = iIdCache.erase(i);
+                released = true;
+            }
             else
                 ++i;
         }
+        // released faces have returned their glyphs to the atlas; compact it a bounded amount at a time
+        if (released)
+            iGlyphAtlas.defragment();
     }
 }
\ No newline at end of file
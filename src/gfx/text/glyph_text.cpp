@@ -26,6 +26,18 @@
 namespace neogfx
 {
     template class basic_glyph_text_content<glyph_text_container, const glyph_char*, glyph_char*>;
+    template class basic_glyph_text_content<compact_glyph_text_container, const compact_glyph_char*, compact_glyph_char*>;
+
+    glyph_text expand_glyph_text(i_compact_glyph_text const& aText)
+    {
+        glyph_text result{ aText.major_font() };
+        for (auto const& g : aText)
+            result.content().push_back(to_glyph_char(g));
+        for (auto lineBreak : aText.line_breaks())
+            result.content().line_breaks().push_back(lineBreak);
+        result.content().set_baseline(aText.baseline());
+        return result;
+    }
 
     glyph_text::glyph_text(font const& aFont) :
         iContent{ service<i_font_manager>().glyph_text_factory().create_glyph_text(aFont).content() }
@@ -29,18 +29,43 @@
 
 namespace neogfx
 {
+    font_style native_face_style(FT_Face aFace)
+    {
+        font_style style = font_style::Invalid;
+        if (aFace->style_flags & FT_STYLE_FLAG_ITALIC)
+            style |= static_cast<font_style>(style | font_style::Italic);
+        if (aFace->style_flags & FT_STYLE_FLAG_BOLD)
+            style |= static_cast<font_style>(style | font_style::Bold);
+        auto const searchKey = neolib::ci_string{ aFace->style_name != nullptr ? aFace->style_name : "" };
+        if (searchKey.find("italic") != neolib::ci_string::npos)
+            style |= font_style::Italic;
+        if (searchKey.find("bold") != neolib::ci_string::npos || searchKey.find("heavy") != neolib::ci_string::npos || searchKey.find("black") != neolib::ci_string::npos)
+            style |= font_style::Bold;
+        if (style == font_style::Invalid)
+            style = font_style::Normal;
+        return style;
+    }
+
     native_font::native_font(FT_Library aFontLib, const std::string aFileName) :
-        iFontLib(aFontLib), iSource(filename_type(aFileName)), iCache{}, iFaceCount(0)
+        iFontLib(aFontLib), iSource(filename_type(aFileName)), iFaceCount(0)
     {
         register_faces();
     }
 
     native_font::native_font(FT_Library aFontLib, const void* aData, std::size_t aSizeInBytes) :
-        iFontLib(aFontLib), iSource(memory_block_type(aData, aSizeInBytes)), iCache{}, iFaceCount(0)
+        iFontLib(aFontLib), iSource(memory_block_type(aData, aSizeInBytes)), iFaceCount(0)
     {
         register_faces();
     }
 
+    native_font::native_font(FT_Library aFontLib, const std::string aFileName, std::string const& aFamilyName, std::vector<indexed_face> const& aFaces) :
+        iFontLib(aFontLib), iSource(filename_type(aFileName)), iFamilyName(aFamilyName), iFaceCount(static_cast<FT_Long>(aFaces.size()))
+    {
+        for (auto const& face : aFaces)
+            iStyleMap.emplace(std::make_pair(face.style, face.styleName), face.faceIndex);
+        add_emulated_styles();
+    }
+
     native_font::~native_font()
     {
         if (iHarfbuzzBlob != nullptr)
@@ -163,6 +188,11 @@ namespace neogfx
         register_face(0);
         for (FT_Long f = 1; f < iFaceCount; ++f)
             register_face(f);
+        add_emulated_styles();
+    }
+
+    void native_font::add_emulated_styles()
+    {
         if (!has_style(font_style::Bold) && has_style(font_style::Normal))
         {
             auto existingNormal = find_style(font_style::Normal);
@@ -179,8 +209,6 @@ namespace neogfx
             auto existingNormal = find_style(font_style::Normal);
             iStyleMap.emplace(std::make_pair(font_style::EmulatedBoldItalic, "Bold Italic (Emulated)"), existingNormal->second);
         }
-        iCache.clear();
-        iCache.shrink_to_fit();
     }
 
     void native_font::register_face(FT_Long aFaceIndex)
@@ -193,19 +221,7 @@ namespace neogfx
                 iFaceCount = face.first->num_faces;
                 iFamilyName = face.first->family_name;
             }
-            font_style style = font_style::Invalid;
-            if (face.first->style_flags & FT_STYLE_FLAG_ITALIC)
-                style |= static_cast<font_style>(style | font_style::Italic);
-            if (face.first->style_flags & FT_STYLE_FLAG_BOLD)
-                style |= static_cast<font_style>(style | font_style::Bold);
-            auto const searchKey = neolib::ci_string{ face.first->style_name };
-            if (searchKey.find("italic") != neolib::ci_string::npos)
-                style |= font_style::Italic;
-            if (searchKey.find("bold") != neolib::ci_string::npos || searchKey.find("heavy") != neolib::ci_string::npos || searchKey.find("black") != neolib::ci_string::npos)
-                style |= font_style::Bold;
-            if (style == font_style::Invalid)
-                style = font_style::Normal;
-            iStyleMap.emplace(std::make_pair(style, face.first->style_name), aFaceIndex);
+            iStyleMap.emplace(std::make_pair(native_face_style(face.first), face.first->style_name), aFaceIndex);
         }
         catch (...)
         {
@@ -218,44 +234,31 @@ namespace neogfx
     std::pair<FT_Face, hb_face_t*> native_font::open_face(FT_Long aFaceIndex)
     {
         std::pair<FT_Face, hb_face_t*> face;
-        if (std::holds_alternative<filename_type>(iSource))
+        // One blob per font file shared by FreeType and HarfBuzz; for files HarfBuzz memory-maps the file
+        // (falling back to reading it) so faces are paged in on demand rather than copied into the heap.
+        if (iHarfbuzzBlob == nullptr)
         {
-            if (iCache.empty())
+            if (std::holds_alternative<filename_type>(iSource))
+                iHarfbuzzBlob = hb_blob_create_from_file_or_fail(std::get<filename_type>(iSource).c_str());
+            else
             {
-                std::size_t fileSize = static_cast<std::size_t>(std::filesystem::file_size(static_variant_cast<const filename_type&>(iSource)));
-                iCache.resize(fileSize);
-                std::ifstream file{ std::get<filename_type>(iSource).c_str(), std::ios::in | std::ios::binary };
-                file.read(reinterpret_cast<char*>(&iCache[0]), fileSize);
+                auto const& memBlk = std::get<memory_block_type>(iSource);
+                iHarfbuzzBlob = hb_blob_create_or_fail(static_cast<const char*>(memBlk.first), static_cast<unsigned int>(memBlk.second), hb_memory_mode_t::HB_MEMORY_MODE_READONLY, nullptr, nullptr);
             }
-            FT_Error error = FT_New_Memory_Face(
-                iFontLib,
-                static_cast<const FT_Byte*>(&iCache[0]),
-                static_cast<FT_Long>(iCache.size()),
-                aFaceIndex,
-                &face.first);
-            if (error)
-                throw failed_to_load_font();
-            iHarfbuzzBlob = hb_blob_create_from_file_or_fail(std::get<filename_type>(iSource).c_str());
-            if (iHarfbuzzBlob == nullptr)
-                throw failed_to_load_font();
-            face.second = hb_face_create(iHarfbuzzBlob, aFaceIndex);
-        }
-        else
-        {
-            auto const& memBlk = std::get<memory_block_type>(iSource);
-            FT_Error error = FT_New_Memory_Face(
-                iFontLib,
-                static_cast<const FT_Byte*>(memBlk.first),
-                static_cast<FT_Long>(memBlk.second),
-                aFaceIndex,
-                &face.first);
-            if (error)
-                throw failed_to_load_font();
-            iHarfbuzzBlob = hb_blob_create_or_fail(static_cast<const char*>(memBlk.first), static_cast<unsigned int>(memBlk.second), hb_memory_mode_t::HB_MEMORY_MODE_READONLY, nullptr, nullptr);
             if (iHarfbuzzBlob == nullptr)
                 throw failed_to_load_font();
-            face.second = hb_face_create(iHarfbuzzBlob, aFaceIndex);
         }
+        unsigned int dataLength = 0u;
+        auto const data = hb_blob_get_data(iHarfbuzzBlob, &dataLength);
+        FT_Error error = FT_New_Memory_Face(
+            iFontLib,
+            reinterpret_cast<const FT_Byte*>(data),
+            static_cast<FT_Long>(dataLength),
+            aFaceIndex,
+            &face.first);
+        if (error)
+            throw failed_to_load_font();
+        face.second = hb_face_create(iHarfbuzzBlob, aFaceIndex);
         return face;
     }
 
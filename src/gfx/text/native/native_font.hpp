@@ -34,11 +34,19 @@
 
 namespace neogfx
 {
+    font_style native_face_style(FT_Face aFace);
+
     class native_font : public reference_counted<i_native_font>
     {
     public:
         typedef std::string filename_type;
         typedef std::pair<const void*, std::size_t> memory_block_type;
+        struct indexed_face
+        {
+            FT_Long faceIndex;
+            font_style style;
+            std::string styleName;
+        };
     private:
         typedef std::variant<std::monostate, filename_type, memory_block_type> source_type;
         typedef std::map<std::pair<font_style, string>, FT_Long> style_map;
@@ -49,6 +57,7 @@ namespace neogfx
     public:
         native_font(FT_Library aFontLib, const std::string aFileName);
         native_font(FT_Library aFontLib, const void* aData, std::size_t aSizeInBytes);
+        native_font(FT_Library aFontLib, const std::string aFileName, std::string const& aFamilyName, std::vector<indexed_face> const& aFaces);
         ~native_font();
     public:
         i_string const& family_name() const final;
@@ -65,13 +74,13 @@ namespace neogfx
         style_map::const_iterator find_style(font_style aStyle) const;
         void register_faces();
         void register_face(FT_Long aFaceIndex);
+        void add_emulated_styles();
         std::pair<FT_Face, hb_face_t*> open_face(FT_Long aFaceIndex);
         void close_face(FT_Face aFace);
         ref_ptr<i_native_font_face> create_face(FT_Long aFaceIndex, font_style aStyle, font::point_size aSize, stroke aOutline, i_device_resolution const& aDevice);
     private:
         FT_Library iFontLib;
         source_type iSource;
-        std::vector<unsigned char> iCache;
         hb_blob_t* iHarfbuzzBlob = nullptr;
         string iFamilyName;
         FT_Long iFaceCount;
@@ -92,6 +92,17 @@ namespace neogfx
 
     native_font_face::~native_font_face()
     {
+        auto& glyphAtlas = service<i_font_manager>().glyph_atlas();
+        auto destroy_glyph_textures = [&](i_glyph const& aGlyph)
+        {
+            glyphAtlas.destroy_sub_texture(glyphAtlas.sub_texture(aGlyph.texture().atlas_id()));
+            if (aGlyph.has_outline_texture())
+                glyphAtlas.destroy_sub_texture(glyphAtlas.sub_texture(aGlyph.outline_texture().atlas_id()));
+        };
+        for (auto const& glyph : iGlyphs)
+            destroy_glyph_textures(glyph.second);
+        if (iInvalidGlyph != std::nullopt)
+            destroy_glyph_textures(*iInvalidGlyph);
         if (iHandle.freetypeFace != nullptr)
             sGetAdvanceCache.erase(sGetAdvanceCache.find(iHandle.freetypeFace));
         FT_Done_Face(iHandle.freetypeFace);
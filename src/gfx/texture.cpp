@@ -214,6 +214,13 @@ namespace neogfx
         return native_texture().get_pixel(aPosition);
     }
 
+    void texture::copy_pixels(const rect& aSourceRect, i_texture& aDestination, const point& aDestinationPosition) const
+    {
+        if (is_empty())
+            throw texture_empty();
+        native_texture().copy_pixels(aSourceRect, aDestination, aDestinationPosition);
+    }
+
     i_vector<texture_line_segment> const& texture::intersection(texture_line_segment const& aLine, rect const& aBoundingBox, vec2 const& aSampleSize, scalar aTolerance) const
     {
         if (is_empty())
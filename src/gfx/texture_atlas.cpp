@@ -19,6 +19,8 @@
 
 #include <neogfx/neogfx.hpp>
 
+#include <algorithm>
+
 #include <neogfx/gfx/texture_atlas.hpp>
 #include <neogfx/gfx/image.hpp>
 
@@ -50,6 +52,7 @@ namespace neogfx
         auto newSpace = allocate_space(aSize, aDpiScaleFactor, aSampling, aDataFormat);
         auto nextId = iTextureManager.allocate_texture_id();
         auto entry = iEntries.emplace(std::piecewise_construct, std::forward_as_tuple(nextId), std::forward_as_tuple(newSpace.first, nextId, newSpace.first->first, newSpace.second, aSize));
+        entry.first->second.lastUse = ++iUseClock;
         return *entry.first->second.texture;
     }
 
@@ -58,6 +61,7 @@ namespace neogfx
         auto newSpace = allocate_space(aImage.extents(), aImage.dpi_scale_factor(), aImage.sampling(), aImage.data_format());
         auto nextId = iTextureManager.allocate_texture_id();
         auto entry = iEntries.emplace(std::piecewise_construct, std::forward_as_tuple(nextId), std::forward_as_tuple(newSpace.first, nextId, newSpace.first->first, newSpace.second, aImage.extents()));
+        entry.first->second.lastUse = ++iUseClock;
         entry.first->second.texture->set_pixels(aImage);
         return *entry.first->second.texture;
     }
@@ -67,6 +71,7 @@ namespace neogfx
         auto newSpace = allocate_space(aImagePart.extents(), aImage.dpi_scale_factor(), aImage.sampling(), aImage.data_format());
         auto nextId = iTextureManager.allocate_texture_id();
         auto entry = iEntries.emplace(std::piecewise_construct, std::forward_as_tuple(nextId), std::forward_as_tuple(newSpace.first, nextId, newSpace.first->first, newSpace.second, aImagePart.extents()));
+        entry.first->second.lastUse = ++iUseClock;
         entry.first->second.texture->set_pixels(aImage, aImagePart);
         return *entry.first->second.texture;
     }
@@ -76,12 +81,98 @@ namespace neogfx
         auto iterEntry = iEntries.find(aSubTexture.atlas_id());
         if (iterEntry == iEntries.end() || &aSubTexture != &*iterEntry->second.texture)
             throw sub_texture_not_found();
-        auto rectEntry = iterEntry->second.texture->atlas_location();
-        auto space = iterEntry->second.page->second.used.find(rectEntry);
-        if (space != iterEntry->second.page->second.used.end())
-            iterEntry->second.page->second.used.erase(space);
-        iterEntry->second.page->second.freed.insert(rectEntry);
+        auto const page = iterEntry->second.page;
+        page->second.erase(iterEntry->second.texture->atlas_location().inflated(size{ 1.0, 1.0 }));
+        // the texture list keeps the sub-texture alive while the atlas gives up its reference
+        auto& subTexture = *iterEntry->second.texture;
         iEntries.erase(iterEntry);
+        iTextureManager.remove_sub_texture(subTexture);
+        release_page_if_empty(page);
+    }
+
+    void texture_atlas::touch(texture_id aSubTextureId) const
+    {
+        auto iterEntry = iEntries.find(aSubTextureId);
+        if (iterEntry != iEntries.end())
+            iterEntry->second.lastUse = ++iUseClock;
+    }
+
+    std::uint64_t texture_atlas::last_use(texture_id aSubTextureId) const
+    {
+        auto iterEntry = iEntries.find(aSubTextureId);
+        if (iterEntry == iEntries.end())
+            throw sub_texture_not_found();
+        return iterEntry->second.lastUse;
+    }
+
+    std::uint32_t texture_atlas::page_count() const
+    {
+        return static_cast<std::uint32_t>(iPages.size());
+    }
+
+    std::uint32_t texture_atlas::defragment(std::uint32_t aMaxMoves)
+    {
+        std::uint32_t moves = 0u;
+        while (moves < aMaxMoves)
+        {
+            // empty the least occupied page into the most occupied pages of the same kind
+            auto source = iPages.end();
+            dimension sourceArea = 0.0;
+            std::vector<pages::iterator> targets;
+            for (auto iterPage = iPages.begin(); iterPage != iPages.end(); ++iterPage)
+            {
+                auto const area = iterPage->second.used_area();
+                bool hasSibling = false;
+                for (auto iterOther = iPages.begin(); !hasSibling && iterOther != iPages.end(); ++iterOther)
+                    hasSibling = (iterOther != iterPage && page_matches(*iterOther, iterPage->first.dpi_scale_factor(), iterPage->first.sampling(), iterPage->first.data_format()));
+                if (hasSibling && (source == iPages.end() || area < sourceArea))
+                {
+                    source = iterPage;
+                    sourceArea = area;
+                }
+            }
+            if (source == iPages.end())
+                break;
+            dimension targetFreeArea = 0.0;
+            for (auto iterPage = iPages.begin(); iterPage != iPages.end(); ++iterPage)
+                if (iterPage != source && page_matches(*iterPage, source->first.dpi_scale_factor(), source->first.sampling(), source->first.data_format()))
+                {
+                    targets.push_back(iterPage);
+                    targetFreeArea += page_size().cx * page_size().cy - iterPage->second.used_area();
+                }
+            if (targetFreeArea < sourceArea)
+                break;
+            std::sort(targets.begin(), targets.end(), [](pages::iterator lhs, pages::iterator rhs) { return lhs->second.used_area() > rhs->second.used_area(); });
+            // most recently used first so that if the pass runs out of moves what remains behind is cold
+            std::vector<entry*> live;
+            bool stuck = false;
+            for (auto& e : iEntries)
+                if (e.second.page == source)
+                {
+                    // copies of a sub-texture hold their own atlas location so only entries referenced
+                    // solely by the atlas and the texture list can be moved
+                    if (iTextureManager.use_count(e.first) > 2)
+                        stuck = true;
+                    live.push_back(&e.second);
+                }
+            if (stuck)
+                break;
+            std::sort(live.begin(), live.end(), [](entry const* lhs, entry const* rhs) { return lhs->lastUse > rhs->lastUse; });
+            for (auto e : live)
+            {
+                if (moves == aMaxMoves)
+                    break;
+                if (!relocate(*e, targets))
+                {
+                    stuck = true;
+                    break;
+                }
+                ++moves;
+            }
+            if (stuck || !release_page_if_empty(source))
+                break;
+        }
+        return moves;
     }
 
     const size& texture_atlas::page_size() const
@@ -89,6 +180,11 @@ namespace neogfx
         return iPageSize;
     }
 
+    bool texture_atlas::page_matches(const page& aPage, dimension aDpiScaleFactor, texture_sampling aSampling, texture_data_format aDataFormat)
+    {
+        return aPage.first.dpi_scale_factor() == aDpiScaleFactor && aPage.first.sampling() == aSampling && aPage.first.data_format() == aDataFormat;
+    }
+
     texture_atlas::pages::iterator texture_atlas::create_page(dimension aDpiScaleFactor, texture_sampling aSampling, texture_data_format aDataFormat)
     {
         return iPages.insert(iPages.end(), page{ texture{ page_size(), aDpiScaleFactor, aSampling, aDataFormat }, fragments{ page_size() } });
@@ -100,7 +196,7 @@ namespace neogfx
             create_page(aDpiScaleFactor, aSampling, aDataFormat);
         rect result;
         for (auto iterPage = iPages.begin(); iterPage != iPages.end(); ++iterPage)
-            if (iterPage->first.dpi_scale_factor() == aDpiScaleFactor && iterPage->first.sampling() == aSampling && iterPage->first.data_format() == aDataFormat && iterPage->second.insert(aSize + size{ 2.0, 2.0 }, result))
+            if (page_matches(*iterPage, aDpiScaleFactor, aSampling, aDataFormat) && iterPage->second.insert(aSize + size{ 2.0, 2.0 }, result))
                 return std::make_pair(iterPage, result + point{ 1.0, 1.0 } + size{ -2.0, -2.0 });
         auto iterPage = create_page(aDpiScaleFactor, aSampling, aDataFormat);
         if (iterPage->second.insert(aSize + size{ 2.0, 2.0 }, result))
@@ -108,4 +204,40 @@ namespace neogfx
         iPages.erase(iterPage);
         throw texture_too_big_for_atlas();
     }
+
+    bool texture_atlas::relocate(entry& aEntry, const std::vector<pages::iterator>& aTargets)
+    {
+        auto& subTexture = *aEntry.texture;
+        auto const source = aEntry.page;
+        auto const space = subTexture.atlas_location().inflated(size{ 1.0, 1.0 });
+        for (auto target : aTargets)
+        {
+            rect newSpace;
+            if (!target->second.insert(space.extents(), newSpace))
+                continue;
+            source->first.copy_pixels(space, target->first, newSpace.top_left());
+            source->second.erase(space);
+            subTexture.relocate(target->first, newSpace + point{ 1.0, 1.0 } + size{ -2.0, -2.0 });
+            aEntry.page = target;
+            return true;
+        }
+        return false;
+    }
+
+    bool texture_atlas::release_page_if_empty(pages::iterator aPage)
+    {
+        if (!aPage->second.used.empty())
+            return false;
+        // a page still referenced from outside the atlas (e.g. by a copied sub-texture) has to stay
+        if (iTextureManager.use_count(aPage->first.id()) > 2)
+            return false;
+        // keep the last page of each kind so that a steady trickle of allocations doesn't thrash page creation
+        for (auto iterPage = iPages.begin(); iterPage != iPages.end(); ++iterPage)
+            if (iterPage != aPage && page_matches(*iterPage, aPage->first.dpi_scale_factor(), aPage->first.sampling(), aPage->first.data_format()))
+            {
+                iPages.erase(aPage);
+                return true;
+            }
+        return false;
+    }
 }
\ No newline at end of file
@@ -83,6 +83,15 @@ namespace neogfx
         textures().add(aSubTexture.id(), &aSubTexture);
     }
 
+    void texture_manager::remove_sub_texture(i_sub_texture& aSubTexture)
+    {
+        release(aSubTexture.atlas_texture().id());
+        // the atlas has already dropped its reference so, unless copies of the sub-texture are still alive, this list
+        // is the last owner; otherwise release() removes it when the last copy goes
+        if (textures().contains(aSubTexture.id()) && textures()[aSubTexture.id()].unique())
+            textures().remove(aSubTexture.id());
+    }
+
     const texture_manager::texture_list& texture_manager::textures() const
     {
         return iTextures;
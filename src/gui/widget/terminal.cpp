@@ -167,33 +167,46 @@ namespace neogfx
         {
             if (line.glyphs == std::nullopt)
             {
-                line.glyphs = aGc.to_glyph_text(line.text,
+                line.expanded = std::nullopt;
+                // scrollback keeps its glyphs in compact form; only visible lines are expanded for drawing
+                auto const lineGlyphs = aGc.to_glyph_text(line.text,
                     [&](std::size_t n) -> neogfx::font
                     {
                         return n < line.attributes.size() ? font(line.attributes[n].style) : normal_font();
                     });
+                line.glyphs.emplace();
+                line.glyphs->set_major_font(lineGlyphs.major_font());
+                line.glyphs->set_baseline(lineGlyphs.baseline());
                 float xPrevious = 0.0f;
-                for (auto& g : *line.glyphs)
+                for (auto g : lineGlyphs)
                 {
                     g.cell[0].x = xPrevious;
                     g.cell[1].x = xPrevious + static_cast<float>(ce.cx);
                     g.cell[2].x = xPrevious + static_cast<float>(ce.cx);
                     g.cell[3].x = xPrevious;
                     xPrevious += static_cast<float>(ce.cx);
+                    line.glyphs->push_back(compact_glyph_char{ g });
                 }
             }
             if (y + ce.cy >= cr.top() && y < cr.bottom())
             {
+                // the expansion is kept while the line stays visible rather than allocated again on every paint
+                if (line.expanded == std::nullopt)
+                {
+                    line.expanded = expand_glyph_text(*line.glyphs);
+                    for (auto& g : *line.expanded)
+                        if (line.attributes[g.clusters.first].underline)
+                            set_underline(g, true);
+                }
+                auto const& glyphs = *line.expanded;
                 thread_local text_format_spans attributes;
                 attributes.clear();
-                for (auto& g : *line.glyphs)
+                for (auto const& g : glyphs)
                 {
                     auto ink = line.attributes[g.clusters.first].ink;
                     auto paper = line.attributes[g.clusters.first].paper;
                     if (line.attributes[g.clusters.first].reverse)
                         std::swap(ink, paper);
-                    if (line.attributes[g.clusters.first].underline)
-                        set_underline(g, true);
                     optional_text_effect effect;
                     if (iTextFormat)
                     {
@@ -207,8 +220,10 @@ namespace neogfx
                     }
                     attributes.add(g.clusters.first, ink, paper, effect);
                 }
-                aGc.draw_glyphs(tl + point{ 0, y }, *line.glyphs, attributes);
+                aGc.draw_glyphs(tl + point{ 0, y }, glyphs, attributes);
             }
+            else
+                line.expanded = std::nullopt;
             y += ce.cy;
         }
 
@@ -19,10 +19,13 @@
 
 #include <neogfx/neogfx.hpp>
 
+#include <deque>
+#include <future>
 #include <boost/algorithm/string/find.hpp>
 
 #include <neolib/core/scoped.hpp>
 #include <neolib/task/thread.hpp>
+#include <neolib/task/thread_pool.hpp>
 #include <neolib/app/i_power.hpp>
 
 #include <neogfx/app/i_basic_services.hpp>
@@ -80,6 +83,247 @@ namespace neogfx
         scoped_property_transition_suppression iSts2;
     };
 
+    class text_edit::paragraph_shaper : public widget_timer
+    {
+    public:
+        static constexpr std::size_t Threshold = 65536u;
+    private:
+        static constexpr std::size_t BatchSize = 256u;
+        static constexpr std::size_t MaxBatchLength = 65536u;
+        static constexpr std::chrono::milliseconds CommitBudget{ 8 };
+        using font_run = std::pair<std::u32string::size_type, neogfx::font>;
+        struct paragraph
+        {
+            document_text::difference_type textFirst;
+            document_text::difference_type textLast;
+            column_delimiters columnDelimiters;
+        };
+        struct batch
+        {
+            std::vector<paragraph> paragraphs;
+            std::u32string text;
+            std::vector<font_run> fontRuns;
+            std::future<std::vector<std::optional<shaped_glyph_text>>> result;
+        };
+    public:
+        paragraph_shaper(text_edit& aOwner) :
+            widget_timer{ aOwner, [&](widget_timer& aTimer)
+            {
+                if (process())
+                    aTimer.again();
+            }, std::chrono::milliseconds{ 16 } },
+            iOwner{ aOwner },
+            iGc{ aOwner, graphics_context::type::Unattached },
+            iNextText{ 0 },
+            iCommittedText{ 0 },
+            iLaidOutText{ 0 },
+            iColumnCount{ 0u },
+            iCancelled{ false },
+            iFinished{ false }
+        {
+            if (aOwner.password() && (!aOwner.iPasswordBits || !aOwner.iPasswordBits.value().showPassword.is_pressed()))
+                iGc.set_password(true, aOwner.PasswordMask.value().empty() ? "\xE2\x97\x8F"_s : aOwner.PasswordMask);
+            iGc.set_tab_stops(aOwner.tab_stops());
+            // the pool threads only see this snapshot; iGc itself is only used on the UI thread
+            iShapingContext = service<i_font_manager>().glyph_text_factory().shaping_context(iGc);
+        }
+        ~paragraph_shaper()
+        {
+            iCancelled = true;
+            for (auto& b : iBatches)
+                if (b.result.valid())
+                    b.result.wait();
+        }
+    public:
+        bool finished() const
+        {
+            return iFinished;
+        }
+        void start()
+        {
+            // shape what is initially visible on this thread; the rest of the document is shaped on the thread pool...
+            auto const visibleLines = static_cast<std::size_t>(std::ceil(iOwner.client_rect(false).cy / std::max(iOwner.font().height(), 1.0))) + 1u;
+            if (prepare_batch(visibleLines))
+            {
+                commit(iBatches.back(), shape(iBatches.back()));
+                iBatches.pop_back();
+            }
+            dispatch();
+            refresh();
+        }
+        void finish()
+        {
+            while (!finished())
+            {
+                dispatch();
+                if (iBatches.empty())
+                    break;
+                commit(iBatches.front(), iBatches.front().result.get());
+                iBatches.pop_front();
+            }
+            refresh();
+        }
+        // moving the cursor past what has been shaped would wait for shaping to finish so it is moved once shaping
+        // gets there
+        void move_cursor_when_shaped(position_type aPosition)
+        {
+            iPendingCursor = aPosition;
+            move_pending_cursor();
+        }
+    private:
+        bool process()
+        {
+            if (finished())
+                return false;
+            auto const start = std::chrono::steady_clock::now();
+            bool committed = false;
+            while (!iBatches.empty() && iBatches.front().result.wait_for(std::chrono::seconds{ 0 }) == std::future_status::ready)
+            {
+                commit(iBatches.front(), iBatches.front().result.get());
+                iBatches.pop_front();
+                committed = true;
+                if (std::chrono::steady_clock::now() - start >= CommitBudget)
+                    break;
+            }
+            dispatch();
+            // laying out again only once the committed text has doubled keeps total layout work linear in document size
+            if (iBatches.empty() || (committed && iCommittedText >= iLaidOutText * 2))
+                refresh();
+            return !finished();
+        }
+        bool prepare_batch(std::size_t aMaxParagraphs = BatchSize)
+        {
+            auto const& text = iOwner.iText;
+            if (iNextText >= static_cast<document_text::difference_type>(text.size()))
+                return false;
+            auto& b = iBatches.emplace_back();
+            auto const last = text.cend();
+            auto nextParagraph = std::next(text.cbegin(), iNextText);
+            column_delimiters columnDelimiters;
+            for (auto iterChar = nextParagraph; iterChar != last; ++iterChar)
+            {
+                auto const ch = iterChar->character;
+                auto const& column = iOwner.iColumns[std::min(columnDelimiters.size(), iOwner.iColumns.size() - 1)];
+                if (ch == column.info.delimiter && columnDelimiters.size() + 1 < iOwner.iColumns.size())
+                    columnDelimiters.push_back(std::distance(nextParagraph, iterChar));
+                auto const& characterFont = iOwner.character_font(nextParagraph, std::distance(nextParagraph, iterChar), columnDelimiters);
+                if (b.fontRuns.empty() || b.fontRuns.back().second != characterFont)
+                    b.fontRuns.emplace_back(b.text.size(), characterFont);
+                b.text.push_back(ch);
+                if (ch == U'\n' || std::next(iterChar) == last)
+                {
+                    b.paragraphs.push_back(paragraph{ 
+                        std::distance(text.cbegin(), nextParagraph), 
+                        std::distance(text.cbegin(), std::next(iterChar)), 
+                        columnDelimiters });
+                    nextParagraph = std::next(iterChar);
+                    columnDelimiters.clear();
+                    if (b.paragraphs.size() >= aMaxParagraphs || b.text.size() >= MaxBatchLength)
+                        break;
+                }
+            }
+            iNextText = std::distance(text.cbegin(), nextParagraph);
+            return true;
+        }
+        void dispatch()
+        {
+            auto const maxInFlight = std::max<std::size_t>(std::thread::hardware_concurrency(), 1u) * 2u;
+            while (iBatches.size() < maxInFlight && prepare_batch())
+            {
+                auto& b = iBatches.back();
+                b.result = neolib::thread_pool::default_thread_pool().run([this, &b]() { return shape(b); });
+            }
+        }
+        static std::u32string_view paragraph_text(batch const& aBatch, paragraph const& aParagraph)
+        {
+            auto const offset = static_cast<std::size_t>(aParagraph.textFirst - aBatch.paragraphs.front().textFirst);
+            return std::u32string_view{ std::next(aBatch.text.data(), offset), static_cast<std::size_t>(aParagraph.textLast - aParagraph.textFirst) };
+        }
+        static std::function<neogfx::font(std::size_t)> paragraph_fonts(batch const& aBatch, paragraph const& aParagraph)
+        {
+            auto const offset = static_cast<std::u32string::size_type>(aParagraph.textFirst - aBatch.paragraphs.front().textFirst);
+            return [&aBatch, offset](std::size_t aSourceIndex)
+            {
+                auto const run = std::upper_bound(aBatch.fontRuns.begin(), aBatch.fontRuns.end(), offset + aSourceIndex,
+                    [](std::u32string::size_type aIndex, font_run const& aRun) { return aIndex < aRun.first; });
+                return std::prev(run)->second;
+            };
+        }
+        std::vector<std::optional<shaped_glyph_text>> shape(batch const& aBatch) const
+        {
+            // runs on the thread pool: HarfBuzz shaping only, glyphs are rasterized when the batch is committed
+            std::vector<std::optional<shaped_glyph_text>> result;
+            result.reserve(aBatch.paragraphs.size());
+            for (auto const& p : aBatch.paragraphs)
+            {
+                if (iCancelled)
+                    break;
+                result.push_back(service<i_font_manager>().glyph_text_factory().shape_glyph_text(iShapingContext, paragraph_text(aBatch, p), paragraph_fonts(aBatch, p)));
+            }
+            return result;
+        }
+        void commit(batch const& aBatch, std::vector<std::optional<shaped_glyph_text>> const& aResult)
+        {
+            auto& factory = service<i_font_manager>().glyph_text_factory();
+            auto& glyphs = iOwner.glyphs();
+            auto& paragraphs = iOwner.iGlyphParagraphs;
+            for (std::size_t i = 0; i < aResult.size(); ++i)
+            {
+                auto const& p = aBatch.paragraphs[i];
+                // paragraphs that need fallback fonts or emoji could not be shaped off the UI thread
+                auto const gt = aResult[i] ? 
+                    factory.resolve_glyph_text(aResult[i].value()) :
+                    factory.to_glyph_text(iGc, paragraph_text(aBatch, p), paragraph_fonts(aBatch, p), false);
+                iCommittedText = p.textLast;
+                iColumnCount = std::max(iColumnCount, p.columnDelimiters.size() + 1);
+                if (gt.cbegin() == gt.cend())
+                    continue;
+                auto const paragraphGlyphs = glyphs.insert(glyphs.cend(), gt.cbegin(), gt.cend());
+                for (auto& newGlyph : gt)
+                    glyphs.glyph_font(newGlyph);
+                document_span const span{
+                    p.textFirst,
+                    p.textLast,
+                    std::distance(glyphs.begin(), paragraphGlyphs),
+                    std::distance(glyphs.begin(), std::next(paragraphGlyphs, gt.size())) };
+                auto const paragraph = paragraphs.emplace(paragraphs.cend(), &iOwner, span);
+                paragraph->columnBreaks.assign(p.columnDelimiters.begin(), p.columnDelimiters.end());
+                paragraph->lineBreaks.assign(gt.content().line_breaks().begin(), gt.content().line_breaks().end());
+            }
+        }
+        void refresh()
+        {
+            iFinished = iBatches.empty() && iNextText >= static_cast<document_text::difference_type>(iOwner.iText.size());
+            iOwner.iGlyphColumns.resize(std::max(iColumnCount, iOwner.iGlyphColumns.size()), { &iOwner });
+            for (auto& column : iOwner.iGlyphColumns)
+                column.lines.clear();
+            iOwner.refresh_columns();
+            iLaidOutText = iCommittedText;
+            move_pending_cursor();
+        }
+        void move_pending_cursor()
+        {
+            if (!iPendingCursor || (!iFinished && static_cast<document_text::difference_type>(*iPendingCursor) >= iLaidOutText))
+                return;
+            auto const position = *iPendingCursor;
+            iPendingCursor = std::nullopt;
+            iOwner.cursor().set_position(position);
+            iOwner.iCursorHint.x = iOwner.glyph_position(iOwner.cursor_glyph_position(), true).pos.x;
+        }
+    private:
+        text_edit& iOwner;
+        graphics_context iGc;
+        glyph_shaping_context iShapingContext;
+        std::deque<batch> iBatches;
+        document_text::difference_type iNextText;
+        document_text::difference_type iCommittedText;
+        document_text::difference_type iLaidOutText;
+        std::size_t iColumnCount;
+        std::atomic<bool> iCancelled;
+        bool iFinished;
+        std::optional<position_type> iPendingCursor;
+    };
+
     text_edit::character_style::character_style() :
         iSmartUnderline{ false },
         iIgnoreEmoji{ true }
@@ -2006,6 +2250,7 @@ namespace neogfx
 
     void text_edit::clear()
     {
+        iParagraphShaper = nullptr;
         cursor().set_position(0);
         iPreviousText = iText;
         iText.clear();
@@ -2090,6 +2335,8 @@ namespace neogfx
         if (aStart == aEnd)
             return;
 
+        finish_shaping();
+
         auto eraseBegin = iText.begin() + aStart;
         auto eraseEnd = iText.begin() + aEnd;
         auto eraseAmount = eraseEnd - eraseBegin;
@@ -2097,7 +2344,7 @@ namespace neogfx
         iPreviousText = iText;
         iUtf8TextCache = std::nullopt;
 
-        for (auto& ch : std::ranges::subrange(eraseBegin, eraseEnd))
+        for (auto const ch : std::ranges::subrange(eraseBegin, eraseEnd))
         {
             auto existingStyle = iStyleMap.find(ch.style);
             if (existingStyle != iStyleMap.end())
@@ -2304,6 +2551,8 @@ namespace neogfx
         
         iSink += cursor().PositionChanged([this]()
         {
+            if (shaping_in_progress() && (iGlyphParagraphs.empty() || cursor().position() >= iGlyphParagraphs.back().text_end_index()))
+                finish_shaping();
             if (neolib::service<i_keyboard>().layout().ime_active(*this))
                 neolib::service<i_keyboard>().layout().update_ime_position(cursor_rect().bottom_left());
             iNextStyle = std::nullopt;
@@ -2352,6 +2601,9 @@ namespace neogfx
         if (!accept)
             return 0;
 
+        if (!aClearFirst)
+            finish_shaping();
+
         iPreviousText = iText;
         iUtf8TextCache = std::nullopt;
 
@@ -2381,7 +2633,8 @@ namespace neogfx
             }
 
             auto const pos = std::distance(iText.cbegin(), aWhere);
-            auto next = std::next(iText.begin(), pos);
+            thread_local std::u32string filtered;
+            filtered.clear();
             char32_t previousChar = (aWhere != iText.begin() ? std::prev(aWhere)->character : 0);
             for (auto const ch : std::ranges::subrange(begin, end))
             {
@@ -2393,7 +2646,10 @@ namespace neogfx
                     case '\n':
                         if (previousChar == '\r')
                         {
-                            std::prev(next)->character = '\n';
+                            if (!filtered.empty())
+                                filtered.back() = '\n';
+                            else
+                                iText.replace(static_cast<document_text::size_type>(pos - 1), '\n');
                             if (is_automatic(iLineEnding))
                                 iLineEnding = text_edit_line_ending::AutomaticLfCr;
                             discard = true;
@@ -2419,11 +2675,12 @@ namespace neogfx
                 }
                 if (!discard)
                 {
-                    next = std::next(iText.insert(next, document_char{ ch, style.cookie() }));
+                    filtered.push_back(ch);
                     ++insertionSize;
                 }
                 previousChar = ch;
             }
+            iText.insert(std::next(iText.cbegin(), pos), filtered.data(), filtered.data() + filtered.size(), style.cookie());
             return std::next(iText.begin(), pos);
         };
 
@@ -2475,7 +2732,9 @@ namespace neogfx
 
         update();
         
-        if (aMoveCursor)
+        if (aMoveCursor && shaping_in_progress())
+            iParagraphShaper->move_cursor_when_shaped(insertionPoint - iText.begin() + insertionSize);
+        else if (aMoveCursor)
         {
             cursor().set_position(insertionPoint - iText.begin() + insertionSize);
             iCursorHint.x = glyph_position(cursor_glyph_position(), true).pos.x;
@@ -2572,8 +2831,17 @@ namespace neogfx
         if (aDelta == 0 || iGlyphParagraphs.empty())
         {
             (void)aWhere;
+            iParagraphShaper = nullptr;
             glyphs().clear();
             iGlyphParagraphs.clear();
+            if ((iCaps & text_edit_caps::ParallelShaping) == text_edit_caps::ParallelShaping && iText.size() >= paragraph_shaper::Threshold)
+            {
+                if (iPasswordBits)
+                    iPasswordBits.value().showPassword.show(!iText.empty());
+                iParagraphShaper = std::make_unique<paragraph_shaper>(*this);
+                iParagraphShaper->start();
+                return;
+            }
             first = iText.begin();
             last = iText.end();
             glyphsInsertPos = glyphs().end();
@@ -2613,21 +2881,12 @@ namespace neogfx
             gc.set_password(true, PasswordMask.value().empty() ? "\xE2\x97\x8F"_s : PasswordMask);
 
         auto nextParagraph = first;
-        thread_local std::vector<std::u32string::difference_type> cachedColumnDelimiters;
+        thread_local column_delimiters cachedColumnDelimiters;
         auto& columnDelimiters = cachedColumnDelimiters;
  
         auto fs = [this, &nextParagraph, &columnDelimiters](std::u32string::size_type aSourceIndex)
         {
-            auto characterStyle = iStyleMap.find(std::next(nextParagraph, aSourceIndex)->style);
-            std::size_t indexColumn = std::lower_bound(columnDelimiters.begin(), columnDelimiters.end(), 
-                static_cast<std::u32string::difference_type>(aSourceIndex)) - columnDelimiters.begin();
-            if (indexColumn > columns() - 1)
-                indexColumn = columns() - 1;
-            auto const& columnStyle = column_style(indexColumn);
-            auto const& style =
-                characterStyle != iStyleMap.end() ? **characterStyle :
-                columnStyle.character().font() != std::nullopt ? columnStyle : iDefaultStyle;
-            return style.character().font() != std::nullopt ? style.character().font().value() : font();
+            return character_font(nextParagraph, aSourceIndex, columnDelimiters);
         };
         
         columnDelimiters.clear();
@@ -2696,6 +2955,31 @@ namespace neogfx
         refresh_columns();
     }
 
+    neogfx::font const& text_edit::character_font(document_text::const_iterator aParagraph, std::u32string::size_type aSourceIndex, column_delimiters const& aColumnDelimiters) const
+    {
+        auto characterStyle = iStyleMap.find(std::next(aParagraph, aSourceIndex)->style);
+        std::size_t indexColumn = std::lower_bound(aColumnDelimiters.begin(), aColumnDelimiters.end(),
+            static_cast<std::u32string::difference_type>(aSourceIndex)) - aColumnDelimiters.begin();
+        if (indexColumn > columns() - 1)
+            indexColumn = columns() - 1;
+        auto const& columnStyle = column_style(indexColumn);
+        auto const& style =
+            characterStyle != iStyleMap.end() ? **characterStyle :
+            columnStyle.character().font() != std::nullopt ? columnStyle : iDefaultStyle;
+        return style.character().font() != std::nullopt ? style.character().font().value() : font();
+    }
+
+    bool text_edit::shaping_in_progress() const
+    {
+        return iParagraphShaper != nullptr && !iParagraphShaper->finished();
+    }
+
+    void text_edit::finish_shaping()
+    {
+        if (shaping_in_progress())
+            iParagraphShaper->finish();
+    }
+
     void text_edit::refresh_columns()
     {
         iTextExtents = std::nullopt;
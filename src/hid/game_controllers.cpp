@@ -202,7 +202,7 @@ namespace neogfx
     void game_controllers::load_database()
     {
         auto resource = service<i_resource_manager>().load_resource(game_controller_database_uri());
-        std::istringstream lines{ std::string{ static_cast<const char*>(resource->data()), resource->size() } };
+        std::istringstream lines{ std::string{ static_cast<const char*>(resource->cdata()), resource->size() } };
         std::string line;
         while (std::getline(lines, line))
         {
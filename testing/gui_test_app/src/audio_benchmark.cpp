@@ -0,0 +1,338 @@
+﻿#include <neogfx/neogfx.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <numbers>
+
+#include <neogfx/audio/audio_mixer.hpp>
+#include <neogfx/audio/audio_waveform.hpp>
+#include <neogfx/audio/audio_oscillator.hpp>
+#include <neogfx/audio/audio_instrument_atlas.hpp>
+#include <neogfx/audio/audio_resampler.hpp>
+#include <neogfx/audio/audio_instrument.hpp>
+#include <neogfx/audio/audio_track.hpp>
+#include <neogfx/audio/audio_renderer.hpp>
+#include <neogfx/audio/audio_graph.hpp>
+#include <neogfx/audio/audio_nodes.hpp>
+#include <neogfx/audio/audio_capture.hpp>
+#include <neogfx/audio/audio_meter.hpp>
+
+#include "test.hpp"
+
+namespace
+{
+    // Mixes 64 oscillators of each function into a 48 kHz stereo buffer and reports how many such voices one core
+    // could sustain in real time.
+    void oscillator_benchmark()
+    {
+        ng::audio_sample_rate const sampleRate = 48000u;
+        std::uint32_t const voiceCount = 64u;
+        ng::audio_frame_count const blockSize = 512u;
+        ng::audio_frame_count const totalFrames = sampleRate * 10u;
+        std::pair<ng::oscillator_function, char const*> const functions[] = {
+            { ng::oscillator_function::Sine, "sine" },
+            { ng::oscillator_function::Square, "square" },
+            { ng::oscillator_function::Triangle, "triangle" },
+            { ng::oscillator_function::Sawtooth, "sawtooth" } };
+
+        std::cout << std::left << std::setw(12) << "function" << std::setw(16) << "ns/sample" << "voices/core" << std::endl;
+        for (auto const& function : functions)
+        {
+            std::vector<ng::ref_ptr<ng::audio_oscillator>> oscillators;
+            for (std::uint32_t v = 0u; v < voiceCount; ++v)
+                oscillators.push_back(ng::make_ref<ng::audio_oscillator>(sampleRate, 110.0f + 27.5f * v, 1.0f, function.first));
+            std::vector<float> output(static_cast<std::size_t>(blockSize * 2u));
+            auto const start = std::chrono::steady_clock::now();
+            for (ng::audio_frame_count frame = 0u; frame < totalFrames; frame += blockSize)
+            {
+                std::fill(output.begin(), output.end(), 0.0f);
+                for (auto const& o : oscillators)
+                    o->mix(blockSize, 1.0f / voiceCount, 2u, output.data());
+            }
+            std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start;
+            auto const samples = static_cast<double>(totalFrames) * voiceCount;
+            std::cout << std::left << std::setw(12) << function.second <<
+                std::setw(16) << std::fixed << std::setprecision(3) << 1e9 * elapsed.count() / samples <<
+                std::setprecision(0) << samples / sampleRate / elapsed.count() << std::endl;
+        }
+        std::cout << std::endl;
+    }
+
+    // Resamples a 44.1 kHz sine to 48 kHz at pitch ratios across the keyboard, reporting the cost and the error
+    // against the exact signal.
+    void resampler_benchmark()
+    {
+        double const sourceRate = 44100.0;
+        double const outputRate = 48000.0;
+        double const frequency = 1000.0;
+        std::vector<float> source(static_cast<std::size_t>(sourceRate * 10.0));
+        for (std::size_t i = 0u; i < source.size(); ++i)
+            source[i] = static_cast<float>(std::sin(2.0 * std::numbers::pi * frequency * i / sourceRate));
+        double const semitones[] = { -24.0, -12.0, -1.0, 0.0, 1.0, 7.0, 12.0 };
+
+        std::cout << std::left << std::setw(12) << "semitones" << std::setw(16) << "ns/frame" << "SNR (dB)" << std::endl;
+        for (auto semitone : semitones)
+        {
+            auto const pitch = std::pow(2.0, semitone / 12.0);
+            ng::audio_resampler const resampler{ pitch * sourceRate / outputRate };
+            std::vector<float> output(static_cast<std::size_t>(resampler.length(source.size())));
+            auto const start = std::chrono::steady_clock::now();
+            resampler.generate_from(source, 0u, output.size(), output.data());
+            std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start;
+            double signal = 0.0;
+            double noise = 0.0;
+            // away from the ends, where the kernel runs off the source
+            for (std::size_t i = 1000u; i + 1000u < output.size(); ++i)
+            {
+                auto const exact = std::sin(2.0 * std::numbers::pi * frequency * pitch * i / outputRate);
+                signal += exact * exact;
+                noise += (output[i] - exact) * (output[i] - exact);
+            }
+            std::cout << std::left << std::setw(12) << semitone <<
+                std::setw(16) << std::fixed << std::setprecision(3) << 1e9 * elapsed.count() / output.size() <<
+                std::setprecision(1) << 10.0 * std::log10(signal / noise) << std::endl;
+        }
+        std::cout << std::endl;
+    }
+
+    // Renders compositions of 100 to 100000 short pure tone notes, reporting the cost of a block, which should not
+    // depend on the length of the composition.
+    void composition_benchmark()
+    {
+        ng::audio_sample_rate const sampleRate = 48000u;
+        ng::audio_frame_count const blockSize = 512u;
+        std::size_t const noteCounts[] = { 100u, 10000u, 100000u };
+
+        std::cout << std::left << std::setw(12) << "notes" << "us/block" << std::endl;
+        for (auto noteCount : noteCounts)
+        {
+            ng::audio_instrument instrument{ sampleRate, ng::instrument::PureTone };
+            instrument.set_envelope(ng::adsr_envelope{ 0.01f, 0.02f, 0.7f, 0.05f });
+            for (std::size_t n = 0u; n < noteCount; ++n)
+                instrument.play_note(static_cast<ng::note>(static_cast<std::uint32_t>(ng::note::C4) + n % 12u), std::chrono::duration<double>{ 0.1 });
+            std::vector<float> output(static_cast<std::size_t>(blockSize * 2u));
+            // one second from the middle of the composition
+            auto const first = instrument.length() / 2u;
+            ng::audio_frame_count blocks = 0u;
+            auto const start = std::chrono::steady_clock::now();
+            for (auto frame = first; frame < first + sampleRate; frame += blockSize, ++blocks)
+            {
+                std::fill(output.begin(), output.end(), 0.0f);
+                instrument.generate_from(ng::audio_channel::Left | ng::audio_channel::Right, frame, blockSize, output.data());
+            }
+            std::chrono::duration<double, std::micro> const elapsed = std::chrono::steady_clock::now() - start;
+            std::cout << std::left << std::setw(12) << noteCount << std::fixed << std::setprecision(3) << elapsed.count() / blocks << std::endl;
+        }
+        std::cout << std::endl;
+    }
+
+    // Processes ten seconds of four independent chains (oscillators, filter, pan, delay and reverb send into a
+    // limiter) single threaded and on the thread pool, then reports each node's share of a block.
+    void graph_benchmark()
+    {
+        ng::audio_sample_rate const sampleRate = 48000u;
+        ng::audio_frame_count const blockSize = 256u;
+        ng::audio_frame_count const totalFrames = sampleRate * 10u;
+        std::size_t const chainCount = 4u;
+
+        ng::audio_graph graph{ sampleRate, blockSize };
+        std::vector<ng::ref_ptr<ng::audio_waveform>> waveforms;
+        for (std::size_t c = 0u; c < chainCount; ++c)
+        {
+            waveforms.push_back(ng::make_ref<ng::audio_waveform>(sampleRate, 0.25f));
+            for (std::size_t o = 0u; o < 8u; ++o)
+                waveforms.back()->create_oscillator(110.0f * (c + 1u) + 55.0f * o, 0.125f, ng::oscillator_function::Sawtooth);
+            auto& source = graph.add<ng::audio_source_node>(*waveforms.back());
+            auto& filter = graph.add<ng::audio_biquad_node>(ng::audio_filter_type::LowPass, 2000.0f, 0.9f);
+            auto& pan = graph.add<ng::audio_pan_node>(-0.75f + 0.5f * c);
+            auto& delay = graph.add<ng::audio_delay_node>(1.0f, 0.25f, 0.4f, 0.3f);
+            auto& reverb = graph.add<ng::audio_reverb_node>(0.3f);
+            auto& limiter = graph.add<ng::audio_limiter_node>(0.9f);
+            graph.connect(source, filter);
+            graph.connect(filter, pan);
+            graph.connect(pan, delay);
+            graph.connect(pan, reverb);
+            graph.connect(delay, limiter);
+            graph.connect(reverb, limiter);
+        }
+        graph.prepare();
+
+        std::vector<float> output(static_cast<std::size_t>(blockSize * 2u));
+        std::cout << std::left << std::setw(16) << "threads" << "us/block" << std::endl;
+        for (bool multithreaded : { false, true })
+        {
+            graph.set_multithreaded(multithreaded);
+            graph.reset();
+            graph.reset_timings();
+            auto const start = std::chrono::steady_clock::now();
+            for (ng::audio_frame_count frame = 0u; frame < totalFrames; frame += blockSize)
+                graph.process(output.data(), blockSize);
+            std::chrono::duration<double, std::micro> const elapsed = std::chrono::steady_clock::now() - start;
+            std::cout << std::left << std::setw(16) << (multithreaded ? "pool" : "1") <<
+                std::fixed << std::setprecision(3) << elapsed.count() * blockSize / totalFrames << std::endl;
+        }
+        std::cout << std::endl;
+
+        // the chains are alike so the first one is representative
+        auto const nodes = graph.nodes();
+        std::cout << std::left << std::setw(16) << "node" << "us/block" << std::endl;
+        for (std::size_t n = 0u; n < nodes.size() / chainCount; ++n)
+        {
+            auto const timing = graph.timing(*nodes[n]);
+            auto const* node = nodes[n];
+            std::cout << std::left << std::setw(16) << node->name() << std::fixed << std::setprecision(3) <<
+                std::chrono::duration<double, std::micro>{ timing.total }.count() / timing.blocks << std::endl;
+        }
+        std::cout << std::endl;
+    }
+
+    // Passes ten seconds of a -6 dBFS 1 kHz stereo sine through a capture buffer in 512 frame callbacks, reporting
+    // the cost on the audio thread (write) and on the consumer (metering and spectrum) and the resulting readings.
+    void capture_benchmark()
+    {
+        ng::audio_data_format const dataFormat{ ng::audio_sample_format::F32, 2u, 48000u };
+        ng::audio_frame_count const blockSize = 512u;
+        ng::audio_frame_count const totalFrames = dataFormat.sampleRate * 10u;
+
+        ng::audio_capture capture{ dataFormat };
+        ng::audio_level_meter meter{ 2u, dataFormat.sampleRate };
+        ng::audio_spectrum spectrum{ 2u, dataFormat.sampleRate };
+        std::vector<float> input(static_cast<std::size_t>(blockSize * 2u));
+        std::vector<float> output(input.size());
+        std::chrono::duration<double, std::nano> writing{};
+        std::chrono::duration<double, std::nano> metering{};
+        std::chrono::duration<double, std::nano> analysing{};
+        for (ng::audio_frame_count frame = 0u; frame < totalFrames; frame += blockSize)
+        {
+            for (std::size_t i = 0u; i < blockSize; ++i)
+                input[i * 2u] = input[i * 2u + 1u] = static_cast<float>(0.5 * std::sin(2.0 * std::numbers::pi * 1000.0 * (frame + i) / dataFormat.sampleRate));
+            auto const start = std::chrono::steady_clock::now();
+            capture.write(input.data(), blockSize);
+            auto const written = std::chrono::steady_clock::now();
+            auto const frames = capture.read(output.data(), blockSize);
+            meter.process(output.data(), frames);
+            auto const metered = std::chrono::steady_clock::now();
+            spectrum.process(output.data(), frames);
+            auto const analysed = std::chrono::steady_clock::now();
+            writing += written - start;
+            metering += metered - written;
+            analysing += analysed - metered;
+        }
+        auto const magnitudes = spectrum.magnitudes();
+        auto const loudest = std::distance(magnitudes.begin(), std::max_element(magnitudes.begin(), magnitudes.end()));
+
+        std::cout << std::left << std::setw(16) << "write ns/frame" << std::setw(16) << "meter ns/frame" << "spectrum ns/frame" << std::endl;
+        std::cout << std::left << std::fixed << std::setprecision(3) << std::setw(16) << writing.count() / totalFrames <<
+            std::setw(16) << metering.count() / totalFrames << analysing.count() / totalFrames << std::endl;
+        std::cout << "peak " << std::setprecision(2) << ng::audio_level_meter::to_decibels(meter.channel(0u).peak) <<
+            " dB, RMS " << ng::audio_level_meter::to_decibels(meter.channel(0u).rms) << " dB, loudest bin " <<
+            std::setprecision(0) << spectrum.bin_frequency(static_cast<std::size_t>(loudest)) << " Hz, overruns " << capture.overruns() << std::endl;
+        std::cout << std::endl;
+    }
+}
+
+// Runs the oscillator, resampler, composition, graph and capture benchmarks and then renders ten seconds of 1-64
+// sine voices through the mixer into memory (no device) at typical callback sizes, reporting the cost of each
+// callback relative to the audio it produced and how many callbacks went over budget.
+int audio_benchmark()
+{
+    oscillator_benchmark();
+    resampler_benchmark();
+    composition_benchmark();
+    graph_benchmark();
+    capture_benchmark();
+
+    ng::audio_data_format const dataFormat{ ng::audio_sample_format::F32, 2u, 48000u };
+    std::uint32_t const voiceCounts[] = { 1u, 8u, 32u, 64u };
+    ng::audio_frame_count const blockSizes[] = { 128u, 512u, 2048u };
+    ng::audio_frame_count const totalFrames = dataFormat.sampleRate * 10u;
+
+    std::cout << std::left << std::setw(8) << "voices" << std::setw(8) << "block" << std::setw(16) << "us/block" << std::setw(12) << "% of budget" << "over budget" << std::endl;
+    for (auto voiceCount : voiceCounts)
+        for (auto blockSize : blockSizes)
+        {
+            ng::audio_mixer mixer{ dataFormat, voiceCount };
+            std::vector<ng::ref_ptr<ng::audio_waveform>> waveforms;
+            for (std::uint32_t v = 0u; v < voiceCount; ++v)
+            {
+                waveforms.push_back(ng::make_ref<ng::audio_waveform>(dataFormat.sampleRate, 1.0f / voiceCount));
+                waveforms.back()->create_oscillator(220.0f + 55.0f * v);
+                mixer.play(*waveforms.back(), totalFrames);
+            }
+            std::vector<float> output(static_cast<std::size_t>(blockSize * dataFormat.channels));
+            std::chrono::duration<double, std::micro> elapsed{};
+            ng::audio_frame_count blocks = 0u;
+            for (ng::audio_frame_count frame = 0u; frame < totalFrames; frame += blockSize, ++blocks)
+            {
+                auto const start = std::chrono::steady_clock::now();
+                mixer.mix(output.data(), blockSize);
+                elapsed += std::chrono::steady_clock::now() - start;
+            }
+            auto const perBlock = elapsed.count() / blocks;
+            auto const budget = 1e6 * blockSize / dataFormat.sampleRate;
+            std::cout << std::left << std::setw(8) << voiceCount << std::setw(8) << blockSize <<
+                std::setw(16) << std::fixed << std::setprecision(3) << perBlock <<
+                std::setw(12) << std::setprecision(2) << 100.0 * perBlock / budget << mixer.overbudget_callbacks() << std::endl;
+        }
+    return EXIT_SUCCESS;
+}
+
+// The offline bake step: writes the sample bank of every instrument in music.zip so that no instrument has to be
+// baked when it is first played.
+int bake_instruments()
+{
+    ng::audio_instrument_atlas atlas;
+    for (auto id = static_cast<std::uint32_t>(ng::instrument::AcousticGrandPiano); id <= static_cast<std::uint32_t>(ng::instrument::Gunshot); ++id)
+    {
+        auto const instrument = static_cast<ng::instrument>(id);
+        auto const start = std::chrono::steady_clock::now();
+        if (!atlas.bake_instrument(instrument))
+            continue;
+        std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << std::left << std::setw(32) << ng::to_string(instrument) <<
+            std::fixed << std::setprecision(2) << elapsed.count() << " s" << std::endl;
+    }
+    return EXIT_SUCCESS;
+}
+
+// Renders two minutes of 16 tracks of pure tone compositions and waveforms offline, single threaded and on the thread
+// pool, reporting the real time factor of each and checking that both produce the same samples. The output is
+// written to aOutputFile as a 16 bit WAV if given.
+int render_benchmark(std::optional<std::string> const& aOutputFile)
+{
+    ng::audio_data_format const dataFormat{ ng::audio_sample_format::S16, 2u, 48000u };
+    std::size_t const trackCount = 16u;
+    ng::audio_frame_count const length = dataFormat.sampleRate * 120u;
+
+    ng::audio_renderer renderer{ dataFormat };
+    for (std::size_t t = 0u; t < trackCount; ++t)
+    {
+        auto track = ng::make_ref<ng::audio_track>(dataFormat.sampleRate, 1.0f / trackCount);
+        auto instrument = ng::make_ref<ng::audio_instrument>(dataFormat.sampleRate, ng::instrument::PureTone);
+        instrument->set_envelope(ng::adsr_envelope{ 0.01f, 0.05f, 0.6f, 0.1f });
+        while (instrument->length() < length)
+            instrument->play_note(static_cast<ng::note>(static_cast<std::uint32_t>(ng::note::C3) + (t * 7u + instrument->length() / 12000u) % 36u), std::chrono::duration<double>{ 0.25 });
+        track->add_clip(instrument, 0u);
+        auto waveform = ng::make_ref<ng::audio_waveform>(dataFormat.sampleRate, 0.25f);
+        waveform->create_oscillator(55.0f * (1u + t % 4u), 1.0f, ng::oscillator_function::Sawtooth);
+        track->add_clip(waveform, 0u, length);
+        renderer.add_track(track);
+    }
+
+    std::vector<float> singleThreaded;
+    std::vector<float> multithreaded;
+    renderer.set_multithreaded(false);
+    auto const single = renderer.render(singleThreaded);
+    renderer.set_multithreaded(true);
+    auto const multi = renderer.render(multithreaded);
+    std::cout << std::left << std::setw(16) << "threads" << std::setw(16) << "seconds" << "real time factor" << std::endl;
+    std::cout << std::left << std::setw(16) << "1" << std::setw(16) << std::fixed << std::setprecision(3) << single.elapsed.count() << std::setprecision(1) << single.realTimeFactor << std::endl;
+    std::cout << std::left << std::setw(16) << "pool" << std::setw(16) << std::fixed << std::setprecision(3) << multi.elapsed.count() << std::setprecision(1) << multi.realTimeFactor << std::endl;
+    bool const deterministic = (singleThreaded == multithreaded);
+    std::cout << "output " << (deterministic ? "identical" : "DIFFERS") << std::endl;
+    if (aOutputFile)
+        renderer.render(*aOutputFile, ng::audio_file_format::Wav);
+    return deterministic ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,120 @@
+﻿#include <neogfx/neogfx.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+
+#include <neolib/core/random.hpp>
+
+#include <neogfx/game/ecs.hpp>
+#include <neogfx/game/ecs_helpers.hpp>
+#include <neogfx/game/standard_archetypes.hpp>
+#include <neogfx/game/game_world.hpp>
+#include <neogfx/game/simple_physics.hpp>
+#include <neogfx/game/collision_detector.hpp>
+
+#include "test.hpp"
+
+namespace
+{
+    ng::game::sprite_2d_archetype const benchmarkCollider{ "BenchmarkCollider" };
+
+    char const* to_string(ng::game::broadphase_type aBroadphase)
+    {
+        switch (aBroadphase)
+        {
+        case ng::game::broadphase_type::Tree:
+            return "quadtree";
+        case ng::game::broadphase_type::SortAndSweep:
+            return "sort and sweep";
+        case ng::game::broadphase_type::DynamicAabbTree:
+            return "dynamic AABB tree";
+        default:
+            return "?";
+        }
+    }
+}
+
+// Moves 10k-200k colliders around a world for a number of cycles with each broadphase and delivery in turn, timing
+// tree update plus pair generation (collider AABB updates are identical for all broadphases so are excluded).
+int broadphase_benchmark()
+{
+    std::uint32_t const colliderCounts[] = { 10'000u, 50'000u, 100'000u, 200'000u };
+    ng::game::broadphase_type const broadphases[] =
+    {
+        ng::game::broadphase_type::Tree,
+        ng::game::broadphase_type::SortAndSweep,
+        ng::game::broadphase_type::DynamicAabbTree
+    };
+    ng::game::collision_delivery const deliveries[] =
+    {
+        ng::game::collision_delivery::PerPair,
+        ng::game::collision_delivery::Batch
+    };
+    std::uint32_t const cycles = 60u;
+    float const worldExtent = 4000.0f;
+    float const timestep = 1.0f / 60.0f;
+
+    std::cout << std::left << std::setw(12) << "colliders" << std::setw(20) << "broadphase" << std::setw(10) << "delivery" << std::setw(16) << "ms/cycle" << "pairs/cycle" << std::endl;
+    for (auto colliderCount : colliderCounts)
+        for (auto broadphase : broadphases)
+            for (auto delivery : deliveries)
+            {
+                neolib::basic_random<float> prng;
+                auto ecs = ng::game::make_ecs<ng::game::simple_physics>(ng::game::ecs_flags::Default | ng::game::ecs_flags::NoThreads);
+                ecs->component<ng::game::mesh_filter>();
+                ecs->component<ng::game::animation_filter>();
+                ecs->system<ng::game::game_world>().set_broadphase(broadphase);
+                auto& detector = ecs->system<ng::game::collision_detector>();
+                detector.set_collision_delivery(delivery);
+                std::uint64_t pairs = 0u;
+                ~~~~detector.Collision([&](ng::game::entity_id, ng::game::entity_id) { ++pairs; });
+                ~~~~detector.CollisionBatch([&](ng::game::collision_pairs const& aPairs) { pairs += aPairs.size(); });
+
+                for (std::uint32_t i = 0u; i < colliderCount; ++i)
+                {
+                    auto const size = prng(8.0f) + 4.0f;
+                    ecs->create_entity(
+                        benchmarkCollider,
+                        ng::to_ecs_component(ng::game_rect{ ng::size{ size, size } }.with_centered_origin()),
+                        ng::game::rigid_body
+                        {
+                            { prng(worldExtent * 2.0f) - worldExtent, prng(worldExtent * 2.0f) - worldExtent, 0.0f }, 1.0f,
+                            { prng(100.0f) - 50.0f, prng(100.0f) - 50.0f, 0.0f }
+                        },
+                        ng::game::box_collider_2d{ 1ull << (i % 2u) });
+                }
+
+                std::chrono::duration<double, std::milli> elapsed{};
+                for (std::uint32_t cycle = 0u; cycle <= cycles; ++cycle)
+                {
+                    auto& bodies = ecs->component<ng::game::rigid_body>();
+                    for (auto entity : bodies.entities())
+                    {
+                        auto& body = bodies.entity_record(entity);
+                        body.position += body.velocity * timestep;
+                        if (std::abs(body.position.x) > worldExtent)
+                            body.velocity.x = -body.velocity.x;
+                        if (std::abs(body.position.y) > worldExtent)
+                            body.velocity.y = -body.velocity.y;
+                        detector.set_collider_dirty(entity);
+                    }
+                    detector.run_cycle(ng::game::collision_detection_cycle::UpdateColliders);
+                    if (cycle == 0u)
+                    {
+                        // initial build is not representative of steady state
+                        detector.run_cycle(ng::game::collision_detection_cycle::Detect);
+                        pairs = 0u;
+                        continue;
+                    }
+                    auto const start = std::chrono::steady_clock::now();
+                    detector.run_cycle(ng::game::collision_detection_cycle::Detect);
+                    elapsed += std::chrono::steady_clock::now() - start;
+                }
+
+                std::cout << std::left << std::setw(12) << colliderCount << std::setw(20) << to_string(broadphase) <<
+                    std::setw(10) << (delivery == ng::game::collision_delivery::Batch ? "batch" : "per pair") <<
+                    std::setw(16) << std::fixed << std::setprecision(3) << elapsed.count() / cycles << pairs / cycles << std::endl;
+            }
+    return EXIT_SUCCESS;
+}
@@ -40,15 +40,19 @@ namespace archetypes
     ng::game::animated_sprite_archetype const missileExplosion{ "MissileExplosion" };
 }
 
-ng::game::i_ecs& create_game(ng::i_layout& aLayout)
+ng::game::i_ecs& create_game(ng::i_layout& aLayout, bool aFrameScheduler)
 {
-    // Create an ECS and canvas to render game world on...
+    // Create an ECS and canvas to render game world on (without system threads if a frame scheduler is to apply the systems)...
+    auto const ecsFlags = aFrameScheduler ?
+        ng::game::ecs_flags::Default | ng::game::ecs_flags::CreatePaused | ng::game::ecs_flags::NoThreads :
+        ng::game::ecs_flags::Default | ng::game::ecs_flags::CreatePaused;
     auto& canvas = aLayout.add(
         ng::make_ref<ng::game::canvas>(
-            ng::game::make_ecs<ng::game::simple_physics>(ng::game::ecs_flags::Default | ng::game::ecs_flags::CreatePaused)));
+            ng::game::make_ecs<ng::game::simple_physics>(ecsFlags)));
     canvas.set_font(ng::font{ canvas.font(), ng::font_style::Bold, 16 });
     canvas.set_background_color(ng::color::Black);
     canvas.set_layers(4);
+    canvas.enable_sprite_packing();
 
     auto& ecs = canvas.ecs();
 
@@ -146,7 +150,7 @@ ng::game::i_ecs& create_game(ng::i_layout& aLayout)
             archetypes::asteroid,
             ng::game::mesh_renderer
             {
-                ng::game::material{ ng::to_ecs_component(ng::color::from_hsl(gameState->prng(360.0f), 1.0f, 0.75f)) }, {}, 1
+                ng::game::material{ ng::to_ecs_component(ng::color::from_hsl(gameState->prng(360.0f), 1.0f, 0.75f)) }, {}, 1, {}, false, true
             },
             make_asteroid_mesh(size),
             ng::game::rigid_body
@@ -178,9 +182,10 @@ ng::game::i_ecs& create_game(ng::i_layout& aLayout)
         filter.transformation = ng::mat44f::identity();
         filter.autoDestroy = true;
         ng::apply_scaling(*filter.transformation, ng::aabb_extents(target).max(ng::vec2f{ 16.0f, 16.0f }));
+        // explosions and missiles overlap in any order so they may be regrouped by texture to batch
         ecs.async_create_entity(
             color ? archetypes::missileExplosion : archetypes::explosion,
-            material,  
+            ng::game::mesh_renderer{ material, {}, 0, {}, false, true },
             filter,
             ng::game::rigid_body{ ng::aabb_origin(target), 1.0f, velocity },
             ng::game::box_collider_2d{ color ? 0x1ull : 0x2ull });
@@ -375,7 +380,7 @@ ng::game::i_ecs& create_game(ng::i_layout& aLayout)
                         auto missile = ecs.create_entity(
                             archetypes::missile,
                             ng::to_ecs_component(ng::rect{ ng::size{ 3.0, 3.0} }.with_centered_origin()),
-                            ng::game::material{ ng::to_ecs_component(ng::color{ rand() % 160 + 96, rand() % 160 + 96, rand() % 160 + 96 }), {}, {}, {} },
+                            ng::game::mesh_renderer{ ng::game::material{ ng::to_ecs_component(ng::color{ rand() % 160 + 96, rand() % 160 + 96, rand() % 160 + 96 }), {}, {}, {} }, {}, 0, {}, false, true },
                             ng::game::rigid_body
                             {
                                 spaceshipPhysics.position + ~(tm * ng::vec4f{ 0.0f, 18.0f, 0.0f, 1.0f }).xyz,
@@ -408,6 +413,7 @@ ng::game::i_ecs& create_game(ng::i_layout& aLayout)
             ng::game::scoped_component_lock<ng::game::rigid_body> lock{ canvas.ecs() };
             canvas.ecs().component<ng::game::rigid_body>().entity_record(spaceship).position = newPos.to_vec3();
             ng::game::set_render_cache_dirty(canvas.ecs(), spaceship);
+            canvas.ecs().system<ng::game::collision_detector>().set_collider_dirty(spaceship);
         }
     });
 
@@ -28,7 +28,22 @@ int main(int argc, char* argv[])
     egregious this function is a special case: it is test code which mostly just creates widgets. 
     Most of this code is about to disappear into code auto-generated by the neoGFX resource compiler! */
 
-    test::main_app app{ argc, argv, "neoGFX Test App (Pre-Release)" };
+    bool const broadphaseBenchmark = (argc > 1 && std::string{ argv[1] } == "--broadphase-benchmark");
+    bool const audioBenchmark = (argc > 1 && std::string{ argv[1] } == "--audio-benchmark");
+    bool const bakeInstruments = (argc > 1 && std::string{ argv[1] } == "--bake-instruments");
+    bool const renderBenchmark = (argc > 1 && std::string{ argv[1] } == "--render-benchmark");
+    bool const frameScheduler = (argc > 1 && std::string{ argv[1] } == "--frame-scheduler");
+
+    test::main_app app{ broadphaseBenchmark || audioBenchmark || bakeInstruments || renderBenchmark || frameScheduler ? 1 : argc, argv, "neoGFX Test App (Pre-Release)" };
+
+    if (broadphaseBenchmark)
+        return broadphase_benchmark();
+    if (audioBenchmark)
+        return audio_benchmark();
+    if (bakeInstruments)
+        return bake_instruments();
+    if (renderBenchmark)
+        return render_benchmark(argc > 2 ? std::optional<std::string>{ argv[2] } : std::nullopt);
 
     try
     {
@@ -1186,12 +1201,18 @@ int main(int argc, char* argv[])
 
         bool gameCreated = false;
         ng::game::i_ecs* gameEcs = nullptr;
+        std::optional<ng::game::frame_scheduler> gameScheduler;
         window.pageGame.VisibilityChanged([&]()
         {
             if (window.pageGame.visible() && !gameCreated)
             {
-                auto& ecs = create_game(window.layoutGame);
+                auto& ecs = create_game(window.layoutGame, frameScheduler);
                 gameEcs = &ecs;
+                if (frameScheduler)
+                {
+                    gameScheduler.emplace(ecs);
+                    gameScheduler->add_standard_systems();
+                }
                 auto& worldClock = ecs.shared_component<ng::game::clock>()[0];
                 window.sliderBoxTimestep.ValueChanged([&]() 
                 { 
@@ -1596,7 +1617,9 @@ int main(int argc, char* argv[])
             window.groupMeshShape.show(mouseOver);
             if (window.groupBox.is_checkable() && window.groupBox.check_box().is_checked())
                 window.update();
-            if (gameEcs)
+            if (gameScheduler)
+                gameScheduler->run_frame();
+            else if (gameEcs)
             {
                 if (gameEcs->system<ng::game::simple_physics>().can_apply())
                     gameEcs->system<ng::game::simple_physics>().apply();
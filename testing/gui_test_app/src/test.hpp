@@ -33,6 +33,7 @@
 #include <neogfx/game/mesh_render_cache.hpp>
 #include <neogfx/game/animator.hpp>
 #include <neogfx/game/time.hpp>
+#include <neogfx/game/frame_scheduler.hpp>
 
 #include "test.ui.hpp"
 
@@ -219,5 +220,9 @@ private:
     ng::text_edit& iTextEdit;
 };
 
-ng::game::i_ecs& create_game(ng::i_layout& aLayout);
+ng::game::i_ecs& create_game(ng::i_layout& aLayout, bool aFrameScheduler = false);
+int broadphase_benchmark();
+int audio_benchmark();
+int bake_instruments();
+int render_benchmark(std::optional<std::string> const& aOutputFile);
 